@@ -32,6 +32,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <map>
 #include "dirDiffPatch/dir_patch/dir_patch.h"
 
 #if (_IS_NEED_DIR_DIFF_PATCH)
@@ -158,20 +159,199 @@ static inline bool isMatchIgnoreList(const std::string& subPath,const std::vecto
     return false;
 }
 
+//compiled ignore path list, same match result as isMatchIgnoreList();
+//  all ignore paths saved in two prefix tries (float match & match from a name begin),
+//  a path matched with all ignore paths in one pass by a lazily built DFA.
+class CIgnorePathMatcher{
+public:
+    CIgnorePathMatcher():_isMatchAll(false),_isEmpty(true),_cachePrefixState(kNoState){
+        _nodes.resize(kRootCount);
+        _resetDFA();
+    }
+    void addIgnoreList(const std::vector<std::string>& ignoreList){
+        for (size_t i=0; i<ignoreList.size(); ++i)
+            _addIgnore(ignoreList[i]);
+        _resetDFA();
+    }
+    bool isMatch(const std::string& subPath){
+        if (_isMatchAll) return true;
+        if (_isEmpty) return false;
+        const size_t pathSize=subPath.size();
+        size_t prefixSize=(pathSize>1)?subPath.find_last_of(kPatch_dirSeparator,pathSize-2):std::string::npos;
+        prefixSize=(prefixSize==std::string::npos)?0:prefixSize+1; //parent dir with '/'
+        size_t state=kStartState;
+        size_t i=0;
+        if ((prefixSize>0)&&(_cachePrefixState!=kNoState)&&(prefixSize==_cachePrefix.size())&&(0==subPath.compare(0,prefixSize,_cachePrefix))){
+            state=_cachePrefixState; //parent dir is walked before its sub paths
+            i=prefixSize;
+        }
+        for (;i<pathSize;++i){
+            if (i==prefixSize){
+                _cachePrefix.assign(subPath,0,prefixSize);
+                _cachePrefixState=state;
+            }
+            size_t next=_dNext[state*kCharCount+(unsigned char)subPath[i]];
+            if (next==kNoState) next=_getNext(state,(unsigned char)subPath[i]);
+            if (next==kMatchedState) return true;
+            state=next;
+        }
+        return _dIsEndMatched[state];
+    }
+private:
+    enum { kAnyRoot=0, kNameRoot=1, kRootCount=2, kCharCount=256, kMaxDFAStateCount=1024*4 };
+    static const size_t kNoState=~(size_t)0;
+    static const size_t kMatchedState=kNoState-1;
+    static const size_t kStartState=0;
+    struct TNode{
+        std::vector<std::pair<unsigned char,size_t> > next; //by char
+        size_t      starNext; //by '*', 0 if none
+        bool        isStar;   //'*': loop by any char except dirSeparator
+        bool        isMatchAny; //matched, not care chars after
+        bool        isMatchEnd; //matched at path end or before a dirSeparator
+        TNode():starNext(0),isStar(false),isMatchAny(false),isMatchEnd(false){}
+    };
+    std::vector<TNode>  _nodes;
+    bool                _isMatchAll;
+    bool                _isEmpty;
+    //DFA
+    std::map<std::vector<size_t>,size_t> _dStateMap;
+    std::vector<const std::vector<size_t>*> _dStates;
+    std::vector<size_t> _dNext;
+    std::vector<bool>   _dIsEndMatched;
+    std::vector<size_t> _tempSet;
+    std::string         _cachePrefix;
+    size_t              _cachePrefixState; //DFA state after _cachePrefix, kNoState if DFA reset
+    
+    size_t _findNext(size_t node,unsigned char c)const{
+        const std::vector<std::pair<unsigned char,size_t> >& next=_nodes[node].next;
+        for (size_t i=0; i<next.size(); ++i){
+            if (next[i].first==c) return next[i].second;
+        }
+        return 0;
+    }
+    size_t _addNext(size_t node,unsigned char c){
+        size_t result=_findNext(node,c);
+        if (result) return result;
+        result=_nodes.size();
+        _nodes.push_back(TNode());
+        _nodes[node].next.push_back(std::make_pair(c,result));
+        return result;
+    }
+    size_t _addStarNext(size_t node){
+        if (_nodes[node].starNext) return _nodes[node].starNext;
+        size_t result=_nodes.size();
+        _nodes.push_back(TNode());
+        _nodes[result].isStar=true;
+        _nodes[node].starNext=result;
+        return result;
+    }
+    void _addIgnore(const std::string& ignore){ //ignore formated by _formatIgnorePathSet()
+        assert(!ignore.empty());
+        std::vector<std::string> matchs;
+        size_t cur=0;
+        while (cur<ignore.size()){
+            size_t clip=ignore.find(_private_kIgnoreMagicChar,cur);
+            if (clip==std::string::npos) clip=ignore.size();
+            if (cur<clip) matchs.push_back(ignore.substr(cur,clip-cur));
+            cur=clip+1;
+        }
+        if (matchs.empty()) { _isMatchAll=true; return; } // WARNING : match any path
+        _isEmpty=false;
+        const bool isFrontAny=(ignore[0]==_private_kIgnoreMagicChar)||(matchs[0][0]==kPatch_dirSeparator);
+        const bool isBackAny=(ignore[ignore.size()-1]==_private_kIgnoreMagicChar)
+                                ||(matchs.back()[matchs.back().size()-1]==kPatch_dirSeparator);
+        size_t node=isFrontAny?kAnyRoot:kNameRoot;
+        for (size_t m=0; m<matchs.size(); ++m){
+            if (m>0) node=_addStarNext(node);
+            const std::string& match=matchs[m];
+            for (size_t i=0; i<match.size(); ++i)
+                node=_addNext(node,(unsigned char)match[i]);
+        }
+        if (isBackAny)
+            _nodes[node].isMatchAny=true;
+        else
+            _nodes[node].isMatchEnd=true;
+    }
+    
+    void _resetDFA(){
+        _dStateMap.clear();
+        _dStates.clear();
+        _dNext.clear();
+        _dIsEndMatched.clear();
+        _cachePrefixState=kNoState;
+        _tempSet.clear();
+        _tempSet.push_back(kAnyRoot);
+        _tempSet.push_back(kNameRoot);
+        _addDState(_tempSet); //kStartState
+    }
+    size_t _addDState(const std::vector<size_t>& nodeSet){
+        size_t result=_dStates.size();
+        std::map<std::vector<size_t>,size_t>::iterator it=
+                _dStateMap.insert(std::make_pair(nodeSet,result)).first;
+        _dStates.push_back(&it->first);
+        _dNext.resize(_dNext.size()+kCharCount,(size_t)kNoState);
+        bool isEndMatched=false;
+        for (size_t i=0; i<nodeSet.size(); ++i)
+            isEndMatched|=_nodes[nodeSet[i]].isMatchEnd;
+        _dIsEndMatched.push_back(isEndMatched);
+        return result;
+    }
+    size_t _getNext(size_t state,unsigned char c){
+        const bool isDirSeparator=(c==kPatch_dirSeparator);
+        const std::vector<size_t>& nodeSet=*_dStates[state];
+        size_t result=kMatchedState;
+        _tempSet.clear();
+        for (size_t i=0; i<nodeSet.size(); ++i){
+            const TNode& node=_nodes[nodeSet[i]];
+            if (isDirSeparator&&node.isMatchEnd) goto _out_set;
+            if (node.isStar&&(!isDirSeparator)) _tempSet.push_back(nodeSet[i]);
+            size_t next=_findNext(nodeSet[i],c);
+            if (next){
+                if (_nodes[next].isMatchAny) goto _out_set;
+                _tempSet.push_back(next);
+                if (_nodes[next].starNext) _tempSet.push_back(_nodes[next].starNext); //'*' can match empty
+            }
+        }
+        _tempSet.push_back(kAnyRoot);
+        if (isDirSeparator) _tempSet.push_back(kNameRoot);
+        std::sort(_tempSet.begin(),_tempSet.end());
+        _tempSet.erase(std::unique(_tempSet.begin(),_tempSet.end()),_tempSet.end());
+        {
+            std::map<std::vector<size_t>,size_t>::const_iterator it=_dStateMap.find(_tempSet);
+            if (it!=_dStateMap.end()){
+                result=it->second;
+            }else{
+                if (_dStates.size()>=kMaxDFAStateCount){ // limit memory, rebuild DFA
+                    std::vector<size_t> nextSet;
+                    nextSet.swap(_tempSet);
+                    _resetDFA();
+                    return _addDState(nextSet);
+                }
+                result=_addDState(_tempSet);
+            }
+        }
+    _out_set:
+        _dNext[state*kCharCount+c]=result;
+        return result;
+    }
+};
+
 struct CDirPathIgnore{
     CDirPathIgnore(const std::vector<std::string>& ignorePathListBase,
                    const std::vector<std::string>& ignorePathList,bool isPrintIgnore)
-    :_ignorePathListBase(ignorePathListBase),_ignorePathList(ignorePathList),
-    _isPrintIgnore(isPrintIgnore),_ignoreCount(0){ }
+    :_isPrintIgnore(isPrintIgnore),_ignoreCount(0){
+        _matcher.addIgnoreList(ignorePathListBase);
+        if (&ignorePathListBase!=&ignorePathList)
+            _matcher.addIgnoreList(ignorePathList);
+    }
     CDirPathIgnore(const std::vector<std::string>& ignorePathList,bool isPrintIgnore)
-    :_ignorePathListBase(ignorePathList),_ignorePathList(ignorePathList),
-    _isPrintIgnore(isPrintIgnore),_ignoreCount(0){ }
+    :_isPrintIgnore(isPrintIgnore),_ignoreCount(0){
+        _matcher.addIgnoreList(ignorePathList);
+    }
     bool isNeedIgnore(const std::string& path,size_t rootPathNameLen){
-        std::string subPath(path.begin()+rootPathNameLen,path.end());
-        formatIgnorePathName(subPath);
-        bool result=   isMatchIgnoreList(subPath,_ignorePathListBase);
-        if ((!result)&&(&_ignorePathListBase!=&_ignorePathList))
-            result=isMatchIgnoreList(subPath,_ignorePathList);
+        _subPath.assign(path.begin()+rootPathNameLen,path.end());
+        formatIgnorePathName(_subPath);
+        bool result=_matcher.isMatch(_subPath);
         if (result) ++_ignoreCount;
         if (result&&_isPrintIgnore){ //printf
             printf("  ignore file : \"");
@@ -181,8 +361,8 @@ struct CDirPathIgnore{
     }
     inline size_t ignoreCount()const{ return _ignoreCount; }
 private:
-    const std::vector<std::string>& _ignorePathListBase;
-    const std::vector<std::string>& _ignorePathList;
+    CIgnorePathMatcher              _matcher;
+    std::string                     _subPath;
     const bool                      _isPrintIgnore;
     size_t                          _ignoreCount;
 };
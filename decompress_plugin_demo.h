@@ -62,19 +62,175 @@
 #define _dec_onDecErr_rt()  do { if (!(self)->decError) (self)->decError=hpatch_dec_error;  return 0; } while(0)
 #define _dec_onDecErr_up()  do { if ((self)->decError) _hpatch_update_decError(decompressPlugin,(self)->decError); } while(0)
 
-static void* _dec_malloc(hpatch_size_t size) {
-    void* result=malloc(size);
-    if (!result) LOG_ERRNO(errno);
-    return result;
+//decompressor context pool:
+//  if opened, the memory of closed decompressors (handle & codec state & dict window) is cached
+//  by (plugin,size), and reused at next open; the same plugin with the same dictSize requests
+//  the same memory sizes, so a process decompress many times (dir patch with segmented hdiffData
+//  reopen decompressors for every segment, patch server, batch patch, sync with many files by
+//  dict plugins alloc with _dec_malloc) not need malloc again for every open.
+//  default closed; hpatch_decompressPool_open() before patch, hpatch_decompressPool_close() at end.
+typedef struct hpatch_TDecompressPoolInfo{
+    hpatch_StreamPos_t  mallocCount; //real malloc count when pool opened
+    hpatch_StreamPos_t  reuseCount;  //alloc from pool cache count
+    hpatch_StreamPos_t  freeCount;   //real free count when pool opened
+    size_t              cachedSize;  //memory size now cached in pool
+    size_t              maxCachedSize;
+    size_t              usedSize;    //memory size now used by opened decompressors
+    size_t              maxUsedSize; //peak of usedSize, decompressors's dict & state opened at same time
+} hpatch_TDecompressPoolInfo;
+
+#ifndef kDecompressPoolMaxCachedSize_default
+#   define kDecompressPoolMaxCachedSize_default ((size_t)1<<23) //min cap when opened by maxCachedSize==0
+#endif
+
+#if (_IS_USED_MULTITHREAD)
+#   include "libParallel/parallel_import_c.h"
+#endif
+typedef void (*_dec_TPoolKeepObjFree)(void* mem);
+typedef union _dec_TPoolNode{
+    struct{
+        union _dec_TPoolNode*   next;
+        const void*             key; //plugin, or codec alloc function's tag
+        _dec_TPoolKeepObjFree   keepObjFree; //not null when mem keep a codec object for reuse
+        size_t                  size;
+    } h;
+    hpatch_StreamPos_t  _align[4];
+} _dec_TPoolNode;
+static struct{
+    _dec_TPoolNode*     cached;
+    hpatch_BOOL         isOpened;
+    hpatch_BOOL         isAutoMaxCachedSize;
+    hpatch_TDecompressPoolInfo info;
+#if (_IS_USED_MULTITHREAD)
+    HLocker             locker;
+#endif
+} _dec_pool={0};
+#if (_IS_USED_MULTITHREAD)
+#   define _dec_pool_lock()     do { if (_dec_pool.locker) c_locker_enter(_dec_pool.locker); } while(0)
+#   define _dec_pool_unlock()   do { if (_dec_pool.locker) c_locker_leave(_dec_pool.locker); } while(0)
+#else
+#   define _dec_pool_lock()
+#   define _dec_pool_unlock()
+#endif
+
+hpatch_inline static void _dec_pool_freeNode(_dec_TPoolNode* node){
+    if (node->h.keepObjFree)
+        node->h.keepObjFree(node+1);
+    free(node);
+}
+//key: same key & size can reuse;
+//*out_isReused: if keepObjFree!=0 & reused, the codec object saved in mem is still alive
+hpatch_inline static
+void* _dec_pool_malloc(const void* key,_dec_TPoolKeepObjFree keepObjFree,hpatch_size_t size,hpatch_BOOL* out_isReused){
+    _dec_TPoolNode* node=0;
+    if (_dec_pool.isOpened){
+        _dec_TPoolNode** pnode;
+        _dec_pool_lock();
+        for (pnode=&_dec_pool.cached;(*pnode)!=0;pnode=&(*pnode)->h.next){
+            if (((*pnode)->h.key==key)&&((*pnode)->h.size==size)&&((*pnode)->h.keepObjFree==keepObjFree)){
+                node=*pnode;
+                *pnode=node->h.next;
+                _dec_pool.info.cachedSize-=size;
+                ++_dec_pool.info.reuseCount;
+                break;
+            }
+        }
+        if (!node) ++_dec_pool.info.mallocCount;
+        _dec_pool.info.usedSize+=size;
+        if (_dec_pool.info.maxUsedSize<_dec_pool.info.usedSize){
+            _dec_pool.info.maxUsedSize=_dec_pool.info.usedSize;
+            if (_dec_pool.isAutoMaxCachedSize&&(_dec_pool.info.maxCachedSize<_dec_pool.info.maxUsedSize))
+                _dec_pool.info.maxCachedSize=_dec_pool.info.maxUsedSize; //cap grow by dictSize
+        }
+        _dec_pool_unlock();
+    }
+    if (out_isReused) *out_isReused=(node!=0);
+    if (!node){
+        node=(_dec_TPoolNode*)malloc(sizeof(_dec_TPoolNode)+size);
+        if (!node){ LOG_ERRNO(errno); return 0; }
+        node->h.key=key;
+        node->h.keepObjFree=keepObjFree;
+        node->h.size=size;
+    }
+    node->h.next=0;
+    return node+1;
+}
+hpatch_inline static void _dec_pool_free(void* mem){
+    _dec_TPoolNode* node;
+    if (!mem) return;
+    node=((_dec_TPoolNode*)mem)-1;
+    if (_dec_pool.isOpened){
+        _dec_pool_lock();
+        if (_dec_pool.info.usedSize>=node->h.size) //else malloced before pool opened
+            _dec_pool.info.usedSize-=node->h.size;
+        if (node->h.size<=_dec_pool.info.maxCachedSize-_dec_pool.info.cachedSize){
+            node->h.next=_dec_pool.cached;
+            _dec_pool.cached=node;
+            _dec_pool.info.cachedSize+=node->h.size;
+            node=0;
+        }else{
+            ++_dec_pool.info.freeCount;
+        }
+        _dec_pool_unlock();
+    }
+    if (node) _dec_pool_freeNode(node);
+}
+
+//maxCachedSize: max memory size kept by the pool;
+//  can 0 for auto: cap=max(8MB,info.maxUsedSize), so cache all decompressors opened at same time
+//  whatever their dictSize (lzma's 8MB dict + state > 8MB), not need more memory than peak used.
+hpatch_inline static hpatch_BOOL hpatch_decompressPool_open(size_t maxCachedSize){
+    if (_dec_pool.isOpened) return hpatch_TRUE;
+    memset(&_dec_pool.info,0,sizeof(_dec_pool.info));
+    _dec_pool.isAutoMaxCachedSize=(maxCachedSize==0);
+    _dec_pool.info.maxCachedSize=maxCachedSize?maxCachedSize:kDecompressPoolMaxCachedSize_default;
+#if (_IS_USED_MULTITHREAD)
+    _dec_pool.locker=c_locker_new();
+    if (!_dec_pool.locker) return hpatch_FALSE;
+#endif
+    _dec_pool.isOpened=hpatch_TRUE;
+    return hpatch_TRUE;
+}
+//free all cached memory; decompressors still opened can be closed after pool closed
+hpatch_inline static void hpatch_decompressPool_close(void){
+    if (!_dec_pool.isOpened) return;
+    _dec_pool.isOpened=hpatch_FALSE;
+    while (_dec_pool.cached){
+        _dec_TPoolNode* node=_dec_pool.cached;
+        _dec_pool.cached=node->h.next;
+        _dec_pool.info.cachedSize-=node->h.size;
+        ++_dec_pool.info.freeCount;
+        _dec_pool_freeNode(node);
+    }
+#if (_IS_USED_MULTITHREAD)
+    if (_dec_pool.locker){
+        c_locker_delete(_dec_pool.locker);
+        _dec_pool.locker=0;
+    }
+#endif
 }
+hpatch_inline static void hpatch_decompressPool_getInfo(hpatch_TDecompressPoolInfo* out_info){
+    _dec_pool_lock();
+    *out_info=_dec_pool.info;
+    _dec_pool_unlock();
+}
+
+//decompressor's memory, pooled by plugin
+#define _dec_malloc_by(decompressPlugin,size)  _dec_pool_malloc(decompressPlugin,0,size,0)
+hpatch_inline static void* _dec_malloc(hpatch_size_t size) {
+    return _dec_pool_malloc(0,0,size,0);
+}
+#define _dec_free(p)    _dec_pool_free(p)
+//codec's memory, pooled by codec type
 #define __dec_Alloc_fun(_type_TDecompress,p,size) {  \
-    void* result=_dec_malloc(size); \
+    static const char _codec_tag=0; \
+    void* result=_dec_pool_malloc(&_codec_tag,0,size,0); \
     if (!result)    \
         ((_type_TDecompress*)p)->decError=hpatch_dec_mem_error;   \
     return result;  }
 
 static void __dec_free(void* _, void* address){
-    if (address) free(address); }
+    _dec_free(address); }
 
 #ifdef  _CompressPlugin_zlib
 #if (_IsNeedIncludeDefaultCompressHead)
@@ -133,12 +289,12 @@ static void __dec_free(void* _, void* address){
                                                           hpatch_StreamPos_t code_begin,
                                                           hpatch_StreamPos_t code_end){
         _zlib_TDecompress* self=0;
-        unsigned char* _mem_buf=(unsigned char*)_dec_malloc(sizeof(_zlib_TDecompress)+kDecompressBufSize);
+        unsigned char* _mem_buf=(unsigned char*)_dec_malloc_by(decompressPlugin,sizeof(_zlib_TDecompress)+kDecompressBufSize);
         if (!_mem_buf) _dec_memErr_rt();
         self=_zlib_decompress_open_at(decompressPlugin,codeStream,code_begin,code_end,1,
                                       (_zlib_TDecompress*)_mem_buf,sizeof(_zlib_TDecompress)+kDecompressBufSize);
         if (!self)
-            free(_mem_buf);
+            _dec_free(_mem_buf);
         return self;
     }
     static hpatch_decompressHandle  _zlib_decompress_open_deflate(hpatch_TDecompress* decompressPlugin,
@@ -147,12 +303,12 @@ static void __dec_free(void* _, void* address){
                                                                   hpatch_StreamPos_t code_begin,
                                                                   hpatch_StreamPos_t code_end){
         _zlib_TDecompress* self=0;
-        unsigned char* _mem_buf=(unsigned char*)_dec_malloc(sizeof(_zlib_TDecompress)+kDecompressBufSize);
+        unsigned char* _mem_buf=(unsigned char*)_dec_malloc_by(decompressPlugin,sizeof(_zlib_TDecompress)+kDecompressBufSize);
         if (!_mem_buf) _dec_memErr_rt();
         self=_zlib_decompress_open_at(decompressPlugin,codeStream,code_begin,code_end,0,
                                       (_zlib_TDecompress*)_mem_buf,sizeof(_zlib_TDecompress)+kDecompressBufSize);
         if (!self)
-            free(_mem_buf);
+            _dec_free(_mem_buf);
         return self;
     }
 
@@ -187,7 +343,7 @@ static void __dec_free(void* _, void* address){
                                               hpatch_decompressHandle decompressHandle){
         _zlib_TDecompress* self=(_zlib_TDecompress*)decompressHandle;
         hpatch_BOOL result=_zlib_decompress_close_by(decompressPlugin,self);
-        if (self) free(self);
+        if (self) _dec_free(self);
         return result;
     }
 
@@ -450,13 +606,13 @@ static void __dec_free(void* _, void* address){
         const size_t data_buf_size=_de_ldef_kDictSize+((_de_ldef_kMaxBlockSize<dataSize)?_de_ldef_kMaxBlockSize:(size_t)dataSize);
         const size_t code_buf_size=(_de_ldef_kMaxBlockSize<in_size)?_de_ldef_kMaxBlockSize:(size_t)in_size;
         size_t _mem_size=sizeof(_ldef_TDecompress)+data_buf_size+code_buf_size;
-        unsigned char* _mem_buf=(unsigned char*)_dec_malloc(_mem_size);
+        unsigned char* _mem_buf=(unsigned char*)_dec_malloc_by(decompressPlugin,_mem_size);
         if (!_mem_buf) _dec_memErr_rt();
 
         self=_ldef_decompress_open_at(decompressPlugin,codeStream,code_begin,code_end,1,
                                       (_ldef_TDecompress*)_mem_buf,data_buf_size,code_buf_size);
         if (!self)
-            free(_mem_buf);
+            _dec_free(_mem_buf);
         return self;
     }
 
@@ -480,7 +636,7 @@ static void __dec_free(void* _, void* address){
                                               hpatch_decompressHandle decompressHandle){
         _ldef_TDecompress* self=(_ldef_TDecompress*)decompressHandle;
         hpatch_BOOL result=_ldef_decompress_close_by(decompressPlugin,self);
-        if (self) free(self);
+        if (self) _dec_free(self);
         return result;
     }
 
@@ -590,6 +746,8 @@ static void __dec_free(void* _, void* address){
         hpatch_dec_error_t decError;
         unsigned char   dec_buf[kDecompressBufSize];
     } _bz2_TDecompress;
+    static void * __bz2_dec_Alloc(void* p,int items,int size)
+        __dec_Alloc_fun(_bz2_TDecompress,p,((items)*(size_t)(size)))
     static hpatch_BOOL _bz2_is_can_open(const char* compressType){
         return (0==strcmp(compressType,"bz2"))||(0==strcmp(compressType,"bzip2"))
              ||(0==strcmp(compressType,"pbz2"))||(0==strcmp(compressType,"pbzip2"));
@@ -600,15 +758,18 @@ static void __dec_free(void* _, void* address){
                                                hpatch_StreamPos_t code_begin,
                                                hpatch_StreamPos_t code_end){
         int ret;
-        _bz2_TDecompress* self=(_bz2_TDecompress*)_dec_malloc(sizeof(_bz2_TDecompress));
+        _bz2_TDecompress* self=(_bz2_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_bz2_TDecompress));
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_bz2_TDecompress)-kDecompressBufSize);
         self->codeStream=codeStream;
         self->code_begin=code_begin;
         self->code_end=code_end;
+        self->d_stream.bzalloc=__bz2_dec_Alloc;
+        self->d_stream.bzfree=__dec_free;
+        self->d_stream.opaque=self;
         
         ret=BZ2_bzDecompressInit(&self->d_stream,0,0);
-        if (ret!=BZ_OK){ free(self); _dec_openErr_rt(); }
+        if (ret!=BZ_OK){ _dec_free(self); _dec_openErr_rt(); }
         return self;
     }
     static hpatch_BOOL _bz2_close(struct hpatch_TDecompress* decompressPlugin,
@@ -618,7 +779,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return result;
         _dec_onDecErr_up();
         _dec_close_check(BZ_OK==BZ2_bzDecompressEnd(&self->d_stream));
-        free(self);
+        _dec_free(self);
         return result;
     }
     static hpatch_BOOL _bz2_reset_for_next_node(_bz2_TDecompress* self){
@@ -752,7 +913,7 @@ static void __dec_free(void* _, void* address){
         if (!codeStream->read(codeStream,code_begin,props,props+propsSize)) return 0;
         code_begin+=propsSize;
 
-        self=(_lzma_TDecompress*)_dec_malloc(sizeof(_lzma_TDecompress));
+        self=(_lzma_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_lzma_TDecompress));
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_lzma_TDecompress)-kDecompressBufSize);
         self->memAllocBase.Alloc=__lzma1_dec_Alloc;
@@ -766,7 +927,7 @@ static void __dec_free(void* _, void* address){
         
         LzmaDec_Construct(&self->decEnv);
         ret=LzmaDec_Allocate(&self->decEnv,props,propsSize,&self->memAllocBase);
-        if (ret!=SZ_OK){ _dec_onDecErr_up(); free(self); _dec_openErr_rt(); }
+        if (ret!=SZ_OK){ _dec_onDecErr_up(); _dec_free(self); _dec_openErr_rt(); }
         LzmaDec_Init(&self->decEnv);
         return self;
     }
@@ -776,7 +937,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return hpatch_TRUE;
         LzmaDec_Free(&self->decEnv,&self->memAllocBase);
         _dec_onDecErr_up();
-        free(self);
+        _dec_free(self);
         return hpatch_TRUE;
     }
     static hpatch_BOOL _lzma_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -862,7 +1023,7 @@ static void __dec_free(void* _, void* address){
         if (!codeStream->read(codeStream,code_begin,&propsSize,&propsSize+1)) return 0;
         ++code_begin;
         
-        self=(_lzma2_TDecompress*)_dec_malloc(sizeof(_lzma2_TDecompress));
+        self=(_lzma2_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_lzma2_TDecompress));
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_lzma2_TDecompress)-kDecompressBufSize);
         self->memAllocBase.Alloc=__lzma2_dec_Alloc;
@@ -876,7 +1037,7 @@ static void __dec_free(void* _, void* address){
         
         Lzma2Dec_Construct(&self->decEnv);
         ret=Lzma2Dec_Allocate(&self->decEnv,propsSize,&self->memAllocBase);
-        if (ret!=SZ_OK){ _dec_onDecErr_up(); free(self); _dec_openErr_rt(); }
+        if (ret!=SZ_OK){ _dec_onDecErr_up(); _dec_free(self); _dec_openErr_rt(); }
         Lzma2Dec_Init(&self->decEnv);
         return self;
     }
@@ -886,7 +1047,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return hpatch_TRUE;
         Lzma2Dec_Free(&self->decEnv,&self->memAllocBase);
         _dec_onDecErr_up();
-        free(self);
+        _dec_free(self);
         return hpatch_TRUE;
     }
     static hpatch_BOOL _lzma2_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -1013,7 +1174,7 @@ static void __dec_free(void* _, void* address){
                                               hpatch_StreamPos_t code_end){
         _7zXZ_TDecompress* self=0;
         
-        self=(_7zXZ_TDecompress*)_dec_malloc(sizeof(_7zXZ_TDecompress));
+        self=(_7zXZ_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_7zXZ_TDecompress));
         if (!self) _dec_memErr_rt();
         _7zXZ_open_at(self,decompressPlugin,dataSize,codeStream,
                       code_begin,code_end,hpatch_FALSE,hpatch_TRUE);
@@ -1026,7 +1187,7 @@ static void __dec_free(void* _, void* address){
                                                 hpatch_StreamPos_t code_end){
         _7zXZ_TDecompress* self=0;
         
-        self=(_7zXZ_TDecompress*)_dec_malloc(sizeof(_7zXZ_TDecompress));
+        self=(_7zXZ_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_7zXZ_TDecompress));
         if (!self) _dec_memErr_rt();
         _7zXZ_open_at(self,decompressPlugin,dataSize,codeStream,
                       code_begin,code_end,hpatch_TRUE,hpatch_TRUE);
@@ -1036,7 +1197,7 @@ static void __dec_free(void* _, void* address){
                                     hpatch_decompressHandle decompressHandle){
         if (decompressHandle){
             _7zXZ_close_at(decompressHandle);
-            free(decompressHandle);
+            _dec_free(decompressHandle);
         }
         return hpatch_TRUE;
     }
@@ -1146,7 +1307,7 @@ static void __dec_free(void* _, void* address){
             if ((kLz4CompressBufSize<0)||(kLz4CompressBufSize>=kMaxLz4CompressBufSize)) _dec_openErr_rt();
             code_buf_size=LZ4_compressBound(kLz4CompressBufSize);
         }
-        self=(_lz4_TDecompress*)_dec_malloc(sizeof(_lz4_TDecompress)+kLz4CompressBufSize+code_buf_size);
+        self=(_lz4_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_lz4_TDecompress)+kLz4CompressBufSize+code_buf_size);
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_lz4_TDecompress));
         self->codeStream=codeStream;
@@ -1158,7 +1319,7 @@ static void __dec_free(void* _, void* address){
         self->data_end=0;
         
         self->s = LZ4_createStreamDecode();
-        if (!self->s){ free(self); _dec_openErr_rt(); }
+        if (!self->s){ _dec_free(self); _dec_openErr_rt(); }
         return self;
     }
     static hpatch_BOOL _lz4_close(struct hpatch_TDecompress* decompressPlugin,
@@ -1168,7 +1329,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return result;
         _dec_onDecErr_up();
         _dec_close_check(0==LZ4_freeStreamDecode(self->s));
-        free(self);
+        _dec_free(self);
         return result;
     }
     static hpatch_BOOL _lz4_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -1226,6 +1387,10 @@ static void __dec_free(void* _, void* address){
     static void* __ZSTD_alloc(void* opaque, size_t size)
         __dec_Alloc_fun(_zstd_TDecompress,opaque,size)
     #endif
+    static void __zstd_dec_keepObjFree(void* mem){
+        _zstd_TDecompress* self=(_zstd_TDecompress*)mem;
+        if (self->s) ZSTD_freeDStream(self->s);
+    }
     static hpatch_BOOL _zstd_is_can_open(const char* compressType){
         return (0==strcmp(compressType,"zstd"));
     }
@@ -1236,10 +1401,14 @@ static void __dec_free(void* _, void* address){
                                                hpatch_StreamPos_t code_end){
         _zstd_TDecompress* self=0;
         size_t  ret;
+        ZSTD_DStream* s=0;
+        hpatch_BOOL isReused=hpatch_FALSE;
         size_t _input_size=ZSTD_DStreamInSize();
         size_t _output_size=ZSTD_DStreamOutSize();
-        self=(_zstd_TDecompress*)_dec_malloc(sizeof(_zstd_TDecompress)+_input_size+_output_size);
+        self=(_zstd_TDecompress*)_dec_pool_malloc(decompressPlugin,__zstd_dec_keepObjFree,
+                                   sizeof(_zstd_TDecompress)+_input_size+_output_size,&isReused);
         if (!self) _dec_memErr_rt();
+        if (isReused) s=self->s; //reuse DStream & it's window
         memset(self,0,sizeof(_zstd_TDecompress));
         self->codeStream=codeStream;
         self->code_begin=code_begin;
@@ -1251,6 +1420,11 @@ static void __dec_free(void* _, void* address){
         self->s_output.size=_output_size;
         self->s_output.pos=0;
         self->data_begin=0;
+        if (s){
+            self->s=s;
+            ret=ZSTD_DCtx_reset(self->s,ZSTD_reset_session_and_parameters);
+            if (ZSTD_isError(ret)) { _dec_onDecErr_up(); _dec_free(self); _dec_openErr_rt(); }
+        }else{
         #ifdef ZSTD_STATIC_LINKING_ONLY
         {
             ZSTD_customMem customMem={__ZSTD_alloc,__dec_free,self};
@@ -1259,9 +1433,10 @@ static void __dec_free(void* _, void* address){
         #else
             self->s=ZSTD_createDStream();
         #endif
-        if (!self->s){ _dec_onDecErr_up(); free(self); _dec_openErr_rt(); }
+        if (!self->s){ _dec_onDecErr_up(); _dec_free(self); _dec_openErr_rt(); }
         ret=ZSTD_initDStream(self->s);
-        if (ZSTD_isError(ret)) { ZSTD_freeDStream(self->s); _dec_onDecErr_up(); free(self); _dec_openErr_rt(); }
+        if (ZSTD_isError(ret)) { _dec_onDecErr_up(); _dec_free(self); _dec_openErr_rt(); }
+        }
         #define _ZSTD_WINDOWLOG_MAX 30
         ret=ZSTD_DCtx_setParameter(self->s,ZSTD_d_windowLogMax,_ZSTD_WINDOWLOG_MAX);
         //if (ZSTD_isError(ret)) { printf("WARNING: ZSTD_DCtx_setMaxWindowSize() error!"); }
@@ -1273,8 +1448,7 @@ static void __dec_free(void* _, void* address){
         _zstd_TDecompress* self=(_zstd_TDecompress*)decompressHandle;
         if (!self) return result;
         _dec_onDecErr_up();
-        _dec_close_check(0==ZSTD_freeDStream(self->s));
-        free(self);
+        _dec_free(self); //self->s freed by __zstd_dec_keepObjFree() or cached by pool
         return result;
     }
     static hpatch_BOOL _zstd_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -1336,6 +1510,8 @@ static void __dec_free(void* _, void* address){
         hpatch_dec_error_t  decError;
         unsigned char       buf[1];
     } _brotli_TDecompress;
+    static void * __brotli_dec_Alloc(void* p,size_t size)
+        __dec_Alloc_fun(_brotli_TDecompress,p,size)
     static hpatch_BOOL _brotli_is_can_open(const char* compressType){
         return (0==strcmp(compressType,"brotli"));
     }
@@ -1347,7 +1523,7 @@ static void __dec_free(void* _, void* address){
         const size_t kBufSize=kDecompressBufSize;
         _brotli_TDecompress* self=0;
         assert(code_begin<code_end);
-        self=(_brotli_TDecompress*)_dec_malloc(sizeof(_brotli_TDecompress)+kBufSize*2);
+        self=(_brotli_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_brotli_TDecompress)+kBufSize*2);
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_brotli_TDecompress));
         self->codeStream=codeStream;
@@ -1361,10 +1537,10 @@ static void __dec_free(void* _, void* address){
         self->next_out  =self->output;
         self->data_begin=self->output;
         
-        self->s = BrotliDecoderCreateInstance(0,0,0);
-        if (!self->s){ free(self); _dec_openErr_rt(); }
+        self->s = BrotliDecoderCreateInstance(__brotli_dec_Alloc,__dec_free,self);
+        if (!self->s){ _dec_free(self); _dec_openErr_rt(); }
         if (!BrotliDecoderSetParameter(self->s, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1u))
-            { BrotliDecoderDestroyInstance(self->s); free(self); _dec_openErr_rt(); }
+            { BrotliDecoderDestroyInstance(self->s); _dec_free(self); _dec_openErr_rt(); }
         return self;
     }
     static hpatch_BOOL _brotli_close(struct hpatch_TDecompress* decompressPlugin,
@@ -1373,7 +1549,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return hpatch_TRUE;
         _dec_onDecErr_up();
         BrotliDecoderDestroyInstance(self->s);
-        free(self);
+        _dec_free(self);
         return hpatch_TRUE;
     }
     static hpatch_BOOL _brotli_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -1466,7 +1642,7 @@ static void __dec_free(void* _, void* address){
             ++code_begin;
         }
 
-        self=(_lzham_TDecompress*)_dec_malloc(sizeof(_lzham_TDecompress)+kBufSize*2);
+        self=(_lzham_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_lzham_TDecompress)+kBufSize*2);
         if (!self) _dec_memErr_rt();
         memset(self,0,sizeof(_lzham_TDecompress));
         self->codeStream=codeStream;
@@ -1485,7 +1661,7 @@ static void __dec_free(void* _, void* address){
         params.m_dict_size_log2 = dict_bits;
 
         self->s = lzham_decompress_init(&params);
-        if (!self->s){ free(self); _dec_openErr_rt(); }
+        if (!self->s){ _dec_free(self); _dec_openErr_rt(); }
 
         return self;
     }
@@ -1495,7 +1671,7 @@ static void __dec_free(void* _, void* address){
         if (!self) return hpatch_TRUE;
         _dec_onDecErr_up();
         lzham_decompress_deinit(self->s);
-        free(self);
+        _dec_free(self);
         return hpatch_TRUE;
     }
     static hpatch_BOOL _lzham_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -1593,7 +1769,7 @@ static void __dec_free(void* _, void* address){
                                               hpatch_StreamPos_t code_end){
         tuz_size_t dictSize;
         _tuz_TDecompress* self=0;
-        self=(_tuz_TDecompress*)_dec_malloc(sizeof(_tuz_TDecompress));
+        self=(_tuz_TDecompress*)_dec_malloc_by(decompressPlugin,sizeof(_tuz_TDecompress));
         if (!self) _dec_memErr_rt();
         self->dec_mem=0;
         self->codeStream=codeStream;
@@ -1601,12 +1777,12 @@ static void __dec_free(void* _, void* address){
         self->code_end=code_end;
         self->decError=hpatch_dec_ok;
         dictSize=tuz_TStream_read_dict_size(self,_tuz_TDecompress_read_code);
-        if (((tuz_size_t)(dictSize-1))>=tuz_kMaxOfDictSize) { free(self); _dec_openErr_rt(); }
-        self->dec_mem=(tuz_byte*)_dec_malloc(dictSize+kDecompressBufSize);
-        if (self->dec_mem==0){ free(self); _dec_memErr_rt(); }
+        if (((tuz_size_t)(dictSize-1))>=tuz_kMaxOfDictSize) { _dec_free(self); _dec_openErr_rt(); }
+        self->dec_mem=(tuz_byte*)_dec_malloc_by(decompressPlugin,dictSize+kDecompressBufSize);
+        if (self->dec_mem==0){ _dec_free(self); _dec_memErr_rt(); }
         if (tuz_OK!=tuz_TStream_open(&self->s,self,_tuz_TDecompress_read_code,
                                      self->dec_mem,dictSize,kDecompressBufSize)){
-            free(self->dec_mem); free(self); _dec_openErr_rt(); }
+            _dec_free(self->dec_mem); _dec_free(self); _dec_openErr_rt(); }
         return self;
     }
     static hpatch_BOOL _tuz_close(struct hpatch_TDecompress* decompressPlugin,
@@ -1614,8 +1790,8 @@ static void __dec_free(void* _, void* address){
         _tuz_TDecompress* self=(_tuz_TDecompress*)decompressHandle;
         if (!self) return hpatch_TRUE;
         _dec_onDecErr_up();
-        if (self->dec_mem) free(self->dec_mem);
-        free(self);
+        if (self->dec_mem) _dec_free(self->dec_mem);
+        _dec_free(self);
         return hpatch_TRUE;
     }
     static hpatch_BOOL _tuz_decompress_part(hpatch_decompressHandle decompressHandle,
@@ -32,15 +32,20 @@
 #include <set>
 #include "../../libHDiffPatch/HDiff/private_diff/limit_mem_diff/adler_roll.h"
 #include "../../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../../libHDiffPatch/HDiff/private_diff/limit_mem_diff/covers.h"
 #include "../../libHDiffPatch/HDiff/diff.h"
 #include "../../libHDiffPatch/HDiff/match_block.h"
 #include "../../libHDiffPatch/HPatch/patch.h"
 #include "../dir_patch/dir_patch.h"
 #include "../dir_patch/dir_patch_private.h"
 #include "dir_diff_tools.h"
+#if (_IS_USED_MULTITHREAD)
+#include "../../libParallel/parallel_channel.h"
+#endif
 using namespace hdiff_private;
 
 static const char* kDirDiffVersionType= "HDIFF19";
+static const char* kDirDiffSegmentType= "seg"; //privateExternData type of segmented hdiffData
 
 static std::string  cmp_hash_type    =  "fadler64";
 #define cmp_hash_value_t                uint64_t
@@ -152,6 +157,160 @@ struct _TCmp_byHit {
     const std::vector<size_t>& oldHitList;
 };
 
+namespace{
+    //run doWork(workIndex) for every workIndex in [0,workCount) by threads
+    struct TParallelWork{
+        void        (*doWork)(TParallelWork* self,size_t workIndex);
+        size_t      workCount;
+        size_t      curIndex;
+        bool        isOnError;
+        std::string errorInfo;
+    #if (_IS_USED_MULTITHREAD)
+        CHLocker    locker;
+    #endif
+    };
+}
+
+static void _parallelWork_thread(int threadIndex,void* workData){
+    TParallelWork& pw=*(TParallelWork*)workData;
+    try {
+        while (true) {
+            size_t wi;
+            {
+#if (_IS_USED_MULTITHREAD)
+                CAutoLocker _autoLocker(pw.locker.locker);
+#endif
+                if (pw.isOnError||(pw.curIndex>=pw.workCount)) break;
+                wi=pw.curIndex++;
+            }
+            pw.doWork(&pw,wi);
+        }
+    } catch (const std::exception& e) {
+#if (_IS_USED_MULTITHREAD)
+        CAutoLocker _autoLocker(pw.locker.locker);
+#endif
+        if (!pw.isOnError){
+            pw.isOnError=true;
+            pw.errorInfo=e.what();
+        }
+    }
+}
+
+#if (_IS_USED_MULTITHREAD)
+namespace{
+    struct TParallelWorkMt:public TMtByChannel{
+        inline explicit TParallelWorkMt(TParallelWork& _pw):pw(_pw){}
+        TParallelWork& pw;
+    };
+}
+static void _parallelWork_mt(int threadIndex,void* workData){
+    TParallelWorkMt& mt=*(TParallelWorkMt*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(mt);
+    _parallelWork_thread(threadIndex,&mt.pw);
+}
+#endif
+
+static void _runParallelWork(TParallelWork& pw,void (*doWork)(TParallelWork* self,size_t workIndex),
+                             size_t workCount,size_t threadNum){
+    pw.doWork=doWork;
+    pw.workCount=workCount;
+    pw.curIndex=0;
+    pw.isOnError=false;
+    if (threadNum>workCount) threadNum=workCount;
+#if (_IS_USED_MULTITHREAD)
+    if (threadNum>1){
+        TParallelWorkMt mt(pw);
+        checkv(mt.start_threads((int)threadNum,_parallelWork_mt,&mt,true));
+        mt.wait_all_thread_end();
+    }else
+#endif
+    {
+        _parallelWork_thread(0,&pw);
+    }
+    check(!pw.isOnError,pw.errorInfo);
+}
+
+namespace{
+    //hash all old & new files by threads, then getRefList only use the results
+    struct TFileHashWork:public TParallelWork{
+        const std::vector<std::string>* oldList;
+        const std::vector<std::string>* newList;
+        bool                            isFileSizeAsHash;
+        std::vector<hpatch_StreamPos_t>* oldSizeList;
+        std::vector<hpatch_StreamPos_t>* newSizeList;
+        std::vector<cmp_hash_value_t>*   oldHashList;
+        std::vector<cmp_hash_value_t>*   newHashList;
+        //compare eqPath same hash file pair by threads, [newi]: 0 not same, 1 same, -1 not compared
+        const std::vector<size_t>*       eqPathOldIndexs;
+        std::vector<signed char>*        eqPathIsSames;
+        //reuse cached hash if file not changed
+        CManifestCache*                 manifestCache;
+        std::vector<hpatch_TFileStatTag> fileTags;      //[wi]
+        std::vector<TByte>              fileTagStates; //[wi]: 0 no tag, 1 hash reused, 2 need update to cache
+        inline size_t pathCount()const{ return oldList->size()+newList->size(); }
+    };
+}
+
+static const TByte kFileTag_reused    =1;
+static const TByte kFileTag_needUpdate=2;
+    //as fadler64 checksum's bytes
+    static void _hashToBytes(cmp_hash_value_t hash,TByte* out_bytes){
+        for (size_t i=0;i<sizeof(cmp_hash_value_t);++i){
+            out_bytes[i]=(TByte)hash;
+            hash>>=8;
+        }
+    }
+    static cmp_hash_value_t _hashFromBytes(const TByte* bytes){
+        cmp_hash_value_t hash=0;
+        for (size_t i=sizeof(cmp_hash_value_t);i>0;--i)
+            hash=(hash<<8)|bytes[i-1];
+        return hash;
+    }
+
+static void _hashFile(TParallelWork* self,size_t wi){
+    TFileHashWork& hw=*(TFileHashWork*)self;
+    const bool isOld=(wi<hw.oldList->size());
+    const size_t fi=isOld?wi:(wi-hw.oldList->size());
+    const std::string& fileName=isOld?(*hw.oldList)[fi]:(*hw.newList)[fi];
+    if (isDirName(fileName)) return;
+    hpatch_StreamPos_t fileSize=0;
+    cmp_hash_value_t hash;
+    if (hw.isFileSizeAsHash){
+        fileSize=getFileSize(fileName);
+        hash=fileSize;
+    }else{
+        if (isOld&&(fileName.empty())&&(hw.oldList->size()==1)){ // isOldPathInputEmpty
+            hpatch_TStreamInput emptyStream;
+            mem_as_hStreamInput(&emptyStream,0,0);
+            hash=getStreamHash(&emptyStream,"isOldPathInputEmpty, as empty file");
+            fileSize=0;
+        }else if (hw.manifestCache&&hpatch_getFileStatTag(fileName.c_str(),&hw.fileTags[wi])){
+            const hpatch_TFileStatTag& fileTag=hw.fileTags[wi];
+            TByte hashBuf[sizeof(cmp_hash_value_t)];
+            if (hw.manifestCache->find(cmp_hash_type,fileName,fileTag,hashBuf,sizeof(hashBuf))){
+                hash=_hashFromBytes(hashBuf);
+                fileSize=fileTag.fileSize;
+                hw.fileTagStates[wi]=kFileTag_reused;
+            }else{
+                hash=getFileHash(fileName,&fileSize);
+                if (fileSize==fileTag.fileSize)
+                    hw.fileTagStates[wi]=kFileTag_needUpdate;
+            }
+        }else{
+            hash=getFileHash(fileName,&fileSize);
+        }
+    }
+    (isOld?(*hw.oldSizeList):(*hw.newSizeList))[fi]=fileSize;
+    (isOld?(*hw.oldHashList):(*hw.newHashList))[fi]=hash;
+}
+
+static void _compareEqPathFile(TParallelWork* self,size_t newi){
+    TFileHashWork& hw=*(TFileHashWork*)self;
+    size_t oldi=(*hw.eqPathOldIndexs)[newi];
+    if (oldi==~(size_t)0) return;
+    (*hw.eqPathIsSames)[newi]=fileData_isSame((*hw.oldList)[oldi],(*hw.newList)[newi])?1:0;
+}
+
 static void getRefList(const std::string& oldRootPath,const std::string& newRootPath,
                        const std::vector<std::string>& oldList,const std::vector<std::string>& newList,
                        std::vector<hpatch_StreamPos_t>& out_oldSizeList,
@@ -160,62 +319,96 @@ static void getRefList(const std::string& oldRootPath,const std::string& newRoot
                        std::vector<size_t>& out_oldRefList,std::vector<size_t>& out_newRefList,
                        bool isNeedOutHashs,
                        std::vector<cmp_hash_value_t>& out_oldHashList,
-                       std::vector<cmp_hash_value_t>& out_newHashList){
+                       std::vector<cmp_hash_value_t>& out_newHashList,
+                       size_t threadNum,IDirDiffListener* listener,CManifestCache* manifestCache){
     typedef std::multimap<cmp_hash_value_t,size_t> TMap;
     TMap hashMap;
     std::set<size_t> oldRefSet;
     const bool isFileSizeAsHash =(!isNeedOutHashs) && ((oldList.size()*newList.size())<=16);
     out_oldSizeList.assign(oldList.size(),0);
     out_newSizeList.assign(newList.size(),0);
-    if (isNeedOutHashs){
-        out_oldHashList.assign(oldList.size(),0);
-        out_newHashList.assign(newList.size(),0);
+    std::vector<cmp_hash_value_t> oldHashList(oldList.size(),0);
+    std::vector<cmp_hash_value_t> newHashList(newList.size(),0);
+    
+    TFileHashWork hw;
+    hw.oldList=&oldList;
+    hw.newList=&newList;
+    hw.isFileSizeAsHash=isFileSizeAsHash;
+    hw.oldSizeList=&out_oldSizeList;
+    hw.newSizeList=&out_newSizeList;
+    hw.oldHashList=&oldHashList;
+    hw.newHashList=&newHashList;
+    hw.eqPathOldIndexs=0;
+    hw.eqPathIsSames=0;
+    hw.manifestCache=isFileSizeAsHash?0:manifestCache;
+    if (hw.manifestCache){
+        hw.fileTags.resize(hw.pathCount());
+        hw.fileTagStates.assign(hw.pathCount(),0);
     }
-    for (size_t oldi=0; oldi<oldList.size(); ++oldi) {
-        const std::string& fileName=oldList[oldi];
-        if (isDirName(fileName)) continue;
-        hpatch_StreamPos_t fileSize=0;
-        cmp_hash_value_t hash;
-        if (isFileSizeAsHash){
-            fileSize=getFileSize(fileName);
-            hash=fileSize;
-        }else{
-            if ((fileName.empty())&&(oldList.size()==1)){ // isOldPathInputEmpty
-                hpatch_TStreamInput emptyStream;
-                mem_as_hStreamInput(&emptyStream,0,0);
-                hash=getStreamHash(&emptyStream,"isOldPathInputEmpty, as empty file");
-                fileSize=0;
-            }else{
-                hash=getFileHash(fileName,&fileSize);
+    if (threadNum>hw.pathCount()) threadNum=hw.pathCount();
+    if (threadNum<1) threadNum=1;
+    listener->hashFilesBegin(hw.pathCount(),threadNum);
+    _runParallelWork(hw,_hashFile,hw.pathCount(),threadNum);
+    if (hw.manifestCache){
+        size_t reusedCount=0;
+        for (size_t wi=0;wi<hw.pathCount();++wi){
+            if (hw.fileTagStates[wi]==kFileTag_reused){
+                ++reusedCount;
+            }else if (hw.fileTagStates[wi]==kFileTag_needUpdate){
+                const bool isOld=(wi<oldList.size());
+                const size_t fi=isOld?wi:(wi-oldList.size());
+                TByte hashBuf[sizeof(cmp_hash_value_t)];
+                _hashToBytes(isOld?oldHashList[fi]:newHashList[fi],hashBuf);
+                manifestCache->update(cmp_hash_type,isOld?oldList[fi]:newList[fi],
+                                      hw.fileTags[wi],hashBuf,sizeof(hashBuf));
             }
         }
-        out_oldSizeList[oldi]=fileSize;
-        if (isNeedOutHashs) out_oldHashList[oldi]=hash;
-        if (fileSize==0) continue;
-        hashMap.insert(TMap::value_type(hash,oldi));
+        listener->hashFilesCacheInfo(reusedCount);
+    }
+    listener->hashFilesEnd();
+    
+    for (size_t oldi=0; oldi<oldList.size(); ++oldi) {
+        if (isDirName(oldList[oldi])) continue;
+        if (out_oldSizeList[oldi]==0) continue;
+        hashMap.insert(TMap::value_type(oldHashList[oldi],oldi));
         oldRefSet.insert(oldi);
     }
+    
+    //the most likely same file pair is eqPath & same hash, compare them first by threads;
+    //  getRefList's result is the same as compare serially.
+    std::vector<size_t> eqPathOldIndexs(newList.size(),~(size_t)0);
+    std::vector<signed char> eqPathIsSames(newList.size(),-1);
+    if (threadNum>1){
+        std::map<std::string,size_t> oldPathMap;
+        for (size_t oldi=0; oldi<oldList.size(); ++oldi){
+            if (isDirName(oldList[oldi])||(out_oldSizeList[oldi]==0)) continue;
+            oldPathMap[oldList[oldi].substr(oldRootPath.size())]=oldi;
+        }
+        for (size_t newi=0; newi<newList.size(); ++newi){
+            const std::string& fileName=newList[newi];
+            if (isDirName(fileName)||(out_newSizeList[newi]==0)) continue;
+            std::map<std::string,size_t>::const_iterator it=oldPathMap.find(fileName.substr(newRootPath.size()));
+            if (it==oldPathMap.end()) continue;
+            size_t oldi=it->second;
+            if ((oldHashList[oldi]==newHashList[newi])&&(out_oldSizeList[oldi]==out_newSizeList[newi]))
+                eqPathOldIndexs[newi]=oldi;
+        }
+        hw.eqPathOldIndexs=&eqPathOldIndexs;
+        hw.eqPathIsSames=&eqPathIsSames;
+        _runParallelWork(hw,_compareEqPathFile,newList.size(),threadNum);
+    }
+    
     out_dataSamePairList.clear();
     out_newRefList.clear();
     std::vector<size_t> oldHitList(oldList.size(),0);
     for (size_t newi=0; newi<newList.size(); ++newi){
         const std::string& fileName=newList[newi];
         if (isDirName(fileName)) continue;
-        hpatch_StreamPos_t fileSize=0;
-        cmp_hash_value_t hash;
-        if (isFileSizeAsHash){
-            fileSize=getFileSize(fileName);
-            hash=fileSize;
-        }else{
-            hash=getFileHash(fileName,&fileSize);
-        }
-        out_newSizeList[newi]=fileSize;
-        if (isNeedOutHashs) out_newHashList[newi]=hash;
-        if (fileSize==0) continue;
+        if (out_newSizeList[newi]==0) continue;
         
         bool isFoundSame=false;
         size_t oldIndex=~(size_t)0;
-        std::pair<TMap::const_iterator,TMap::const_iterator> range=hashMap.equal_range(hash);
+        std::pair<TMap::const_iterator,TMap::const_iterator> range=hashMap.equal_range(newHashList[newi]);
         std::vector<size_t> oldHashIndexs;
         for (;range.first!=range.second;++range.first)
             oldHashIndexs.push_back(range.first->second);
@@ -225,8 +418,12 @@ static void getRefList(const std::string& oldRootPath,const std::string& newRoot
                       _TCmp_byHit(newPath,oldList,oldRootPath.size(),oldHitList));
         for (size_t oldi=0;oldi<oldHashIndexs.size();++oldi){
             size_t curOldIndex=oldHashIndexs[oldi];
-            const std::string& oldName=oldList[curOldIndex];
-            if (fileData_isSame(oldName,fileName)){
+            bool isSame;
+            if ((curOldIndex==eqPathOldIndexs[newi])&&(eqPathIsSames[newi]>=0))
+                isSame=(eqPathIsSames[newi]!=0);
+            else
+                isSame=fileData_isSame(oldList[curOldIndex],fileName);
+            if (isSame){
                 isFoundSame=true;
                 oldIndex=curOldIndex;
                 break;
@@ -244,6 +441,413 @@ static void getRefList(const std::string& oldRootPath,const std::string& newRoot
     }
     out_oldRefList.assign(oldRefSet.begin(),oldRefSet.end());
     std::sort(out_oldRefList.begin(),out_oldRefList.end());
+    listener->compareFilesEnd(out_dataSamePairList.size());
+    if (isNeedOutHashs){
+        out_oldHashList.swap(oldHashList);
+        out_newHashList.swap(newHashList);
+    }
+}
+
+namespace{
+    //diff by file pair: every changed new file paired with an old file (same path, or same file name
+    //  with nearest size, or most similar content by sketch), match covers between the pair by threads
+    //  (only load the pair's datas);
+    //  new datas not covered by pairs use covers matched by block between all old & new ref datas.
+    struct TFilePair{
+        size_t              newi;
+        size_t              oldi;
+        hpatch_StreamPos_t  newRefPos; //file's pos in newRefStream
+        hpatch_StreamPos_t  oldRefPos; //file's pos in oldRefStream
+    };
+    struct TFilePairDiffWork:public TParallelWork{
+        const std::vector<std::string>*         oldList;
+        const std::vector<std::string>*         newList;
+        const THDiffSets*                       hdiffSets;
+        std::vector<TFilePair>                  pairs;
+        std::vector<std::vector<hpatch_TCover> > pairCovers; //[pairIndex]
+    };
+    struct TFileSketchWork:public TParallelWork{
+        std::vector<const std::string*>                 fileList;
+        std::vector<std::vector<hpatch_uint64_t> >      sketchs; //[fileList index]
+    };
+    static const double kMinSketchSimilarity=0.1;
+}
+
+static void _sketchFile(TParallelWork* self,size_t wi){
+    TFileSketchWork& sw=*(TFileSketchWork*)self;
+    CFileStreamInput file(*sw.fileList[wi]);
+    getFileSketch(sw.sketchs[wi],&file.base);
+}
+
+//pair new files by content similarity: sketch unpaired new files & all old ref files,
+//  old files found by sketch values index, select the most similar one.
+static void _getSimilarPairs(std::vector<size_t>& pairOldRefis,size_t threadNum,
+                             const std::vector<std::string>& oldList,const std::vector<std::string>& newList,
+                             const std::vector<size_t>& oldRefIList,const std::vector<size_t>& newRefIList){
+    const size_t kNullIndex=~(size_t)0;
+    TFileSketchWork sw;
+    std::vector<size_t> newRefis;
+    for (size_t i=0;i<newRefIList.size();++i){
+        if (pairOldRefis[i]!=kNullIndex) continue;
+        newRefis.push_back(i);
+        sw.fileList.push_back(&newList[newRefIList[i]]);
+    }
+    if (newRefis.empty()||oldRefIList.empty()) return;
+    for (size_t i=0;i<oldRefIList.size();++i)
+        sw.fileList.push_back(&oldList[oldRefIList[i]]);
+    sw.sketchs.resize(sw.fileList.size());
+    _runParallelWork(sw,_sketchFile,sw.fileList.size(),threadNum);
+    
+    typedef std::pair<hpatch_uint64_t,size_t> TSketchValue; //sketch value,oldRefi
+    std::vector<TSketchValue> oldIndex;
+    for (size_t i=0;i<oldRefIList.size();++i){
+        const std::vector<hpatch_uint64_t>& sketch=sw.sketchs[newRefis.size()+i];
+        for (size_t k=0;k<sketch.size();++k)
+            oldIndex.push_back(TSketchValue(sketch[k],i));
+    }
+    std::sort(oldIndex.begin(),oldIndex.end());
+    std::vector<size_t> candidates;
+    for (size_t ni=0;ni<newRefis.size();++ni){
+        const std::vector<hpatch_uint64_t>& sketch=sw.sketchs[ni];
+        candidates.clear();
+        for (size_t k=0;k<sketch.size();++k){
+            std::vector<TSketchValue>::const_iterator it=std::lower_bound(oldIndex.begin(),oldIndex.end(),
+                                                                          TSketchValue(sketch[k],0));
+            for (;(it!=oldIndex.end())&&(it->first==sketch[k]);++it)
+                candidates.push_back(it->second);
+        }
+        std::sort(candidates.begin(),candidates.end());
+        candidates.erase(std::unique(candidates.begin(),candidates.end()),candidates.end());
+        double bestSimilarity=kMinSketchSimilarity;
+        for (size_t c=0;c<candidates.size();++c){
+            double similarity=getSketchSimilarity(sketch,sw.sketchs[newRefis.size()+candidates[c]]);
+            if (similarity>=bestSimilarity){
+                bestSimilarity=similarity;
+                pairOldRefis[newRefis[ni]]=candidates[c];
+            }
+        }
+    }
+}
+
+    static std::string _getFileName(const std::string& path){
+        size_t pos=path.find_last_of(kPatch_dirSeparator);
+        return (pos==std::string::npos)?path:path.substr(pos+1);
+    }
+static void _getFilePairs(std::vector<TFilePair>& out_pairs,
+                          const std::string& oldRootPath,const std::string& newRootPath,
+                          const std::vector<std::string>& oldList,const std::vector<std::string>& newList,
+                          const std::vector<hpatch_StreamPos_t>& oldSizeList,
+                          const std::vector<size_t>& oldRefIList,const std::vector<size_t>& newRefIList,
+                          const std::vector<hpatch_StreamPos_t>& newRefSizeList,size_t threadNum){
+    const size_t kNullIndex=~(size_t)0;
+    typedef std::map<std::string,size_t> TPathMap;
+    typedef std::multimap<std::string,size_t> TNameMap;
+    TPathMap  oldPathMap; //path -> oldRefIList's index
+    TNameMap  oldNameMap; //file name -> oldRefIList's index
+    std::vector<hpatch_StreamPos_t> oldRefPosList(oldRefIList.size());
+    hpatch_StreamPos_t refPos=0;
+    for (size_t i=0;i<oldRefIList.size();++i){
+        const std::string& oldPath=oldList[oldRefIList[i]];
+        oldRefPosList[i]=refPos;
+        refPos+=oldSizeList[oldRefIList[i]];
+        oldPathMap[oldPath.substr(oldRootPath.size())]=i;
+        oldNameMap.insert(TNameMap::value_type(_getFileName(oldPath),i));
+    }
+    std::vector<size_t> pairOldRefis(newRefIList.size(),kNullIndex);
+    size_t namePairCount=0;
+    for (size_t i=0;i<newRefIList.size();++i){
+        const std::string& newPath=newList[newRefIList[i]];
+        size_t& oldRefi=pairOldRefis[i];
+        TPathMap::const_iterator it=oldPathMap.find(newPath.substr(newRootPath.size()));
+        if (it!=oldPathMap.end()){
+            oldRefi=it->second;
+        }else{ //same file name (moved), select nearest size
+            hpatch_StreamPos_t minSizeDis=~(hpatch_StreamPos_t)0;
+            const hpatch_StreamPos_t newSize=newRefSizeList[i];
+            std::pair<TNameMap::const_iterator,TNameMap::const_iterator> range=oldNameMap.equal_range(_getFileName(newPath));
+            for (;range.first!=range.second;++range.first){
+                hpatch_StreamPos_t oldSize=oldSizeList[oldRefIList[range.first->second]];
+                hpatch_StreamPos_t sizeDis=(oldSize>newSize)?(oldSize-newSize):(newSize-oldSize);
+                if (sizeDis<minSizeDis){
+                    minSizeDis=sizeDis;
+                    oldRefi=range.first->second;
+                }
+            }
+        }
+        if (oldRefi!=kNullIndex) ++namePairCount;
+    }
+    _getSimilarPairs(pairOldRefis,threadNum,oldList,newList,oldRefIList,newRefIList);
+    
+    out_pairs.clear();
+    refPos=0;
+    for (size_t i=0;i<newRefIList.size();refPos+=newRefSizeList[i],++i){
+        const size_t oldRefi=pairOldRefis[i];
+        if (oldRefi==kNullIndex) continue; //not found pair
+        TFilePair pair;
+        pair.newi=newRefIList[i];
+        pair.oldi=oldRefIList[oldRefi];
+        pair.newRefPos=refPos;
+        pair.oldRefPos=oldRefPosList[oldRefi];
+        out_pairs.push_back(pair);
+    }
+    _out_diff_info("  paired %" PRIu64 " new files by path or name, %" PRIu64 " by content similarity\n",
+                   (hpatch_StreamPos_t)namePairCount,(hpatch_StreamPos_t)(out_pairs.size()-namePairCount));
+}
+
+    static void _loadFile(TAutoMem& mem,const std::string& fileName){
+        CFileStreamInput file(fileName);
+        mem.realloc((size_t)file.base.streamSize);
+        check(mem.size()==file.base.streamSize,"file \""+fileName+"\" too large error!");
+        check(file.base.read(&file.base,0,mem.data(),mem.data_end()),"read file \""+fileName+"\" error!");
+    }
+static void _diffFilePair(TParallelWork* self,size_t pairIndex){
+    TFilePairDiffWork& pw=*(TFilePairDiffWork*)self;
+    const TFilePair& pair=pw.pairs[pairIndex];
+    const THDiffSets& hdiffSets=*pw.hdiffSets;
+    std::vector<hpatch_TCover>& out_covers=pw.pairCovers[pairIndex];
+    TAutoMem newMem;
+    TAutoMem oldMem;
+    _loadFile(newMem,(*pw.newList)[pair.newi]);
+    _loadFile(oldMem,(*pw.oldList)[pair.oldi]);
+    if (hdiffSets.isDiffInMem){
+        std::vector<hpatch_TCover_sz> covers;
+        get_match_covers_by_sstring(newMem.data(),newMem.data_end(),oldMem.data(),oldMem.data_end(),covers,
+                                    (int)hdiffSets.matchScore,hdiffSets.isUseBigCacheMatch!=0);
+        out_covers.resize(covers.size());
+        for (size_t i=0;i<covers.size();++i)
+            setCover(out_covers[i],covers[i].oldPos,covers[i].newPos,covers[i].length);
+    }else{
+        TCoversBuf covers(newMem.size(),oldMem.size());
+        get_match_covers_by_block(newMem.data(),newMem.data_end(),oldMem.data(),oldMem.data_end(),
+                                  &covers,hdiffSets.matchBlockSize,1);
+        out_covers.resize(covers.coverCount());
+        for (size_t i=0;i<covers.coverCount();++i)
+            covers.covers(i,&out_covers[i]);
+    }
+    for (size_t i=0;i<out_covers.size();++i){ //to pos in ref stream
+        out_covers[i].oldPos+=pair.oldRefPos;
+        out_covers[i].newPos+=pair.newRefPos;
+    }
+}
+
+    //push covers[gi...] clipped in new range [newBegin,newEnd)
+    static void _pushClippedCovers(std::vector<hpatch_TCover>& out_covers,const TCovers& covers,size_t& gi,
+                                   hpatch_StreamPos_t newBegin,hpatch_StreamPos_t newEnd){
+        for (;gi<covers.coverCount();++gi){
+            hpatch_TCover c;
+            covers.covers(gi,&c);
+            if (c.newPos+c.length<=newBegin) continue;
+            if (c.newPos>=newEnd) break;
+            if (c.newPos<newBegin){
+                hpatch_StreamPos_t skip=newBegin-c.newPos;
+                c.newPos+=skip;
+                c.oldPos+=skip;
+                c.length-=skip;
+            }
+            const bool isCoverNext=(c.newPos+c.length>newEnd);
+            if (isCoverNext)
+                c.length=newEnd-c.newPos;
+            if (c.length>=kCoverMinMatchLen)
+                out_covers.push_back(c);
+            if (isCoverNext) break; //covers[gi] may be used by next range
+        }
+    }
+
+    //new ranges not covered by pairs' covers, as one stream for match by block
+    struct TNewGapsStream{
+        struct TGap{
+            hpatch_StreamPos_t  newPos;  //pos in newRefStream
+            hpatch_StreamPos_t  gapsPos; //pos in gaps stream
+            hpatch_StreamPos_t  length;
+        };
+        TNewGapsStream(const hpatch_TStreamInput* newRefStream,hpatch_StreamPos_t kMinGapLen)
+        :_newRefStream(newRefStream),_kMinGapLen(kMinGapLen){
+            memset(&base,0,sizeof(base));
+            base.streamImport=this;
+            base.read=_read;
+        }
+        void addGap(hpatch_StreamPos_t newBegin,hpatch_StreamPos_t newEnd){
+            if ((newBegin>=newEnd)||(newEnd-newBegin<_kMinGapLen)) return; //can't match a block
+            TGap gap={newBegin,base.streamSize,newEnd-newBegin};
+            gaps.push_back(gap);
+            base.streamSize+=gap.length;
+        }
+        //cover in gaps stream to covers in newRefStream; split at gaps' border
+        void toNewCovers(std::vector<hpatch_TCover>& out_covers,hpatch_TCover c)const{
+            size_t i=_findGap(c.newPos);
+            while (c.length>0){
+                const TGap& gap=gaps[i++];
+                hpatch_StreamPos_t len=gap.gapsPos+gap.length-c.newPos;
+                if (len>c.length) len=c.length;
+                if (len>=kCoverMinMatchLen){
+                    hpatch_TCover nc;
+                    setCover(nc,c.oldPos,gap.newPos+(c.newPos-gap.gapsPos),len);
+                    out_covers.push_back(nc);
+                }
+                c.oldPos+=len;
+                c.newPos+=len;
+                c.length-=len;
+            }
+        }
+        hpatch_TStreamInput     base;
+        std::vector<TGap>       gaps;
+    private:
+        const hpatch_TStreamInput*  _newRefStream;
+        const hpatch_StreamPos_t    _kMinGapLen;
+        size_t _findGap(hpatch_StreamPos_t gapsPos)const{ //gaps[result] include gapsPos
+            size_t left=0,right=gaps.size();
+            while (right-left>1){
+                size_t mid=left+(right-left)/2;
+                if (gaps[mid].gapsPos<=gapsPos) left=mid; else right=mid;
+            }
+            return left;
+        }
+        static hpatch_BOOL _read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                 unsigned char* out_data,unsigned char* out_data_end){
+            const TNewGapsStream* self=(const TNewGapsStream*)stream->streamImport;
+            size_t i=self->_findGap(readFromPos);
+            while (out_data<out_data_end){
+                const TGap& gap=self->gaps[i++];
+                size_t len=(size_t)(gap.gapsPos+gap.length-readFromPos);
+                if (len>(size_t)(out_data_end-out_data)) len=(size_t)(out_data_end-out_data);
+                const hpatch_TStreamInput* newRef=self->_newRefStream;
+                if (!newRef->read(newRef,gap.newPos+(readFromPos-gap.gapsPos),out_data,out_data+len))
+                    return hpatch_FALSE;
+                out_data+=len;
+                readFromPos+=len;
+            }
+            return hpatch_TRUE;
+        }
+    };
+
+static void _getCoversByFilePair(std::vector<hpatch_TCover>& out_covers,const THDiffSets& hdiffSets,size_t threadNum,
+                                 const std::vector<std::string>& oldList,const std::vector<std::string>& newList,
+                                 std::vector<TFilePair>& pairs,
+                                 const hpatch_TStreamInput* newRefStream,const hpatch_TStreamInput* oldRefStream){
+    TFilePairDiffWork pw;
+    pw.oldList=&oldList;
+    pw.newList=&newList;
+    pw.hdiffSets=&hdiffSets;
+    pw.pairs.swap(pairs);
+    _out_diff_info("  match covers by %" PRIu64 " file pairs (threadNum %d) ...\n",
+                   (hpatch_StreamPos_t)pw.pairs.size(),(int)threadNum);
+    pw.pairCovers.resize(pw.pairs.size());
+    _runParallelWork(pw,_diffFilePair,pw.pairs.size(),threadNum);
+    
+    //only new ranges not covered by pairs match by block with all old ref datas
+    std::vector<hpatch_TCover> pairCovers;
+    TNewGapsStream newGaps(newRefStream,hdiffSets.matchBlockSize);
+    {
+        hpatch_StreamPos_t lastNewEnd=0;
+        for (size_t i=0;i<pw.pairs.size();++i){
+            std::vector<hpatch_TCover>& covers=pw.pairCovers[i];
+            for (size_t ci=0;ci<covers.size();++ci){
+                const hpatch_TCover& c=covers[ci];
+                newGaps.addGap(lastNewEnd,c.newPos);
+                pairCovers.push_back(c);
+                lastNewEnd=c.newPos+c.length;
+            }
+            swapClear(covers);
+        }
+        newGaps.addGap(lastNewEnd,newRefStream->streamSize);
+    }
+    _out_diff_info("  match covers by block between uncovered new %" PRIu64 " bytes & all old ref datas ...\n",
+                   newGaps.base.streamSize);
+    std::vector<hpatch_TCover> gapCovers;
+    if (newGaps.base.streamSize>0){
+        TCoversBuf covers(newGaps.base.streamSize,oldRefStream->streamSize);
+        const hdiff_TMTSets_s mtsets=hdiff_TMTSets_s_kEmpty; //ref streams not MT safe
+        get_match_covers_by_block(&newGaps.base,oldRefStream,&covers,hdiffSets.matchBlockSize,&mtsets);
+        for (size_t i=0;i<covers.coverCount();++i){
+            hpatch_TCover c;
+            covers.covers(i,&c);
+            newGaps.toNewCovers(gapCovers,c);
+        }
+    }
+
+    //merge covers by newPos; pair's covers & gap's covers not overlap in new
+    out_covers.resize(pairCovers.size()+gapCovers.size());
+    size_t pi=0,gi=0;
+    for (size_t i=0;i<out_covers.size();++i){
+        if ((gi==gapCovers.size())||((pi<pairCovers.size())&&(pairCovers[pi].newPos<gapCovers[gi].newPos)))
+            out_covers[i]=pairCovers[pi++];
+        else
+            out_covers[i]=gapCovers[gi++];
+    }
+}
+
+//return isZeroSubDiff
+static bool _getMatchCovers(std::vector<hpatch_TCover>& out_covers,const THDiffSets& hdiffSets,
+                            const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                            const hdiff_TMTSets_s* mtsets){
+    if (hdiffSets.isDiffInMem){
+        TAutoMem newMem((size_t)newData->streamSize);
+        TAutoMem oldMem((size_t)oldData->streamSize);
+        check((newMem.size()==newData->streamSize)&&(oldMem.size()==oldData->streamSize),"ref datas too large error!");
+        check(newData->read(newData,0,newMem.data(),newMem.data_end()),"read new ref datas error!");
+        check(oldData->read(oldData,0,oldMem.data(),oldMem.data_end()),"read old ref datas error!");
+        std::vector<hpatch_TCover_sz> covers;
+        get_match_covers_by_sstring(newMem.data(),newMem.data_end(),oldMem.data(),oldMem.data_end(),covers,
+                                    (int)hdiffSets.matchScore,hdiffSets.isUseBigCacheMatch!=0,0,hdiffSets.threadNum);
+        out_covers.resize(covers.size());
+        for (size_t i=0;i<covers.size();++i)
+            setCover(out_covers[i],covers[i].oldPos,covers[i].newPos,covers[i].length);
+        return false;
+    }else{
+        TCoversBuf covers(newData->streamSize,oldData->streamSize);
+        get_match_covers_by_block(newData,oldData,&covers,hdiffSets.matchBlockSize,mtsets);
+        out_covers.resize(covers.coverCount());
+        for (size_t i=0;i<covers.coverCount();++i)
+            covers.covers(i,&out_covers[i]);
+        return true;
+    }
+}
+
+//hdiffData saved as segments: segment i is diffSize(8byte little-endian)+compressedDiff, the compressedDiff
+//  between all oldData & newData[i*segmentSize,min((i+1)*segmentSize,newSize)); see dir_patch.c
+static const size_t kSegmentDiffSizeBytes=8;
+    static void _writeSegmentDiffSize(const hpatch_TStreamOutput* out_diff,hpatch_StreamPos_t& writeToPos,
+                                      hpatch_StreamPos_t diffSize){
+        TByte buf[kSegmentDiffSizeBytes];
+        for (size_t i=0;i<kSegmentDiffSizeBytes;++i,diffSize>>=8)
+            buf[i]=(TByte)diffSize;
+        writeStream(out_diff,writeToPos,buf,kSegmentDiffSizeBytes);
+    }
+    static hpatch_StreamPos_t _readSegmentDiffSize(const hpatch_TStreamInput* diff,hpatch_StreamPos_t& readPos){
+        TByte buf[kSegmentDiffSizeBytes];
+        check(diff->streamSize-readPos>=kSegmentDiffSizeBytes,"segment diffSize error!");
+        check(diff->read(diff,readPos,buf,buf+kSegmentDiffSizeBytes),"read segment diffSize error!");
+        readPos+=kSegmentDiffSizeBytes;
+        hpatch_StreamPos_t diffSize=0;
+        for (size_t i=kSegmentDiffSizeBytes;i>0;--i)
+            diffSize=(diffSize<<8)|buf[i-1];
+        check(diffSize<=diff->streamSize-readPos,"segment diffSize error!");
+        return diffSize;
+    }
+static void _createSegmentsDiff(const hpatch_TStreamOutput* out_diff,hpatch_StreamPos_t segmentSize,
+                                const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                                const std::vector<hpatch_TCover>& covers,bool isZeroSubDiff,
+                                const hdiff_TCompress* compressPlugin){
+    const TCovers allCovers((void*)covers.data(),covers.size(),false);
+    std::vector<hpatch_TCover> segCovers;
+    size_t ci=0;
+    hpatch_StreamPos_t writeToPos=0;
+    for (hpatch_StreamPos_t newPos=0;newPos<newData->streamSize;newPos+=segmentSize){
+        const hpatch_StreamPos_t newEnd=(newData->streamSize-newPos<segmentSize)?newData->streamSize:newPos+segmentSize;
+        segCovers.clear();
+        _pushClippedCovers(segCovers,allCovers,ci,newPos,newEnd);
+        for (size_t i=0;i<segCovers.size();++i)
+            segCovers[i].newPos-=newPos;
+        TStreamInputClip segNewData;
+        TStreamInputClip_init(&segNewData,newData,newPos,newEnd);
+        hpatch_StreamPos_t sizePos=writeToPos;
+        _writeSegmentDiffSize(out_diff,writeToPos,0); //placeholder, out_diff may not support write after it's end
+        TOffsetStreamOutput ofStream(out_diff,writeToPos);
+        create_compressed_diff_by_covers(&segNewData.base,oldData,segCovers.data(),segCovers.size(),
+                                         isZeroSubDiff,&ofStream,compressPlugin);
+        _writeSegmentDiffSize(out_diff,sizePos,ofStream.outSize);
+        writeToPos+=ofStream.outSize;
+    }
 }
 
 struct CChecksumCombine:public CChecksum{
@@ -278,10 +882,17 @@ static void _getExecuteList(std::vector<size_t>& outExecuteList,
     }
 }
 
+static size_t _getRefListThreadNum(size_t threadNum,size_t kMaxOpenFileNumber){
+    //every thread open 2 files at most when compare
+    const size_t maxThreadNum=kMaxOpenFileNumber/2;
+    if (threadNum>maxThreadNum) threadNum=maxThreadNum;
+    return (threadNum>1)?threadNum:1;
+}
+
 void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
               const TManifest& newManifest,const hpatch_TStreamOutput* outDiffStream,
               const hdiff_TCompress* compressPlugin,hpatch_TChecksum* checksumPlugin,
-              const THDiffSets& hdiffSets,size_t kMaxOpenFileNumber){
+              const THDiffSets& hdiffSets,size_t kMaxOpenFileNumber,CManifestCache* manifestCache){
     assert(listener!=0);
     assert(kMaxOpenFileNumber>=kMaxOpenFileNumber_limit_min);
     if ((checksumPlugin)&&(!hdiffSets.isDiffInMem)){
@@ -312,7 +923,8 @@ void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
     std::vector<cmp_hash_value_t> newHashList;
     getRefList(oldManifest.rootPath,newManifest.rootPath,oldList,newList,
                oldSizeList,newSizeList,dataSamePairList,oldRefIList,newRefIList,
-               isCachedHashs,oldHashList,newHashList);
+               isCachedHashs,oldHashList,newHashList,
+               _getRefListThreadNum(hdiffSets.threadNum,kMaxOpenFileNumber),listener,manifestCache);
     if (hdiffSets.isCheckNotEqual){
         bool isEq=(oldIsDir==newIsDir)
                 &&(oldList.size()==newList.size()) //same file count
@@ -393,6 +1005,12 @@ void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
     }
     sameFileChecksum.appendEnd();
     
+    std::vector<TFilePair> filePairs;
+    if (hdiffSets.isDiffByFilePair)
+        _getFilePairs(filePairs,oldManifest.rootPath,newManifest.rootPath,oldList,newList,oldSizeList,
+                      oldRefIList,newRefIList,newRefSizeList,
+                      _getRefListThreadNum(hdiffSets.threadNum,kMaxOpenFileNumber));
+    
     listener->diffRefInfo(oldList.size(),newList.size(),dataSamePairList.size(),
                           sameFileSize,oldRefIList.size(),newRefIList.size(),
                           oldRefStream.stream->streamSize,newRefStream.stream->streamSize);
@@ -437,7 +1055,13 @@ void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
     packUInt(out_data,sameFileSize);
     packUInt(out_data,newExecuteList.size());   swapClear(newExecuteList);
     packUInt(out_data,privateReservedData.size()); swapClear(privateReservedData);
-    std::vector<TByte> privateExternData;//now empty
+    std::vector<TByte> privateExternData;
+    if (hdiffSets.hdiffSegmentSize>0){
+        check(!hdiffSets.isSingleCompressedDiff,"segmented diffData unsupport single compressed diff");
+        pushCStr(privateExternData,kDirDiffSegmentType);
+        privateExternData.push_back('\0');
+        packUInt(privateExternData,hdiffSets.hdiffSegmentSize);
+    }
     //privateExtern size
     packUInt(out_data,privateExternData.size());
     //externData size
@@ -487,7 +1111,26 @@ void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
     {
         const hdiff_TMTSets_s mtsets={hdiffSets.threadNum,hdiffSets.threadNumSearch_s,false,false};
         TOffsetStreamOutput ofStream(outDiffStream,writeToPos);
-        if (hdiffSets.isSingleCompressedDiff){
+        if (hdiffSets.isDiffByFilePair||(hdiffSets.hdiffSegmentSize>0)){
+            std::vector<hpatch_TCover> covers;
+            bool isZeroSubDiff; //all covers matched by block
+            if (hdiffSets.isDiffByFilePair){
+                _getCoversByFilePair(covers,hdiffSets,_getRefListThreadNum(hdiffSets.threadNum,kMaxOpenFileNumber),
+                                     oldList,newList,filePairs,newRefStream.stream,oldRefStream.stream);
+                isZeroSubDiff=!hdiffSets.isDiffInMem;
+            }else{
+                isZeroSubDiff=_getMatchCovers(covers,hdiffSets,newRefStream.stream,oldRefStream.stream,&mtsets);
+            }
+            if (hdiffSets.hdiffSegmentSize>0)
+                _createSegmentsDiff(&ofStream,hdiffSets.hdiffSegmentSize,newRefStream.stream,oldRefStream.stream,
+                                    covers,isZeroSubDiff,compressPlugin);
+            else if (hdiffSets.isSingleCompressedDiff)
+                create_single_compressed_diff_by_covers(newRefStream.stream,oldRefStream.stream,covers.data(),covers.size(),
+                                                        isZeroSubDiff,&ofStream,compressPlugin,hdiffSets.patchStepMemSize);
+            else
+                create_compressed_diff_by_covers(newRefStream.stream,oldRefStream.stream,covers.data(),covers.size(),
+                                                 isZeroSubDiff,&ofStream,compressPlugin);
+        }else if (hdiffSets.isSingleCompressedDiff){
             if (hdiffSets.isDiffInMem)
                 create_single_compressed_diff_block(newRefStream.stream,oldRefStream.stream,&ofStream,compressPlugin,
                                                     (int)hdiffSets.matchScore,hdiffSets.patchStepMemSize,hdiffSets.isUseBigCacheMatch,
@@ -746,7 +1389,7 @@ clear:
 
 void resave_dirdiff(const hpatch_TStreamInput* in_diff,hpatch_TDecompress* decompressPlugin,
                     const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
-                    hpatch_TChecksum* checksumPlugin){
+                    hpatch_TChecksum* checksumPlugin,size_t threadNum){
     _TDirDiffHead       head;
     TDirDiffInfo        diffInfo;
     assert(in_diff!=0);
@@ -822,11 +1465,25 @@ void resave_dirdiff(const hpatch_TStreamInput* in_diff,hpatch_TDecompress* decom
         TStreamClip clip(in_diff,head.hdiffDataOffset,head.hdiffDataOffset+head.hdiffDataSize);
         
         hpatch_singleCompressedDiffInfo singleDiffInfo;
-        hpatch_BOOL isSingleStreamDiff=getSingleCompressedDiffInfo(&singleDiffInfo,&clip,0);
-        if (isSingleStreamDiff){
-            resave_single_compressed_diff(&clip,decompressPlugin,&ofStream,compressPlugin,&singleDiffInfo);
+        hpatch_BOOL isSingleStreamDiff=hpatch_FALSE;
+        if (head.hdiffSegmentSize>0){ //resave every segment
+            hpatch_StreamPos_t readPos=0;
+            hpatch_StreamPos_t segWritePos=0;
+            while (readPos<clip.streamSize){
+                hpatch_StreamPos_t diffSize=_readSegmentDiffSize(&clip,readPos);
+                TStreamClip segClip(&clip,readPos,readPos+diffSize);
+                hpatch_StreamPos_t sizePos=segWritePos;
+                _writeSegmentDiffSize(&ofStream,segWritePos,0); //placeholder
+                TOffsetStreamOutput segStream(&ofStream,segWritePos);
+                resave_compressed_diff(&segClip,decompressPlugin,&segStream,compressPlugin,0,threadNum);
+                _writeSegmentDiffSize(&ofStream,sizePos,segStream.outSize);
+                segWritePos+=segStream.outSize;
+                readPos+=diffSize;
+            }
+        }else if ((isSingleStreamDiff=getSingleCompressedDiffInfo(&singleDiffInfo,&clip,0))){
+            resave_single_compressed_diff(&clip,decompressPlugin,&ofStream,compressPlugin,&singleDiffInfo,0,0,threadNum);
         }else{
-            resave_compressed_diff(&clip,decompressPlugin,&ofStream,compressPlugin);
+            resave_compressed_diff(&clip,decompressPlugin,&ofStream,compressPlugin,0,threadNum);
         }
         writeToPos+=ofStream.outSize;
     }
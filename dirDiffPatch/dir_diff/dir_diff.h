@@ -36,6 +36,8 @@ struct THDiffSets{
     //diff in mem
     hpatch_BOOL isUseBigCacheMatch;
     hpatch_BOOL isCheckNotEqual;
+    hpatch_BOOL isDiffByFilePair; //dir diff: match covers between paired old & new files by threads
+    size_t      hdiffSegmentSize; //dir diff: !=0 save hdiffData as segments of newRefData, for patch by threads
     size_t matchScore;
     size_t patchStepMemSize;
     size_t matchBlockSize;
@@ -50,6 +52,10 @@ struct THDiffSets{
 struct IDirDiffListener{
     virtual ~IDirDiffListener(){}
     virtual bool isExecuteFile(const std::string& fileName) { return false; }
+    virtual void hashFilesBegin(size_t pathCount,size_t threadNum){}
+    virtual void hashFilesCacheInfo(size_t reusedFileCount){}
+    virtual void hashFilesEnd(){}
+    virtual void compareFilesEnd(size_t sameFilePairCount){}
     virtual void diffRefInfo(size_t oldPathCount,size_t newPathCount,size_t sameFilePairCount,
                              hpatch_StreamPos_t sameFileSize,size_t refOldFileCount,size_t refNewFileCount,
                              hpatch_StreamPos_t refOldFileSize,hpatch_StreamPos_t refNewFileSize){}
@@ -62,7 +68,8 @@ struct IDirDiffListener{
 void dir_diff(IDirDiffListener* listener,const TManifest& oldManifest,
               const TManifest& newManifest,const hpatch_TStreamOutput* outDiffStream,
               const hdiff_TCompress* compressPlugin,hpatch_TChecksum* checksumPlugin,
-              const THDiffSets& hdiffSets,size_t kMaxOpenFileNumber);
+              const THDiffSets& hdiffSets,size_t kMaxOpenFileNumber,
+              CManifestCache* manifestCache=0); //if manifestCache!=0, reuse cached file hash
 bool check_dirdiff(IDirDiffListener* listener,const TManifest& oldManifest,const TManifest& newManifest,
                    const hpatch_TStreamInput* testDiffData,hpatch_TDecompress* decompressPlugin,
                    hpatch_TChecksum* checksumPlugin,size_t kMaxOpenFileNumber,size_t threadNum=1);
@@ -73,7 +80,7 @@ hpatch_BOOL check_dirOldDataChecksum(const char* oldPath,hpatch_TStreamInput* di
 
 void resave_dirdiff(const hpatch_TStreamInput* in_diff,hpatch_TDecompress* decompressPlugin,
                     const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
-                    hpatch_TChecksum* checksumPlugin);
+                    hpatch_TChecksum* checksumPlugin,size_t threadNum=1);
 
 #endif
 #endif //hdiff_dir_diff_h
@@ -27,6 +27,7 @@
  OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "dir_diff_tools.h"
+#include "../../libHDiffPatch/HDiff/private_diff/limit_mem_diff/adler_roll.h"
 
 #if (_IS_NEED_DIR_DIFF_PATCH)
 #ifdef _WIN32
@@ -362,6 +363,58 @@ namespace hdiff_private{
         check(hpatch_TResHandleLimit_close(&limit),"TResHandleLimit_close error!");
     }
     
+    static inline hpatch_uint64_t _sketchHash(hpatch_uint64_t v){ //mix adler bits
+        v^=v>>33; v*=0xff51afd7ed558ccdULL;
+        v^=v>>33; v*=0xc4ceb9fe1a85ec53ULL;
+        v^=v>>33; return v;
+    }
+    static inline void _sketchInsert(std::vector<hpatch_uint64_t>& sketch,hpatch_uint64_t v){
+        if ((sketch.size()==kFileSketchSize)&&(v>=sketch.back())) return;
+        std::vector<hpatch_uint64_t>::iterator it=std::lower_bound(sketch.begin(),sketch.end(),v);
+        if ((it!=sketch.end())&&(*it==v)) return;
+        sketch.insert(it,v);
+        if (sketch.size()>kFileSketchSize) sketch.pop_back();
+    }
+    void getFileSketch(std::vector<hpatch_uint64_t>& out_sketch,const hpatch_TStreamInput* data){
+        out_sketch.clear();
+        if (data->streamSize<kFileSketchWindow) return;
+        out_sketch.reserve(kFileSketchSize+1);
+        TAutoMem buf(kFileSketchWindow+hdiff_kFileIOBufBestSize);
+        TByte* window=buf.data(); //buf[0..kFileSketchWindow) is last window's datas
+        hpatch_StreamPos_t readPos=kFileSketchWindow;
+        checkv(data->read(data,0,window,window+kFileSketchWindow));
+        hpatch_uint64_t adler=fast_adler64_start(window,kFileSketchWindow);
+        _sketchInsert(out_sketch,_sketchHash(adler));
+        while (readPos<data->streamSize){
+            size_t len=hdiff_kFileIOBufBestSize;
+            if (len>(data->streamSize-readPos))
+                len=(size_t)(data->streamSize-readPos);
+            TByte* cur=window+kFileSketchWindow;
+            checkv(data->read(data,readPos,cur,cur+len));
+            readPos+=len;
+            for (size_t i=0;i<len;++i){
+                adler=fast_adler64_roll(adler,kFileSketchWindow,window[i],cur[i]);
+                _sketchInsert(out_sketch,_sketchHash(adler));
+            }
+            memmove(window,cur+len-kFileSketchWindow,kFileSketchWindow);
+        }
+    }
+    double getSketchSimilarity(const std::vector<hpatch_uint64_t>& sketch0,const std::vector<hpatch_uint64_t>& sketch1){
+        //the kFileSketchSize min values of union sketch, count values in both sketch
+        size_t i0=0,i1=0,unionCount=0,sameCount=0;
+        while ((unionCount<kFileSketchSize)&&((i0<sketch0.size())||(i1<sketch1.size()))){
+            if ((i1==sketch1.size())||((i0<sketch0.size())&&(sketch0[i0]<sketch1[i1]))){
+                ++i0;
+            }else if ((i0==sketch0.size())||(sketch1[i1]<sketch0[i0])){
+                ++i1;
+            }else{
+                ++sameCount; ++i0; ++i1;
+            }
+            ++unionCount;
+        }
+        return (unionCount==0)?0:((double)sameCount/unionCount);
+    }
+    
     hpatch_BOOL CFileResHandleLimit::openRes(struct hpatch_IResHandle* res,hpatch_TStreamInput** out_stream){
         CFile* self=(CFile*)res->resImport;
         assert(self->m_file==0);
@@ -177,6 +177,14 @@ inline static size_t pushNameList(std::vector<TByte>& out_data,const std::string
                                   const std::vector<std::string>& nameList){
     return pushNameList(out_data,rootPath.c_str(),nameList.data(),nameList.size()); }
 
+//file content sketch (bottom-k MinHash): the kFileSketchSize min hash values of all kFileSketchWindow bytes
+//  windows in file; used for find similar files (for renamed or moved file).
+static const size_t kFileSketchWindow=32;
+static const size_t kFileSketchSize=64;
+void getFileSketch(std::vector<hpatch_uint64_t>& out_sketch,const hpatch_TStreamInput* data);
+//estimate Jaccard similarity of two files's content by their sketch; return [0,1]
+double getSketchSimilarity(const std::vector<hpatch_uint64_t>& sketch0,const std::vector<hpatch_uint64_t>& sketch1);
+
 void packList(std::vector<TByte>& out_data,const hpatch_StreamPos_t* list,size_t listSize);
 inline static void packList(std::vector<TByte>& out_data,const std::vector<hpatch_StreamPos_t>& list){
     packList(out_data,list.data(),list.size()); }
@@ -31,6 +31,10 @@
 #include "../../_atosize.h"
 #include "../../_hextobytes.h"
 #include "dir_diff_tools.h"
+#include <time.h>
+#if (_IS_USED_MULTITHREAD)
+#include "../../libParallel/parallel_channel.h"
+#endif
 using namespace hdiff_private;
 
 struct CDir{
@@ -78,24 +82,170 @@ static void _getDirSubFileList(const std::string& dirPath,std::vector<std::strin
         _getDirSubFileList(subDirs[i],out_list,filter,rootPathNameLen);
     }
 }
+
+#if (_IS_USED_MULTITHREAD)
+namespace{
+    //paths saved in one memory block, not many small std::string
+    struct TPathArena{
+        std::vector<char>   buf;     //paths, every path end with '\0'
+        std::vector<size_t> pathPos; //path begin pos in buf
+        inline void add(const char* path,size_t pathLen){
+            pathPos.push_back(buf.size());
+            buf.insert(buf.end(),path,path+pathLen+1);
+        }
+        inline void clear(){ buf.clear(); pathPos.clear(); }
+        inline size_t size()const{ return pathPos.size(); }
+        inline const char* path(size_t i)const{ return buf.data()+pathPos[i]; }
+    };
+    
+    //walk dirs by threads, sub dirs found be pushed into dirQueue;
+    //  filter is not thread safe, called with locker once per dir for all sub paths.
+    struct TDirWalkMt:public TMtByChannel{
+        IDirPathIgnore*             filter;
+        size_t                      rootPathNameLen;
+        std::vector<std::string>    dirQueue;  //dirs without '/' wait to walk
+        size_t                      busyCount; //threads walking a dir
+        bool                        isOnError;
+        std::string                 errorInfo;
+        std::vector<TPathArena>     outPaths;  //one arena per thread
+        CHLocker                    locker;
+        HCondvar                    condvar;
+        TDirWalkMt():filter(0),rootPathNameLen(0),busyCount(0),isOnError(false),condvar(0){
+            condvar=condvar_new(); }
+        ~TDirWalkMt(){ if (condvar) condvar_delete(condvar); }
+    };
+    
+    static inline bool _cmp_path(const char* x,const char* y){ return strcmp(x,y)<0; }
+}
+
+static void _walkOneDir(TDirWalkMt& mt,const std::string& dirPath,TPathArena& subPaths,
+                        std::vector<size_t>& subDirs,std::string& tempPath,TPathArena& out_paths){
+    subPaths.clear();
+    subDirs.clear();
+    {//read all sub names
+        CDir dir(dirPath);
+        check((dir.handle!=0),"hdiff_dirOpenForRead \""+dirPath+"\" error!");
+        while (true) {
+            hpatch_TPathType  type;
+            const char* path=0;
+            check(hdiff_dirNext(dir.handle,&type,&path),"hdiff_dirNext \""+dirPath+"\" error!");
+            if (path==0) break; //finish
+            if ((0==strcmp(path,""))||(0==strcmp(path,"."))||(0==strcmp(path,"..")))
+                continue;
+            if ((type!=kPathType_dir)&&(type!=kPathType_file)) continue;
+            tempPath.assign(dirPath);
+            tempPath.push_back(kPatch_dirSeparator);
+            tempPath.append(path);
+            if (type==kPathType_dir)
+                assignDirTag(tempPath);
+            subPaths.add(tempPath.c_str(),tempPath.size());
+        }
+    }
+    {//filter
+        CAutoLocker _autoLocker(mt.locker.locker);
+        for (size_t i=0;i<subPaths.size();++i){
+            tempPath.assign(subPaths.path(i));
+            if (mt.filter->isNeedIgnore(tempPath,mt.rootPathNameLen)) continue;
+            out_paths.add(tempPath.c_str(),tempPath.size());
+            if (hdiff_private::isDirName(tempPath))
+                subDirs.push_back(i);
+        }
+    }
+}
+
+static void _dirWalk_thread(int threadIndex,void* workData){
+    TDirWalkMt& mt=*(TDirWalkMt*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(mt);
+    TPathArena&  out_paths=mt.outPaths[threadIndex];
+    TPathArena   subPaths;
+    std::vector<size_t> subDirs;
+    std::string  dirPath;
+    std::string  tempPath;
+    try {
+        while (true) {
+            {
+                CAutoLocker _autoLocker(mt.locker.locker);
+                while (mt.dirQueue.empty()&&(mt.busyCount>0)&&(!mt.isOnError))
+                    condvar_wait(mt.condvar,&_autoLocker);
+                if (mt.isOnError||mt.dirQueue.empty()) break; //error or all dirs walked
+                dirPath.swap(mt.dirQueue.back());
+                mt.dirQueue.pop_back();
+                ++mt.busyCount;
+            }
+            _walkOneDir(mt,dirPath,subPaths,subDirs,tempPath,out_paths);
+            {
+                CAutoLocker _autoLocker(mt.locker.locker);
+                --mt.busyCount;
+                for (size_t i=0;i<subDirs.size();++i){
+                    const char* subDir=subPaths.path(subDirs[i]);
+                    mt.dirQueue.push_back(std::string(subDir,subDir+strlen(subDir)-1)); //no '/'
+                }
+                if ((!subDirs.empty())||(mt.busyCount==0))
+                    condvar_broadcast(mt.condvar);
+            }
+        }
+    } catch (const std::exception& e) {
+        CAutoLocker _autoLocker(mt.locker.locker);
+        if (!mt.isOnError){
+            mt.isOnError=true;
+            mt.errorInfo=e.what();
+        }
+        condvar_broadcast(mt.condvar);
+    }
+}
+
+static void _getDirSubFileList_mt(const std::string& dirPath,std::vector<std::string>& out_list,
+                                  IDirPathIgnore* filter,size_t rootPathNameLen,size_t threadNum){
+    TDirWalkMt mt;
+    mt.filter=filter;
+    mt.rootPathNameLen=rootPathNameLen;
+    mt.outPaths.resize(threadNum);
+    mt.dirQueue.push_back(dirPath);
+    check(mt.start_threads((int)threadNum,_dirWalk_thread,&mt,true),"start dir walk threads error!");
+    mt.wait_all_thread_end();
+    check(!mt.isOnError,mt.errorInfo);
+    
+    std::vector<const char*> paths;
+    size_t pathCount=0;
+    for (size_t t=0;t<threadNum;++t)
+        pathCount+=mt.outPaths[t].size();
+    paths.reserve(pathCount);
+    for (size_t t=0;t<threadNum;++t){
+        const TPathArena& arena=mt.outPaths[t];
+        for (size_t i=0;i<arena.size();++i)
+            paths.push_back(arena.path(i));
+    }
+    std::sort(paths.begin(),paths.end(),_cmp_path); //same order as sortDirPathList()
+    out_list.reserve(out_list.size()+pathCount);
+    for (size_t i=0;i<pathCount;++i)
+        out_list.push_back(paths[i]);
+}
+#endif
+
 void getDirAllPathList(const std::string& dirPath,std::vector<std::string>& out_list,
-                       IDirPathIgnore* filter){
+                       IDirPathIgnore* filter,size_t threadNum){
     assert(hdiff_private::isDirName(dirPath));
-    out_list.push_back(dirPath);
     const std::string dirName(dirPath.c_str(),dirPath.c_str()+dirPath.size()-1); //without '/'
+#if (_IS_USED_MULTITHREAD)
+    if ((threadNum>1)&&out_list.empty()){
+        out_list.push_back(dirPath);
+        _getDirSubFileList_mt(dirName,out_list,filter,dirName.size(),threadNum); //sorted
+        return;
+    }
+#endif
+    out_list.push_back(dirPath);
     _getDirSubFileList(dirName,out_list,filter,dirName.size());
     sortDirPathList(out_list);
 }
 
-void get_manifest(IDirPathIgnore* listener,const std::string& inputPath,TManifest& out_manifest){
+void get_manifest(IDirPathIgnore* listener,const std::string& inputPath,TManifest& out_manifest,size_t threadNum){
     assert(listener!=0);
     std::vector<std::string>& pathList=out_manifest.pathList;
     pathList.clear();
     out_manifest.rootPath=inputPath;
     const bool inputIsDir=isDirName(inputPath);
     if (inputIsDir){
-        getDirAllPathList(inputPath,pathList,listener);
-        sortDirPathList(pathList);
+        getDirAllPathList(inputPath,pathList,listener,threadNum); //sorted
     }else{
         pathList.push_back(inputPath);
     }
@@ -128,10 +278,11 @@ static std::string kChecksumTypeTag="Checksum_Type:";
 static std::string kPathCountTag="Path_Count:";
 static std::string kPathTag="Path:";
 
-void save_manifest(const TManifest& manifest,
-                   const hpatch_TStreamOutput* outManifest,hpatch_TChecksum* checksumPlugin){
+void save_manifest(const TManifest& manifest,const hpatch_TStreamOutput* outManifest,
+                   hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache){
     const std::vector<std::string>& pathList=manifest.pathList;
     std::vector<TByte> out_data;
+    std::vector<TByte> fileChecksum;
     {//head
         pushCStr(out_data,"HDiff_Manifest_Version:1.0\n");
         pushCStr(out_data,kChecksumTypeTag.c_str());
@@ -147,12 +298,9 @@ void save_manifest(const TManifest& manifest,
         const std::string& pathName=pathList[i];
         pushCStr(out_data, "Path:");
         if ((!isDirName(pathName))&&(checksumPlugin!=0)){//checksum file
-            CChecksum  fileChecksum(checksumPlugin);
-            CFileStreamInput file(pathName);
-            fileChecksum.append(&file.base);
-            fileChecksum.appendEnd();
+            getFileChecksum(fileChecksum,pathName,checksumPlugin,manifestCache);
             //to hex
-            const std::vector<TByte>& datas=fileChecksum.checksum;
+            const std::vector<TByte>& datas=fileChecksum;
             checkv(datas.size()==checksumPlugin->checksumByteSize());
             std::string hexs(datas.size()*2,' ');
             bytes_to_hexs(datas.data(),datas.size(),&hexs[0]);
@@ -169,11 +317,11 @@ void save_manifest(const TManifest& manifest,
           "write manifest data error!");
 }
 
-void save_manifest(IDirPathIgnore* listener,const std::string& inputPath,
-                   const hpatch_TStreamOutput* outManifest,hpatch_TChecksum* checksumPlugin){
+void save_manifest(IDirPathIgnore* listener,const std::string& inputPath,const hpatch_TStreamOutput* outManifest,
+                   hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache){
     TManifest manifest;
     get_manifest(listener,inputPath,manifest);
-    save_manifest(manifest,outManifest,checksumPlugin);
+    save_manifest(manifest,outManifest,checksumPlugin,manifestCache);
 }
 
 void load_manifestFile(TManifestSaved& out_manifest,const std::string& rootPath,
@@ -304,7 +452,8 @@ void load_manifest(TManifestSaved& out_manifest,const std::string& rootPath,
     }
     check(out_manifest.pathList.size()==pathCount,"manifest path count error!");
 }
-void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksumPlugin){
+void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksumPlugin,
+                       CManifestCache* manifestCache){
     if (checksumPlugin==0){
         check(manifest.checksumType.empty(),
               "checksum_manifest checksumPlugin can't null, need checksumType: "+manifest.checksumType);
@@ -316,6 +465,7 @@ void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksum
     if (checksumByteSize>0)
         check(checksumByteSize==checksumPlugin->checksumByteSize(),"checksum_manifest checksumByteSize");
     
+    std::vector<TByte> fileChecksum;
     for (size_t i=0; i<manifest.pathList.size(); ++i) {
         const std::string& pathName=manifest.pathList[i];
         hpatch_TPathType pathType;
@@ -324,16 +474,181 @@ void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksum
             check(pathType==kPathType_dir,"checksum_manifest dir: "+pathName);
         }else{
             check(pathType==kPathType_file,"checksum_manifest file: "+pathName);
-            CChecksum fileChecksum(checksumPlugin);
-            CFileStreamInput file(pathName);
-            fileChecksum.append(&file.base);
-            fileChecksum.appendEnd();
+            getFileChecksum(fileChecksum,pathName,checksumPlugin,manifestCache);
             const TByte* savedChecksum=&manifest.checksumList[i*checksumByteSize];
-            check(0==memcmp(savedChecksum,fileChecksum.checksum.data(),checksumByteSize),
+            check(0==memcmp(savedChecksum,fileChecksum.data(),checksumByteSize),
                   "checksum_manifest checksum: "+pathName);
         }
     }
 }
 
 
+static const std::string kCacheVersionTag="HDiff_Manifest_Cache_Version:1.0";
+static const std::string kCacheSavedTimeTag="Saved_Time:";
+static const std::string kCacheItemCountTag="Item_Count:";
+static const std::string kCacheItemTag="Item:";
+
+CManifestCache::CManifestCache(const std::string& cacheFileName,bool isForceVerify)
+:_cacheFileName(cacheFileName),_isForceVerify(isForceVerify),_updatedCount(0){
+    if (_cacheFileName.empty()) return;
+    try {
+        _load();
+    } catch (const std::exception&) {
+        _items.clear(); //cache file damaged, as empty cache
+    }
+}
+
+    static bool _readU64(const char*& cur,const char* end,hpatch_uint64_t* out_v){
+        const char* pos=std::find(cur,end,':');
+        if ((pos==end)||(!a_to_u64(cur,pos-cur,out_v))) return false;
+        cur=pos+1;
+        return true;
+    }
+void CManifestCache::_load(){
+    hpatch_TPathType cacheType;
+    checkv(hpatch_getPathStat(_cacheFileName.c_str(),&cacheType,0));
+    if (cacheType!=kPathType_file) return; //not found cache, empty
+    CFileStreamInput cf(_cacheFileName);
+    TAutoMem buf((size_t)cf.base.streamSize);
+    checkv(buf.size()==cf.base.streamSize);
+    checkv(cf.base.read(&cf.base,0,buf.data(),buf.data_end()));
+    const char* cur=(const char*)buf.data();
+    const char* const end=(const char*)buf.data_end();
+    hpatch_uint64_t savedTime=0;
+    hpatch_uint64_t itemCount=0;
+    bool isVersionOk=false;
+    while (cur<end){
+        const char* lineEnd=std::find(cur,end,'\n');
+        const char* line=cur;
+        cur=(lineEnd<end)?lineEnd+1:end;
+        if ((size_t)(lineEnd-line)>=kCacheItemTag.size()
+            &&(0==memcmp(line,kCacheItemTag.c_str(),kCacheItemTag.size()))){
+            //Item:checksumType:hexChecksum:fileSize:mtime_ns:inode:path
+            checkv(isVersionOk);
+            line+=kCacheItemTag.size();
+            const char* typeEnd=std::find(line,lineEnd,':');
+            checkv(typeEnd!=lineEnd);
+            const char* hexEnd=std::find(typeEnd+1,lineEnd,':');
+            checkv(hexEnd!=lineEnd);
+            const size_t hexSize=hexEnd-(typeEnd+1);
+            checkv((hexSize&1)==0);
+            TItem item;
+            item.checksum.resize(hexSize/2);
+            if (hexSize>0)
+                checkv(hexs_to_bytes(typeEnd+1,hexSize,(TByte*)&item.checksum[0]));
+            const char* pv=hexEnd+1;
+            checkv(_readU64(pv,lineEnd,&item.fileTag.fileSize));
+            checkv(_readU64(pv,lineEnd,&item.fileTag.mtime_ns));
+            checkv(_readU64(pv,lineEnd,&item.fileTag.inode));
+            checkv(pv<lineEnd);
+            // if file modified in the same second after hashed, mtime maybe not changed
+            item.isRacy=(item.fileTag.mtime_ns/1000000000>=savedTime);
+            _items[std::string(line,typeEnd+1)+std::string(pv,lineEnd)]=item;
+        }else if ((size_t)(lineEnd-line)>=kCacheSavedTimeTag.size()
+                  &&(0==memcmp(line,kCacheSavedTimeTag.c_str(),kCacheSavedTimeTag.size()))){
+            line+=kCacheSavedTimeTag.size();
+            checkv(a_to_u64(line,lineEnd-line,&savedTime));
+        }else if ((size_t)(lineEnd-line)>=kCacheItemCountTag.size()
+                  &&(0==memcmp(line,kCacheItemCountTag.c_str(),kCacheItemCountTag.size()))){
+            line+=kCacheItemCountTag.size();
+            checkv(a_to_u64(line,lineEnd-line,&itemCount));
+        }else if ((size_t)(lineEnd-line)==kCacheVersionTag.size()
+                  &&(0==memcmp(line,kCacheVersionTag.c_str(),kCacheVersionTag.size()))){
+            isVersionOk=true;
+        }
+    }
+    check(_items.size()==itemCount,"manifest cache item count error!"); //file not completed?
+}
+
+bool CManifestCache::find(const std::string& checksumType,const std::string& fileName,
+                          const hpatch_TFileStatTag& fileTag,unsigned char* out_checksum,size_t checksumByteSize)const{
+    if (_isForceVerify) return false;
+    std::map<std::string,TItem>::const_iterator it=_items.find(checksumType+":"+fileName);
+    if (it==_items.end()) return false;
+    const TItem& item=it->second;
+    if (item.isRacy||(item.checksum.size()!=checksumByteSize)
+        ||(item.fileTag.fileSize!=fileTag.fileSize)||(item.fileTag.mtime_ns!=fileTag.mtime_ns)
+        ||(item.fileTag.inode!=fileTag.inode))
+        return false;
+    if (checksumByteSize>0)
+        memcpy(out_checksum,item.checksum.data(),checksumByteSize);
+    return true;
+}
+
+void CManifestCache::update(const std::string& checksumType,const std::string& fileName,
+                            const hpatch_TFileStatTag& fileTag,const unsigned char* checksum,size_t checksumByteSize){
+    TItem& item=_items[checksumType+":"+fileName];
+    item.fileTag=fileTag;
+    item.checksum.assign((const char*)checksum,checksumByteSize);
+    item.isRacy=false;
+    ++_updatedCount;
+}
+
+void CManifestCache::save(){
+    if (_updatedCount==0) return;
+    std::vector<TByte> out_data;
+    char numBuf[_u64_to_a_kMaxLen];
+    pushString(out_data,kCacheVersionTag+"\n");
+    pushString(out_data,kCacheSavedTimeTag+u64_to_enough_a((hpatch_uint64_t)time(0),numBuf)+"\n");
+    pushString(out_data,kCacheItemCountTag+u64_to_enough_a(_items.size(),numBuf)+"\n\n");
+    std::string hexs;
+    for (std::map<std::string,TItem>::const_iterator it=_items.begin();it!=_items.end();++it){
+        const TItem& item=it->second;
+        pushString(out_data,kCacheItemTag);
+        const size_t typeLen=it->first.find(':');
+        out_data.insert(out_data.end(),it->first.begin(),it->first.begin()+typeLen+1);
+        hexs.assign(item.checksum.size()*2,' ');
+        if (!item.checksum.empty())
+            bytes_to_hexs((const TByte*)item.checksum.data(),item.checksum.size(),&hexs[0]);
+        pushString(out_data,hexs+":");
+        pushCStr(out_data,u64_to_enough_a(item.fileTag.fileSize,numBuf)); pushCStr(out_data,":");
+        pushCStr(out_data,u64_to_enough_a(item.fileTag.mtime_ns,numBuf)); pushCStr(out_data,":");
+        pushCStr(out_data,u64_to_enough_a(item.fileTag.inode,numBuf));    pushCStr(out_data,":");
+        out_data.insert(out_data.end(),it->first.begin()+typeLen+1,it->first.end());
+        pushCStr(out_data,"\n");
+    }
+    //write to a temp file & rename it, old cache file is not damaged when write failed
+    char tempFileName[hpatch_kPathMaxSize];
+    check(hpatch_getTempPathName(_cacheFileName.c_str(),tempFileName,tempFileName+sizeof(tempFileName)),
+          "get manifest cache temp file name \""+_cacheFileName+"\" error!");
+    {
+        hpatch_TFileStreamOutput of;
+        hpatch_TFileStreamOutput_init(&of);
+        bool isWriteOk=hpatch_TFileStreamOutput_open(&of,tempFileName,out_data.size())
+                       &&of.base.write(&of.base,0,out_data.data(),out_data.data()+out_data.size());
+        isWriteOk=hpatch_TFileStreamOutput_close(&of)&&isWriteOk;
+        if (!isWriteOk){
+            hpatch_removeFile(tempFileName);
+            check(false,"write manifest cache \""+_cacheFileName+"\" error!");
+        }
+    }
+    //rename() replace file atomically on posix; else remove old cache file & rename
+    bool isRenameOk=hpatch_renamePath(tempFileName,_cacheFileName.c_str())
+                    ||(hpatch_removeFile(_cacheFileName.c_str())&&hpatch_renamePath(tempFileName,_cacheFileName.c_str()));
+    if (!isRenameOk){
+        hpatch_removeFile(tempFileName);
+        check(false,"rename manifest cache \""+_cacheFileName+"\" error!");
+    }
+    _updatedCount=0;
+}
+
+void getFileChecksum(std::vector<TByte>& out_checksum,const std::string& fileName,
+                     hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache){
+    const size_t checksumByteSize=checksumPlugin->checksumByteSize();
+    out_checksum.resize(checksumByteSize);
+    hpatch_TFileStatTag fileTag;
+    const bool isHaveTag=(manifestCache!=0)&&hpatch_getFileStatTag(fileName.c_str(),&fileTag);
+    if (isHaveTag&&manifestCache->find(checksumPlugin->checksumType(),fileName,fileTag,
+                                       out_checksum.data(),checksumByteSize))
+        return; //ok, reuse
+    CChecksum fileChecksum(checksumPlugin);
+    CFileStreamInput file(fileName);
+    fileChecksum.append(&file.base);
+    fileChecksum.appendEnd();
+    out_checksum.swap(fileChecksum.checksum);
+    if (isHaveTag&&(fileTag.fileSize==file.base.streamSize))
+        manifestCache->update(checksumPlugin->checksumType(),fileName,fileTag,
+                              out_checksum.data(),checksumByteSize);
+}
+
 #endif
@@ -34,8 +34,10 @@
 #include <string>
 #include <vector>
 #include <algorithm> //std::sort
+#include <map>
 #include "../../libHDiffPatch/HDiff/diff_types.h"
 #include "../../libHDiffPatch/HPatch/checksum_plugin.h"
+#include "../../file_for_patch.h"
 
 static inline
 void assignDirTag(std::string& dir){
@@ -53,20 +55,54 @@ struct IDirPathIgnore{
     virtual bool isNeedIgnore(const std::string& path,size_t rootPathNameLen)=0;
 };
 
+//if threadNum>1, walk sub dirs by threads (filter called with a locker)
 void getDirAllPathList(const std::string& dir,std::vector<std::string>& out_list,
-                       IDirPathIgnore* filter);
+                       IDirPathIgnore* filter,size_t threadNum=1);
 
 struct TManifest{
     std::string                 rootPath;
     std::vector<std::string>    pathList;
 };
 
-void get_manifest(IDirPathIgnore* listener,const std::string& inputPath,TManifest& out_manifest);
-void save_manifest(const TManifest& manifest,
-                   const hpatch_TStreamOutput* outManifest,hpatch_TChecksum* checksumPlugin);
+// manifest cache: saved files's checksum, key by (checksumType,path) & check by file's (size,mtime,inode);
+//   if file's stat not changed since cache saved, reuse the checksum, not need read file data again.
+class CManifestCache{
+public:
+    // load cache from cacheFileName if exists (if load fail then as empty cache);
+    // isForceVerify: not reuse any cached checksum, re-read all files & update cache.
+    explicit CManifestCache(const std::string& cacheFileName,bool isForceVerify=false);
+    // if found cached checksum, copy it to out_checksum & return true;
+    //   it's thread safe when no update() running.
+    bool find(const std::string& checksumType,const std::string& fileName,const hpatch_TFileStatTag& fileTag,
+              unsigned char* out_checksum,size_t checksumByteSize)const;
+    void update(const std::string& checksumType,const std::string& fileName,const hpatch_TFileStatTag& fileTag,
+                const unsigned char* checksum,size_t checksumByteSize);
+    void save(); //write to cacheFileName if updated
+    inline size_t updatedCount()const{ return _updatedCount; }
+private:
+    struct TItem{
+        hpatch_TFileStatTag fileTag;
+        std::string         checksum;
+        bool                isRacy; //file modified at the time when cache saved, can't reuse
+    };
+    std::string                 _cacheFileName;
+    bool                        _isForceVerify;
+    size_t                      _updatedCount;
+    std::map<std::string,TItem> _items; //key: checksumType+":"+fileName
+    void _load();
+};
+
+// file's checksum by checksumPlugin; if manifestCache!=0, try reuse cached checksum
+void getFileChecksum(std::vector<unsigned char>& out_checksum,const std::string& fileName,
+                     hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache=0);
 
-void save_manifest(IDirPathIgnore* listener,const std::string& inputPath,
-                   const hpatch_TStreamOutput* outManifest,hpatch_TChecksum* checksumPlugin);
+void get_manifest(IDirPathIgnore* listener,const std::string& inputPath,TManifest& out_manifest,
+                  size_t threadNum=1);
+void save_manifest(const TManifest& manifest,const hpatch_TStreamOutput* outManifest,
+                   hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache=0);
+
+void save_manifest(IDirPathIgnore* listener,const std::string& inputPath,const hpatch_TStreamOutput* outManifest,
+                   hpatch_TChecksum* checksumPlugin,CManifestCache* manifestCache=0);
 
 struct TManifestSaved:public TManifest{
     std::string                     checksumType;
@@ -74,14 +110,12 @@ struct TManifestSaved:public TManifest{
     std::vector<unsigned char>      checksumList;//size==checksumByteSize*pathList.size()
 };
 
-void save_manifest(IDirPathIgnore* filter,const std::string& inputPath,
-                   const hpatch_TStreamOutput* outManifest,hpatch_TChecksum* checksumPlugin);
-
 void load_manifestFile(TManifestSaved& out_manifest,const std::string& rootPath,
                        const std::string& manifestFile);
 void load_manifest(TManifestSaved& out_manifest,const std::string& rootPath,
                    const hpatch_TStreamInput* manifestStream);
-void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksumPlugin);
+void checksum_manifest(const TManifestSaved& manifest,hpatch_TChecksum* checksumPlugin,
+                       CManifestCache* manifestCache=0);
 
 #endif
 #endif //hdiff_dir_manifest_h
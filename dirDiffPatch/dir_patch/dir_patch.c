@@ -33,8 +33,13 @@
 #include "dir_patch_tools.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h> //malloc
+#if (_IS_USED_MULTITHREAD)
+#include "../../libParallel/parallel_import_c.h"
+#endif
 
 static const char* kVersionType="HDIFF19";
+static const char* kSegmentType="seg"; //privateExternData type of segmented hdiffData
 
 #define TUInt hpatch_StreamPos_t
 
@@ -71,6 +76,98 @@ clear:
     return result;
 }
 
+//segmented hdiffData (hdiffz -D-seg): privateExternData is kSegmentType+'\0'+segmentSize(packUInt);
+//  hdiffData is segments list, segment i is diffSize(8byte little-endian)+compressedDiff, the compressedDiff
+//  between all oldRefData & newRefData[i*segmentSize,min((i+1)*segmentSize,newRefDataSize)).
+#define _kSegmentDiffSizeBytes 8
+
+static hpatch_BOOL _read_privateExtern(_TDirDiffHead* out_head,const hpatch_TStreamInput* dirDiffFile){
+    hpatch_BOOL       result=hpatch_TRUE;
+    TStreamCacheClip  _clip;
+    TStreamCacheClip* clip=&_clip;
+    TByte             temp_cache[hpatch_kStreamCacheSize];
+    char              externType[hpatch_kMaxPluginTypeLength+1];
+    out_head->hdiffSegmentSize=0;
+    _TStreamCacheClip_init(clip,dirDiffFile,out_head->privateExternDataOffset,
+                           out_head->privateExternDataOffset+out_head->privateExternDataSize,
+                           temp_cache,sizeof(temp_cache));
+    if (!_TStreamCacheClip_readType_end(clip,'\0',externType)) return result;//unknown extern data, not error
+    if (0==strcmp(externType,kSegmentType)){
+        unpackUIntTo(&out_head->hdiffSegmentSize,clip);
+        check(out_head->hdiffSegmentSize>0);
+    }
+clear:
+    return result;
+}
+
+static hpatch_BOOL _readSegmentDiffSize(const hpatch_TStreamInput* hdiffData,hpatch_StreamPos_t pos,
+                                        hpatch_StreamPos_t* out_diffSize){
+    TByte buf[_kSegmentDiffSizeBytes];
+    hpatch_StreamPos_t diffSize=0;
+    size_t i;
+    if (pos+_kSegmentDiffSizeBytes>hdiffData->streamSize) return hpatch_FALSE;
+    if (!hdiffData->read(hdiffData,pos,buf,buf+_kSegmentDiffSizeBytes)) return hpatch_FALSE;
+    for (i=_kSegmentDiffSizeBytes;i>0;--i)
+        diffSize=(diffSize<<8)|buf[i-1];
+    if (diffSize>hdiffData->streamSize-(pos+_kSegmentDiffSizeBytes)) return hpatch_FALSE;
+    *out_diffSize=diffSize;
+    return hpatch_TRUE;
+}
+
+static hpatch_inline
+size_t _getSegmentCount(hpatch_StreamPos_t newDataSize,hpatch_StreamPos_t segmentSize){
+    hpatch_StreamPos_t count=(newDataSize+segmentSize-1)/segmentSize;
+    return (count==(size_t)count)?(size_t)count:0; }
+
+//out_diffPosList[i]: segment i pos in hdiffData; out_diffPosList[segmentCount]==hdiffData->streamSize
+static hpatch_BOOL _getSegmentDiffPosList(hpatch_StreamPos_t* out_diffPosList,size_t segmentCount,
+                                          const hpatch_TStreamInput* hdiffData){
+    hpatch_StreamPos_t pos=0;
+    size_t i;
+    for (i=0;i<segmentCount;++i){
+        hpatch_StreamPos_t diffSize;
+        out_diffPosList[i]=pos;
+        if (!_readSegmentDiffSize(hdiffData,pos,&diffSize)) return hpatch_FALSE;
+        pos+=_kSegmentDiffSizeBytes+diffSize;
+    }
+    out_diffPosList[segmentCount]=pos;
+    return (pos==hdiffData->streamSize);
+}
+
+//hdiffInfo of all segments
+static hpatch_BOOL _getSegmentsDiffInfo(hpatch_compressedDiffInfo* out_info,const hpatch_TStreamInput* hdiffData,
+                                        hpatch_StreamPos_t oldDataSize,hpatch_StreamPos_t newDataSize,
+                                        hpatch_StreamPos_t segmentSize){
+    hpatch_BOOL result=hpatch_TRUE;
+    hpatch_StreamPos_t pos=0;
+    hpatch_StreamPos_t newPos=0;
+    memset(out_info,0,sizeof(*out_info));
+    out_info->oldDataSize=oldDataSize;
+    out_info->newDataSize=newDataSize;
+    while (newPos<newDataSize){
+        hpatch_compressedDiffInfo segInfo;
+        hpatch_StreamPos_t diffSize;
+        TStreamInputClip diffClip;
+        const hpatch_StreamPos_t segNewSize=(newDataSize-newPos<segmentSize)?(newDataSize-newPos):segmentSize;
+        check(_readSegmentDiffSize(hdiffData,pos,&diffSize));
+        pos+=_kSegmentDiffSizeBytes;
+        TStreamInputClip_init(&diffClip,hdiffData,pos,pos+diffSize);
+        check(getCompressedDiffInfo(&segInfo,&diffClip.base));
+        check(segInfo.oldDataSize==oldDataSize);
+        check(segInfo.newDataSize==segNewSize);
+        if (newPos==0)
+            memcpy(out_info->compressType,segInfo.compressType,sizeof(segInfo.compressType));
+        else
+            check(0==strcmp(out_info->compressType,segInfo.compressType));
+        out_info->compressedCount+=segInfo.compressedCount;
+        pos+=diffSize;
+        newPos+=segNewSize;
+    }
+    check(pos==hdiffData->streamSize);
+clear:
+    return result;
+}
+
 static hpatch_BOOL _read_dirdiff_head(TDirDiffInfo* out_info,_TDirDiffHead* out_head,
                                       const hpatch_TStreamInput* dirDiffFile,hpatch_BOOL* out_isAppendContinue){
     hpatch_BOOL result=hpatch_TRUE;
@@ -149,12 +246,21 @@ static hpatch_BOOL _read_dirdiff_head(TDirDiffInfo* out_info,_TDirDiffHead* out_
         curPos+=out_info->externDataSize;
         out_head->hdiffDataOffset=curPos;
         out_head->hdiffDataSize=dirDiffFile->streamSize-curPos;
+        out_head->hdiffSegmentSize=0;
         if (isLoadHDiffInfo){
             TStreamInputClip_init(&hdiffStream,dirDiffFile,out_head->hdiffDataOffset,
                                   out_head->hdiffDataOffset+out_head->hdiffDataSize);
+            if (out_head->privateExternDataSize>0)
+                check(_read_privateExtern(out_head,dirDiffFile));
 #if (_IS_NEED_SINGLE_STREAM_DIFF)
             out_info->isSingleCompressedDiff=hpatch_FALSE;
             out_info->sdiffInfo.stepMemSize=0;
+#endif
+            if (out_head->hdiffSegmentSize>0){
+                check(_getSegmentsDiffInfo(&out_info->hdiffInfo,&hdiffStream.base,savedOldRefSize,
+                                           savedNewRefSize,out_head->hdiffSegmentSize));
+            }else
+#if (_IS_NEED_SINGLE_STREAM_DIFF)
             if (getSingleCompressedDiffInfo(&out_info->sdiffInfo,&hdiffStream.base,0)){
                 out_info->isSingleCompressedDiff=hpatch_TRUE;
                 if (strlen(out_info->sdiffInfo.compressType)==0)
@@ -546,6 +652,340 @@ void _do_checksumOldRef(TDirPatcher* self,const hpatch_TStreamInput* oldData,hpa
     }
 }
 
+typedef struct _TOffsetStreamOutput{
+    hpatch_TStreamOutput        base;
+    const hpatch_TStreamOutput* dst;
+    hpatch_StreamPos_t          offset;
+} _TOffsetStreamOutput;
+static hpatch_BOOL _offsetStream_write(const hpatch_TStreamOutput* stream,hpatch_StreamPos_t writeToPos,
+                                       const unsigned char* data,const unsigned char* data_end){
+    const _TOffsetStreamOutput* self=(const _TOffsetStreamOutput*)stream->streamImport;
+    return self->dst->write(self->dst,self->offset+writeToPos,data,data_end);
+}
+static void _offsetStream_init(_TOffsetStreamOutput* self,const hpatch_TStreamOutput* dst,
+                               hpatch_StreamPos_t offset,hpatch_StreamPos_t streamSize){
+    self->base.streamImport=self;
+    self->base.streamSize=streamSize;
+    self->base.read_writed=0;
+    self->base.write=_offsetStream_write;
+    self->dst=dst;
+    self->offset=offset;
+}
+
+#if (_IS_USED_MULTITHREAD)
+//shared stream for threads, read by locker
+typedef struct _TLockedStreamInput{
+    hpatch_TStreamInput         base;
+    const hpatch_TStreamInput*  src;
+    HLocker                     locker;
+} _TLockedStreamInput;
+static hpatch_BOOL _lockedStream_read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                      unsigned char* out_data,unsigned char* out_data_end){
+    const _TLockedStreamInput* self=(const _TLockedStreamInput*)stream->streamImport;
+    hpatch_BOOL result;
+    c_locker_enter(self->locker);
+    result=self->src->read(self->src,readFromPos,out_data,out_data_end);
+    c_locker_leave(self->locker);
+    return result;
+}
+static void _lockedStream_init(_TLockedStreamInput* self,const hpatch_TStreamInput* src,HLocker locker){
+    self->base.streamImport=self;
+    self->base.streamSize=src->streamSize;
+    self->base.read=_lockedStream_read;
+    self->src=src;
+    self->locker=locker;
+}
+
+//oldRef stream of a worker thread: opened by it's own file handles (limited by it's own hpatch_TResHandleLimit),
+//  not need lock for read, and other threads not close it's opened handles;
+//  small res resident in shared memory cache read by memory.
+typedef struct _TWorkerOldRef{
+    TDirPatcher*                patcher;
+    hpatch_TRefStream           refStream;
+    hpatch_TResHandleLimit      resLimit;
+    hpatch_IResHandle*          resList;
+    hpatch_TFileStreamInput*    fileList;
+    hpatch_TStreamInput*        memList;
+    hpatch_FileError_t          fileError;
+    void*                       _buf;
+} _TWorkerOldRef;
+
+static hpatch_BOOL _workerOldRef_openRes(hpatch_IResHandle* res,hpatch_TStreamInput** out_stream){
+    hpatch_BOOL  result=hpatch_TRUE;
+    _TWorkerOldRef*     self=(_TWorkerOldRef*)res->resImport;
+    size_t              resIndex=res-self->resList;
+    hpatch_TFileStreamInput*   file=self->fileList+resIndex;
+    const unsigned char* memData=self->patcher->_resLimit._ex_streamList[resIndex].memData;
+    const char*         utf8fileName=0;
+    char _tmpPath[hpatch_kPathMaxSize];
+    if (memData){
+        mem_as_hStreamInput(&self->memList[resIndex],memData,memData+(size_t)res->resStreamSize);
+        *out_stream=&self->memList[resIndex];
+        return hpatch_TRUE;
+    }
+    assert(file->m_file==0);
+    utf8fileName=TDirPatcher_getOldRefPathByRefIndex(self->patcher,resIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
+    check(utf8fileName!=0);
+    check(hpatch_TFileStreamInput_open(file,utf8fileName));
+    *out_stream=&file->base;
+clear:
+    if (!result) set_ferr(self->fileError,file->fileError);
+    return result;
+}
+static hpatch_BOOL _workerOldRef_closeRes(hpatch_IResHandle* res,const hpatch_TStreamInput* stream){
+    hpatch_BOOL  result=hpatch_TRUE;
+    _TWorkerOldRef*     self=(_TWorkerOldRef*)res->resImport;
+    size_t              resIndex=res-self->resList;
+    hpatch_TFileStreamInput*   file=self->fileList+resIndex;
+    if (stream==&self->memList[resIndex]) return hpatch_TRUE;
+    assert(stream==&file->base);
+    check(hpatch_TFileStreamInput_close(file));
+clear:
+    mix_ferr(self->fileError,file->fileError);
+    return result;
+}
+
+static hpatch_BOOL _workerOldRef_open(_TWorkerOldRef* self,TDirPatcher* patcher,size_t limitMaxOpenCount){
+    hpatch_BOOL result=hpatch_TRUE;
+    const size_t refCount=patcher->dirDiffHead.oldRefFileCount;
+    size_t       i;
+    self->patcher=patcher;
+    self->_buf=malloc((sizeof(hpatch_IResHandle)+sizeof(hpatch_TFileStreamInput)+sizeof(hpatch_TStreamInput))*refCount);
+    check(self->_buf!=0);
+    self->resList=(hpatch_IResHandle*)self->_buf;
+    self->fileList=(hpatch_TFileStreamInput*)&self->resList[refCount];
+    self->memList=(hpatch_TStreamInput*)&self->fileList[refCount];
+    memset(self->fileList,0,sizeof(hpatch_TFileStreamInput)*refCount);
+    for (i=0;i<refCount;++i){
+        self->resList[i]=patcher->_resList[i];
+        self->resList[i].resImport=self;
+        self->resList[i].open=_workerOldRef_openRes;
+        self->resList[i].close=_workerOldRef_closeRes;
+    }
+    check(hpatch_TResHandleLimit_open(&self->resLimit,limitMaxOpenCount,self->resList,refCount));
+    check(hpatch_TRefStream_open(&self->refStream,self->resLimit.streamList,self->resLimit.streamCount,1));
+clear:
+    return result;
+}
+
+static hpatch_BOOL _workerOldRef_close(_TWorkerOldRef* self){
+    hpatch_BOOL result=hpatch_TRUE;
+    hpatch_TResHandleLimitInfo* info=&self->patcher->_resLimit.info;
+    info->readCount+=self->resLimit.info.readCount;
+    info->hitCount+=self->resLimit.info.hitCount;
+    info->openCount+=self->resLimit.info.openCount;
+    info->reopenCount+=self->resLimit.info.reopenCount;
+    if (self->resLimit.streamList){ //opened
+        if (!hpatch_TResHandleLimit_close(&self->resLimit))
+            result=hpatch_FALSE;
+    }
+    hpatch_TRefStream_close(&self->refStream);
+    mix_ferr(self->patcher->fileError,self->fileError);
+    if (self->_buf){
+        free(self->_buf);
+        self->_buf=0;
+    }
+    return result;
+}
+
+//every thread patch a segment to it's memory, and write to out_newData by segment order
+typedef struct _TSegmentsPatchMt{
+    HLocker                     locker;        //for segment schedule & write order
+    HCondvar                    waitCondvar;
+    const hpatch_TStreamOutput* out_newData;
+    const hpatch_TStreamInput*  oldData;       //used when oldRefs==0
+    _TWorkerOldRef*             oldRefs;       //oldRef stream of every thread
+    const hpatch_TStreamInput*  hdiffData;
+    hpatch_TDecompress*         decompressPlugin;
+    const hpatch_StreamPos_t*   diffPosList;
+    hpatch_StreamPos_t          segmentSize;
+    size_t                      segmentCount;
+    TByte*                      segmentMems;   //segmentSize*threadNum
+    TByte*                      patchCaches;   //patchCacheSize*threadNum
+    size_t                      patchCacheSize;
+    size_t                      nextSegment;   //next segment for patch
+    size_t                      writeSegment;  //next segment for write to out_newData
+    size_t                      threadEndCount;
+    hpatch_BOOL                 isOnError;
+} _TSegmentsPatchMt;
+
+static void _segmentsPatch_thread(int threadIndex,void* workData){
+    _TSegmentsPatchMt* self=(_TSegmentsPatchMt*)workData;
+    TByte* out_buf=self->segmentMems+(size_t)self->segmentSize*(size_t)threadIndex;
+    TByte* temp_cache=self->patchCaches+self->patchCacheSize*(size_t)threadIndex;
+    TByte* temp_cache_end=temp_cache+self->patchCacheSize;
+    const hpatch_StreamPos_t newDataSize=self->out_newData->streamSize;
+    const hpatch_TStreamInput* oldData=self->oldRefs?self->oldRefs[threadIndex].refStream.stream:self->oldData;
+    while (1){
+        size_t segi;
+        hpatch_BOOL isOk;
+        hpatch_StreamPos_t newPos;
+        size_t segNewSize;
+        hpatch_TStreamOutput outSegment;
+        TStreamInputClip     diffClip;
+        c_locker_enter(self->locker);
+        segi=self->nextSegment;
+        if ((!self->isOnError)&&(segi<self->segmentCount))
+            ++self->nextSegment;
+        else
+            segi=self->segmentCount;
+        c_locker_leave(self->locker);
+        if (segi==self->segmentCount) break; //finish
+        
+        newPos=self->segmentSize*segi;
+        segNewSize=(size_t)((newDataSize-newPos<self->segmentSize)?(newDataSize-newPos):self->segmentSize);
+        mem_as_hStreamOutput(&outSegment,out_buf,out_buf+segNewSize);
+        TStreamInputClip_init(&diffClip,self->hdiffData,self->diffPosList[segi]+_kSegmentDiffSizeBytes,
+                              self->diffPosList[segi+1]);
+        isOk=patch_decompress_with_cache(&outSegment,oldData,&diffClip.base,self->decompressPlugin,
+                                         temp_cache,temp_cache_end);
+        c_locker_enter(self->locker);
+        if (isOk){ //wait write order
+            while ((self->writeSegment!=segi)&&(!self->isOnError))
+                c_condvar_wait(self->waitCondvar,self->locker);
+            isOk=(!self->isOnError);
+        }else{
+            self->isOnError=hpatch_TRUE;
+            c_condvar_broadcast(self->waitCondvar);
+        }
+        c_locker_leave(self->locker);
+        if (!isOk) break;
+        
+        isOk=self->out_newData->write(self->out_newData,newPos,out_buf,out_buf+segNewSize);
+        c_locker_enter(self->locker);
+        if (isOk)
+            ++self->writeSegment;
+        else
+            self->isOnError=hpatch_TRUE;
+        c_condvar_broadcast(self->waitCondvar);
+        c_locker_leave(self->locker);
+        if (!isOk) break;
+    }
+    c_locker_enter(self->locker);
+    ++self->threadEndCount;
+    c_condvar_broadcast(self->waitCondvar);
+    c_locker_leave(self->locker);
+}
+
+static hpatch_BOOL _patchSegments_mt(TDirPatcher* self,const hpatch_TStreamOutput* out_newData,
+                                     const hpatch_TStreamInput* oldData,const hpatch_TStreamInput* hdiffData,
+                                     const hpatch_StreamPos_t* diffPosList,size_t segmentCount,
+                                     TByte* temp_cache,TByte* temp_cache_end,size_t threadNum){
+    hpatch_BOOL         result=hpatch_TRUE;
+    _TSegmentsPatchMt   mt;
+    _TLockedStreamInput lockedOld;
+    _TLockedStreamInput lockedDiff;
+    HLocker             oldLocker=0;
+    HLocker             diffLocker=0;
+    size_t              oldRefCount=0;
+    size_t              startedCount=0;
+    memset(&mt,0,sizeof(mt));
+    mt.segmentSize=self->dirDiffHead.hdiffSegmentSize;
+    mt.segmentCount=segmentCount;
+    mt.patchCaches=temp_cache;
+    mt.patchCacheSize=(size_t)(temp_cache_end-temp_cache)/threadNum;
+    mt.locker=c_locker_new();
+    mt.waitCondvar=c_condvar_new();
+    diffLocker=c_locker_new();
+    check((mt.locker!=0)&&(mt.waitCondvar!=0)&&(diffLocker!=0));
+    mt.segmentMems=(TByte*)malloc((size_t)mt.segmentSize*threadNum);
+    check(mt.segmentMems!=0);
+    if ((oldData==self->_oldRefStream.stream)&&(self->_resLimit.streamList!=0)){
+        //every thread opened it's own handles; the shared handles closed for keep the open file number limit
+        size_t limitMaxOpenCount=self->_resLimit._limitMaxOpenCount/threadNum;
+        check(_TDirPatcher_closeOldFileHandles(self));
+        mt.oldRefs=(_TWorkerOldRef*)malloc(sizeof(_TWorkerOldRef)*threadNum);
+        check(mt.oldRefs!=0);
+        memset(mt.oldRefs,0,sizeof(_TWorkerOldRef)*threadNum);
+        for (oldRefCount=0;oldRefCount<threadNum;++oldRefCount)
+            check(_workerOldRef_open(&mt.oldRefs[oldRefCount],self,limitMaxOpenCount));
+    }else{
+        oldLocker=c_locker_new();
+        check(oldLocker!=0);
+        _lockedStream_init(&lockedOld,oldData,oldLocker);
+        mt.oldData=&lockedOld.base;
+    }
+    _lockedStream_init(&lockedDiff,hdiffData,diffLocker);
+    mt.out_newData=out_newData;
+    mt.hdiffData=&lockedDiff.base;
+    mt.decompressPlugin=self->_decompressPlugin;
+    mt.diffPosList=diffPosList;
+    for (startedCount=0;startedCount<threadNum;++startedCount){
+        const hpatch_BOOL isThisThread=(startedCount+1==threadNum);
+        if (!c_thread_parallel(1,_segmentsPatch_thread,&mt,isThisThread,(int)startedCount)){
+            c_locker_enter(mt.locker);
+            mt.isOnError=hpatch_TRUE;
+            c_condvar_broadcast(mt.waitCondvar);
+            c_locker_leave(mt.locker);
+            break;
+        }
+    }
+    c_locker_enter(mt.locker);
+    while (mt.threadEndCount<startedCount)
+        c_condvar_wait(mt.waitCondvar,mt.locker);
+    c_locker_leave(mt.locker);
+    check(!mt.isOnError);
+    check(mt.writeSegment==segmentCount);
+clear:
+    if (mt.oldRefs){
+        size_t i;
+        if (oldRefCount<threadNum) ++oldRefCount; //the failed one
+        for (i=0;i<oldRefCount;++i){
+            if (!_workerOldRef_close(&mt.oldRefs[i]))
+                result=hpatch_FALSE;
+        }
+        free(mt.oldRefs);
+    }
+    if (mt.segmentMems) free(mt.segmentMems);
+    if (oldLocker) c_locker_delete(oldLocker);
+    if (diffLocker) c_locker_delete(diffLocker);
+    if (mt.waitCondvar) c_condvar_delete(mt.waitCondvar);
+    if (mt.locker) c_locker_delete(mt.locker);
+    return result;
+}
+#endif //_IS_USED_MULTITHREAD
+
+static hpatch_BOOL _patchSegments(TDirPatcher* self,const hpatch_TStreamOutput* out_newData,
+                                  const hpatch_TStreamInput* oldData,const hpatch_TStreamInput* hdiffData,
+                                  TByte* temp_cache,TByte* temp_cache_end,size_t threadNum,size_t patchCacheSize_min){
+    hpatch_BOOL         result=hpatch_TRUE;
+    const hpatch_StreamPos_t segmentSize=self->dirDiffHead.hdiffSegmentSize;
+    const size_t        segmentCount=_getSegmentCount(out_newData->streamSize,segmentSize);
+    hpatch_StreamPos_t* diffPosList=0;
+    check((segmentCount>0)||(out_newData->streamSize==0));
+    diffPosList=(hpatch_StreamPos_t*)malloc(sizeof(hpatch_StreamPos_t)*(segmentCount+1));
+    check(diffPosList!=0);
+    check(_getSegmentDiffPosList(diffPosList,segmentCount,hdiffData));
+#if (_IS_USED_MULTITHREAD)
+    if (threadNum>segmentCount) threadNum=segmentCount;
+    while ((threadNum>1)&&((size_t)(temp_cache_end-temp_cache)/threadNum<patchCacheSize_min))
+        --threadNum;
+    if ((oldData==self->_oldRefStream.stream)&&(threadNum>self->_resLimit._limitMaxOpenCount))
+        threadNum=self->_resLimit._limitMaxOpenCount; //every thread need open oldRef file by self
+    if ((threadNum>1)&&(segmentSize*threadNum==(size_t)(segmentSize*threadNum))){
+        check(_patchSegments_mt(self,out_newData,oldData,hdiffData,diffPosList,segmentCount,
+                                temp_cache,temp_cache_end,threadNum));
+    }else
+#endif
+    {
+        size_t segi;
+        for (segi=0;segi<segmentCount;++segi){
+            _TOffsetStreamOutput outSegment;
+            TStreamInputClip     diffClip;
+            const hpatch_StreamPos_t newPos=segmentSize*segi;
+            const hpatch_StreamPos_t segNewSize=(out_newData->streamSize-newPos<segmentSize)?
+                                                (out_newData->streamSize-newPos):segmentSize;
+            _offsetStream_init(&outSegment,out_newData,newPos,segNewSize);
+            TStreamInputClip_init(&diffClip,hdiffData,diffPosList[segi]+_kSegmentDiffSizeBytes,diffPosList[segi+1]);
+            check(patch_decompress_with_cache(&outSegment.base,oldData,&diffClip.base,
+                                              self->_decompressPlugin,temp_cache,temp_cache_end));
+        }
+    }
+clear:
+    if (diffPosList) free(diffPosList);
+    return result;
+}
+
 hpatch_BOOL TDirPatcher_patch(TDirPatcher* self,const hpatch_TStreamOutput* out_newData,
                               const hpatch_TStreamInput* oldData,
                               TByte* temp_cache,TByte* temp_cache_end,size_t threadNum){
@@ -573,6 +1013,10 @@ hpatch_BOOL TDirPatcher_patch(TDirPatcher* self,const hpatch_TStreamOutput* out_
     }
     TStreamInputClip_init(&hdiffData,self->_dirDiffData,self->dirDiffHead.hdiffDataOffset,
                           self->dirDiffHead.hdiffDataOffset+self->dirDiffHead.hdiffDataSize);
+    if (self->dirDiffHead.hdiffSegmentSize>0){
+        checki(_patchSegments(self,out_newData,oldData,&hdiffData.base,temp_cache,temp_cache_end,
+                              threadNum,patchCacheSize_min),"TDirPatcher_patch() _patchSegments");
+    }else
 #if (_IS_NEED_SINGLE_STREAM_DIFF)
     if (self->dirDiffInfo.isSingleCompressedDiff){
         hpatch_singleCompressedDiffInfo* sdiffInfo=&self->dirDiffInfo.sdiffInfo;
@@ -600,6 +1044,7 @@ hpatch_BOOL TDirPatcher_close(TDirPatcher* self){
     if (!TDirPatcher_closeOldRefStream(self))
         result=hpatch_FALSE;
     TDirPatcher_finishOldSameRefCount(self);
+    TDirPatcher_finishInPlaceUpdate(self);
     if (!TNewDirOutput_close(&self->_newDir))
         result=hpatch_FALSE;
     if (self->_pChecksumMem){
@@ -681,6 +1126,67 @@ void TDirPatcher_decOldSameRefCount(TDirPatcher* self,size_t sameIndex){
     --self->_pOldSameRefCount[oldIndex];
 }
 
+    static int _cmp_path(const void* pa,const void* pb){
+        return strcmp(*(const char* const*)pa,*(const char* const*)pb);
+    }
+#define _oldUpdateTypes(_self)  ((_self)->_pInPlaceTypes)
+#define _newInPlaceFlags(_self) ((_self)->_pInPlaceTypes+(_self)->dirDiffHead.oldPathCount)
+
+hpatch_BOOL TDirPatcher_initInPlaceUpdate(TDirPatcher* self){
+    const size_t oldPathCount=self->dirDiffHead.oldPathCount;
+    const size_t newPathCount=self->_newDir.newPathCount;
+    const char** sortedNewPaths;
+    unsigned char* oldTypes;
+    unsigned char* newFlags;
+    size_t  i;
+    assert(self->_pInPlaceTypes==0);
+    self->_pInPlaceTypes=(unsigned char*)malloc(oldPathCount+newPathCount+1);
+    if (self->_pInPlaceTypes==0) return hpatch_FALSE;
+    sortedNewPaths=(const char**)malloc(sizeof(const char*)*(newPathCount+1));
+    if (sortedNewPaths==0) { TDirPatcher_finishInPlaceUpdate(self); return hpatch_FALSE; }
+    
+    oldTypes=_oldUpdateTypes(self);
+    newFlags=_newInPlaceFlags(self);
+    memset(oldTypes,kOldPath_remove,oldPathCount);
+    memset(newFlags,0,newPathCount);
+    for (i=0;i<self->dirDiffHead.sameFilePairCount; ++i) {
+        const hpatch_TSameFilePair* pair=&self->_newDir.dataSamePairList[i];
+        if (0==strcmp(self->oldUtf8PathList[pair->oldIndex],self->_newDir.newUtf8PathList[pair->newIndex])){
+            oldTypes[pair->oldIndex]=kOldPath_keep;
+            newFlags[pair->newIndex]=1;
+        }
+    }
+    memcpy(sortedNewPaths,self->_newDir.newUtf8PathList,sizeof(const char*)*newPathCount);
+    qsort(sortedNewPaths,newPathCount,sizeof(const char*),_cmp_path);
+    for (i=0;i<oldPathCount; ++i) {
+        if (oldTypes[i]==kOldPath_keep) continue;
+        if (bsearch(&self->oldUtf8PathList[i],sortedNewPaths,newPathCount,sizeof(const char*),_cmp_path))
+            oldTypes[i]=kOldPath_replace;
+    }
+    free(sortedNewPaths);
+    return hpatch_TRUE;
+}
+void TDirPatcher_finishInPlaceUpdate(TDirPatcher* self){
+    if (self->_pInPlaceTypes!=0){
+        free(self->_pInPlaceTypes);
+        self->_pInPlaceTypes=0;
+    }
+}
+TOldPathUpdateType TDirPatcher_oldPathUpdateType(const TDirPatcher* self,size_t oldPathIndex){
+    assert(oldPathIndex<self->dirDiffHead.oldPathCount);
+    return (TOldPathUpdateType)_oldUpdateTypes(self)[oldPathIndex];
+}
+hpatch_BOOL TDirPatcher_isNewPathInPlace(const TDirPatcher* self,size_t newPathIndex){
+    assert(newPathIndex<self->_newDir.newPathCount);
+    return _newInPlaceFlags(self)[newPathIndex]!=0;
+}
+hpatch_BOOL TDirPatcher_isInPlaceSameFile(const TDirPatcher* self,size_t sameIndex){
+    assert(sameIndex<self->dirDiffHead.sameFilePairCount);
+    return TDirPatcher_isNewPathInPlace(self,self->_newDir.dataSamePairList[sameIndex].newIndex);
+}
+#undef _oldUpdateTypes
+#undef _newInPlaceFlags
+
 
 //TDirOldDataChecksum
 hpatch_BOOL TDirOldDataChecksum_append(TDirOldDataChecksum* self,unsigned char* dirDiffData_part,
@@ -96,6 +96,7 @@ hpatch_BOOL getIsDirDiffFile(const char* diffFileName){
         hpatch_StreamPos_t  headDataCompressedSize;
         hpatch_StreamPos_t  hdiffDataOffset;
         hpatch_StreamPos_t  hdiffDataSize;
+        hpatch_StreamPos_t  hdiffSegmentSize; //!=0 when hdiffData saved as segments (hdiffz -D-seg)
     } _TDirDiffHead;
     
     struct hpatch_TFileStreamInput;
@@ -128,6 +129,7 @@ typedef struct TDirPatcher{
     const hpatch_TStreamInput*  _dirDiffData;
     void*                       _pDiffDataMem;
     size_t*                     _pOldSameRefCount;
+    unsigned char*              _pInPlaceTypes;
     hpatch_FileError_t          fileError;
 } TDirPatcher;
 
@@ -143,8 +145,15 @@ hpatch_BOOL TDirPatcher_loadDirData(TDirPatcher* self,hpatch_TDecompress* decomp
 
 hpatch_BOOL TDirPatcher_openOldRefAsStream(TDirPatcher* self,size_t kMaxOpenFileNumber,
                                            const hpatch_TStreamInput** out_oldRefStream);
+//call after TDirPatcher_openOldRefAsStream; keep small old files in memory (up to memCacheSize) if they may be reopened
+static hpatch_inline hpatch_BOOL TDirPatcher_setOldRefMemCache(TDirPatcher* self,size_t memCacheSize)
+    { return hpatch_TResHandleLimit_setMemCache(&self->_resLimit,memCacheSize,hpatch_kResMemCacheSmallFileSize); }
+static hpatch_inline const hpatch_TResHandleLimitInfo* TDirPatcher_getOldRefHandleInfo(const TDirPatcher* self)
+    { return &self->_resLimit.info; }
 hpatch_BOOL TDirPatcher_openNewDirAsStream(TDirPatcher* self,IDirPatchListener* listener,
                                            const hpatch_TStreamOutput** out_newDirStream);
+//if hdiffSegmentSize!=0, decompressors reopened for every segment; caller can open
+//  hpatch_decompressPool (decompress_plugin_demo.h) before patch for reuse their memory.
 hpatch_BOOL TDirPatcher_patch(TDirPatcher* self,const hpatch_TStreamOutput* out_newData,
                               const hpatch_TStreamInput* oldData,
                               unsigned char* temp_cache,unsigned char* temp_cache_end,size_t threadNum);
@@ -211,6 +220,19 @@ const char* TDirPatcher_getNewPathBySameIndex(const TDirPatcher* self,size_t sam
                                               char* out_pathBuf,char* out_pathBufEnd);
 size_t      TDirPatcher_oldSameRefCount(TDirPatcher* self,size_t sameIndex);
 void        TDirPatcher_decOldSameRefCount(TDirPatcher* self,size_t sameIndex);
+
+//in-place update: new dir patched to a temp dir, then only changed paths updated in old dir;
+//  same file at same path not be copied or moved.
+typedef enum TOldPathUpdateType{
+    kOldPath_remove=0, //not in new dir, need delete
+    kOldPath_replace,  //path also in new dir, will be replaced by new file (or is a kept dir)
+    kOldPath_keep      //same file at same path in new dir, not need update
+} TOldPathUpdateType;
+hpatch_BOOL TDirPatcher_initInPlaceUpdate(TDirPatcher* self);
+void        TDirPatcher_finishInPlaceUpdate(TDirPatcher* self);
+TOldPathUpdateType TDirPatcher_oldPathUpdateType(const TDirPatcher* self,size_t oldPathIndex);
+hpatch_BOOL TDirPatcher_isNewPathInPlace(const TDirPatcher* self,size_t newPathIndex);
+hpatch_BOOL TDirPatcher_isInPlaceSameFile(const TDirPatcher* self,size_t sameIndex);
     
 
 
@@ -40,32 +40,48 @@
 #define  check(value) checki(value,"check " #value)
 
 static hpatch_BOOL _TDirPatcher_copyFile(const char* oldFileName_utf8,const char* newFileName_utf8,
-                                         hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError){
+                                         hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError,
+                                         hpatch_TFileCopyCounts* copyCounts){
 #define _tempCacheSize hpatch_kFileIOBufBetterSize
     hpatch_BOOL result=hpatch_TRUE;
     TByte        temp_cache[_tempCacheSize];
     hpatch_StreamPos_t pos=0;
+    hpatch_TFileCopyType copyType=hpatch_kFileCopy_byUser;
+    hpatch_BOOL  isNeedWrite;
     hpatch_TFileStreamInput   oldFile;
     hpatch_TFileStreamOutput  newFile;
     hpatch_TFileStreamInput_init(&oldFile);
     hpatch_TFileStreamOutput_init(&newFile);
     
     check(hpatch_TFileStreamInput_open(&oldFile,oldFileName_utf8));
-    if (newFileName_utf8)
+    if (newFileName_utf8){
         check(hpatch_TFileStreamOutput_open(&newFile,newFileName_utf8,oldFile.base.streamSize));
-    while (pos<oldFile.base.streamSize) {
-        size_t copyLen=_tempCacheSize;
-        if (pos+copyLen>oldFile.base.streamSize)
-            copyLen=(size_t)(oldFile.base.streamSize-pos);
-        check(oldFile.base.read(&oldFile.base,pos,temp_cache,temp_cache+copyLen));
-        if (newFileName_utf8)
-            check(newFile.base.write(&newFile.base,pos,temp_cache,temp_cache+copyLen));
-        if (copyListener)
-            copyListener->copyedData(copyListener,temp_cache,temp_cache+copyLen);
-        pos+=copyLen;
+        copyType=hpatch_TFileStreamOutput_copyBySystem(&newFile,&oldFile);
     }
-    if (newFileName_utf8)
+    isNeedWrite=(newFileName_utf8!=0)&&(copyType==hpatch_kFileCopy_byUser);
+    if (isNeedWrite||copyListener){ //copyListener need read old data for checksum
+        while (pos<oldFile.base.streamSize) {
+            size_t copyLen=_tempCacheSize;
+            if (pos+copyLen>oldFile.base.streamSize)
+                copyLen=(size_t)(oldFile.base.streamSize-pos);
+            check(oldFile.base.read(&oldFile.base,pos,temp_cache,temp_cache+copyLen));
+            if (isNeedWrite)
+                check(newFile.base.write(&newFile.base,pos,temp_cache,temp_cache+copyLen));
+            if (copyListener)
+                copyListener->copyedData(copyListener,temp_cache,temp_cache+copyLen);
+            pos+=copyLen;
+        }
+    }
+    if (newFileName_utf8){
         check(newFile.out_length==newFile.base.streamSize);
+        if (copyCounts){
+            switch (copyType){
+                case hpatch_kFileCopy_byClone:  copyCounts->clonedSize+=newFile.out_length; break;
+                case hpatch_kFileCopy_byKernel: copyCounts->kernelCopiedSize+=newFile.out_length; break;
+                default:                        copyCounts->userCopiedSize+=newFile.out_length; break;
+            }
+        }
+    }
 clear:
     if (newFile.fileError) { result=hpatch_FALSE; set_ferr(*out_fileError,newFile.fileError); }
     if (oldFile.fileError) { result=hpatch_FALSE; set_ferr(*out_fileError,oldFile.fileError); }
@@ -78,15 +94,16 @@ clear:
 }
 
 hpatch_BOOL TDirPatcher_copyFile(const char* oldFileName_utf8,const char* newFileName_utf8,
-                                 hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError){
+                                 hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError,
+                                 hpatch_TFileCopyCounts* copyCounts){
     hpatch_BOOL result=hpatch_TRUE;
     check(newFileName_utf8!=0);
-    result=_TDirPatcher_copyFile(oldFileName_utf8,newFileName_utf8,copyListener,out_fileError);
+    result=_TDirPatcher_copyFile(oldFileName_utf8,newFileName_utf8,copyListener,out_fileError,copyCounts);
 clear:
     return result;
 }
 hpatch_BOOL TDirPatcher_readFile(const char* oldFileName_utf8,hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError){
-    return _TDirPatcher_copyFile(oldFileName_utf8,0,copyListener,out_fileError);
+    return _TDirPatcher_copyFile(oldFileName_utf8,0,copyListener,out_fileError,0);
 }
 
 
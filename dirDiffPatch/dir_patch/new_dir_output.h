@@ -44,8 +44,13 @@ extern "C" {
                               const unsigned char* dataEnd);
     } hpatch_ICopyDataListener;
     
+    struct hpatch_TFileCopyCounts;
+    
+//copy by reflink or copy_file_range if system support, else by read & write;
+//  copyCounts can null, else add copyed size by copy type.
 hpatch_BOOL TDirPatcher_copyFile(const char* oldFileName_utf8,const char* newFileName_utf8,
-                                 hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError);
+                                 hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError,
+                                 struct hpatch_TFileCopyCounts* copyCounts);
 hpatch_BOOL TDirPatcher_readFile(const char* oldFileName_utf8,hpatch_ICopyDataListener* copyListener,hpatch_FileError_t* out_fileError);
 
 
@@ -29,35 +29,69 @@
 #if (_IS_NEED_DIR_DIFF_PATCH)
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h> //memcpy
 
 #define  check(value) { if (!(value)){ LOG_ERR("check "#value" error!\n"); return hpatch_FALSE; } }
 
-static hpatch_BOOL _TResHandleLimit_closeOneHandle(hpatch_TResHandleLimit* self){
-    size_t              best_i=~(size_t)0;
-    hpatch_StreamPos_t  best_hit=~(hpatch_StreamPos_t)0;
-    hpatch_TStreamInput*    cur=0;
-    hpatch_IResHandle*      res=0;
-    size_t count=self->streamCount;
-    size_t i;
-    for (i=0; i<count;++i) {
-        if (self->_in_streamList[i]){
-            hpatch_StreamPos_t cur_hit=self->_ex_streamList[i].hit;
-            if (cur_hit<best_hit){
-                best_hit=cur_hit;
-                best_i=i;
-            }
-        }
-    }
-    check(best_i<count);
-    cur=self->_in_streamList[best_i];
-    res=&self->_resList[best_i];
-    self->_in_streamList[best_i]=0;
-    check(res->close(res,cur));
+#define _kNullIndex (~(size_t)0)
+
+static void _TResHandleLimit_lruRemove(hpatch_TResHandleLimit* self,size_t index){
+    _hpatch_TResHandleBox* ex=&self->_ex_streamList[index];
+    if (ex->lruPrev!=_kNullIndex)
+        self->_ex_streamList[ex->lruPrev].lruNext=ex->lruNext;
+    else
+        self->_lruHead=ex->lruNext;
+    if (ex->lruNext!=_kNullIndex)
+        self->_ex_streamList[ex->lruNext].lruPrev=ex->lruPrev;
+    else
+        self->_lruTail=ex->lruPrev;
+    ex->lruPrev=_kNullIndex;
+    ex->lruNext=_kNullIndex;
+}
+
+static void _TResHandleLimit_lruPushFront(hpatch_TResHandleLimit* self,size_t index){
+    _hpatch_TResHandleBox* ex=&self->_ex_streamList[index];
+    ex->lruPrev=_kNullIndex;
+    ex->lruNext=self->_lruHead;
+    if (self->_lruHead!=_kNullIndex)
+        self->_ex_streamList[self->_lruHead].lruPrev=index;
+    else
+        self->_lruTail=index;
+    self->_lruHead=index;
+}
+
+static hpatch_BOOL _TResHandleLimit_closeHandle(hpatch_TResHandleLimit* self,size_t index){
+    hpatch_TStreamInput* cur=self->_in_streamList[index];
+    hpatch_IResHandle*   res=&self->_resList[index];
+    assert(cur!=0);
+    self->_in_streamList[index]=0;
     --self->_curOpenCount;
+    return res->close(res,cur);
+}
+
+static hpatch_BOOL _TResHandleLimit_closeOneHandle(hpatch_TResHandleLimit* self){
+    size_t lru_i=self->_lruTail;
+    check(lru_i<self->streamCount);
+    _TResHandleLimit_lruRemove(self,lru_i);
+    check(_TResHandleLimit_closeHandle(self,lru_i));
+    return hpatch_TRUE;
+}
+
+static hpatch_BOOL _TResHandleLimit_loadToMem(hpatch_TResHandleLimit* self,size_t index){
+    _hpatch_TResHandleBox*     ex=&self->_ex_streamList[index];
+    const hpatch_TStreamInput* in_stream=self->_in_streamList[index];
+    unsigned char* mem=self->_memCache+self->_memCacheUsed;
+    size_t         memSize=(size_t)in_stream->streamSize;
+    check(in_stream->read(in_stream,0,mem,mem+memSize));
+    self->_memCacheUsed+=memSize;
+    self->info.memCachedSize+=memSize;
+    ex->memData=mem;
+    check(_TResHandleLimit_closeHandle(self,index));
     return hpatch_TRUE;
 }
 
 static hpatch_BOOL _TResHandleLimit_openHandle(hpatch_TResHandleLimit* self,size_t index){
+    _hpatch_TResHandleBox* ex=&self->_ex_streamList[index];
     hpatch_IResHandle*  res=&self->_resList[index];
     hpatch_TStreamInput** pCur=&self->_in_streamList[index];
     assert((*pCur)==0);
@@ -67,6 +101,13 @@ static hpatch_BOOL _TResHandleLimit_openHandle(hpatch_TResHandleLimit* self,size
     check((*pCur)!=0);
     check((*pCur)->streamSize==res->resStreamSize);
     ++self->_curOpenCount;
+    ++self->info.openCount;
+    if (ex->isOpened) ++self->info.reopenCount;
+    ex->isOpened=hpatch_TRUE;
+    if ((self->_memCache!=0)&&(res->resStreamSize<=self->_memCacheMaxResSize)
+            &&(res->resStreamSize<=self->_memCacheSize-self->_memCacheUsed))
+        return _TResHandleLimit_loadToMem(self,index);
+    _TResHandleLimit_lruPushFront(self,index);
     return hpatch_TRUE;
 }
 
@@ -77,11 +118,24 @@ static hpatch_BOOL _TResHandleLimit_read(const hpatch_TStreamInput* stream,hpatc
     size_t           index=ex-self->_ex_streamList;
     const hpatch_TStreamInput* in_stream=self->_in_streamList[index];
     assert(index<self->streamCount);
-    ex->hit= ++self->_curHit;
-    if (!in_stream){
+    ++self->info.readCount;
+    if (ex->memData){
+        ++self->info.hitCount;
+    }else if (in_stream){
+        ++self->info.hitCount;
+        if (self->_lruHead!=index){
+            _TResHandleLimit_lruRemove(self,index);
+            _TResHandleLimit_lruPushFront(self,index);
+        }
+    }else{ //miss
         check(_TResHandleLimit_openHandle(self,index));
         in_stream=self->_in_streamList[index];
     }
+    if (ex->memData){ //cached or loaded now
+        check(readFromPos+(size_t)(out_data_end-out_data)<=stream->streamSize);
+        memcpy(out_data,ex->memData+(size_t)readFromPos,out_data_end-out_data);
+        return hpatch_TRUE;
+    }
     return in_stream->read(in_stream,readFromPos,out_data,out_data_end);
 }
 
@@ -105,12 +159,17 @@ hpatch_BOOL hpatch_TResHandleLimit_open(hpatch_TResHandleLimit* self,size_t limi
     self->streamCount=resCount;
     self->_resList=resList;
     self->_limitMaxOpenCount=limitMaxOpenCount;
-    self->_curHit=0;
+    self->_lruHead=_kNullIndex;
+    self->_lruTail=_kNullIndex;
     self->_curOpenCount=0;
+    memset(&self->info,0,sizeof(self->info));
     for (i=0; i<resCount; ++i) {
         _hpatch_TResHandleBox* ex=&self->_ex_streamList[i];
-        ex->hit=0;
         ex->owner=self;
+        ex->memData=0;
+        ex->lruPrev=_kNullIndex;
+        ex->lruNext=_kNullIndex;
+        ex->isOpened=hpatch_FALSE;
         ex->box.streamImport=ex;
         ex->box.streamSize=self->_resList[i].resStreamSize;
         ex->box.read=_TResHandleLimit_read;
@@ -121,18 +180,32 @@ hpatch_BOOL hpatch_TResHandleLimit_open(hpatch_TResHandleLimit* self,size_t limi
     return hpatch_TRUE;
 }
 
+hpatch_BOOL hpatch_TResHandleLimit_setMemCache(hpatch_TResHandleLimit* self,size_t memCacheSize,
+                                               hpatch_StreamPos_t maxResSize){
+    hpatch_StreamPos_t sumSize=0;
+    size_t i;
+    assert(self->_memCache==0);
+    if (self->streamCount<=self->_limitMaxOpenCount) return hpatch_TRUE; //never need reopen
+    for (i=0; i<self->streamCount; ++i) {
+        hpatch_StreamPos_t resSize=self->_resList[i].resStreamSize;
+        if (resSize<=maxResSize) sumSize+=resSize;
+    }
+    if (sumSize<memCacheSize) memCacheSize=(size_t)sumSize;
+    if (memCacheSize==0) return hpatch_TRUE;
+    self->_memCache=(unsigned char*)malloc(memCacheSize);
+    if (self->_memCache==0) return hpatch_FALSE;
+    self->_memCacheSize=memCacheSize;
+    self->_memCacheUsed=0;
+    self->_memCacheMaxResSize=maxResSize;
+    return hpatch_TRUE;
+}
+
 hpatch_BOOL hpatch_TResHandleLimit_closeFileHandles(hpatch_TResHandleLimit* self){
-    size_t count=self->streamCount;
     hpatch_BOOL result=hpatch_TRUE;
-    size_t i;
-    for (i=0; i<count; ++i) {
-        const hpatch_TStreamInput* stream=self->_in_streamList[i];
-        if (stream){
-            hpatch_IResHandle* res=&self->_resList[i];
-            if (!res->close(res,stream)) result=hpatch_FALSE;
-            self->_in_streamList[i]=0;
-            --self->_curOpenCount;
-        }
+    while (self->_lruHead!=_kNullIndex) {
+        size_t index=self->_lruHead;
+        _TResHandleLimit_lruRemove(self,index);
+        if (!_TResHandleLimit_closeHandle(self,index)) result=hpatch_FALSE;
     }
     assert(self->_curOpenCount==0);
     return result;
@@ -142,6 +215,12 @@ hpatch_BOOL hpatch_TResHandleLimit_close(hpatch_TResHandleLimit* self){
     hpatch_BOOL result=hpatch_TResHandleLimit_closeFileHandles(self);
     self->streamList=0;
     self->streamCount=0;
+    if (self->_memCache){
+        free(self->_memCache);
+        self->_memCache=0;
+        self->_memCacheSize=0;
+        self->_memCacheUsed=0;
+    }
     if (self->_buf){
         free(self->_buf);
         self->_buf=0;
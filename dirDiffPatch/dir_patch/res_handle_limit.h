@@ -44,28 +44,53 @@ struct hpatch_TResHandleLimit;
 typedef struct _hpatch_TResHandleBox{
     hpatch_TStreamInput     box;
     struct hpatch_TResHandleLimit* owner;
-    hpatch_StreamPos_t      hit;
+    const unsigned char*    memData; //!=0 when all data of res resident in memory
+    size_t                  lruPrev; //in LRU list of opened handles
+    size_t                  lruNext;
+    hpatch_BOOL             isOpened; //opened before
 } _hpatch_TResHandleBox;
 
+typedef struct hpatch_TResHandleLimitInfo{
+    hpatch_StreamPos_t  readCount;
+    hpatch_StreamPos_t  hitCount;    //read by an opened handle or memory, not need open
+    hpatch_StreamPos_t  openCount;
+    hpatch_StreamPos_t  reopenCount; //open again after be closed
+    hpatch_StreamPos_t  memCachedSize; //small res data resident in memory
+} hpatch_TResHandleLimitInfo;
+
+#define hpatch_kResMemCacheSmallFileSize  (1024*64)
+
 //Internally controls the maximum number of simultaneously open handles, externally simulates a complete stream list where all resources are available;
+//  closes the least recently used handle when need open a new one;
+//  small res can be loaded into a memory arena, then closed and never reopened.
 typedef struct hpatch_TResHandleLimit{
     const hpatch_TStreamInput** streamList;
     size_t                      streamCount;
+    hpatch_TResHandleLimitInfo  info;
 //private:
     _hpatch_TResHandleBox*      _ex_streamList;
     hpatch_TStreamInput**       _in_streamList;
     hpatch_IResHandle*          _resList;
-    hpatch_StreamPos_t          _curHit;
+    size_t                      _lruHead; //most recently used
+    size_t                      _lruTail; //least recently used, close first
     size_t                      _curOpenCount;
     size_t                      _limitMaxOpenCount;
     //mem
     unsigned char*              _buf;
+    unsigned char*              _memCache;
+    size_t                      _memCacheSize;
+    size_t                      _memCacheUsed;
+    hpatch_StreamPos_t          _memCacheMaxResSize;
 } hpatch_TResHandleLimit;
 
 hpatch_inline static
 void        hpatch_TResHandleLimit_init(hpatch_TResHandleLimit* self) { memset(self,0,sizeof(*self)); }
 hpatch_BOOL hpatch_TResHandleLimit_open(hpatch_TResHandleLimit* self,size_t limitMaxOpenCount,
                                         hpatch_IResHandle* resList,size_t resCount);
+//call after open; memCacheSize is the max memory for resident small res (size<=maxResSize);
+//  not used if all handles can be opened at same time.
+hpatch_BOOL hpatch_TResHandleLimit_setMemCache(hpatch_TResHandleLimit* self,size_t memCacheSize,
+                                               hpatch_StreamPos_t maxResSize);
 hpatch_BOOL hpatch_TResHandleLimit_closeFileHandles(hpatch_TResHandleLimit* self);
 hpatch_BOOL hpatch_TResHandleLimit_close(hpatch_TResHandleLimit* self);
     
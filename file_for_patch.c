@@ -220,6 +220,46 @@ hpatch_BOOL _hpatch_getPathStat_noEndDirSeparator(const char* path_utf8,hpatch_T
 }
 
 
+hpatch_BOOL hpatch_getFileStatTag(const char* fileName_utf8,hpatch_TFileStatTag* out_tag){
+#if (_IS_FOR_WINXP)
+    return hpatch_FALSE; //unsupport
+#else
+#   if (_IS_USED_WIN32_UTF8_WAPI)
+    int            wsize;
+    wchar_t        path_w[hpatch_kPathMaxSize];
+    struct _stat64 s;
+#   elif defined(_MSC_VER)
+    struct _stat64 s;
+#   else
+    struct stat  s;
+#   endif
+    int          rt;
+    assert(out_tag!=0);
+    memset(&s,0,sizeof(s));
+#   if (_IS_USED_WIN32_UTF8_WAPI)
+    wsize=_utf8FileName_to_w(fileName_utf8,path_w,hpatch_kPathMaxSize);
+    if (wsize<=0) return hpatch_FALSE;
+    rt = _wstat64(path_w,&s);
+#   elif defined(_MSC_VER)
+    rt = _stat64(fileName_utf8,&s);
+#   else
+    rt = stat(fileName_utf8,&s);
+#   endif
+    if ((rt!=0)||((s.st_mode&S_IFMT)!=S_IFREG))
+        return hpatch_FALSE;
+    out_tag->fileSize=(hpatch_StreamPos_t)s.st_size;
+    out_tag->inode=(hpatch_uint64_t)s.st_ino;
+#   if defined(__APPLE__)
+    out_tag->mtime_ns=(hpatch_uint64_t)s.st_mtimespec.tv_sec*1000000000+(hpatch_uint64_t)s.st_mtimespec.tv_nsec;
+#   elif defined(__linux__) || defined(__ANDROID__)
+    out_tag->mtime_ns=(hpatch_uint64_t)s.st_mtim.tv_sec*1000000000+(hpatch_uint64_t)s.st_mtim.tv_nsec;
+#   else
+    out_tag->mtime_ns=(hpatch_uint64_t)s.st_mtime*1000000000;
+#   endif
+    return hpatch_TRUE;
+#endif
+}
+
 hpatch_BOOL hpatch_getTempPathName(const char* path_utf8,char* out_tempPath_utf8,char* out_tempPath_end){
     //use tmpnam()?
 #define _AddingLen 8
@@ -487,6 +527,61 @@ hpatch_BOOL _import_fileTruncate(hpatch_FileHandle file,hpatch_StreamPos_t new_f
     return hpatch_TRUE;
 }
 
+#ifndef _IS_USED_FILE_COPY_BY_SYSTEM
+#   if (defined(__linux__))
+#       define _IS_USED_FILE_COPY_BY_SYSTEM 1
+#   else
+#       define _IS_USED_FILE_COPY_BY_SYSTEM 0
+#   endif
+#endif
+#if (_IS_USED_FILE_COPY_BY_SYSTEM)
+#   include <sys/ioctl.h> // ioctl
+#   include <sys/syscall.h> // syscall SYS_copy_file_range
+#   include <linux/fs.h> //FICLONE
+#   ifndef FICLONE
+#       define FICLONE _IOW(0x94,9,int)
+#   endif
+#   define _kMaxCopyFileRangeSize  ((size_t)1<<30)
+#endif
+
+hpatch_TFileCopyType hpatch_TFileStreamOutput_copyBySystem(hpatch_TFileStreamOutput* self,
+                                                           const hpatch_TFileStreamInput* srcFile){
+#if (_IS_USED_FILE_COPY_BY_SYSTEM)
+    const hpatch_StreamPos_t fileSize=srcFile->base.streamSize;
+    int srcFno;
+    int dstFno;
+    if ((self->out_length!=0)||(srcFile->m_offset!=0)||(fileSize>self->base.streamSize)||(fileSize==0))
+        return hpatch_kFileCopy_byUser;
+    srcFno=fileno(srcFile->m_file);
+    dstFno=fileno(self->m_file);
+    if ((srcFno==-1)||(dstFno==-1)) return hpatch_kFileCopy_byUser;
+    
+    if (0==ioctl(dstFno,FICLONE,srcFno)){ //reflink, only some filesystem support it (btrfs,xfs,...)
+        self->out_length=fileSize;
+        return hpatch_kFileCopy_byClone;
+    }
+#   ifdef SYS_copy_file_range
+    {
+        long long srcPos=0; //same as kernel's loff_t, not need glibc's off64_t
+        long long dstPos=0;
+        while ((hpatch_StreamPos_t)dstPos<fileSize){
+            hpatch_StreamPos_t copyLen=fileSize-(hpatch_StreamPos_t)dstPos;
+            long ret;
+            if (copyLen>_kMaxCopyFileRangeSize) copyLen=_kMaxCopyFileRangeSize;
+            ret=syscall(SYS_copy_file_range,srcFno,&srcPos,dstFno,&dstPos,(size_t)copyLen,0);
+            if (ret<=0) break; //ENOSYS EXDEV EINVAL EOPNOTSUPP ... or file changed
+        }
+        if ((hpatch_StreamPos_t)dstPos==fileSize){
+            self->out_length=fileSize;
+            return hpatch_kFileCopy_byKernel;
+        }
+        //else fail, caller will rewrite all data by user
+    }
+#   endif
+#endif
+    return hpatch_kFileCopy_byUser;
+}
+
 #if (_IS_USED_WIN32_UTF8_WAPI)
 #   define _FileModeType const wchar_t*
 #   define _kFileReadMode  L"rb"
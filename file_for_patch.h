@@ -166,6 +166,15 @@ hpatch_BOOL hpatch_isPathExist(const char* pathName){
     return (kPathType_notExist!=type);
 }
 
+    // file's stat infos, used to find whether the file be changed (without read file data)
+    typedef struct hpatch_TFileStatTag{
+        hpatch_StreamPos_t  fileSize;
+        hpatch_uint64_t     mtime_ns;  // last modification time, in nanoseconds
+        hpatch_uint64_t     inode;     // 0 if unsupport
+    } hpatch_TFileStatTag;
+// if return hpatch_FALSE, fileName not a file or unsupport stat tag
+hpatch_BOOL hpatch_getFileStatTag(const char* fileName_utf8,hpatch_TFileStatTag* out_tag);
+
 hpatch_inline static
 hpatch_BOOL  hpatch_getFileSize(const char* fileName_utf8,hpatch_StreamPos_t* out_fileSize){
     hpatch_TPathType   type;
@@ -233,6 +242,24 @@ hpatch_BOOL hpatch_TFileStreamOutput_close(hpatch_TFileStreamOutput* self);
 hpatch_BOOL hpatch_TFileStreamOutput_reopen(hpatch_TFileStreamOutput* self,const char* fileName_utf8,
                                             hpatch_StreamPos_t max_file_length);
 hpatch_BOOL hpatch_TFileStreamOutput_truncate(hpatch_TFileStreamOutput* self,hpatch_StreamPos_t new_file_length);
+
+typedef enum hpatch_TFileCopyType{
+    hpatch_kFileCopy_byUser=0, // not copied, caller need copy by read & write
+    hpatch_kFileCopy_byClone,  // shared extents by reflink (FICLONE)
+    hpatch_kFileCopy_byKernel, // copied in kernel by copy_file_range
+} hpatch_TFileCopyType;
+
+typedef struct hpatch_TFileCopyCounts{
+    hpatch_StreamPos_t  clonedSize;
+    hpatch_StreamPos_t  kernelCopiedSize;
+    hpatch_StreamPos_t  userCopiedSize;
+} hpatch_TFileCopyCounts;
+
+// try copy all data of srcFile to a just opened empty outFile by system, not need user buffer;
+//   return hpatch_kFileCopy_byUser when the system or filesystem not support it;
+//   if return other type, outFile->out_length==srcFile->base.streamSize.
+hpatch_TFileCopyType hpatch_TFileStreamOutput_copyBySystem(hpatch_TFileStreamOutput* self,
+                                                           const hpatch_TFileStreamInput* srcFile);
     
 #ifdef __cplusplus
 }
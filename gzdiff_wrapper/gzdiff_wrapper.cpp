@@ -0,0 +1,344 @@
+// gzdiff_wrapper.cpp
+// HDiffPatch
+/*
+ The MIT License (MIT)
+ Copyright (c) 2024 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "gzdiff_wrapper.h"
+#include "gzpatch_wrapper.h"
+#include "../libHDiffPatch/HDiff/match_block.h"
+#include "../libHDiffPatch/HDiff/private_diff/mem_buf.h"
+#include "../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include <string.h>
+#include <stdexcept>  //std::runtime_error
+#include "zlib.h" // http://zlib.net/  https://github.com/madler/zlib
+#define _check(value,info) { if (!(value)) { throw std::runtime_error(info); } }
+static const char* kGzDiffVersionType="HDIFFGZ1";
+
+namespace hdiff_private{
+    typedef unsigned char TByte;
+    static const size_t kMaxZStep=((size_t)1<<30);
+
+    static inline void pushUInt64LE(std::vector<unsigned char>& buf,hpatch_uint64_t v){
+        for (int i=0;i<8;++i,v>>=8)
+            buf.push_back((unsigned char)v);
+    }
+
+    //gzip member head, RFC 1952
+    static bool _gz_getHeadSize(const TByte* gz,const TByte* gz_end,size_t* out_headSize){
+        const size_t kMinHeadSize=10;
+        if ((size_t)(gz_end-gz)<kMinHeadSize) return false;
+        if ((gz[0]!=0x1f)||(gz[1]!=0x8b)||(gz[2]!=Z_DEFLATED)) return false;
+        const TByte flg=gz[3];
+        if (flg&0xE0) return false; //reserved bits
+        const TByte* p=gz+kMinHeadSize;
+        if (flg&4){ //FEXTRA
+            if (gz_end-p<2) return false;
+            size_t xlen=p[0]|(((size_t)p[1])<<8);
+            p+=2;
+            if ((size_t)(gz_end-p)<xlen) return false;
+            p+=xlen;
+        }
+        for (int f=8;f<=16;f<<=1){ //FNAME,FCOMMENT
+            if (0==(flg&f)) continue;
+            while ((p<gz_end)&&(*p!=0)) ++p;
+            if (p==gz_end) return false;
+            ++p;
+        }
+        if (flg&2){ //FHCRC
+            if (gz_end-p<2) return false;
+            p+=2;
+        }
+        *out_headSize=(size_t)(p-gz);
+        return true;
+    }
+
+    //inflate one deflate stream; windowBits see inflateInit2()
+    static bool _inflate(const TByte* code,const TByte* code_end,int windowBits,
+                         std::vector<TByte>& out_data,size_t* out_codeSize){
+        z_stream s;
+        memset(&s,0,sizeof(s));
+        if (Z_OK!=inflateInit2(&s,windowBits)) return false;
+        out_data.clear();
+        const size_t kOutStep=(size_t)1<<20;
+        size_t outSize=0;
+        int ret=Z_OK;
+        s.next_in=(Bytef*)code;
+        while (ret!=Z_STREAM_END){
+            if (s.avail_in==0){
+                size_t len=(size_t)(code_end-(const TByte*)s.next_in);
+                if (len==0) break; //data error
+                s.avail_in=(uInt)((len<kMaxZStep)?len:kMaxZStep);
+            }
+            if (out_data.size()==outSize)
+                out_data.resize(outSize+kOutStep+outSize/2);
+            s.next_out=out_data.data()+outSize;
+            size_t outLeave=out_data.size()-outSize;
+            s.avail_out=(uInt)((outLeave<kMaxZStep)?outLeave:kMaxZStep);
+            ret=inflate(&s,Z_NO_FLUSH);
+            outSize=(size_t)(s.next_out-out_data.data());
+            if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)) break;
+        }
+        if (out_codeSize) *out_codeSize=(size_t)((const TByte*)s.next_in-code);
+        inflateEnd(&s);
+        out_data.resize(outSize);
+        return (ret==Z_STREAM_END);
+    }
+
+    struct TDeflateSets{
+        int level;
+        int memLevel;
+        int windowBits;
+        int strategy;
+    };
+
+    //deflate(data) == code ?  input data & compare code by small step, return false when first mismatch;
+    //  if checkCodeSize<code size, only check code[0,checkCodeSize) & return true when it matched.
+    static bool _isDeflateTo(const TDeflateSets& sets,const TByte* data,const TByte* data_end,
+                             const TByte* code,const TByte* code_end,std::vector<TByte>& buf,
+                             size_t checkCodeSize=~(size_t)0){
+        z_stream s;
+        memset(&s,0,sizeof(s));
+        if (Z_OK!=deflateInit2(&s,sets.level,Z_DEFLATED,-sets.windowBits,sets.memLevel,sets.strategy))
+            return false;
+        const size_t kInputStep=1024*32; //output of a step must < buf.size()
+        const TByte* checkEnd=((size_t)(code_end-code)>checkCodeSize)?code+checkCodeSize:0;
+        bool result=true;
+        s.next_in=(Bytef*)data;
+        while (true){
+            if (s.avail_in==0){
+                size_t len=(size_t)(data_end-(const TByte*)s.next_in);
+                s.avail_in=(uInt)((len<kInputStep)?len:kInputStep);
+            }
+            const bool isFinish=((const TByte*)s.next_in+s.avail_in==data_end);
+            s.next_out=buf.data();
+            s.avail_out=(uInt)buf.size();
+            int ret=deflate(&s,isFinish?Z_FINISH:Z_NO_FLUSH);
+            if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)&&(ret!=Z_BUF_ERROR)) { result=false; break; }
+            size_t outLen=(size_t)(s.next_out-buf.data());
+            if ((outLen>(size_t)(code_end-code))||(0!=memcmp(buf.data(),code,outLen))) { result=false; break; }
+            code+=outLen;
+            if (ret==Z_STREAM_END) { result=(code==code_end); break; }
+            if ((checkEnd!=0)&&(code>=checkEnd)) break; //checked part matched
+        }
+        deflateEnd(&s);
+        return result;
+    }
+
+    //gzip head's XFL: 2 compressor used maximum compression, 4 used fastest algorithm
+    static int _gz_likelyLevel(const TByte* gz){
+        switch (gz[8]){
+            case 2:  return 9;
+            case 4:  return 1;
+            default: return 6; //zlib's default level
+        }
+    }
+
+    //probe likely sets first: level from gzip head, default memLevel; level 0 only output stored blocks;
+    //  every candidate checked by the code's prefix first, full deflate only for candidates matched the prefix.
+    static bool _findDeflateSets(TDeflateSets* out_sets,const TByte* data,const TByte* data_end,
+                                 const TByte* code,const TByte* code_end,int likelyLevel){
+        static const int kLevels[]={6,9,1,5,4,3,2,7,8};
+        static const int kMemLevels[]={8,9,7,6,5,4,3,2,1};
+        const size_t kPrefixCodeSize=1024*16;
+        if (code==code_end) return false;
+        std::vector<int> levels;
+        const bool isStoredBlock=(((code[0]>>1)&3)==0); //first block's BTYPE
+        if (isStoredBlock) levels.push_back(0);
+        levels.push_back(likelyLevel);
+        for (size_t l=0;l<sizeof(kLevels)/sizeof(kLevels[0]);++l){
+            if (kLevels[l]!=likelyLevel)
+                levels.push_back(kLevels[l]);
+        }
+        std::vector<TByte> buf(hdiff_kFileIOBufBestSize);
+        std::vector<TDeflateSets> prefixMatched;
+        for (size_t m=0;m<sizeof(kMemLevels)/sizeof(kMemLevels[0]);++m){
+            for (size_t l=0;l<levels.size();++l){
+                TDeflateSets sets={levels[l],kMemLevels[m],MAX_WBITS,Z_DEFAULT_STRATEGY};
+                if (_isDeflateTo(sets,data,data_end,code,code_end,buf,kPrefixCodeSize))
+                    prefixMatched.push_back(sets);
+            }
+            //check prefixMatched fully, likely sets first
+            for (size_t i=0;i<prefixMatched.size();++i){
+                if (_isDeflateTo(prefixMatched[i],data,data_end,code,code_end,buf)){
+                    *out_sets=prefixMatched[i];
+                    return true;
+                }
+            }
+            prefixMatched.clear();
+        }
+        return false;
+    }
+
+    static hpatch_uint32_t _crc32(const TByte* data,const TByte* data_end){
+        uLong crc=crc32(0,0,0);
+        while (data<data_end){
+            size_t len=(size_t)(data_end-data);
+            if (len>kMaxZStep) len=kMaxZStep;
+            crc=crc32(crc,data,(uInt)len);
+            data+=len;
+        }
+        return (hpatch_uint32_t)crc;
+    }
+
+    struct TOffsetStreamOutput:public hpatch_TStreamOutput{
+        TOffsetStreamOutput(const hpatch_TStreamOutput* _base,hpatch_StreamPos_t _offset)
+        :base(_base),offset(_offset){
+            streamImport=this;
+            streamSize=(_base->streamSize==hpatch_kNullStreamPos)?hpatch_kNullStreamPos:(_base->streamSize-_offset);
+            read_writed=(_base->read_writed)?_read_writed:0;
+            write=_write;
+        }
+        const hpatch_TStreamOutput* base;
+        hpatch_StreamPos_t          offset;
+        static hpatch_BOOL _read_writed(const struct hpatch_TStreamOutput* stream,hpatch_StreamPos_t readFromPos,
+                                        unsigned char* out_data,unsigned char* out_data_end){
+            const TOffsetStreamOutput* self=(const TOffsetStreamOutput*)stream->streamImport;
+            return self->base->read_writed(self->base,self->offset+readFromPos,out_data,out_data_end);
+        }
+        static hpatch_BOOL _write(const struct hpatch_TStreamOutput* stream,hpatch_StreamPos_t writeToPos,
+                                  const unsigned char* data,const unsigned char* data_end){
+            const TOffsetStreamOutput* self=(const TOffsetStreamOutput*)stream->streamImport;
+            return self->base->write(self->base,self->offset+writeToPos,data,data_end);
+        }
+    };
+}
+using namespace hdiff_private;
+
+bool create_gzdiff(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                   const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
+                   bool isSingleCompressedDiff,bool isDiffInMem,int kMinSingleMatchScore,
+                   size_t patchStepMemSize,bool isUseBigCacheMatch,size_t matchBlockSize,
+                   const hdiff_TMTSets_s* mtsets,TGzDiffRestInfo* out_restInfo){
+    const size_t kGzTailSize=8; //crc32 + isize
+    if (mtsets==0) mtsets=&hdiff_TMTSets_s_kEmpty;
+    TGzDiffRestInfo restInfo={0,0};
+    std::vector<TByte> newRaw;
+    std::vector<TByte> oldRaw;
+    std::vector<TByte> head;
+    {//new
+        TAutoMem newGz;
+        _check(newData->streamSize==(size_t)newData->streamSize,"create_gzdiff() newData too large");
+        newGz.realloc((size_t)newData->streamSize);
+        _check(newData->read(newData,0,newGz.data(),newGz.data_end()),"create_gzdiff() read newData");
+        size_t headSize;
+        size_t codeSize;
+        if (!_gz_getHeadSize(newGz.data(),newGz.data_end(),&headSize)) return false;
+        const TByte* code=newGz.data()+headSize;
+        if (!_inflate(code,newGz.data_end(),-MAX_WBITS,newRaw,&codeSize)) return false;
+        TDeflateSets sets;
+        if (!_findDeflateSets(&sets,newRaw.data(),newRaw.data()+newRaw.size(),code,code+codeSize,
+                              _gz_likelyLevel(newGz.data()))) return false;
+        //ok can recompress
+        const size_t tailSize=newGz.size()-headSize-codeSize;
+        restInfo.newRestSize=(tailSize>kGzTailSize)?(tailSize-kGzTailSize):0;
+        bool oldIsGz=false;
+        if (oldData->streamSize>0){
+            _check(oldData->streamSize==(size_t)oldData->streamSize,"create_gzdiff() oldData too large");
+            TAutoMem oldGz((size_t)oldData->streamSize);
+            _check(oldData->read(oldData,0,oldGz.data(),oldGz.data_end()),"create_gzdiff() read oldData");
+            size_t oldHeadSize;
+            size_t oldGzSize=0;
+            oldIsGz=_gz_getHeadSize(oldGz.data(),oldGz.data_end(),&oldHeadSize)
+                    &&_inflate(oldGz.data(),oldGz.data_end(),16+MAX_WBITS,oldRaw,&oldGzSize);
+            if (oldIsGz)
+                restInfo.oldRestSize=oldGz.size()-oldGzSize;
+            else
+                oldRaw.assign(oldGz.data(),oldGz.data_end());
+        }
+        head.assign(kGzDiffVersionType,kGzDiffVersionType+hpatch_kGzDiffVersionTypeLen);
+        head.push_back(oldIsGz?1:0);
+        head.push_back((TByte)sets.level);
+        head.push_back((TByte)sets.memLevel);
+        head.push_back((TByte)sets.windowBits);
+        head.push_back((TByte)sets.strategy);
+        head.resize(head.size()+3,0); //reserved
+        pushUInt64LE(head,oldData->streamSize);
+        pushUInt64LE(head,newData->streamSize);
+        pushUInt64LE(head,headSize);
+        pushUInt64LE(head,tailSize);
+        pushUInt64LE(head,_crc32(newGz.data(),newGz.data_end()));
+        assert(head.size()==hpatch_kGzDiffHeadLen);
+        head.insert(head.end(),newGz.data(),newGz.data()+headSize);
+        head.insert(head.end(),newGz.data_end()-tailSize,newGz.data_end());
+    }
+    _check(out_diff->write(out_diff,0,head.data(),head.data()+head.size()),"create_gzdiff() write diffData");
+    TOffsetStreamOutput innerDiff(out_diff,head.size());
+    TByte* pnew=newRaw.data();  TByte* pnew_end=pnew+newRaw.size();
+    TByte* pold=oldRaw.data();  TByte* pold_end=pold+oldRaw.size();
+    if (isDiffInMem){
+        if (isSingleCompressedDiff)
+            create_single_compressed_diff_block(pnew,pnew_end,pold,pold_end,&innerDiff,compressPlugin,
+                                                kMinSingleMatchScore,patchStepMemSize,isUseBigCacheMatch,
+                                                matchBlockSize,mtsets->threadNum);
+        else
+            create_compressed_diff_block(pnew,pnew_end,pold,pold_end,&innerDiff,compressPlugin,
+                                         kMinSingleMatchScore,isUseBigCacheMatch,
+                                         matchBlockSize,mtsets->threadNum);
+    }else{
+        hdiff_TStreamInput newStream;
+        hdiff_TStreamInput oldStream;
+        mem_as_hStreamInput(&newStream,pnew,pnew_end);
+        mem_as_hStreamInput(&oldStream,pold,pold_end);
+        hdiff_TMTSets_s memsets=*mtsets;
+        memsets.newDataIsMTSafe=true;
+        memsets.oldDataIsMTSafe=true;
+        if (isSingleCompressedDiff)
+            create_single_compressed_diff_stream(&newStream,&oldStream,&innerDiff,compressPlugin,
+                                                 matchBlockSize,patchStepMemSize,&memsets);
+        else
+            create_compressed_diff_stream(&newStream,&oldStream,&innerDiff,compressPlugin,
+                                          matchBlockSize,&memsets);
+    }
+    if (out_restInfo) *out_restInfo=restInfo;
+    return true;
+}
+
+bool check_gzdiff(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                  const hpatch_TStreamInput* diffData,hpatch_TDecompress* decompressPlugin){
+    const size_t kACacheBufSize=hdiff_kFileIOBufBestSize;
+    size_t stepMemSize=0;
+    size_t oldRawSize=0; //inflate old gzip into cache, faster than inflate when read
+    {
+        hpatch_TGzDiffInfo diffInfo;
+        hpatch_TGzInnerDiffStream innerDiff;
+        hpatch_singleCompressedDiffInfo sdiffInfo;
+        hpatch_compressedDiffInfo       cdiffInfo;
+        _test_rt(getGzDiffInfo(&diffInfo,diffData));
+        gzdiff_openInnerDiff(&innerDiff,diffData,&diffInfo);
+        if (getSingleCompressedDiffInfo(&sdiffInfo,&innerDiff.base,0)){
+            stepMemSize=(size_t)sdiffInfo.stepMemSize;
+            if (diffInfo.oldIsGz) oldRawSize=(size_t)sdiffInfo.oldDataSize;
+        }else if (diffInfo.oldIsGz&&getCompressedDiffInfo(&cdiffInfo,&innerDiff.base)){
+            oldRawSize=(size_t)cdiffInfo.oldDataSize;
+        }
+    }
+    TAutoMem _cache(kACacheBufSize*(1+16)+stepMemSize+oldRawSize);
+    _TCheckOutNewDataStream out_newData(newData,_cache.data(),kACacheBufSize);
+    _test_rt(gzpatch_with_cache(&out_newData,oldData,diffData,decompressPlugin,
+                                _cache.data()+kACacheBufSize,_cache.data_end()));
+    _test_rt(out_newData.isWriteFinish());
+    return true;
+}
@@ -0,0 +1,54 @@
+// gzdiff_wrapper.h
+// HDiffPatch
+/*
+ The MIT License (MIT)
+ Copyright (c) 2024 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef hdiff_gzdiff_wrapper_h
+#define hdiff_gzdiff_wrapper_h
+#include "../libHDiffPatch/HDiff/diff.h"
+
+// create diffFile between the inflated datas of gzip files, and save the deflate sets
+//   for recompress new gzip bit-exactly when patch (see gzpatch_wrapper.h);
+//   oldData can be a gzip file or any other file;
+//   if newData is not a gzip file, or can't found deflate sets for recompress it bit-exactly,
+//   then return false & not write to out_diff.
+//   innerDiff created by create_?_diff_block() if isDiffInMem, else by create_?_diff_stream();
+//   only the first member of gzip file be inflated, out_restInfo report the size of other data.
+struct TGzDiffRestInfo{
+    hpatch_StreamPos_t newRestSize; //new gzip's data after first member (other members), saved in diffFile without diff
+    hpatch_StreamPos_t oldRestSize; //old gzip's data after first member, not used as diff reference
+};
+bool create_gzdiff(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                   const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
+                   bool isSingleCompressedDiff,bool isDiffInMem,
+                   int kMinSingleMatchScore=kMinSingleMatchScore_default,
+                   size_t patchStepMemSize=kDefaultPatchStepMemSize,bool isUseBigCacheMatch=false,
+                   size_t matchBlockSize=kMatchBlockSize_default,const hdiff_TMTSets_s* mtsets=0,
+                   TGzDiffRestInfo* out_restInfo=0);
+
+bool check_gzdiff(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
+                  const hpatch_TStreamInput* diffData,hpatch_TDecompress* decompressPlugin);
+
+#endif
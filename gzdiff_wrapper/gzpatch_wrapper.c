@@ -0,0 +1,491 @@
+// gzpatch_wrapper.c
+// HDiffPatch
+/*
+ The MIT License (MIT)
+ Copyright (c) 2024 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "gzpatch_wrapper.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include <stdlib.h>
+#include <string.h>
+#include "zlib.h" // http://zlib.net/  https://github.com/madler/zlib
+#define _hpatch_FALSE   hpatch_FALSE
+//hpatch_uint __debug_check_false_x=0; //for debug
+//#define _hpatch_FALSE (1/__debug_check_false_x)
+
+static const char* kGzDiffVersionType = "HDIFFGZ1";
+#define            kGzCodeBufSize     (hpatch_kStreamCacheSize*4)
+#define            kMaxZStep          ((uInt)1<<30)
+
+static hpatch_inline hpatch_uint32_t _readUInt32(const unsigned char* buf){
+    return buf[0] | (((hpatch_uint32_t)buf[1])<<8)  |
+           (((hpatch_uint32_t)buf[2])<<16)  | (((hpatch_uint32_t)buf[3])<<24) ;
+}
+static hpatch_inline hpatch_uint64_t _readUInt64(const unsigned char* buf){
+    return _readUInt32(buf) | (((hpatch_uint64_t)_readUInt32(buf+4))<<32);
+}
+
+hpatch_BOOL getGzDiffInfo(hpatch_TGzDiffInfo* out_diffInfo,const hpatch_TStreamInput* diffStream){
+    unsigned char _buf[hpatch_kGzDiffHeadLen];
+    const unsigned char* buf=&_buf[0];
+    hpatch_StreamPos_t leaveSize;
+    if (diffStream->streamSize<hpatch_kGzDiffHeadLen)
+        return _hpatch_FALSE;
+    if (!diffStream->read(diffStream,0,_buf,_buf+hpatch_kGzDiffHeadLen))
+        return _hpatch_FALSE;
+    if (0!=memcmp(buf,kGzDiffVersionType,hpatch_kGzDiffVersionTypeLen))
+        return _hpatch_FALSE;
+    buf+=hpatch_kGzDiffVersionTypeLen;
+    if (buf[0]>1) return _hpatch_FALSE;
+    out_diffInfo->oldIsGz=buf[0];
+    out_diffInfo->level=buf[1];
+    out_diffInfo->memLevel=buf[2];
+    out_diffInfo->windowBits=buf[3];
+    out_diffInfo->strategy=buf[4];
+    if ((out_diffInfo->level>9)||(out_diffInfo->memLevel<1)||(out_diffInfo->memLevel>MAX_MEM_LEVEL)
+        ||(out_diffInfo->windowBits<9)||(out_diffInfo->windowBits>MAX_WBITS)||(out_diffInfo->strategy>Z_FIXED))
+        return _hpatch_FALSE;
+    buf+=8;
+    out_diffInfo->oldDataSize  =_readUInt64(buf);
+    out_diffInfo->newDataSize  =_readUInt64(buf+8);
+    out_diffInfo->newGzHeadSize=_readUInt64(buf+8*2);
+    out_diffInfo->newGzTailSize=_readUInt64(buf+8*3);
+    out_diffInfo->newDataCrc32 =(hpatch_uint32_t)_readUInt64(buf+8*4);
+    leaveSize=diffStream->streamSize-hpatch_kGzDiffHeadLen;
+    if ((out_diffInfo->newGzHeadSize>out_diffInfo->newDataSize)
+        ||(out_diffInfo->newGzTailSize>out_diffInfo->newDataSize-out_diffInfo->newGzHeadSize)
+        ||(out_diffInfo->newGzHeadSize>leaveSize)
+        ||(out_diffInfo->newGzTailSize>leaveSize-out_diffInfo->newGzHeadSize))
+        return _hpatch_FALSE;
+    out_diffInfo->innerDiffPos=hpatch_kGzDiffHeadLen+out_diffInfo->newGzHeadSize+out_diffInfo->newGzTailSize;
+    return hpatch_TRUE;
+}
+
+hpatch_BOOL getIsGzDiff(const hpatch_TStreamInput* diffData){
+    hpatch_TGzDiffInfo diffInfo;
+    return getGzDiffInfo(&diffInfo,diffData);
+}
+
+static hpatch_BOOL _innerDiff_read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                   unsigned char* out_data,unsigned char* out_data_end){
+    const hpatch_TGzInnerDiffStream* self=(const hpatch_TGzInnerDiffStream*)stream->streamImport;
+    return self->diffStream->read(self->diffStream,self->innerDiffPos+readFromPos,out_data,out_data_end);
+}
+
+void gzdiff_openInnerDiff(hpatch_TGzInnerDiffStream* self,const hpatch_TStreamInput* diffStream,
+                          const hpatch_TGzDiffInfo* diffInfo){
+    self->diffStream=diffStream;
+    self->innerDiffPos=diffInfo->innerDiffPos;
+    self->base.streamImport=self;
+    self->base.streamSize=diffStream->streamSize-diffInfo->innerDiffPos;
+    self->base.read=_innerDiff_read;
+    self->base._private_reserved=0;
+}
+
+hpatch_BOOL gz_inflate_to_mem(const hpatch_TStreamInput* gzData,unsigned char* out_data,unsigned char* out_data_end,
+                              unsigned char* temp_cache,unsigned char* temp_cache_end){
+    const hpatch_size_t cacheSize=(hpatch_size_t)(temp_cache_end-temp_cache);
+    unsigned char      _emptyOut[1];
+    hpatch_StreamPos_t readPos=0;
+    hpatch_BOOL        result;
+    int                ret=Z_OK;
+    z_stream           s;
+    if (cacheSize==0) return _hpatch_FALSE;
+    memset(&s,0,sizeof(s));
+    if (Z_OK!=inflateInit2(&s,16+MAX_WBITS)) //gzip wrapper
+        return _hpatch_FALSE;
+    if (out_data==0) out_data=out_data_end=_emptyOut;
+    s.next_out=out_data;
+    while (ret!=Z_STREAM_END){
+        if (s.avail_in==0){
+            hpatch_size_t readLen=cacheSize;
+            if (readLen>gzData->streamSize-readPos)
+                readLen=(hpatch_size_t)(gzData->streamSize-readPos);
+            if (readLen==0) break; //data error
+            if (!gzData->read(gzData,readPos,temp_cache,temp_cache+readLen)) break;
+            readPos+=readLen;
+            s.next_in=temp_cache;
+            s.avail_in=(uInt)readLen;
+        }
+        {
+            hpatch_size_t outLeave=(hpatch_size_t)(out_data_end-s.next_out);
+            s.avail_out=(outLeave<kMaxZStep)?(uInt)outLeave:kMaxZStep;
+        }
+        ret=inflate(&s,Z_NO_FLUSH);
+        if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)) break;
+    }
+    result=(ret==Z_STREAM_END)&&(s.next_out==out_data_end);
+    if (Z_OK!=inflateEnd(&s)) result=_hpatch_FALSE;
+    return result;
+}
+
+
+//random access stream of the inflated data of gzip's first member, not need memory for all inflated data;
+//  save inflate states (deflate block begin & window) when index, read from the nearest saved state.
+#define kGzWindowSize       ((hpatch_size_t)1<<15) //max deflate distance
+#define kGzPointSpanMin     ((hpatch_StreamPos_t)1<<18)
+
+typedef struct _TGzAccessPoint{
+    hpatch_StreamPos_t  outPos;  //pos in inflated data
+    hpatch_StreamPos_t  inPos;   //deflate block begin pos in gzData (+bits in the byte before it)
+    int                 bits;
+    unsigned char*      window;  //inflated data before outPos, size: min(outPos,kGzWindowSize)
+} _TGzAccessPoint;
+
+typedef struct _TGzInflateStream{
+    hpatch_TStreamInput         base;
+    const hpatch_TStreamInput*  gzData;
+    _TGzAccessPoint*            points;
+    size_t                      pointCount;
+    size_t                      maxPointCount;
+    hpatch_StreamPos_t          span;
+    hpatch_StreamPos_t          curOutPos;
+    hpatch_StreamPos_t          curInPos;
+    unsigned char*              inBuf;
+    hpatch_size_t               inBufSize;
+    unsigned char*              tempWindow; //kGzWindowSize
+    hpatch_BOOL                 isInflateInit;
+    z_stream                    s;
+} _TGzInflateStream;
+
+#define _kGzPointMemSize        (sizeof(_TGzAccessPoint)+kGzWindowSize)
+#define _gzInflate_minMemSize   (kGzCodeBufSize+kGzWindowSize+_kGzPointMemSize*2+sizeof(hpatch_StreamPos_t))
+//memory size for save access points by kGzPointSpanMin
+static hpatch_StreamPos_t _gzInflate_bestMemSize(hpatch_StreamPos_t rawSize){
+    return _gzInflate_minMemSize+(rawSize/kGzPointSpanMin)*_kGzPointMemSize;
+}
+
+static hpatch_BOOL _gzInflate_readIn(_TGzInflateStream* self){
+    hpatch_size_t readLen=self->inBufSize;
+    if (readLen>self->gzData->streamSize-self->curInPos)
+        readLen=(hpatch_size_t)(self->gzData->streamSize-self->curInPos);
+    if (readLen==0) return _hpatch_FALSE; //data error
+    if (!self->gzData->read(self->gzData,self->curInPos,self->inBuf,self->inBuf+readLen))
+        return _hpatch_FALSE;
+    self->curInPos+=readLen;
+    self->s.next_in=self->inBuf;
+    self->s.avail_in=(uInt)readLen;
+    return hpatch_TRUE;
+}
+
+static void _gzInflate_savePoint(_TGzInflateStream* self,hpatch_StreamPos_t outPos,hpatch_StreamPos_t inPos){
+    _TGzAccessPoint* point=&self->points[self->pointCount++];
+    hpatch_size_t winSize=(outPos<kGzWindowSize)?(hpatch_size_t)outPos:kGzWindowSize;
+    hpatch_size_t head=kGzWindowSize-self->s.avail_out; //tempWindow used as ring buffer
+    point->outPos=outPos;
+    point->inPos=inPos;
+    point->bits=self->s.data_type&7;
+    if (winSize<=head){
+        memcpy(point->window,self->tempWindow+head-winSize,winSize);
+    }else{
+        memcpy(point->window,self->tempWindow+kGzWindowSize-(winSize-head),winSize-head);
+        memcpy(point->window+(winSize-head),self->tempWindow,head);
+    }
+}
+
+//inflate all data once, save access points
+static hpatch_BOOL _gzInflate_index(_TGzInflateStream* self){
+    hpatch_StreamPos_t totalIn=0;
+    hpatch_StreamPos_t totalOut=0;
+    hpatch_StreamPos_t lastOut=0;
+    int ret=Z_OK;
+    if (Z_OK!=inflateInit2(&self->s,16+MAX_WBITS)) //gzip wrapper
+        return _hpatch_FALSE;
+    self->s.avail_out=0;
+    while (ret!=Z_STREAM_END){
+        if ((self->s.avail_in==0)&&(!_gzInflate_readIn(self))) break;
+        if (self->s.avail_out==0){
+            self->s.next_out=self->tempWindow;
+            self->s.avail_out=(uInt)kGzWindowSize;
+        }
+        totalIn+=self->s.avail_in;
+        totalOut+=self->s.avail_out;
+        ret=inflate(&self->s,Z_BLOCK);
+        totalIn-=self->s.avail_in;
+        totalOut-=self->s.avail_out;
+        if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)) break;
+        if ((ret!=Z_STREAM_END)&&(self->s.data_type&128)&&(!(self->s.data_type&64))
+            &&((self->pointCount==0)||(totalOut-lastOut>=self->span))){ //at a deflate block begin
+            if (self->pointCount==self->maxPointCount) { ret=Z_DATA_ERROR; break; }
+            _gzInflate_savePoint(self,totalOut,totalIn);
+            lastOut=totalOut;
+        }
+    }
+    if (Z_OK!=inflateEnd(&self->s)) ret=Z_DATA_ERROR;
+    return (ret==Z_STREAM_END)&&(totalOut==self->base.streamSize)&&(self->pointCount>0);
+}
+
+static hpatch_BOOL _gzInflate_seek(_TGzInflateStream* self,hpatch_StreamPos_t pos){
+    const _TGzAccessPoint* point;
+    size_t left=0;
+    size_t right=self->pointCount;
+    while (left+1<right){ //find last point outPos<=pos
+        size_t mid=left+(right-left)/2;
+        if (self->points[mid].outPos<=pos) left=mid; else right=mid;
+    }
+    point=&self->points[left];
+    if ((self->curOutPos<=pos)&&(self->curOutPos>=point->outPos)) return hpatch_TRUE; //continue inflate
+    if (Z_OK!=inflateReset(&self->s)) return _hpatch_FALSE;
+    self->s.avail_in=0;
+    self->curInPos=point->inPos;
+    if (point->bits){
+        unsigned char b;
+        if (!self->gzData->read(self->gzData,point->inPos-1,&b,&b+1)) return _hpatch_FALSE;
+        if (Z_OK!=inflatePrime(&self->s,point->bits,b>>(8-point->bits))) return _hpatch_FALSE;
+    }
+    if (point->outPos>0){
+        hpatch_size_t winSize=(point->outPos<kGzWindowSize)?(hpatch_size_t)point->outPos:kGzWindowSize;
+        if (Z_OK!=inflateSetDictionary(&self->s,point->window,(uInt)winSize)) return _hpatch_FALSE;
+    }
+    self->curOutPos=point->outPos;
+    return hpatch_TRUE;
+}
+
+static hpatch_BOOL _gzInflate_out(_TGzInflateStream* self,unsigned char* out_data,unsigned char* out_data_end){
+    self->s.next_out=out_data;
+    while (self->s.next_out<out_data_end){
+        int ret;
+        hpatch_size_t outLeave=(hpatch_size_t)(out_data_end-self->s.next_out);
+        if ((self->s.avail_in==0)&&(!_gzInflate_readIn(self))) return _hpatch_FALSE;
+        self->s.avail_out=(outLeave<kMaxZStep)?(uInt)outLeave:kMaxZStep;
+        ret=inflate(&self->s,Z_NO_FLUSH);
+        if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)&&(ret!=Z_BUF_ERROR)) return _hpatch_FALSE;
+        if ((ret==Z_STREAM_END)&&(self->s.next_out<out_data_end)) return _hpatch_FALSE;
+    }
+    self->curOutPos+=(hpatch_size_t)(out_data_end-out_data);
+    return hpatch_TRUE;
+}
+
+static hpatch_BOOL _gzInflate_read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                   unsigned char* out_data,unsigned char* out_data_end){
+    _TGzInflateStream* self=(_TGzInflateStream*)stream->streamImport;
+    if (readFromPos>self->base.streamSize) return _hpatch_FALSE;
+    if ((hpatch_size_t)(out_data_end-out_data)>self->base.streamSize-readFromPos) return _hpatch_FALSE;
+    if (!_gzInflate_seek(self,readFromPos)) return _hpatch_FALSE;
+    while (self->curOutPos<readFromPos){ //skip
+        hpatch_StreamPos_t skipLen=readFromPos-self->curOutPos;
+        if (skipLen>kGzWindowSize) skipLen=kGzWindowSize;
+        if (!_gzInflate_out(self,self->tempWindow,self->tempWindow+(hpatch_size_t)skipLen)) return _hpatch_FALSE;
+    }
+    return _gzInflate_out(self,out_data,out_data_end);
+}
+
+static void _gzInflate_close(_TGzInflateStream* self){
+    if (self->isInflateInit){
+        inflateEnd(&self->s);
+        self->isInflateInit=hpatch_FALSE;
+    }
+}
+
+//all memory (inBuf,ring window,access points) from mem; less memory, sparser access points & slower random read
+static hpatch_BOOL _gzInflate_open(_TGzInflateStream* self,const hpatch_TStreamInput* gzData,hpatch_StreamPos_t rawSize,
+                                   unsigned char* mem,unsigned char* mem_end){
+    size_t i;
+    unsigned char* windows;
+    memset(self,0,sizeof(*self));
+    if ((hpatch_size_t)(mem_end-mem)<_gzInflate_minMemSize) return _hpatch_FALSE;
+    self->base.streamImport=self;
+    self->base.streamSize=rawSize;
+    self->base.read=_gzInflate_read;
+    self->gzData=gzData;
+    self->points=(_TGzAccessPoint*)_hpatch_align_upper(mem,sizeof(hpatch_StreamPos_t));
+    self->maxPointCount=(hpatch_size_t)(mem_end-(unsigned char*)self->points-kGzCodeBufSize-kGzWindowSize)/_kGzPointMemSize;
+    self->span=rawSize/(self->maxPointCount-1)+1;
+    if (self->span<kGzPointSpanMin) self->span=kGzPointSpanMin;
+    windows=(unsigned char*)(self->points+self->maxPointCount);
+    for (i=0;i<self->maxPointCount;++i)
+        self->points[i].window=windows+kGzWindowSize*i;
+    self->tempWindow=windows+kGzWindowSize*self->maxPointCount;
+    self->inBuf=self->tempWindow+kGzWindowSize;
+    self->inBufSize=kGzCodeBufSize;
+    if (!_gzInflate_index(self)) return _hpatch_FALSE;
+    if (Z_OK!=inflateInit2(&self->s,-MAX_WBITS)) return _hpatch_FALSE; //raw deflate for read
+    self->isInflateInit=hpatch_TRUE;
+    self->curOutPos=self->base.streamSize; //need seek
+    return hpatch_TRUE;
+}
+
+
+typedef struct _TGzOutStream{
+    hpatch_TStreamOutput        base;
+    const hpatch_TStreamOutput* out_gz;
+    hpatch_StreamPos_t          outPos;  //writed size to out_gz
+    hpatch_StreamPos_t          rawPos;  //writed size of uncompressed data
+    hpatch_uint32_t             crc;     //crc32 of writed data to out_gz
+    unsigned char*              code;
+    z_stream                    s;
+} _TGzOutStream;
+
+static hpatch_BOOL _gzOut_out(_TGzOutStream* self,const unsigned char* data,const unsigned char* data_end){
+    if (data==data_end) return hpatch_TRUE;
+    if (!self->out_gz->write(self->out_gz,self->outPos,data,data_end))
+        return _hpatch_FALSE;
+    self->crc=(hpatch_uint32_t)crc32(self->crc,data,(uInt)(data_end-data));
+    self->outPos+=(hpatch_size_t)(data_end-data);
+    return hpatch_TRUE;
+}
+
+static hpatch_BOOL _gzOut_copyFrom(_TGzOutStream* self,const hpatch_TStreamInput* src,
+                                   hpatch_StreamPos_t readPos,hpatch_StreamPos_t size){
+    while (size>0){
+        hpatch_size_t len=(size<kGzCodeBufSize)?(hpatch_size_t)size:kGzCodeBufSize;
+        if (!src->read(src,readPos,self->code,self->code+len)) return _hpatch_FALSE;
+        if (!_gzOut_out(self,self->code,self->code+len)) return _hpatch_FALSE;
+        readPos+=len;
+        size-=len;
+    }
+    return hpatch_TRUE;
+}
+
+static hpatch_BOOL _gzOut_deflate(_TGzOutStream* self,const unsigned char* data,const unsigned char* data_end,int flush){
+    while (hpatch_TRUE){
+        int ret;
+        if ((self->s.avail_in==0)&&(data<data_end)){
+            hpatch_size_t len=(hpatch_size_t)(data_end-data);
+            self->s.next_in=(Bytef*)data;
+            self->s.avail_in=(len<kMaxZStep)?(uInt)len:kMaxZStep;
+            data+=self->s.avail_in;
+        }
+        self->s.next_out=self->code;
+        self->s.avail_out=kGzCodeBufSize;
+        ret=deflate(&self->s,(data<data_end)?Z_NO_FLUSH:flush);
+        if ((ret!=Z_OK)&&(ret!=Z_STREAM_END)&&(ret!=Z_BUF_ERROR)) return _hpatch_FALSE;
+        if (!_gzOut_out(self,self->code,self->s.next_out)) return _hpatch_FALSE;
+        if (flush==Z_FINISH){
+            if (ret==Z_STREAM_END) return hpatch_TRUE;
+        }else if ((self->s.avail_in==0)&&(data==data_end)&&(self->s.avail_out!=0)){
+            return hpatch_TRUE;
+        }
+    }
+}
+
+static hpatch_BOOL _gzOut_write(const hpatch_TStreamOutput* stream,hpatch_StreamPos_t writeToPos,
+                                const unsigned char* data,const unsigned char* data_end){
+    _TGzOutStream* self=(_TGzOutStream*)stream->streamImport;
+    if (writeToPos!=self->rawPos) return _hpatch_FALSE; //only support sequential write
+    self->rawPos+=(hpatch_size_t)(data_end-data);
+    return _gzOut_deflate(self,data,data_end,Z_NO_FLUSH);
+}
+
+#define _clear_return(exitValue) {  result=exitValue; goto clear; }
+
+hpatch_BOOL gzpatch_with_cache(const hpatch_TStreamOutput* out_newData,
+                               const hpatch_TStreamInput*  oldData,
+                               const hpatch_TStreamInput*  gzDiff,
+                               hpatch_TDecompress* decompressPlugin,
+                               unsigned char* temp_cache,unsigned char* temp_cache_end){
+    hpatch_TGzDiffInfo          diffInfo;
+    hpatch_TGzInnerDiffStream   innerDiff;
+    hpatch_compressedDiffInfo   hdiffInfo;
+    hpatch_singleCompressedDiffInfo sdiffInfo;
+    hpatch_BOOL                 isSingleDiff=hpatch_FALSE;
+    hpatch_TStreamInput         oldRawStream;
+    _TGzInflateStream           oldGzStream;
+    hpatch_BOOL                 isDeflateInit=hpatch_FALSE;
+    hpatch_BOOL                 result=hpatch_TRUE;
+    _TGzOutStream               gzOut;
+    if ((hpatch_size_t)(temp_cache_end-temp_cache)<kGzCodeBufSize+hpatch_kStreamCacheSize*3) return _hpatch_FALSE;
+    temp_cache_end-=kGzCodeBufSize;
+    memset(&gzOut,0,sizeof(gzOut));
+    memset(&oldGzStream,0,sizeof(oldGzStream));
+    gzOut.code=temp_cache_end;
+
+    if (!getGzDiffInfo(&diffInfo,gzDiff)) return _hpatch_FALSE;
+    if ((diffInfo.oldDataSize!=oldData->streamSize)||(diffInfo.newDataSize!=out_newData->streamSize))
+        return _hpatch_FALSE;
+    gzdiff_openInnerDiff(&innerDiff,gzDiff,&diffInfo);
+    if (getCompressedDiffInfo(&hdiffInfo,&innerDiff.base)){
+        //ok
+    }else if (getSingleCompressedDiffInfo(&sdiffInfo,&innerDiff.base,0)){
+        isSingleDiff=hpatch_TRUE;
+        hdiffInfo.oldDataSize=sdiffInfo.oldDataSize;
+        hdiffInfo.newDataSize=sdiffInfo.newDataSize;
+        if ((hpatch_size_t)(temp_cache_end-temp_cache)<sdiffInfo.stepMemSize+hpatch_kStreamCacheSize*3)
+            return _hpatch_FALSE;
+    }else{
+        return _hpatch_FALSE;
+    }
+    if (diffInfo.oldIsGz){
+        const hpatch_size_t patchCacheSize_min=(isSingleDiff?(hpatch_size_t)sdiffInfo.stepMemSize:0)
+                                               +hpatch_kStreamCacheSize*3;
+        hpatch_size_t cacheSize=(hpatch_size_t)(temp_cache_end-temp_cache);
+        if ((hdiffInfo.oldDataSize<=cacheSize)&&(cacheSize-(hpatch_size_t)hdiffInfo.oldDataSize>=patchCacheSize_min)){
+            //inflate all oldData into cache
+            unsigned char* oldRaw=temp_cache;
+            temp_cache+=(hpatch_size_t)hdiffInfo.oldDataSize;
+            if (!gz_inflate_to_mem(oldData,oldRaw,temp_cache,temp_cache,temp_cache_end))
+                return _hpatch_FALSE;
+            mem_as_hStreamInput(&oldRawStream,oldRaw,temp_cache);
+            oldData=&oldRawStream;
+        }else{ //cache not enough, inflate oldData when read; access points use half of cache at most
+            hpatch_StreamPos_t memSize=_gzInflate_bestMemSize(hdiffInfo.oldDataSize);
+            if (cacheSize<_gzInflate_minMemSize+patchCacheSize_min) return _hpatch_FALSE;
+            if (memSize>cacheSize/2) memSize=cacheSize/2;
+            if (memSize<_gzInflate_minMemSize) memSize=_gzInflate_minMemSize;
+            if (cacheSize-(hpatch_size_t)memSize<patchCacheSize_min) memSize=cacheSize-patchCacheSize_min;
+            if (!_gzInflate_open(&oldGzStream,oldData,hdiffInfo.oldDataSize,temp_cache,temp_cache+(hpatch_size_t)memSize))
+                _clear_return(_hpatch_FALSE);
+            temp_cache+=(hpatch_size_t)memSize;
+            oldData=&oldGzStream.base;
+        }
+    }
+
+    gzOut.out_gz=out_newData;
+    gzOut.crc=(hpatch_uint32_t)crc32(0,0,0);
+    gzOut.base.streamImport=&gzOut;
+    gzOut.base.streamSize=hdiffInfo.newDataSize;
+    gzOut.base.read_writed=0;
+    gzOut.base.write=_gzOut_write;
+    if (Z_OK!=deflateInit2(&gzOut.s,diffInfo.level,Z_DEFLATED,-diffInfo.windowBits,
+                           diffInfo.memLevel,diffInfo.strategy))
+        _clear_return(_hpatch_FALSE);
+    isDeflateInit=hpatch_TRUE;
+
+    if (!_gzOut_copyFrom(&gzOut,gzDiff,hpatch_kGzDiffHeadLen,diffInfo.newGzHeadSize))
+        _clear_return(_hpatch_FALSE);
+    if (isSingleDiff){
+        if (!patch_single_compressed_diff(&gzOut.base,oldData,&innerDiff.base,sdiffInfo.diffDataPos,
+                                          sdiffInfo.uncompressedSize,sdiffInfo.compressedSize,decompressPlugin,
+                                          sdiffInfo.coverCount,(hpatch_size_t)sdiffInfo.stepMemSize,
+                                          temp_cache,temp_cache_end,0,1))
+            _clear_return(_hpatch_FALSE);
+    }else{
+        if (!patch_decompress_with_cache(&gzOut.base,oldData,&innerDiff.base,decompressPlugin,
+                                         temp_cache,temp_cache_end))
+            _clear_return(_hpatch_FALSE);
+    }
+    if (gzOut.rawPos!=hdiffInfo.newDataSize)
+        _clear_return(_hpatch_FALSE);
+    if (!_gzOut_deflate(&gzOut,0,0,Z_FINISH))
+        _clear_return(_hpatch_FALSE);
+    if (!_gzOut_copyFrom(&gzOut,gzDiff,hpatch_kGzDiffHeadLen+diffInfo.newGzHeadSize,diffInfo.newGzTailSize))
+        _clear_return(_hpatch_FALSE);
+    //different deflate code can't recompress bit-exactly
+    if ((gzOut.outPos!=diffInfo.newDataSize)||(gzOut.crc!=diffInfo.newDataCrc32))
+        _clear_return(_hpatch_FALSE);
+clear:
+    if (isDeflateInit) deflateEnd(&gzOut.s);
+    _gzInflate_close(&oldGzStream);
+    return result;
+}
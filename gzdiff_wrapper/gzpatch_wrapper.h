@@ -0,0 +1,85 @@
+// gzpatch_wrapper.h
+// HDiffPatch
+/*
+ The MIT License (MIT)
+ Copyright (c) 2024 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef hpatch_gzpatch_wrapper_h
+#define hpatch_gzpatch_wrapper_h
+#include "../libHDiffPatch/HPatch/patch_types.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// gzdiff: diff the inflated datas of gzip files, and save the deflate sets for bit-exact recompress new gzip.
+//   diffFile format:
+//      "HDIFFGZ1" + oldIsGz(1B) + level(1B) + memLevel(1B) + windowBits(1B) + strategy(1B) + 3B reserved
+//      + oldDataSize(8B) + newDataSize(8B) + newGzHeadSize(8B) + newGzTailSize(8B) + newDataCrc32(8B)
+//      + newGzHead + newGzTail + innerDiff(create by hdiffz, compressedDiff or singleCompressedDiff)
+//   note: only the first member of gzip file be inflated, the rest of data (trailer,other members) saved in newGzTail;
+//         recompress need same deflate code as diff, mismatch can be found by newDataCrc32 when patch.
+
+#define hpatch_kGzDiffVersionTypeLen    8
+#define hpatch_kGzDiffHeadLen           (hpatch_kGzDiffVersionTypeLen+8+8*5)
+
+typedef struct hpatch_TGzDiffInfo{
+    hpatch_BOOL         oldIsGz;
+    int                 level;
+    int                 memLevel;
+    int                 windowBits;
+    int                 strategy;
+    hpatch_StreamPos_t  oldDataSize;   //old file size
+    hpatch_StreamPos_t  newDataSize;   //new gzip file size
+    hpatch_StreamPos_t  newGzHeadSize;
+    hpatch_StreamPos_t  newGzTailSize;
+    hpatch_uint32_t     newDataCrc32;  //crc32 of new gzip file
+    hpatch_StreamPos_t  innerDiffPos;  //innerDiff begin pos in diffFile
+} hpatch_TGzDiffInfo;
+
+hpatch_BOOL getIsGzDiff(const hpatch_TStreamInput* diffData);
+hpatch_BOOL getGzDiffInfo(hpatch_TGzDiffInfo* out_diffInfo,const hpatch_TStreamInput* diffStream);
+
+// innerDiff as a stream; used to get innerDiff's diffInfo & compressType
+typedef struct hpatch_TGzInnerDiffStream{
+    hpatch_TStreamInput         base;
+    const hpatch_TStreamInput*  diffStream;
+    hpatch_StreamPos_t          innerDiffPos;
+} hpatch_TGzInnerDiffStream;
+void gzdiff_openInnerDiff(hpatch_TGzInnerDiffStream* self,const hpatch_TStreamInput* diffStream,
+                          const hpatch_TGzDiffInfo* diffInfo);
+
+// inflate the first member of gzip data to out_data, must got (out_data_end-out_data) bytes
+hpatch_BOOL gz_inflate_to_mem(const hpatch_TStreamInput* gzData,unsigned char* out_data,unsigned char* out_data_end,
+                              unsigned char* temp_cache,unsigned char* temp_cache_end);
+
+hpatch_BOOL gzpatch_with_cache(const hpatch_TStreamOutput* out_newData,
+                               const hpatch_TStreamInput*  oldData,
+                               const hpatch_TStreamInput*  gzDiff, //create by hdiffz -GZ
+                               hpatch_TDecompress* decompressPlugin, //for innerDiff
+                               unsigned char* temp_cache,unsigned char* temp_cache_end);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
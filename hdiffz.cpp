@@ -42,6 +42,9 @@
 #include "file_for_patch.h"
 #include "libHDiffPatch/HDiff/private_diff/mem_buf.h"
 #include "hdiffz_import_patch.h"
+#if (_IS_USED_MULTITHREAD)
+#include "libParallel/parallel_channel.h"
+#endif
 
 #include "_dir_ignore.h"
 #include "dirDiffPatch/dir_diff/dir_diff.h"
@@ -55,6 +58,9 @@
 #ifndef _IS_NEED_VCDIFF
 #   define _IS_NEED_VCDIFF 1
 #endif
+#ifndef _IS_NEED_GZDIFF
+#   define _IS_NEED_GZDIFF 0 //need zlib's deflate code for patch
+#endif
 
 #ifndef _IS_NEED_DEFAULT_CompressPlugin
 #   define _IS_NEED_DEFAULT_CompressPlugin 1
@@ -104,6 +110,10 @@
 #   include "vcdiff_wrapper/vcdiff_wrapper.h"
 #   include "vcdiff_wrapper/vcpatch_wrapper.h"
 #endif
+#if (_IS_NEED_GZDIFF)
+#   include "gzdiff_wrapper/gzdiff_wrapper.h"
+#   include "gzdiff_wrapper/gzpatch_wrapper.h"
+#endif
 
 #include "compress_plugin_demo.h"
 #include "decompress_plugin_demo.h"
@@ -153,6 +163,9 @@ static void printUsage(){
     printf("diff    usage: hdiffz [options] oldPath newPath outDiffFile\n"
            "test    usage: hdiffz    -t     oldPath newPath testDiffFile\n"
            "resave  usage: hdiffz [-c-...]  diffFile outDiffFile\n"
+#if (_IS_NEED_DIR_DIFF_PATCH)
+           "batch  resave: hdiffz [-c-...] [-p-parallelThreadNumber] diffFilesDir outDiffFilesDir\n"
+#endif
            "print    info: hdiffz -info diffFile\n"
 #if (_IS_NEED_DIR_DIFF_PATCH)
            "get  manifest: hdiffz [-g#...] [-C-checksumType] inputPath -M#outManifestTxtFile\n"
@@ -187,6 +200,11 @@ static void printUsage(){
            "      set is use a big cache for slow match, DEFAULT false;\n"
            "      if newData not similar to oldData then diff speed++,\n"
            "      big cache max used O(oldFileSize) memory, and build slow(diff speed--)\n" 
+           "  -cost-0\n"
+           "      must run with -m;\n"
+           "      select covers by adaptive order-0 cost model (rle + byte frequency),\n"
+           "      DEFAULT by adaptive order-1 model; outDiffFile maybe smaller for big binary file\n"
+           "      (e.g. libLLVM.so, about 2%% smaller), but maybe larger for text file.\n"
            "  -SD[-stepSize]\n"
            "      create single compressed diffData, only need one decompress buffer\n"
            "      when patch, and support step by step patching when step by step downloading!\n"
@@ -216,6 +234,16 @@ static void printUsage(){
 #   endif
            "      NOTE: out diffFile used large source window size!\n"
 #endif
+#if (_IS_NEED_GZDIFF)
+           "  -GZ\n"
+           "      if newFile is gzip file, diff between inflated datas of oldFile(can be gzip\n"
+           "        or not) & newFile, and save deflate sets for recompress newFile bit-exactly\n"
+           "        when patch; unsupport input directory(folder);\n"
+           "      if can't recompress newFile bit-exactly by zlib, then run normal diff.\n"
+           "      also support run with -SD, for create single compressed innerDiff.\n"
+           "      NOTE: patch need zlib's deflate code same as diff!\n"
+           "      only the first member of gzip file be inflated (warning for multi-member);\n"
+#endif
 #if (_IS_USED_MULTITHREAD)
            "  -p-parallelThreadNumber\n"
            "      if parallelThreadNumber>1 then open multi-thread Parallel mode;\n"
@@ -230,6 +258,11 @@ static void printUsage(){
            "  -c-compressType[-compressLevel]\n"
            "      set outDiffFile Compress type, DEFAULT uncompress;\n"
            "      for resave diffFile,recompress diffFile to outDiffFile by new set;\n"
+           "        if parallelThreadNumber>1, decompress by a read ahead thread;\n"
+#if (_IS_NEED_DIR_DIFF_PATCH)
+           "        for batch resave, all diffFiles in diffFilesDir resave by\n"
+           "        parallelThreadNumber threads parallel, one thread per diffFile;\n"
+#endif
            "      support compress type & level & dict:\n"
 #ifdef _CompressPlugin_zlib
            "        -c-zlib[-{1..9}[-dictBits]]     DEFAULT level 9\n"
@@ -371,8 +404,27 @@ static void printUsage(){
            "      oldManifestFile is created from oldPath; if no oldPath not need -M-old;\n"
            "  -M-new#newManifestFile\n"
            "      newManifestFile is created from newPath;\n"
+           "  -M-cache#manifestCacheFile\n"
+           "      saved every file's size,mtime,inode & checksum into manifestCacheFile;\n"
+           "      when next run Directory Diff or create / check Manifest, the file not changed\n"
+           "      (same size,mtime,inode) reuse the cached checksum, not need read it again;\n"
+           "      if manifestCacheFile not exists, then create it.\n"
+           "  -M-cache-verify#manifestCacheFile\n"
+           "      same as -M-cache, but force re-read & checksum all files, and update cache.\n"
            "  -D  force run Directory diff between two files; DEFAULT (no -D) run \n"
            "      directory diff need oldPath or newPath is directory.\n"
+           "  -D-pair\n"
+           "      Directory diff: pair every changed newFile with an oldFile (same path, or\n"
+           "      same file name & nearest size, or most similar content by MinHash sketch),\n"
+           "      and match each pair by threads (-p-parallelThreadNumber);\n"
+           "      new datas not matched in pairs, matched by block between all old & new files;\n"
+           "      need less memory than diff all files as one data, diffFile format not changed.\n"
+           "  -D-seg[-segmentSize]\n"
+           "      Directory diff: save diffData as independent segments, every segment for\n"
+           "      segmentSize bytes of new files's data; so hpatchz can patch segments by threads\n"
+           "      (-p-parallelThreadNumber), need add segmentSize*threadNumber memory;\n"
+           "      diffFile a little larger; unsupport run with -SD; DEFAULT -D-seg-4m;\n"
+           "      (old version hpatchz unsupport this diffFile).\n"
 #endif //_IS_NEED_DIR_DIFF_PATCH
            "  -neq\n"
            "      open check: if newPath & oldPath's all datas are equal, then return error; \n"
@@ -426,12 +478,16 @@ int hdiff_cmd_line(int argc,const char * argv[]);
 struct TDiffSets:public THDiffSets{
     hpatch_BOOL isDoDiff;
     hpatch_BOOL isDoPatchCheck;
+    hpatch_BOOL isCoverCostOrder0;
 #if (_IS_NEED_BSDIFF)
     hpatch_BOOL isBsDiff;
 #endif
 #if (_IS_NEED_VCDIFF)
     hpatch_BOOL isVcDiff;
 #endif
+#if (_IS_NEED_GZDIFF)
+    hpatch_BOOL isGzDiff;
+#endif
 };
 
 #if (_IS_NEED_DIR_DIFF_PATCH)
@@ -441,14 +497,23 @@ int hdiff_dir(const char* oldPath,const char* newPath,const char* outDiffFileNam
               const TDiffSets& diffSets,size_t kMaxOpenFileNumber,
               const std::vector<std::string>& ignorePathListBase,const std::vector<std::string>& ignoreOldPathList,
               const std::vector<std::string>& ignoreNewPathList,
-              const std::string& oldManifestFileName,const std::string& newManifestFileName);
+              const std::string& oldManifestFileName,const std::string& newManifestFileName,
+              const std::string& manifestCacheFileName,hpatch_BOOL isManifestCacheVerify);
 int create_manifest(const char* inputPath,const char* outManifestFileName,
-                    hpatch_TChecksum* checksumPlugin,const std::vector<std::string>& ignorePathList);
+                    hpatch_TChecksum* checksumPlugin,const std::vector<std::string>& ignorePathList,
+                    const std::string& manifestCacheFileName,hpatch_BOOL isManifestCacheVerify);
 #endif
 int hdiff(const char* oldFileName,const char* newFileName,const char* outDiffFileName,
           const hdiff_TCompress* compressPlugin,const TDiffSets& diffSets);
+//workDecompressPlugin: the decompress plugin found for diffFile is copied to it, must not shared by threads;
+//  if null, used a local copy
 int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
-                 const hdiff_TCompress* compressPlugin);
+                 const hdiff_TCompress* compressPlugin,size_t threadNum=1,bool isPrintInfo=true,
+                 hpatch_TDecompress* workDecompressPlugin=0);
+#if (_IS_NEED_DIR_DIFF_PATCH)
+int hdiff_resave_batch(const char* diffDirName,const char* outDiffDirName,
+                       hdiff_TCompress* compressPlugin,size_t threadNum,hpatch_BOOL isForceOverwrite);
+#endif
 
 #define _checkPatchMode(_argc,_argv)            \
     if (isSwapToPatchMode(_argc,_argv)){        \
@@ -803,6 +868,7 @@ static int _checkSetCompress(hdiff_TCompress** out_compressPlugin,
 #define _kNULL_SIZE     (~(size_t)0)
 
 #define _THREAD_NUMBER_NULL     _kNULL_SIZE
+#define _kDefaultDirDiffSegmentSize (1024*1024*4)
 #define _THREAD_NUMBER_DEFUALT  kDefaultCompressThreadNumber
 #define _THREAD_NUMBER_MAX      (1<<8)
 
@@ -814,13 +880,19 @@ int hdiff_cmd_line(int argc, const char * argv[]){
 #endif
 #if (_IS_NEED_VCDIFF)
     diffSets.isVcDiff = _kNULL_VALUE;
+#endif
+#if (_IS_NEED_GZDIFF)
+    diffSets.isGzDiff = _kNULL_VALUE;
 #endif
     diffSets.isDoDiff =_kNULL_VALUE;
     diffSets.isDoPatchCheck=_kNULL_VALUE;
     diffSets.isDiffInMem   =_kNULL_VALUE;
     diffSets.isSingleCompressedDiff =_kNULL_VALUE;
     diffSets.isUseBigCacheMatch =_kNULL_VALUE;
+    diffSets.isCoverCostOrder0 =_kNULL_VALUE;
     diffSets.isCheckNotEqual =_kNULL_VALUE;
+    diffSets.isDiffByFilePair=_kNULL_VALUE;
+    diffSets.hdiffSegmentSize=_kNULL_SIZE;
     diffSets.matchBlockSize=_kNULL_SIZE;
     diffSets.threadNum=_THREAD_NUMBER_NULL;
     diffSets.threadNumSearch_s=_THREAD_NUMBER_NULL;
@@ -838,6 +910,8 @@ int hdiff_cmd_line(int argc, const char * argv[]){
     std::string             manifestOut;
     std::string             manifestOld;
     std::string             manifestNew;
+    std::string             manifestCache;
+    hpatch_BOOL             isManifestCacheVerify=hpatch_FALSE;
     std::vector<std::string>    ignorePathList;
     std::vector<std::string>    ignoreOldPathList;
     std::vector<std::string>    ignoreNewPathList;
@@ -938,6 +1012,13 @@ int hdiff_cmd_line(int argc, const char * argv[]){
                 diffSets.isVcDiff=hpatch_TRUE;
             } break;
 #   endif
+#endif
+#if (_IS_NEED_GZDIFF)
+            case 'G':{
+                _options_check((diffSets.isGzDiff==_kNULL_VALUE)
+                               &&(op[2]=='Z')&&(op[3]=='\0'),"-GZ");
+                diffSets.isGzDiff=hpatch_TRUE;
+            } break;
 #endif
             case 'i':{
                 _options_check((isPrintFileInfo==_kNULL_VALUE)&&(op[2]=='n')&&(op[3]=='f')
@@ -1008,6 +1089,9 @@ int hdiff_cmd_line(int argc, const char * argv[]){
                     _options_check((diffSets.isUseBigCacheMatch==_kNULL_VALUE)&&
                         (op[3]=='c')&&(op[4]=='h')&&(op[5]=='e')&&(op[6]=='\0'),"-cache?");
                     diffSets.isUseBigCacheMatch=hpatch_TRUE; //use big cache for match 
+                }else if (op[2]=='o'){
+                    _options_check((diffSets.isCoverCostOrder0==_kNULL_VALUE)&&(0==strcmp(op,"-cost-0")),"-cost-0?");
+                    diffSets.isCoverCostOrder0=hpatch_TRUE; //select covers by order-0 cost model
                 }else{
                     _options_check(false,"-c?");
                 }
@@ -1049,6 +1133,15 @@ int hdiff_cmd_line(int argc, const char * argv[]){
                     }else if ((op[3]=='n')&&(op[4]=='e')&&(op[5]=='w')&&(op[6]=='#')){
                         _options_check(manifestOut.empty()&&manifestNew.empty(),"-M-new#");
                         manifestNew=plist;
+                    }else if (0==strncmp(op+3,"cache#",6)){
+                        _options_check(manifestCache.empty(),"-M-cache#");
+                        manifestCache=op+9;
+                        _options_check(!manifestCache.empty(),"-M-cache#?");
+                    }else if (0==strncmp(op+3,"cache-verify#",13)){
+                        _options_check(manifestCache.empty(),"-M-cache-verify#");
+                        manifestCache=op+16;
+                        isManifestCacheVerify=hpatch_TRUE;
+                        _options_check(!manifestCache.empty(),"-M-cache-verify#?");
                     }else{
                         _options_check(hpatch_FALSE,"-M-?");
                     }
@@ -1057,8 +1150,22 @@ int hdiff_cmd_line(int argc, const char * argv[]){
                 }
             } break;
             case 'D':{
-                _options_check((isForceRunDirDiff==_kNULL_VALUE)&&(op[2]=='\0'),"-D");
-                isForceRunDirDiff=hpatch_TRUE; //force run DirDiff
+                if (op[2]=='\0'){
+                    _options_check(isForceRunDirDiff==_kNULL_VALUE,"-D");
+                    isForceRunDirDiff=hpatch_TRUE; //force run DirDiff
+                }else if (0==strncmp(op,"-D-seg",6)){
+                    _options_check((diffSets.hdiffSegmentSize==_kNULL_SIZE)&&((op[6]=='\0')||(op[6]=='-')),"-D-seg");
+                    if (op[6]=='-'){
+                        const char* pnum=op+7;
+                        _options_check(kmg_to_size(pnum,strlen(pnum),&diffSets.hdiffSegmentSize),"-D-seg-?");
+                        _options_check(diffSets.hdiffSegmentSize>0,"-D-seg-?");
+                    }else{
+                        diffSets.hdiffSegmentSize=_kDefaultDirDiffSegmentSize;
+                    }
+                }else{
+                    _options_check((diffSets.isDiffByFilePair==_kNULL_VALUE)&&(0==strcmp(op,"-D-pair")),"-D-?");
+                    diffSets.isDiffByFilePair=hpatch_TRUE;
+                }
             } break;
 #endif
             case 'n':{
@@ -1103,6 +1210,10 @@ int hdiff_cmd_line(int argc, const char * argv[]){
     }
     if (diffSets.isCheckNotEqual==_kNULL_VALUE)
         diffSets.isCheckNotEqual=hpatch_FALSE;
+    if (diffSets.isDiffByFilePair==_kNULL_VALUE)
+        diffSets.isDiffByFilePair=hpatch_FALSE;
+    if (diffSets.hdiffSegmentSize==_kNULL_SIZE)
+        diffSets.hdiffSegmentSize=0;
     if (diffSets.isSingleCompressedDiff==_kNULL_VALUE)
         diffSets.isSingleCompressedDiff=hpatch_FALSE;
 #if (_IS_NEED_BSDIFF)
@@ -1127,6 +1238,18 @@ int hdiff_cmd_line(int argc, const char * argv[]){
 #endif
     }
 #endif
+#if (_IS_NEED_GZDIFF)
+    if (diffSets.isGzDiff==_kNULL_VALUE)
+        diffSets.isGzDiff=hpatch_FALSE;
+    if (diffSets.isGzDiff){
+#if (_IS_NEED_BSDIFF)
+        _options_check(!diffSets.isBsDiff,"-BSD -GZ can only set one");
+#endif
+#if (_IS_NEED_VCDIFF)
+        _options_check(!diffSets.isVcDiff,"-VCD -GZ can only set one");
+#endif
+    }
+#endif
 #if (_IS_NEED_DIR_DIFF_PATCH)
     if (isSetChecksum==_kNULL_VALUE)
         isSetChecksum=hpatch_FALSE;
@@ -1171,6 +1294,20 @@ int hdiff_cmd_line(int argc, const char * argv[]){
         if (diffSets.isDoDiff&&(!diffSets.isDiffInMem)){
             _options_check(!diffSets.isUseBigCacheMatch, "-cache must run with -m");
         }
+        if (diffSets.isCoverCostOrder0==_kNULL_VALUE)
+            diffSets.isCoverCostOrder0=hpatch_FALSE;
+        if (diffSets.isCoverCostOrder0){
+            _options_check(diffSets.isDiffInMem, "-cost-0 must run with -m");
+#if (_IS_NEED_BSDIFF)
+            _options_check(!diffSets.isBsDiff,"-cost-0 unsupport run with -BSD");
+#endif
+#if (_IS_NEED_VCDIFF)
+            _options_check(!diffSets.isVcDiff,"-cost-0 unsupport run with -VCD");
+#endif
+#if (_IS_NEED_GZDIFF)
+            _options_check(!diffSets.isGzDiff,"-cost-0 unsupport run with -GZ");
+#endif
+        }
         
 #if (_IS_NEED_DIR_DIFF_PATCH)
         if (isForceRunDirDiff==_kNULL_VALUE)
@@ -1250,14 +1387,23 @@ int hdiff_cmd_line(int argc, const char * argv[]){
 #if (_IS_NEED_VCDIFF)
             _options_check(!diffSets.isVcDiff,"VCDIFF unsupport dir diff");
 #endif
+#if (_IS_NEED_GZDIFF)
+            _options_check(!diffSets.isGzDiff,"-GZ unsupport dir diff");
+#endif
+            _options_check(!diffSets.isCoverCostOrder0,"-cost-0 unsupport dir diff");
+            _options_check((diffSets.hdiffSegmentSize==0)||(!diffSets.isSingleCompressedDiff),
+                           "-D-seg unsupport run with -SD");
             return hdiff_dir(oldPath,newPath,outDiffFileName,compressPlugin,
                              checksumPlugin,(kPathType_dir==oldType),(kPathType_dir==newType), 
                              diffSets,kMaxOpenFileNumber,
                              ignorePathList,ignoreOldPathList,ignoreNewPathList,
-                             manifestOld,manifestNew);
+                             manifestOld,manifestNew,manifestCache,isManifestCacheVerify);
         }else
 #endif
         {
+#if (_IS_NEED_DIR_DIFF_PATCH)
+            _options_check(manifestCache.empty(),"-M-cache only support run with dir diff or create manifest");
+#endif
             return hdiff(oldPath,newPath,outDiffFileName,
                          compressPlugin,diffSets);
         }
@@ -1286,18 +1432,25 @@ int hdiff_cmd_line(int argc, const char * argv[]){
             _return_check(outFileType==kPathType_notExist,
                           HDIFF_PATHTYPE_ERROR,"create outManifestFile already exists, overwrite");
         }
-        return create_manifest(inputPath,manifestOut.c_str(),checksumPlugin,ignorePathList);
+        return create_manifest(inputPath,manifestOut.c_str(),checksumPlugin,ignorePathList,
+                               manifestCache,isManifestCacheVerify);
 #endif
     }else{// (arg_values.size()==2)  //resave
         _options_check(!isOldPathInputEmpty,"can't resave, must input a diffFile");
         _options_check((diffSets.isDoDiff==_kNULL_VALUE),"-d unsupport run with resave mode");
         _options_check((diffSets.isDoPatchCheck==_kNULL_VALUE),"-t unsupport run with resave mode");
+#if (_IS_NEED_DIR_DIFF_PATCH)
+        _options_check(manifestCache.empty(),"-M-cache unsupport run with resave mode");
+#endif
 #if (_IS_NEED_BSDIFF)
         _options_check((diffSets.isBsDiff==hpatch_FALSE),"-BSD unsupport run with resave mode");
 #endif
 #if (_IS_NEED_VCDIFF)
         _options_check((diffSets.isVcDiff==hpatch_FALSE),"-VCD unsupport run with resave mode");
 #endif
+#if (_IS_NEED_GZDIFF)
+        _options_check((diffSets.isGzDiff==hpatch_FALSE),"-GZ unsupport run with resave mode");
+#endif
 
 #if (_IS_NEED_DIR_DIFF_PATCH)
         _options_check((isForceRunDirDiff==_kNULL_VALUE),"-D unsupport run with resave mode");
@@ -1305,6 +1458,16 @@ int hdiff_cmd_line(int argc, const char * argv[]){
 #endif
         const char* diffFileName   =arg_values[0];
         const char* outDiffFileName=arg_values[1];
+#if (_IS_NEED_DIR_DIFF_PATCH)
+        {
+            hpatch_TPathType   diffFileType;
+            _return_check(hpatch_getPathStat(diffFileName,&diffFileType,0),
+                          HDIFF_PATHTYPE_ERROR,"get diffFile type");
+            if (diffFileType==kPathType_dir)
+                return hdiff_resave_batch(diffFileName,outDiffFileName,compressPlugin,
+                                          diffSets.threadNum,isForceOverwrite);
+        }
+#endif
         hpatch_BOOL isDiffFile=_getIsCompressedDiffFile(diffFileName);
         isDiffFile=isDiffFile || _getIsSingleStreamDiffFile(diffFileName);
 #if (_IS_NEED_DIR_DIFF_PATCH)
@@ -1329,7 +1492,7 @@ int hdiff_cmd_line(int argc, const char * argv[]){
             _return_check(isForceOverwrite,HDIFF_PATHTYPE_ERROR,"diffFile outDiffFile same name");
         
         if (!isSamePath){
-            return hdiff_resave(diffFileName,outDiffFileName,compressPlugin);
+            return hdiff_resave(diffFileName,outDiffFileName,compressPlugin,diffSets.threadNum);
         }else{
             // 1. resave to newDiffTempName
             // 2. if resave ok    then  { delelte oldDiffFile; rename newDiffTempName to oldDiffName; }
@@ -1338,7 +1501,7 @@ int hdiff_cmd_line(int argc, const char * argv[]){
             _return_check(hpatch_getTempPathName(outDiffFileName,newDiffTempName,newDiffTempName+hpatch_kPathMaxSize),
                           HDIFF_TEMPPATH_ERROR,"getTempPathName(diffFile)");
             printf("NOTE: out_diff temp file will be rename to in_diff name after resave!\n");
-            int result=hdiff_resave(diffFileName,newDiffTempName,compressPlugin);
+            int result=hdiff_resave(diffFileName,newDiffTempName,compressPlugin,diffSets.threadNum);
             if (result==0){//resave ok
                 _return_check(hpatch_removeFile(diffFileName),
                               HDIFF_DELETEPATH_ERROR,"removeFile(diffFile)");
@@ -1441,6 +1604,29 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
               HDIFF_OPENWRITE_ERROR,"open out diffFile");
         hpatch_TFileStreamOutput_setRandomOut(&diffData_out,hpatch_TRUE);
         try{
+#if (_IS_NEED_GZDIFF)
+            bool isGzDiffOk=false;
+            if (diffSets.isGzDiff){
+                TGzDiffRestInfo gzRestInfo;
+                isGzDiffOk=create_gzdiff(&newData.base,&oldData.base,&diffData_out.base,compressPlugin,
+                                         diffSets.isSingleCompressedDiff!=0,diffSets.isDiffInMem!=0,
+                                         (int)diffSets.matchScore,diffSets.patchStepMemSize,diffSets.isUseBigCacheMatch!=0,
+                                         diffSets.matchBlockSize,&mtsets,&gzRestInfo);
+                if (isGzDiffOk){
+                    printf("create gzdiff diffData!\n");
+                    if (gzRestInfo.newRestSize>0)
+                        printf("WARNING: newFile has %" PRIu64 " bytes after the first gzip member (multi-member gzip?),"
+                               " only the first member be diffed, the rest saved into diffFile!\n",gzRestInfo.newRestSize);
+                    if (gzRestInfo.oldRestSize>0)
+                        printf("WARNING: oldFile has %" PRIu64 " bytes after the first gzip member (multi-member gzip?),"
+                               " only the first member be inflated as diff reference!\n",gzRestInfo.oldRestSize);
+                }else
+                    printf("newFile can't recompress bit-exactly as gzip, run normal diff!\n");
+            }
+            if (isGzDiffOk){
+                //ok
+            }else
+#endif
 #if (_IS_NEED_BSDIFF)
             if (diffSets.isBsDiff){
                 if (diffSets.isDiffInMem)
@@ -1470,7 +1656,8 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
                 if (diffSets.isDiffInMem)
                     create_single_compressed_diff_block(&newData.base,&oldData.base,&diffData_out.base,compressPlugin,
                                                         (int)diffSets.matchScore,diffSets.patchStepMemSize,diffSets.isUseBigCacheMatch,
-                                                        diffSets.matchBlockSize,diffSets.threadNum,diffSets.threadNumSearch_s);
+                                                        diffSets.matchBlockSize,diffSets.threadNum,diffSets.threadNumSearch_s,
+                                                        diffSets.isCoverCostOrder0?getOrder0CoverCostModel():0);
                 else
                     create_single_compressed_diff_stream(&newData.base,&oldData.base, &diffData_out.base,
                                                          compressPlugin,diffSets.matchBlockSize,
@@ -1479,7 +1666,8 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
                 if (diffSets.isDiffInMem)
                     create_compressed_diff_block(&newData.base,&oldData.base,&diffData_out.base,compressPlugin,
                                                  (int)diffSets.matchScore,diffSets.isUseBigCacheMatch,
-                                                 diffSets.matchBlockSize,diffSets.threadNum,diffSets.threadNumSearch_s);
+                                                 diffSets.matchBlockSize,diffSets.threadNum,diffSets.threadNumSearch_s,
+                                                 diffSets.isCoverCostOrder0?getOrder0CoverCostModel():0);
                 else
                     create_compressed_diff_stream(&newData.base,&oldData.base, &diffData_out.base,
                                                   compressPlugin,diffSets.matchBlockSize,&mtsets);
@@ -1510,6 +1698,9 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
 #endif
 #if (_IS_NEED_VCDIFF)
         hpatch_BOOL isVcDiff=hpatch_FALSE;
+#endif
+#if (_IS_NEED_GZDIFF)
+        hpatch_BOOL isGzDiff=hpatch_FALSE;
 #endif
         hpatch_TDecompress  _decompressPlugin={0};
         hpatch_TDecompress* saved_decompressPlugin=&_decompressPlugin;
@@ -1518,6 +1709,10 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
             hpatch_singleCompressedDiffInfo sdiffInfo;
 #if (_IS_NEED_VCDIFF)
             hpatch_VcDiffInfo vcdiffInfo;
+#endif
+#if (_IS_NEED_GZDIFF)
+            hpatch_TGzDiffInfo gzdiffInfo;
+            hpatch_TGzInnerDiffStream gzInnerDiff;
 #endif
             const char* compressType="";
             if (getCompressedDiffInfo(&diffInfo,&diffData_in.base)){
@@ -1543,6 +1738,19 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
                 isVcDiff=hpatch_TRUE;
                 if (!diffSets.isDoDiff)
                     printf("test VCDIFF's diffData!\n");
+#endif
+#if (_IS_NEED_GZDIFF)
+            }else if (getGzDiffInfo(&gzdiffInfo,&diffData_in.base)){
+                gzdiff_openInnerDiff(&gzInnerDiff,&diffData_in.base,&gzdiffInfo);
+                if (getCompressedDiffInfo(&diffInfo,&gzInnerDiff.base))
+                    compressType=diffInfo.compressType;
+                else if (getSingleCompressedDiffInfo(&sdiffInfo,&gzInnerDiff.base,0))
+                    compressType=sdiffInfo.compressType;
+                else
+                    check(hpatch_FALSE,HDIFF_PATCH_ERROR,"get gzdiff's innerDiff info");
+                isGzDiff=hpatch_TRUE;
+                if (!diffSets.isDoDiff)
+                    printf("test gzdiff's diffData!\n");
 #endif
             }else{
                 check(hpatch_FALSE,HDIFF_PATCH_ERROR,"get diff info");
@@ -1564,6 +1772,11 @@ static int hdiff_by_stream(const char* oldFileName,const char* newFileName,const
         if (isVcDiff)
             diffrt=check_vcdiff(&newData.base,&oldData.base,&diffData_in.base,saved_decompressPlugin);
         else
+#endif
+#if (_IS_NEED_GZDIFF)
+        if (isGzDiff)
+            diffrt=check_gzdiff(&newData.base,&oldData.base,&diffData_in.base,saved_decompressPlugin);
+        else
 #endif
         if (isSingleCompressedDiff)
             diffrt=check_single_compressed_diff(&newData.base,&oldData.base,&diffData_in.base,saved_decompressPlugin);
@@ -1619,11 +1832,12 @@ int hdiff(const char* oldFileName,const char* newFileName,const char* outDiffFil
 }
 
 int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
-                 const hdiff_TCompress* compressPlugin){
+                 const hdiff_TCompress* compressPlugin,size_t threadNum,bool isPrintInfo,
+                 hpatch_TDecompress* workDecompressPlugin){
     double time0=clock_s();
     std::string fnameInfo=std::string("in_diff : \"")+diffFileName+"\"\n"
         +"out_diff: \""+outDiffFileName+"\"\n";
-    hpatch_printPath_utf8(fnameInfo.c_str());
+    if (isPrintInfo) hpatch_printPath_utf8(fnameInfo.c_str());
     
     int result=HDIFF_SUCCESS;
     hpatch_BOOL  _isInClear=hpatch_FALSE;
@@ -1642,7 +1856,7 @@ int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
     hpatch_TFileStreamOutput_init(&diffData_out);
     
     hpatch_TDecompress _decompressPlugin={0};
-    hpatch_TDecompress* decompressPlugin=&_decompressPlugin;
+    hpatch_TDecompress* decompressPlugin=workDecompressPlugin?workDecompressPlugin:&_decompressPlugin;
     check(hpatch_TFileStreamInput_open(&diffData_in,diffFileName),HDIFF_OPENREAD_ERROR,"open diffFile");
 #if (_IS_NEED_DIR_DIFF_PATCH)
     check(getDirDiffInfo(&dirDiffInfo,&diffData_in.base),HDIFF_OPENREAD_ERROR,"read diffFile");
@@ -1650,13 +1864,13 @@ int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
     if (isDirDiff){
         diffInfo=dirDiffInfo.hdiffInfo;
         diffInfo.compressedCount+=dirDiffInfo.dirDataIsCompressed?1:0;
-        printf("  resave as dir diffFile \n");
+        if (isPrintInfo) printf("  resave as dir diffFile \n");
     }else
 #endif
     if (getSingleCompressedDiffInfo(&singleDiffInfo,&diffData_in.base,0)){
         isSingleDiff=hpatch_TRUE;
         _singleDiffInfoToHDiffInfo(&diffInfo,&singleDiffInfo);
-        printf("  resave as single stream diffFile \n");
+        if (isPrintInfo) printf("  resave as single stream diffFile \n");
     }else if(getCompressedDiffInfo(&diffInfo,&diffData_in.base)){
         //ok
     }else{
@@ -1671,19 +1885,19 @@ int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
                       "can no decompress \""+diffInfo.compressType+" data");
             }else{
                 if (strlen(diffInfo.compressType)>0)
-                    printf("  diffFile added useless compress tag \"%s\"\n",diffInfo.compressType);
+                    if (isPrintInfo) printf("  diffFile added useless compress tag \"%s\"\n",diffInfo.compressType);
                 decompressPlugin=0;
             }
         }else{
             decompressPlugin->decError=hpatch_dec_ok;
-            printf("resave diffFile with decompress plugin: \"%s\" (need decompress %d)\n",diffInfo.compressType,diffInfo.compressedCount);
+            if (isPrintInfo) printf("resave diffFile with decompress plugin: \"%s\" (need decompress %d)\n",diffInfo.compressType,diffInfo.compressedCount);
         }
     }
     {
         const char* compressTypeTxt="";
         if (compressPlugin) compressTypeTxt=compressPlugin->compressTypeForDisplay?
                                 compressPlugin->compressTypeForDisplay():compressPlugin->compressType();
-        printf("resave diffFile with compress plugin: \"%s\"\n",compressTypeTxt);
+        if (isPrintInfo) printf("resave diffFile with compress plugin: \"%s\"\n",compressTypeTxt);
     }
 #if (_IS_NEED_DIR_DIFF_PATCH)
     if (isDirDiff){ //checksumPlugin
@@ -1693,7 +1907,7 @@ int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
             check(checksumPlugin->checksumByteSize()==dirDiffInfo.checksumByteSize,HDIFF_RESAVE_CHECKSUMTYPE_ERROR,
                   "found checksum plugin not same as dirDiffFile used: \""+dirDiffInfo.checksumType+"\"\n");
         }
-        printf("resave dirDiffFile with checksum plugin: \"%s\"\n",dirDiffInfo.checksumType);
+        if (isPrintInfo) printf("resave dirDiffFile with checksum plugin: \"%s\"\n",dirDiffInfo.checksumType);
     }else{
         _options_check(checksumPlugin==0,"-C now only support dir diff");
     }
@@ -1702,31 +1916,31 @@ int hdiff_resave(const char* diffFileName,const char* outDiffFileName,
     check(hpatch_TFileStreamOutput_open(&diffData_out,outDiffFileName,hpatch_kNullStreamPos),HDIFF_OPENWRITE_ERROR,
           "open out diffFile");
     hpatch_TFileStreamOutput_setRandomOut(&diffData_out,hpatch_TRUE);
-    printf("inDiffSize : %" PRIu64 "\n",diffData_in.base.streamSize);
+    if (isPrintInfo) printf("inDiffSize : %" PRIu64 "\n",diffData_in.base.streamSize);
     try{
 #if (_IS_NEED_DIR_DIFF_PATCH)
         if (isDirDiff){
             resave_dirdiff(&diffData_in.base,decompressPlugin,
-                           &diffData_out.base,compressPlugin,checksumPlugin);
+                           &diffData_out.base,compressPlugin,checksumPlugin,threadNum);
         }else
 #endif
         if (isSingleDiff)
             resave_single_compressed_diff(&diffData_in.base,decompressPlugin,
-                                          &diffData_out.base,compressPlugin,&singleDiffInfo);
+                                          &diffData_out.base,compressPlugin,&singleDiffInfo,0,0,threadNum);
         else
             resave_compressed_diff(&diffData_in.base,decompressPlugin,
-                                   &diffData_out.base,compressPlugin);
+                                   &diffData_out.base,compressPlugin,0,threadNum);
         diffData_out.base.streamSize=diffData_out.out_length;
     }catch(const std::exception& e){
         check(!diffData_in.fileError,HDIFF_RESAVE_FILEREAD_ERROR,"read diffFile");
         check(!diffData_out.fileError,HDIFF_RESAVE_OPENWRITE_ERROR,"write diffFile");
         check(false,HDIFF_RESAVE_ERROR,"resave diff run an error: "+e.what());
     }
-    printf("outDiffSize: %" PRIu64 "\n",diffData_out.base.streamSize);
+    if (isPrintInfo) printf("outDiffSize: %" PRIu64 "\n",diffData_out.base.streamSize);
     check(hpatch_TFileStreamOutput_close(&diffData_out),HDIFF_FILECLOSE_ERROR,"out diffFile close");
-    printf("  out diff file ok!\n");
+    if (isPrintInfo) printf("  out diff file ok!\n");
     
-    printf("\nhdiffz resave diffFile time: %.3f s\n",(clock_s()-time0));
+    if (isPrintInfo) printf("\nhdiffz resave diffFile time: %.3f s\n",(clock_s()-time0));
 clear:
     _isInClear=hpatch_TRUE;
     check(hpatch_TFileStreamOutput_close(&diffData_out),HDIFF_FILECLOSE_ERROR,"out diffFile close");
@@ -1747,6 +1961,132 @@ struct DirPathIgnoreListener:public CDirPathIgnore,IDirPathIgnore{
     }
 };
 
+struct TBatchResave{
+    const std::vector<std::string>* diffFiles;
+    const std::vector<std::string>* outDiffFiles;
+    const hdiff_TCompress*          compressPlugin;
+    size_t                          curIndex;
+    size_t                          errorCount;
+#if (_IS_USED_MULTITHREAD)
+    CHLocker                        locker;
+    TMtByChannel                    mt; //for wait all threads end
+#endif
+};
+
+static void _batchResave_thread(int threadIndex,void* workData){
+    TBatchResave& br=*(TBatchResave*)workData;
+#if (_IS_USED_MULTITHREAD)
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(br.mt);
+#endif
+    hpatch_TDecompress workDecompressPlugin; //every worker has its own copy, for decError
+    while (true) {
+        size_t i;
+        {
+#if (_IS_USED_MULTITHREAD)
+            CAutoLocker _autoLocker(br.locker.locker);
+#endif
+            if (br.curIndex>=br.diffFiles->size()) break;
+            i=br.curIndex++;
+        }
+        double time0=clock_s();
+        int result=hdiff_resave((*br.diffFiles)[i].c_str(),(*br.outDiffFiles)[i].c_str(),
+                                br.compressPlugin,1,false,&workDecompressPlugin);
+        {
+#if (_IS_USED_MULTITHREAD)
+            CAutoLocker _autoLocker(br.locker.locker);
+#endif
+            if (result!=HDIFF_SUCCESS) ++br.errorCount;
+            printf("  %s (%.3f s) \"",(result==HDIFF_SUCCESS)?"resave ok":"resave ERROR",clock_s()-time0);
+            hpatch_printPath_utf8((*br.diffFiles)[i].c_str()); printf("\"\n");
+        }
+    }
+}
+
+int hdiff_resave_batch(const char* diffDirName,const char* outDiffDirName,
+                       hdiff_TCompress* compressPlugin,size_t threadNum,hpatch_BOOL isForceOverwrite){
+    double time0=clock_s();
+    std::string diffDir(diffDirName);
+    std::string outDir(outDiffDirName);
+    assignDirTag(diffDir);
+    assignDirTag(outDir);
+    std::vector<std::string> pathList;
+    std::vector<std::string> diffFiles;
+    std::vector<std::string> outDiffFiles;
+    try {
+        const std::vector<std::string> emptyList;
+        DirPathIgnoreListener noIgnore(emptyList,emptyList,false);
+        getDirAllPathList(diffDir,pathList,&noIgnore);
+    } catch (const std::exception& e) {
+        LOG_ERR("batch resave read diffFilesDir error: %s\n",e.what());
+        return HDIFF_OPENREAD_ERROR;
+    }
+    _return_check(hpatch_makeNewDir(outDir.c_str()),HDIFF_OPENWRITE_ERROR,"make outDiffFilesDir");
+    for (size_t i=0;i<pathList.size();++i){
+        const std::string& path=pathList[i];
+        const std::string outPath=outDir+path.substr(diffDir.size());
+        if (hpatch_getIsDirName(path.c_str())){
+            _return_check(hpatch_makeNewDir(outPath.c_str()),HDIFF_OPENWRITE_ERROR,"make outDiffFilesDir sub dir");
+            continue;
+        }
+        hpatch_BOOL isDiffFile=_getIsCompressedDiffFile(path.c_str());
+        isDiffFile=isDiffFile || _getIsSingleStreamDiffFile(path.c_str());
+        isDiffFile=isDiffFile || getIsDirDiffFile(path.c_str());
+        if (!isDiffFile){
+            printf("  skip not hdiff file: \""); hpatch_printPath_utf8(path.c_str()); printf("\"\n");
+            continue;
+        }
+        if (!isForceOverwrite){
+            hpatch_TPathType   outDiffFileType;
+            _return_check(hpatch_getPathStat(outPath.c_str(),&outDiffFileType,0),
+                          HDIFF_PATHTYPE_ERROR,"get outDiffFile type");
+            _return_check(outDiffFileType==kPathType_notExist,
+                          HDIFF_PATHTYPE_ERROR,"resave outDiffFile already exists, overwrite");
+        }
+        _return_check(!hpatch_getIsSamePath(path.c_str(),outPath.c_str()),
+                      HDIFF_PATHTYPE_ERROR,"batch resave diffFile outDiffFile same name");
+        diffFiles.push_back(path);
+        outDiffFiles.push_back(outPath);
+    }
+    
+    const size_t pluginThreadNum=threadNum; //compressPlugin's parallel thread number set by caller
+    if (threadNum>diffFiles.size()) threadNum=diffFiles.size();
+    if (threadNum<1) threadNum=1;
+    {
+        const char* compressTypeTxt="";
+        if (compressPlugin) compressTypeTxt=compressPlugin->compressTypeForDisplay?
+                                compressPlugin->compressTypeForDisplay():compressPlugin->compressType();
+        printf("batch resave %" PRIu64 " diffFiles with compress plugin: \"%s\" (threadNum %d)\n",
+               (hpatch_StreamPos_t)diffFiles.size(),compressTypeTxt,(int)threadNum);
+    }
+    TBatchResave br;
+    br.diffFiles=&diffFiles;
+    br.outDiffFiles=&outDiffFiles;
+    br.compressPlugin=compressPlugin;
+    br.curIndex=0;
+    br.errorCount=0;
+#if (_IS_USED_MULTITHREAD)
+    if (threadNum>1){
+        //parallel between diffFiles, so every diffFile's compress run by single thread
+        if (compressPlugin&&compressPlugin->setParallelThreadNumber)
+            compressPlugin->setParallelThreadNumber(compressPlugin,1);
+        bool isStartOk=br.mt.start_threads((int)threadNum,_batchResave_thread,&br,true);
+        br.mt.wait_all_thread_end();
+        if (compressPlugin&&compressPlugin->setParallelThreadNumber) //restore
+            compressPlugin->setParallelThreadNumber(compressPlugin,(int)pluginThreadNum);
+        if (!isStartOk){
+            LOG_ERR("batch resave start threads error!\n");
+            return HDIFF_RESAVE_ERROR;
+        }
+    }else
+#endif
+    {
+        _batchResave_thread(0,&br);
+    }
+    printf("\nhdiffz batch resave %" PRIu64 " diffFiles (error %" PRIu64 ") time: %.3f s\n",
+           (hpatch_StreamPos_t)diffFiles.size(),(hpatch_StreamPos_t)br.errorCount,(clock_s()-time0));
+    return (br.errorCount==0)?HDIFF_SUCCESS:HDIFF_RESAVE_ERROR;
+}
+
 struct DirDiffListener:public IDirDiffListener{
     virtual bool isExecuteFile(const std::string& fileName) {
         bool result= 0!=hpatch_getIsExecuteFile(fileName.c_str());
@@ -1756,6 +2096,22 @@ struct DirDiffListener:public IDirDiffListener{
         }
         return result;
     }
+    double _hashFilesBegin_time0;
+    double _compareFilesBegin_time0;
+    virtual void hashFilesBegin(size_t pathCount,size_t threadNum){
+        printf("  hash %" PRIu64 " paths (threadNum %d) ...\n",(hpatch_StreamPos_t)pathCount,(int)threadNum);
+        _hashFilesBegin_time0=clock_s();
+    }
+    virtual void hashFilesCacheInfo(size_t reusedFileCount){
+        printf("  reused cached hash: %" PRIu64 " files\n",(hpatch_StreamPos_t)reusedFileCount);
+    }
+    virtual void hashFilesEnd(){
+        _compareFilesBegin_time0=clock_s();
+        printf("  hash    time: %.3f s\n",_compareFilesBegin_time0-_hashFilesBegin_time0);
+    }
+    virtual void compareFilesEnd(size_t sameFilePairCount){
+        printf("  compare time: %.3f s\n",clock_s()-_compareFilesBegin_time0);
+    }
     virtual void diffRefInfo(size_t oldPathCount,size_t newPathCount,size_t sameFilePairCount,
                              hpatch_StreamPos_t sameFileSize,size_t refOldFileCount,size_t refNewFileCount,
                              hpatch_StreamPos_t refOldFileSize,hpatch_StreamPos_t refNewFileSize){
@@ -1779,12 +2135,13 @@ struct DirDiffListener:public IDirDiffListener{
     }
 };
 
-static void check_manifest(TManifest& out_manifest,const std::string& rootPath,const std::string& manifestFileName){
+static void check_manifest(TManifest& out_manifest,const std::string& rootPath,const std::string& manifestFileName,
+                           CManifestCache* manifestCache){
     TManifestSaved  manifest;
     load_manifestFile(manifest,rootPath,manifestFileName);
     hpatch_TChecksum* checksumPlugin=0;
     findChecksum(&checksumPlugin,manifest.checksumType.c_str());
-    checksum_manifest(manifest,checksumPlugin);
+    checksum_manifest(manifest,checksumPlugin,manifestCache);
     out_manifest.rootPath.swap(manifest.rootPath);
     out_manifest.pathList.swap(manifest.pathList);
 }
@@ -1795,7 +2152,8 @@ int hdiff_dir(const char* _oldPath,const char* _newPath,const char* outDiffFileN
               const TDiffSets& diffSets,size_t kMaxOpenFileNumber,
               const std::vector<std::string>& ignorePathListBase,const std::vector<std::string>& ignoreOldPathList,
               const std::vector<std::string>& ignoreNewPathList,
-              const std::string& oldManifestFileName,const std::string& newManifestFileName){
+              const std::string& oldManifestFileName,const std::string& newManifestFileName,
+              const std::string& manifestCacheFileName,hpatch_BOOL isManifestCacheVerify){
     double time0=clock_s();
     std::string oldPath(_oldPath);
     std::string newPath(_newPath);
@@ -1826,6 +2184,8 @@ int hdiff_dir(const char* _oldPath,const char* _newPath,const char* outDiffFileN
     hpatch_TFileStreamInput diffData_in;
     hpatch_TFileStreamOutput_init(&diffData_out);
     hpatch_TFileStreamInput_init(&diffData_in);
+    CManifestCache  _manifestCache(manifestCacheFileName,isManifestCacheVerify!=0);
+    CManifestCache* manifestCache=manifestCacheFileName.empty()?0:&_manifestCache;
     
     TManifest   oldManifest;
     TManifest   newManifest;
@@ -1834,8 +2194,9 @@ int hdiff_dir(const char* _oldPath,const char* _newPath,const char* outDiffFileN
         double check_time0=clock_s();
         try {
             if (!oldPath.empty())// isOldPathInputEmpty
-                check_manifest(oldManifest,oldPath,oldManifestFileName);
-            check_manifest(newManifest,newPath,newManifestFileName);
+                check_manifest(oldManifest,oldPath,oldManifestFileName,manifestCache);
+            check_manifest(newManifest,newPath,newManifestFileName,manifestCache);
+            if (manifestCache) manifestCache->save();
         }catch(const std::exception& e){
             check(false,MANIFEST_TEST_ERROR,"check by manifest found an error: "+e.what());
         }
@@ -1844,8 +2205,10 @@ int hdiff_dir(const char* _oldPath,const char* _newPath,const char* outDiffFileN
     }else{
         DirPathIgnoreListener oldDirPathIgnore(ignorePathListBase,ignoreOldPathList);
         DirPathIgnoreListener newDirPathIgnore(ignorePathListBase,ignoreNewPathList);
-        get_manifest(&oldDirPathIgnore,oldPath,oldManifest);
-        get_manifest(&newDirPathIgnore,newPath,newManifest);
+        double walk_time0=clock_s();
+        get_manifest(&oldDirPathIgnore,oldPath,oldManifest,diffSets.threadNum);
+        get_manifest(&newDirPathIgnore,newPath,newManifest,diffSets.threadNum);
+        printf("get dir file list time: %.3f s\n",(clock_s()-walk_time0));
     }
 
     if (diffSets.isDoDiff){
@@ -1856,8 +2219,9 @@ int hdiff_dir(const char* _oldPath,const char* _newPath,const char* outDiffFileN
             hpatch_TFileStreamOutput_setRandomOut(&diffData_out,hpatch_TRUE);
             DirDiffListener listener;
             dir_diff(&listener,oldManifest,newManifest,&diffData_out.base,
-                     compressPlugin,checksumPlugin,diffSets,kMaxOpenFileNumber);
+                     compressPlugin,checksumPlugin,diffSets,kMaxOpenFileNumber,manifestCache);
             diffData_out.base.streamSize=diffData_out.out_length;
+            if (manifestCache) manifestCache->save();
         }catch(const std::exception& e){
             check(false,DIRDIFF_DIFF_ERROR,"dir diff run an error: "+e.what());
         }
@@ -1908,10 +2272,13 @@ clear:
 }
 
 int create_manifest(const char* _inputPath,const char* outManifestFileName,
-                    hpatch_TChecksum* checksumPlugin,const std::vector<std::string>& ignorePathList){
+                    hpatch_TChecksum* checksumPlugin,const std::vector<std::string>& ignorePathList,
+                    const std::string& manifestCacheFileName,hpatch_BOOL isManifestCacheVerify){
     double time0=clock_s();
     int  result=HDIFF_SUCCESS;
     bool _isInClear=false;
+    CManifestCache  _manifestCache(manifestCacheFileName,isManifestCacheVerify!=0);
+    CManifestCache* manifestCache=manifestCacheFileName.empty()?0:&_manifestCache;
     std::string inputPath(_inputPath);
     {
         hpatch_TPathType inputType;
@@ -1940,7 +2307,7 @@ int create_manifest(const char* _inputPath,const char* outManifestFileName,
                   HDIFF_OPENWRITE_ERROR,"open out manifestFile");
             //hpatch_TFileStreamOutput_setRandomOut(&manifestData_out,hpatch_TRUE);
             DirPathIgnoreListener dirPathIgnore(ignorePathList,emptyPathList);
-            save_manifest(&dirPathIgnore,inputPath,&manifestData_out.base,checksumPlugin);
+            save_manifest(&dirPathIgnore,inputPath,&manifestData_out.base,checksumPlugin,manifestCache);
             manifestData_out.base.streamSize=manifestData_out.out_length;
         }catch(const std::exception& e){
             check(false,MANIFEST_CREATE_ERROR,"create manifest run an error: "+e.what());
@@ -1953,11 +2320,20 @@ int create_manifest(const char* _inputPath,const char* outManifestFileName,
     {//test
         double time1=clock_s();
         TManifest    manifest;
-        try {
-            check_manifest(manifest,inputPath,outManifestFileName);
+        try { //not use manifestCache, it just filled by save_manifest; re-read files for test
+            check_manifest(manifest,inputPath,outManifestFileName,0);
         }catch(const std::exception& e){
             check(false,MANIFEST_TEST_ERROR,"test manifestFile found an error: "+e.what());
         }
+        if (manifestCache){
+            size_t updatedCount=manifestCache->updatedCount();
+            try {
+                manifestCache->save();
+            }catch(const std::exception& e){
+                check(false,MANIFEST_CREATE_ERROR,"save manifest cache error: "+e.what());
+            }
+            printf("  manifest cache updated %" PRIu64 " files\n",(hpatch_StreamPos_t)updatedCount);
+        }
         printf("  test manifestFile ok!\n");
         printf("test   manifest time: %.3f s\n",(clock_s()-time1));
     }
@@ -41,6 +41,7 @@ typedef struct IHPatchDirListener {
     hpatch_BOOL (*patchBegin) (struct IHPatchDirListener* listener,TDirPatcher* dirPatcher);
     hpatch_BOOL (*patchFinish)(struct IHPatchDirListener* listener,hpatch_BOOL isPatchSuccess);
     hpatch_FileError_t fileError; 
+    hpatch_TFileCopyCounts copyCounts; //same files copyed size
 } IHPatchDirListener;
 
 
@@ -52,7 +53,8 @@ static hpatch_BOOL _makeNewDir(IDirPatchListener* listener,const char* newDir){
 }
 static hpatch_BOOL _copySameFile(IDirPatchListener* listener,const char* oldFileName,
                                  const char* newFileName,hpatch_ICopyDataListener* copyListener){
-    return TDirPatcher_copyFile(oldFileName,newFileName,copyListener,&((IHPatchDirListener*)listener)->fileError);
+    IHPatchDirListener* self=(IHPatchDirListener*)listener;
+    return TDirPatcher_copyFile(oldFileName,newFileName,copyListener,&self->fileError,&self->copyCounts);
 }
 static hpatch_BOOL _openNewFile(IDirPatchListener* listener,hpatch_TFileStreamOutput*  out_curNewFile,
                                 const char* newFileName,hpatch_StreamPos_t newFileSize){
@@ -97,7 +99,7 @@ static hpatch_BOOL _dirPatchFinish(IHPatchDirListener* listener,hpatch_BOOL isPa
 }
 
 static IHPatchDirListener defaultPatchDirlistener={{0,_makeNewDir,_copySameFile,_openNewFile,_closeNewFile},
-                                                    0,_dirPatchBegin,_dirPatchFinish,0};
+                                                    0,_dirPatchBegin,_dirPatchFinish,0,{0,0,0}};
 
     
     static hpatch_BOOL _tryRemovePath(const char* pathName){
@@ -109,64 +111,64 @@ static IHPatchDirListener defaultPatchDirlistener={{0,_makeNewDir,_copySameFile,
             return hpatch_removeFile(pathName);
     }
     
-    typedef const char* (*IDirPathMove_getDstPathBySrcPath)(void* importMove,const char* newPath,
-                                                            char* out_pathBuf,char* out_pathBufEnd);
-    typedef struct{
-        void*           importMove;
-        IDirPathMove_getDstPathBySrcPath getDstPathBySrcPath;
-        IDirPathList    srcPathList;
-        IDirPathList    dstPathList;
-        hpatch_FileError_t fileError; 
-    } IDirPathMove;
+    static hpatch_BOOL _moveFileOverwrite(const char* srcPath,const char* dstPath){
+        if (hpatch_moveFile(srcPath,dstPath)) return hpatch_TRUE; //rename() replace dst atomically on posix
+        if (!_tryRemovePath(dstPath)) return hpatch_FALSE;
+        return hpatch_moveFile(srcPath,dstPath);
+    }
     
-    static hpatch_BOOL _moveNewToOld(IDirPathMove* dirPathMove) {
+    //only update changed paths in oldDir:
+    //  delete old files and dirs not in new dir;
+    //  make new dirs, move new files from newTempDir to oldDir (replace old file), skip same files in place;
+    //  remove dirs in newTempDir.
+    static hpatch_BOOL _updateOldByNew(TDirPatcher* dirPatcher,hpatch_FileError_t* out_fileError) {
         char _tmpPath[hpatch_kPathMaxSize];
         char _tmpDstPath[hpatch_kPathMaxSize];
         hpatch_BOOL result=hpatch_TRUE;
-        IDirPathList*  dstPathList=&dirPathMove->dstPathList;
-        IDirPathList*  srcPathList=&dirPathMove->srcPathList;
+        const size_t oldPathCount=dirPatcher->dirDiffHead.oldPathCount;
+        const size_t newPathCount=dirPatcher->dirDiffHead.newPathCount;
         size_t i;
-        //delete file in dstPathList; //WARNING
-        //delete dir in dstPathList; //not check
-        for (i=dstPathList->pathCount; i>0; --i) {
-            size_t dstPathIndex=i-1;
-            const char* dstPath=dstPathList->getPathNameByIndex(dstPathList->import,dstPathIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
-            if (dstPath==0) continue;
-            if (!hpatch_getIsDirName(dstPath)){
-                if (!_tryRemovePath(dstPath)){
+        for (i=oldPathCount; i>0; --i) {
+            size_t oldPathIndex=i-1;
+            const char* oldPath;
+            if (TDirPatcher_oldPathUpdateType(dirPatcher,oldPathIndex)!=kOldPath_remove) continue;
+            oldPath=TDirPatcher_getOldPathByIndex(dirPatcher,oldPathIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
+            if (oldPath==0) continue;
+            if (!hpatch_getIsDirName(oldPath)){
+                if (!_tryRemovePath(oldPath)){
                     printf("WARNING: can't remove old file \"");
-                    hpatch_printPath_utf8(dstPath); printf("\"\n");
+                    hpatch_printPath_utf8(oldPath); printf("\"\n");
                 }
             }else{
-                hpatch_removeDir(dstPath);
+                hpatch_removeDir(oldPath); //not check
             }
         }
-        //move all files and dirs in srcDir to dstDir;
-        for (i=0; i<srcPathList->pathCount; ++i) {//make dirs to dstDir
-            size_t srcPathIndex=i;
-            const char* srcPath=srcPathList->getPathNameByIndex(srcPathList->import,srcPathIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
-            if (srcPath==0) { result=hpatch_FALSE; continue; }
-            if (hpatch_getIsDirName(srcPath)){
-                const char* dstDir=dirPathMove->getDstPathBySrcPath(dirPathMove->importMove,srcPath,_tmpDstPath,_tmpDstPath+sizeof(_tmpDstPath));
-                if (dstDir==0) { result=hpatch_FALSE; continue; }
-                if (!hpatch_makeNewDir(dstDir)) { _update_ferr(dirPathMove->fileError); result=hpatch_FALSE; continue; }
-            }
+        for (i=0; i<newPathCount; ++i) {//make dirs to oldDir
+            const char* newPath=TDirPatcher_getNewPathByIndex(dirPatcher,i,_tmpPath,_tmpPath+sizeof(_tmpPath));
+            const char* oldPath;
+            if (newPath==0) { result=hpatch_FALSE; continue; }
+            if (!hpatch_getIsDirName(newPath)) continue;
+            oldPath=TDirPatcher_getOldPathByNewPath(dirPatcher,newPath,_tmpDstPath,_tmpDstPath+sizeof(_tmpDstPath));
+            if (oldPath==0) { result=hpatch_FALSE; continue; }
+            if (!hpatch_makeNewDir(oldPath)) { _update_ferr(*out_fileError); result=hpatch_FALSE; continue; }
         }
-        for (i=srcPathList->pathCount; i>0; --i) {//move files to dstDir and remove dirs in srcDir
-            size_t srcPathIndex=i-1;
-            const char* srcPath=srcPathList->getPathNameByIndex(srcPathList->import,srcPathIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
-            if (srcPath==0) { result=hpatch_FALSE; continue; }
-            if (hpatch_getIsDirName(srcPath)){
-                hpatch_removeDir(srcPath);
+        for (i=newPathCount; i>0; --i) {//move files to oldDir and remove dirs in newTempDir
+            size_t newPathIndex=i-1;
+            const char* newPath;
+            const char* oldPath;
+            if (TDirPatcher_isNewPathInPlace(dirPatcher,newPathIndex)) continue;
+            newPath=TDirPatcher_getNewPathByIndex(dirPatcher,newPathIndex,_tmpPath,_tmpPath+sizeof(_tmpPath));
+            if (newPath==0) { result=hpatch_FALSE; continue; }
+            if (hpatch_getIsDirName(newPath)){
+                hpatch_removeDir(newPath);
             }else{
-                const char* dstPath=dirPathMove->getDstPathBySrcPath(dirPathMove->importMove,srcPath,_tmpDstPath,_tmpDstPath+sizeof(_tmpDstPath));
-                if (dstPath==0) { result=hpatch_FALSE; continue; }
-                hpatch_removeFile(dstPath);//overwrite
-                if (!hpatch_moveFile(srcPath,dstPath)){//move src to dst
-                     _update_ferr(dirPathMove->fileError);
+                oldPath=TDirPatcher_getOldPathByNewPath(dirPatcher,newPath,_tmpDstPath,_tmpDstPath+sizeof(_tmpDstPath));
+                if (oldPath==0) { result=hpatch_FALSE; continue; }
+                if (!_moveFileOverwrite(newPath,oldPath)){
+                    _update_ferr(*out_fileError);
                     result=hpatch_FALSE;
                     LOG_ERR("can't move new file to oldDirectory \"");
-                    hpatch_printStdErrPath_utf8(srcPath); LOG_ERR("\"  ERROR!\n");
+                    hpatch_printStdErrPath_utf8(newPath); LOG_ERR("\"  ERROR!\n");
                     continue;
                 }
             }
@@ -215,21 +217,26 @@ static hpatch_BOOL _tempDirPatchFinish(IHPatchDirListener* self,hpatch_BOOL isPa
     TDirPatcher* dirPatcher=(TDirPatcher*)self->listenerImport;
     size_t       i;
     hpatch_BOOL  isInitSameRefError=isPatchSuccess?(!TDirPatcher_initOldSameRefCount(dirPatcher)):hpatch_FALSE;
+    if ((!isInitSameRefError)&&isPatchSuccess&&(!TDirPatcher_initInPlaceUpdate(dirPatcher)))
+        isInitSameRefError=hpatch_TRUE;
     if (isInitSameRefError){
         isPatchSuccess=hpatch_FALSE;
         result=hpatch_FALSE;
     }
     if (isPatchSuccess){
         //move(+ some must copy) same to newTempDir from oldDir;
+        //  same file at same path is kept in oldDir (its ref count never dec, so other refs copy it);
         for (i=dirPatcher->dirDiffHead.sameFilePairCount; i>0; --i) {
             size_t sameIndex=i-1;
             const char* oldPath;
-            const char* newPath=TDirPatcher_getNewPathBySameIndex(dirPatcher,sameIndex,_tmpPath0,_tmpPath0+sizeof(_tmpPath0));
+            const char* newPath;
+            if (TDirPatcher_isInPlaceSameFile(dirPatcher,sameIndex)) continue;
+            newPath=TDirPatcher_getNewPathBySameIndex(dirPatcher,sameIndex,_tmpPath0,_tmpPath0+sizeof(_tmpPath0));
             if (newPath==0) { result=hpatch_FALSE; continue; }
             oldPath=TDirPatcher_getOldPathBySameIndex(dirPatcher,sameIndex,_tmpPath1,_tmpPath1+sizeof(_tmpPath1));
             if (oldPath==0) { result=hpatch_FALSE; continue; }
             if (TDirPatcher_oldSameRefCount(dirPatcher,sameIndex)>1){//copy old to new
-                if (!TDirPatcher_copyFile(oldPath,newPath,0,&self->fileError)){
+                if (!TDirPatcher_copyFile(oldPath,newPath,0,&self->fileError,&self->copyCounts)){
                     result=hpatch_FALSE;
                     LOG_ERR("can't copy new file to newTempDir from same old file \"");
                     hpatch_printStdErrPath_utf8(newPath); LOG_ERR("\"  ERROR!\n");
@@ -245,17 +252,9 @@ static hpatch_BOOL _tempDirPatchFinish(IHPatchDirListener* self,hpatch_BOOL isPa
         }
         TDirPatcher_finishOldSameRefCount(dirPatcher);
         
-        {//move new to old:
-            IDirPathMove dirPathMove={0};
-            dirPathMove.importMove=dirPatcher;
-            dirPathMove.getDstPathBySrcPath=(IDirPathMove_getDstPathBySrcPath)TDirPatcher_getOldPathByNewPath;
-            TDirPatcher_getNewDirPathList(dirPatcher,&dirPathMove.srcPathList);
-            TDirPatcher_getOldDirPathList(dirPatcher,&dirPathMove.dstPathList);
-            if (!_moveNewToOld(&dirPathMove)){
-                mix_ferr(self->fileError,dirPathMove.fileError);
-                result=hpatch_FALSE;
-            }
-        }
+        if (!_updateOldByNew(dirPatcher,&self->fileError))//update changed paths in old
+            result=hpatch_FALSE;
+        TDirPatcher_finishInPlaceUpdate(dirPatcher);
     
         {//set execute tags in oldDir
             IDirPathList oldExecuteList;
@@ -288,11 +287,12 @@ static hpatch_BOOL _tempDirPatchFinish(IHPatchDirListener* self,hpatch_BOOL isPa
 //    make new dir to newTempDir
 //    checksum same file
 // 2. if patch ok then  {
-//        move(+ some must copy) same to newTempDir from oldDir;
-//        move new to old             {
-//            delete file in oldPathList; //WARNING
-//            delete dir in oldPathList; //not check
-//            move all files and dir in newTempDir to oldDir; }
+//        skip same file at same path (not copy or move);
+//        move(+ some must copy) other same to newTempDir from oldDir;
+//        update changed paths in old  {
+//            delete file in oldPathList but not in newPathList; //WARNING
+//            delete dir in oldPathList but not in newPathList; //not check
+//            make dirs, move(rename replace) files in newTempDir to oldDir; }
 //        set execute tags in oldDir;
 //        delete newTempDir; }
 //    if patch error then  {
@@ -300,7 +300,7 @@ static hpatch_BOOL _tempDirPatchFinish(IHPatchDirListener* self,hpatch_BOOL isPa
 //        delete newTempDir; }
 static IHPatchDirListener tempDirPatchListener={{&tempDirPatchListener,_makeNewDir,_tempDir_copySameFile,
                                                    _openNewFile,_closeNewFile},
-                                                 0,_tempDirPatchBegin,_tempDirPatchFinish,0};
+                                                 0,_tempDirPatchBegin,_tempDirPatchFinish,0,{0,0,0}};
     
 #endif //_IS_NEED_tempDirPatchListener
 #ifdef __cplusplus
@@ -71,6 +71,9 @@
 #ifndef _IS_NEED_VCDIFF
 #   define _IS_NEED_VCDIFF 1
 #endif
+#ifndef _IS_NEED_GZDIFF
+#   define _IS_NEED_GZDIFF 0 //need zlib's deflate code
+#endif
 #ifndef _IS_NEED_SFX
 #   define _IS_NEED_SFX 1
 #endif
@@ -125,6 +128,9 @@
 #if (_IS_NEED_VCDIFF)
 #   include "vcdiff_wrapper/vcpatch_wrapper.h"
 #endif
+#if (_IS_NEED_GZDIFF)
+#   include "gzdiff_wrapper/gzpatch_wrapper.h"
+#endif
 
 #include "decompress_plugin_demo.h"
 
@@ -210,6 +216,11 @@ static void printUsage(){
 #if (_IS_NEED_VCDIFF)
            "      if diffFile is created by xdelta3,open-vcdiff, then requires\n"
            "        (sourceWindowSize+targetWindowSize + 3*decompress buffer size)+O(1) bytes of memory.\n"
+#endif
+#if (_IS_NEED_GZDIFF)
+           "      if diffFile is created by hdiffz -GZ with gzip oldFile, then always run as -m with\n"
+           "        inflated oldFile; only when memory not enough, inflate oldFile when read by cacheSize,\n"
+           "        it's very slow (10x+ time);\n"
 #endif
            "  -m  oldPath all loaded into Memory;\n"
            "      requires (oldFileSize + 4*decompress buffer size)+O(1) bytes of memory.\n"
@@ -249,10 +260,16 @@ static void printUsage(){
            "      limit Number of open files at same time when stream directory patch;\n"
            "      maxOpenFileNumber>=8, DEFAULT -n-24, the best limit value by different\n"
            "        operating system.\n"
+           "      if old files more than the limit, least recently used file be closed first,\n"
+           "        and small old files (<=64KB) be kept in memory (up to 8MB).\n"
 #endif
            "  -f  Force overwrite, ignore write path already exists;\n"
            "      DEFAULT (no -f) not overwrite and then return error;\n"
            "      support oldPath outNewPath same path!(patch to tempPath and overwrite old)\n"
+#if (_IS_NEED_DIR_DIFF_PATCH)
+           "        if same directory path, only changed files be updated in place,\n"
+           "          same files at same path are not touched;\n"
+#endif
            "      if used -f and outNewPath is exist file:\n"
 #if (_IS_NEED_DIR_DIFF_PATCH)
            "        if patch output file, will overwrite;\n"
@@ -301,6 +318,7 @@ typedef enum THPatchResult {
     HPATCH_SPATCH_ERROR,
     HPATCH_BSPATCH_ERROR,
     HPATCH_VCPATCH_ERROR,
+    HPATCH_GZPATCH_ERROR,
 
     HPATCH_DECOMPRESSER_OPEN_ERROR=20,
     HPATCH_DECOMPRESSER_CLOSE_ERROR,
@@ -421,6 +439,7 @@ static hpatch_BOOL _toChecksumSet(const char* psets,TDirPatchChecksumSet* checks
 #define kPatchCacheSize_min      (hpatch_kStreamCacheSize*8)
 #define kPatchCacheSize_bestmin  ((size_t)1<<21)
 #define kPatchCacheSize_default  ((size_t)1<<23)
+#define kOldRefMemCacheSize      ((size_t)1<<23) //for small old files in dir patch
 
 #define _kNULL_VALUE    (-1)
 #define _kNULL_SIZE     (~(size_t)0)
@@ -785,11 +804,11 @@ int hpatch_cmd_line(int argc, const char * argv[]){
                           HPATCH_PATHTYPE_ERROR,"can not use directory overwrite oldFile");
             _return_check(hpatch_getTempPathName(outNewPath,newTempDir,newTempDir+hpatch_kPathMaxSize),
                           HPATCH_TEMPPATH_ERROR,"getTempPathName(outNewPath)");
-            printf("NOTE: all in outNewPath temp directory will be move to oldDirectory after patch!\n");
+            printf("NOTE: changed files in outNewPath temp directory will be move to oldDirectory after patch!\n");
             result=hpatch_dir(oldPath,diffFileName,newTempDir,isLoadOldAll,patchCacheSize,kMaxOpenFileNumber,
                               &checksumSet,&tempDirPatchListener,diffDataOffert,diffDataSize,threadNum);
             if (result==HPATCH_SUCCESS){
-                printf("all in outNewPath temp directory moved to oldDirectory!\n");
+                printf("changed files in outNewPath temp directory moved to oldDirectory!\n");
             }else if(!hpatch_isPathNotExist(newTempDir)){
                 printf("WARNING: not remove temp directory \"");
                 _log_info_utf8(newTempDir); printf("\"\n");
@@ -966,6 +985,7 @@ typedef struct _THDiffInfos{
     hpatch_BOOL                 isSingleCompressedDiff;
     hpatch_BOOL                 isBsDiff;
     hpatch_BOOL                 isVcDiff;
+    hpatch_BOOL                 isGzDiff;
     hpatch_compressedDiffInfo   diffInfo;
 #if (_IS_NEED_SINGLE_STREAM_DIFF)
     hpatch_singleCompressedDiffInfo sdiffInfo;
@@ -975,6 +995,11 @@ typedef struct _THDiffInfos{
 #endif
 #if (_IS_NEED_VCDIFF)
     hpatch_VcDiffInfo           vcdiffInfo;
+#endif
+#if (_IS_NEED_GZDIFF)
+    hpatch_TGzDiffInfo          gzdiffInfo;
+    hpatch_StreamPos_t          gzInnerStepMemSize; //>0 if innerDiff is single compressed diff
+    hpatch_StreamPos_t          gzInnerOldDataSize; //inflated oldData size if old is gzip file
 #endif
     hpatch_TDecompress          _decompressPlugin;
 } _THDiffInfos;
@@ -1021,6 +1046,27 @@ static int _getHDiffInfos(_THDiffInfos* out_diffInfos,const hpatch_TFileStreamIn
                 check_on_error(HPATCH_COMPRESSTYPE_ERROR);
             }
         }else
+#endif
+#if (_IS_NEED_GZDIFF)
+        if (getGzDiffInfo(&out_diffInfos->gzdiffInfo,&diffData->base)){
+            hpatch_TGzInnerDiffStream innerDiff;
+            gzdiff_openInnerDiff(&innerDiff,&diffData->base,&out_diffInfos->gzdiffInfo);
+            if (getCompressedDiffInfo(diffInfo,&innerDiff.base)){
+            }else{
+#if (_IS_NEED_SINGLE_STREAM_DIFF)
+                check(getSingleCompressedDiffInfo(&out_diffInfos->sdiffInfo,&innerDiff.base,0),
+                      HPATCH_HDIFFINFO_ERROR,"get gzdiff's innerDiff info");
+                _singleDiffInfoToHDiffInfo(diffInfo,&out_diffInfos->sdiffInfo);
+                out_diffInfos->gzInnerStepMemSize=out_diffInfos->sdiffInfo.stepMemSize;
+#else
+                check(hpatch_FALSE,HPATCH_HDIFFINFO_ERROR,"get gzdiff's innerDiff info");
+#endif
+            }
+            out_diffInfos->gzInnerOldDataSize=diffInfo->oldDataSize;
+            diffInfo->newDataSize=out_diffInfos->gzdiffInfo.newDataSize;
+            diffInfo->oldDataSize=out_diffInfos->gzdiffInfo.oldDataSize;
+            out_diffInfos->isGzDiff=hpatch_TRUE;
+        }else
 #endif
         check(hpatch_FALSE,HPATCH_HDIFFINFO_ERROR,"is hdiff file? get diffInfo");
     }
@@ -1061,6 +1107,10 @@ static void _printHDiffInfos(const _THDiffInfos* diffInfos,hpatch_BOOL isInDirDi
             else
                 typeTag="VCDiff";
         } 
+#endif
+#if (_IS_NEED_GZDIFF)
+        if (diffInfos->isGzDiff)
+            typeTag=diffInfos->gzdiffInfo.oldIsGz?"GzDiff (old&new inflated)":"GzDiff (new inflated)";
 #endif
         printf("       diffDataType: %s %s\n",typeTag,isInDirDiff?"(in DirHDiff)":"");
     }
@@ -1074,6 +1124,15 @@ static void _printHDiffInfos(const _THDiffInfos* diffInfos,hpatch_BOOL isInDirDi
     if (diffInfos->isSingleCompressedDiff)
         printf("        stepMemSize: %" PRIu64 "\n",diffInfos->sdiffInfo.stepMemSize);
 #endif
+#if (_IS_NEED_GZDIFF)
+    if (diffInfos->isGzDiff){
+        if (diffInfos->gzInnerStepMemSize>0)
+        printf("        stepMemSize: %" PRIu64 "\n",diffInfos->gzInnerStepMemSize);
+        printf("       deflate sets: level %d memLevel %d windowBits %d strategy %d\n",
+               diffInfos->gzdiffInfo.level,diffInfos->gzdiffInfo.memLevel,
+               diffInfos->gzdiffInfo.windowBits,diffInfos->gzdiffInfo.strategy);
+    }
+#endif
 #if (_IS_NEED_VCDIFF)
     if (diffInfos->isVcDiff){
         printf("      maxSrcWindows: %" PRIu64 "\n",diffInfos->vcdiffInfo.maxSrcWindowsSize);
@@ -1252,6 +1311,16 @@ static TByte* getPatchMemCache(hpatch_BOOL isLoadOldAll,size_t patchCacheSize,si
     }
 #endif //_IS_NEED_PRINT_PROGRESS
 
+//decompressors opened by patch reuse memory in the pool; reused only when a process patch many times
+static void _decompressPool_close(void){
+    hpatch_TDecompressPoolInfo poolInfo;
+    hpatch_decompressPool_close();
+    hpatch_decompressPool_getInfo(&poolInfo);
+    if (poolInfo.reuseCount>0)
+        printf("  decompressor memory: malloc %" PRIu64 " reuse %" PRIu64 "\n",
+               poolInfo.mallocCount,poolInfo.reuseCount);
+}
+
 int hpatch(const char* oldFileName,const char* diffFileName,const char* outNewFileName,
            hpatch_BOOL isLoadOldAll,size_t patchCacheSize,hpatch_StreamPos_t diffDataOffert,
            hpatch_StreamPos_t diffDataSize,hpatch_BOOL vcpatch_isChecksum,hpatch_BOOL vcpatch_isInMem,size_t threadNum){
@@ -1274,6 +1343,7 @@ int hpatch(const char* oldFileName,const char* diffFileName,const char* outNewFi
     hpatch_TFileStreamInput_init(&oldData);
     hpatch_TFileStreamInput_init(&diffData);
     hpatch_TFileStreamOutput_init(&newData);
+    check(hpatch_decompressPool_open(0),HPATCH_MEM_ERROR,"open decompressor pool");
     {//open
         printf(    "old : \""); if (oldFileName) _log_info_utf8(oldFileName);
         printf("\"\ndiff: \""); _log_info_utf8(diffFileName);
@@ -1340,6 +1410,16 @@ int hpatch(const char* oldFileName,const char* diffFileName,const char* outNewFi
             check(diffInfos.sdiffInfo.stepMemSize==(size_t)diffInfos.sdiffInfo.stepMemSize,HPATCH_MEM_ERROR,"stepMemSize too large");
             mustAppendMemSize=(size_t)diffInfos.sdiffInfo.stepMemSize;
         }
+#endif
+#if (_IS_NEED_GZDIFF)
+        if (diffInfos.isGzDiff){
+            check(diffInfos.gzInnerStepMemSize==(size_t)diffInfos.gzInnerStepMemSize,HPATCH_MEM_ERROR,"stepMemSize too large");
+            mustAppendMemSize=(size_t)diffInfos.gzInnerStepMemSize;
+            if (diffInfos.gzdiffInfo.oldIsGz){ //gzpatch inflate oldFile into cache if enough, else inflate when read
+                maxWindowSize=diffInfos.gzInnerOldDataSize;
+                isLoadOldAll=hpatch_TRUE; //inflate when read is too slow (10x+); cache size will halve if malloc fail
+            }
+        }
 #endif
         temp_cache=getPatchMemCache(isLoadOldAll,patchCacheSize,mustAppendMemSize,maxWindowSize, &temp_cache_size);
     }
@@ -1364,6 +1444,13 @@ int hpatch(const char* oldFileName,const char* diffFileName,const char* outNewFi
             patch_result=HPATCH_BSPATCH_ERROR;
     }else
 #endif
+#if (_IS_NEED_GZDIFF)
+    if (diffInfos.isGzDiff){
+        if (!gzpatch_with_cache(pnewData,poldData,&diffData.base,decompressPlugin,
+                                temp_cache,temp_cache+temp_cache_size))
+            patch_result=HPATCH_GZPATCH_ERROR;
+    }else
+#endif
 #if (_IS_NEED_VCDIFF)
     if (diffInfos.isVcDiff){
         if (!vcpatch_with_cache(pnewData,poldData,&diffData.base,decompressPlugin,
@@ -1396,6 +1483,7 @@ clear:
     check(hpatch_TFileStreamInput_close(&diffData),HPATCH_FILECLOSE_ERROR,"diffFile close");
     check(hpatch_TFileStreamInput_close(&oldData),HPATCH_FILECLOSE_ERROR,"oldFile close");
     _free_mem(temp_cache);
+    _decompressPool_close();
     printf("\nhpatchz time: %.3f s\n",(clock_s()-time0));
     return result;
 }
@@ -1423,6 +1511,7 @@ int hpatch_dir(const char* oldPath,const char* diffFileName,const char* outNewPa
 #endif
     hpatch_TFileStreamInput_init(&diffData);
     TDirPatcher_init(&dirPatcher);
+    check(hpatch_decompressPool_open(0),HPATCH_MEM_ERROR,"open decompressor pool");
     if (oldPath) assert(0!=strcmp(oldPath,outNewPath));
     {//dir diff info
         hpatch_BOOL  rt;
@@ -1483,6 +1572,7 @@ int hpatch_dir(const char* oldPath,const char* diffFileName,const char* outNewPa
         check(TDirPatcher_loadDirData(&dirPatcher,decompressPlugin,oldPath,outNewPath),
               DIRPATCH_LAOD_DIRDIFFDATA_ERROR,"load dir data in diffFile");
     }
+    memset(&hlistener->copyCounts,0,sizeof(hlistener->copyCounts));
     check(hlistener->patchBegin(hlistener,&dirPatcher),
           DIRPATCH_PATCHBEGIN_ERROR,"dir patch begin");
     {//mem cache
@@ -1530,6 +1620,9 @@ int hpatch_dir(const char* oldPath,const char* diffFileName,const char* outNewPa
         }
         check(TDirPatcher_openOldRefAsStream(&dirPatcher,kMaxOpenFileNumber,&oldStream),
               DIRPATCH_OPEN_OLDPATH_ERROR,"open oldFile");
+        if (kMaxOpenFileNumber!=kMaxOpenFileNumber_limit_min)
+            check(TDirPatcher_setOldRefMemCache(&dirPatcher,kOldRefMemCacheSize),
+                  HPATCH_MEM_ERROR,"alloc old files memory cache");
     }
     {//new data
         check(TDirPatcher_openNewDirAsStream(&dirPatcher,&hlistener->base,&newStream),
@@ -1560,6 +1653,19 @@ clear:
     check_ferr(hlistener->fileError,DIRPATCH_PATCH_FILE_ERROR,"dir patch file");
     check(hpatch_TFileStreamInput_close(&diffData),HPATCH_FILECLOSE_ERROR,"diffFile close");
     _free_mem(p_temp_mem);
+    {
+        const hpatch_TResHandleLimitInfo* hi=TDirPatcher_getOldRefHandleInfo(&dirPatcher);
+        if (hi->readCount>0)
+            printf("  old files handle: open %" PRIu64 " reopen %" PRIu64 " hit %.2f%% (memory cached %" PRIu64 " bytes)\n",
+                   hi->openCount,hi->reopenCount,hi->hitCount*100.0/hi->readCount,hi->memCachedSize);
+    }
+    {
+        const hpatch_TFileCopyCounts* cc=&hlistener->copyCounts;
+        if (cc->clonedSize+cc->kernelCopiedSize+cc->userCopiedSize>0)
+            printf("  same files copy: cloned %" PRIu64 " kernel copied %" PRIu64 " user copied %" PRIu64 " (bytes)\n",
+                   cc->clonedSize,cc->kernelCopiedSize,cc->userCopiedSize);
+    }
+    _decompressPool_close();
     printf("\nhpatchz dir patch time: %.3f s\n",(clock_s()-time0));
     return result;
 }
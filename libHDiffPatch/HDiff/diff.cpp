@@ -105,13 +105,14 @@ struct TDiffData{
     const TByte*            newData_end;
     const TByte*            oldData;
     const TByte*            oldData_end;
-    inline TDiffData():newData(0),newData_end(0),oldData(0),oldData_end(0){}
+    const hdiff_ICoverCostModel* costModel; //for select covers, can null
+    inline TDiffData():newData(0),newData_end(0),oldData(0),oldData_end(0),costModel(0){}
     inline TDiffData(const TByte* _newData,const TByte* _newData_end,
                      const TByte* _oldData,const TByte* _oldData_end)
-        :newData(_newData),newData_end(_newData_end),oldData(_oldData),oldData_end(_oldData_end){}
+        :newData(_newData),newData_end(_newData_end),oldData(_oldData),oldData_end(_oldData_end),costModel(0){}
     inline TDiffData(const TDiffData& src)
         :newData(src.newData),newData_end(src.newData_end),
-        oldData(src.oldData),oldData_end(src.oldData_end){}
+        oldData(src.oldData),oldData_end(src.oldData_end),costModel(src.costModel){}
 };
 
 
@@ -138,8 +139,8 @@ struct TDiffLimit{
     size_t      newEnd;
     size_t      recoverOldPos;
     size_t      recoverOldEnd;
-    TCompressDetect& nocover_detect;
-    TCompressDetect& cover_detect;
+    TCoverCost&      nocover_detect;
+    TCoverCost&      cover_detect;
     TOldCover        lastCover_back;
     int              kMaxMatchDeep;
 };
@@ -343,7 +344,7 @@ static void _search_cover(std::vector<TOldCover>& covers,const TDiffData& diff,
 
 //Select the appropriate cover lines and remove the unsuitable ones.
 static void _select_cover(std::vector<TOldCover>& covers,size_t cover_begin,const TDiffData& diff,int kMinSingleMatchScore,
-                          TCompressDetect& nocover_detect,TCompressDetect& cover_detect,
+                          TCoverCost& nocover_detect,TCoverCost& cover_detect,
                           TDiffLimit* diffLimit,bool isCanExtendCover){
     TOldCover lastCover(0,0,0);
     if (diffLimit)
@@ -420,8 +421,8 @@ static void _select_cover(std::vector<TOldCover>& covers,size_t cover_begin,cons
 static void select_cover(std::vector<TOldCover>& covers,size_t cover_begin,const TDiffData& diff,
                          int kMinSingleMatchScore,TDiffLimit* diffLimit,bool isCanExtendCover){
     if (diffLimit==0){
-        TCompressDetect  nocover_detect;
-        TCompressDetect  cover_detect;
+        TCoverCost  nocover_detect(diff.costModel);
+        TCoverCost  cover_detect(diff.costModel);
         _select_cover(covers,cover_begin,diff,kMinSingleMatchScore,nocover_detect,cover_detect,0,isCanExtendCover);
     }else{
         _select_cover(covers,cover_begin,diff,kMinSingleMatchScore,diffLimit->nocover_detect,
@@ -768,7 +769,8 @@ struct TDiffResearchCover:public IDiffResearchCover{
         :diff(diff_), covers(covers_),sstring(sstring_),
         kMinSingleMatchScore(kMinSingleMatchScore_),kMaxMatchDeep(kMaxMatchDeep_),
         limitCoverIndex_back(~(size_t)0),limitCoverHitEndPos_back(_kNullCoverHitEndPos),
-        isCanExtendCover(_isCanExtendCover){ researchCover=_researchCover; }
+        isCanExtendCover(_isCanExtendCover),nocover_detect(diff_.costModel),cover_detect(diff_.costModel){
+        researchCover=_researchCover; }
 
     void _researchRange(TDiffLimit* diffLimit){
         search_and_dispose_cover(curCovers,diff,sstring,kMinSingleMatchScore,diffLimit,isCanExtendCover);
@@ -843,8 +845,8 @@ struct TDiffResearchCover:public IDiffResearchCover{
     size_t                  limitCoverIndex_back;
     hpatch_StreamPos_t      limitCoverHitEndPos_back;
     const bool              isCanExtendCover;
-    TCompressDetect  nocover_detect;
-    TCompressDetect  cover_detect;
+    TCoverCost       nocover_detect;
+    TCoverCost       cover_detect;
 };
 
 struct TDiffInsertCover:public IDiffInsertCover{
@@ -891,6 +893,7 @@ static void get_diff(TDiffData& diff,std::vector<TOldCover>& covers,
         assert(sizeof(*covers.data())==sizeof(hpatch_TCover));
     const hpatch_StreamPos_t maxCoverLen=(listener&&listener->get_limit_cover_length)?
                                             listener->get_limit_cover_length(listener):kDefaultLimitCoverLen;
+    diff.costModel=(listener&&listener->get_cover_cost_model)?listener->get_cover_cost_model(listener):0;
     {
         TSuffixString _sstring_default(isUseBigCacheMatch);
         if (sstring==0){
@@ -1312,11 +1315,56 @@ void create_compressed_diff_stream(const hpatch_TStreamInput*  newData,
 }
 
 
+    static void _check_covers_safe(const hpatch_TCover* covers,size_t coverCount,
+                                   hpatch_StreamPos_t newSize,hpatch_StreamPos_t oldSize){
+        hpatch_StreamPos_t lastNewEnd=0;
+        for (size_t i=0;i<coverCount;++i){
+            const hpatch_TCover& c=covers[i];
+            check(c.newPos>=lastNewEnd);
+            check((c.length<=newSize)&&(c.newPos<=newSize-c.length));
+            check((c.length<=oldSize)&&(c.oldPos<=oldSize-c.length));
+            lastNewEnd=c.newPos+c.length;
+        }
+    }
+void create_compressed_diff_by_covers(const hpatch_TStreamInput*  newData,
+                                      const hpatch_TStreamInput*  oldData,
+                                      const hpatch_TCover* covers,size_t coverCount,bool isZeroSubDiff,
+                                      const hpatch_TStreamOutput* out_diff,
+                                      const hdiff_TCompress* compressPlugin){
+    _check_covers_safe(covers,coverCount,newData->streamSize,oldData->streamSize);
+    const TCovers _covers((void*)covers,coverCount,false);
+    serialize_compressed_diff(newData,oldData,isZeroSubDiff,_covers,out_diff,compressPlugin);
+}
+void create_single_compressed_diff_by_covers(const hpatch_TStreamInput*  newData,
+                                             const hpatch_TStreamInput*  oldData,
+                                             const hpatch_TCover* covers,size_t coverCount,bool isZeroSubDiff,
+                                             const hpatch_TStreamOutput* out_diff,
+                                             const hdiff_TCompress* compressPlugin,size_t patchStepMemSize){
+    _check_covers_safe(covers,coverCount,newData->streamSize,oldData->streamSize);
+    const TCovers _covers((void*)covers,coverCount,false);
+    serialize_single_compressed_diff(newData,oldData,isZeroSubDiff,_covers,
+                                     out_diff,compressPlugin,patchStepMemSize);
+}
+
+
+static void _resave_pushStream(TDiffStream& outDiff,const hpatch_TStreamInput* clip,bool isCompressed,
+                               const hdiff_TCompress* compressPlugin,const TPlaceholder& update_compress_sizePos,
+                               size_t threadNum){
+#if (_IS_USED_MULTITHREAD)
+    if (isCompressed&&(threadNum>1)&&(clip->streamSize>0)){
+        TStreamReadAhead_mt decStream(clip); //decompress by a thread
+        outDiff.pushStream(&decStream,compressPlugin,update_compress_sizePos);
+        return;
+    }
+#endif
+    outDiff.pushStream(clip,compressPlugin,update_compress_sizePos);
+}
+
 void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
                             hpatch_TDecompress*         decompressPlugin,
                             const hpatch_TStreamOutput* out_diff,
                             const hdiff_TCompress*      compressPlugin,
-                            hpatch_StreamPos_t          out_diff_curPos){
+                            hpatch_StreamPos_t          out_diff_curPos,size_t threadNum){
     _THDiffzHead              head;
     hpatch_compressedDiffInfo diffInfo;
     assert(in_diff!=0);
@@ -1359,9 +1407,10 @@ void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
         outDiff.packUInt_pos(compressPlugin?head.newDataDiff_size:0);//compress_newDataDiff size
     
     {//save covers
+        bool isCompressed=(head.compress_cover_buf_size>0);
         TStreamClip clip(in_diff,head.headEndPos,head.coverEndPos,
-                         (head.compress_cover_buf_size>0)?decompressPlugin:0,head.cover_buf_size);
-        outDiff.pushStream(&clip,compressPlugin,compress_cover_buf_sizePos);
+                         isCompressed?decompressPlugin:0,head.cover_buf_size);
+        _resave_pushStream(outDiff,&clip,isCompressed,compressPlugin,compress_cover_buf_sizePos,threadNum);
     }
     hpatch_StreamPos_t diffPos0=head.coverEndPos;
     {//save rle ctrl
@@ -1369,7 +1418,7 @@ void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
         hpatch_StreamPos_t bufSize=isCompressed?head.compress_rle_ctrlBuf_size:head.rle_ctrlBuf_size;
         TStreamClip clip(in_diff,diffPos0,diffPos0+bufSize,
                          isCompressed?decompressPlugin:0,head.rle_ctrlBuf_size);
-        outDiff.pushStream(&clip,compressPlugin,compress_rle_ctrlBuf_sizePos);
+        _resave_pushStream(outDiff,&clip,isCompressed,compressPlugin,compress_rle_ctrlBuf_sizePos,threadNum);
         diffPos0+=bufSize;
     }
     {//save rle code
@@ -1377,7 +1426,7 @@ void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
         hpatch_StreamPos_t bufSize=isCompressed?head.compress_rle_codeBuf_size:head.rle_codeBuf_size;
         TStreamClip clip(in_diff,diffPos0,diffPos0+bufSize,
                          isCompressed?decompressPlugin:0,head.rle_codeBuf_size);
-        outDiff.pushStream(&clip,compressPlugin,compress_rle_codeBuf_sizePos);
+        _resave_pushStream(outDiff,&clip,isCompressed,compressPlugin,compress_rle_codeBuf_sizePos,threadNum);
         diffPos0+=bufSize;
     }
     {//save newDataDiff
@@ -1385,7 +1434,7 @@ void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
         hpatch_StreamPos_t bufSize=isCompressed?head.compress_newDataDiff_size:head.newDataDiff_size;
         TStreamClip clip(in_diff,diffPos0,diffPos0+bufSize,
                          isCompressed?decompressPlugin:0,head.newDataDiff_size);
-        outDiff.pushStream(&clip,compressPlugin,compress_newDataDiff_sizePos);
+        _resave_pushStream(outDiff,&clip,isCompressed,compressPlugin,compress_newDataDiff_sizePos,threadNum);
         diffPos0+=bufSize;
     }
 }
@@ -1398,7 +1447,7 @@ hpatch_StreamPos_t
                                    const hdiff_TCompress*      compressPlugin,
                                    const hpatch_singleCompressedDiffInfo* diffInfo,
                                    hpatch_StreamPos_t          in_diff_curPos,
-                                   hpatch_StreamPos_t          out_diff_curPos){
+                                   hpatch_StreamPos_t          out_diff_curPos,size_t threadNum){
     hpatch_singleCompressedDiffInfo _diffInfo;
     if (diffInfo==0){
         checki(getSingleCompressedDiffInfo(&_diffInfo,in_diff,in_diff_curPos),
@@ -1429,11 +1478,25 @@ hpatch_StreamPos_t
         TStreamClip clip(in_diff,diffInfo->diffDataPos+in_diff_curPos,in_diff->streamSize,
                          isCompressed?decompressPlugin:0,diffInfo->uncompressedSize);
         TPlaceholder compressedSize_pos=outDiff.packUInt_pos(compressPlugin?diffInfo->uncompressedSize:0);
-        outDiff.pushStream(&clip,compressPlugin,compressedSize_pos);
+        _resave_pushStream(outDiff,&clip,isCompressed,compressPlugin,compressedSize_pos,threadNum);
     }
     return outDiff.getWritedPos();
 }
 
+static void* _order0_open(const hdiff_ICoverCostModel* costModel){
+    return new TCompressDetectOrder0(); }
+static void _order0_close(const hdiff_ICoverCostModel* costModel,void* model){
+    delete (TCompressDetectOrder0*)model; }
+static void _order0_add_chars(void* model,const unsigned char* d,size_t n,const unsigned char* sub){
+    ((TCompressDetectOrder0*)model)->add_chars(d,n,sub); }
+static size_t _order0_cost(const void* model,const unsigned char* d,size_t n,const unsigned char* sub){
+    return ((const TCompressDetectOrder0*)model)->cost(d,n,sub); }
+
+const hdiff_ICoverCostModel* getOrder0CoverCostModel(){
+    static const hdiff_ICoverCostModel _order0Model={_order0_open,_order0_close,_order0_add_chars,_order0_cost};
+    return &_order0Model;
+}
+
 
 //----------------------------------------------------------------------------------------------------
 
@@ -33,6 +33,11 @@
 
 static const int kMinSingleMatchScore_default = 6;
 
+//cover cost model for select covers, set by ICoverLinesListener::get_cover_cost_model or
+//  create_*_diff_block(...coverCostModel); default (null) is adaptive order-1 model;
+//  adaptive order-0 model (rle + byte frequency) got smaller diffFile for binary file (exe,so...).
+const hdiff_ICoverCostModel* getOrder0CoverCostModel();
+
 //create a diff data between oldData and newData
 //  out_diff is uncompressed, you can use create_compressed_diff()
 //       or create_single_compressed_diff() create compressed diff data
@@ -108,12 +113,14 @@ bool check_compressed_diff(const hpatch_TStreamInput*  newData,
 
 //resave compressed_diff
 //  decompress in_diff and recompress to out_diff
+//  if threadNum>1, decompress by a read ahead thread, parallel with compressPlugin;
+//    (compressPlugin's parallel thread number set by itself)
 //  throw std::runtime_error when input file error or I/O error,etc.
 void resave_compressed_diff(const hpatch_TStreamInput*  in_diff,
                             hpatch_TDecompress*         decompressPlugin,
                             const hpatch_TStreamOutput* out_diff,
                             const hdiff_TCompress*      compressPlugin,
-                            hpatch_StreamPos_t          out_diff_curPos=0);
+                            hpatch_StreamPos_t          out_diff_curPos=0,size_t threadNum=1);
 
 
 
@@ -166,6 +173,7 @@ bool check_single_compressed_diff(const hpatch_TStreamInput* newData,
 
 //resave single_compressed_diff
 //  decompress in_diff and recompress to out_diff
+//  if threadNum>1, decompress by a read ahead thread, parallel with compressPlugin;
 //  throw std::runtime_error when input file error or I/O error,etc.
 //  return new out_diff curPos
 hpatch_StreamPos_t
@@ -175,8 +183,24 @@ hpatch_StreamPos_t
                                    const hdiff_TCompress*      compressPlugin,
                                    const hpatch_singleCompressedDiffInfo* diffInfo=0,
                                    hpatch_StreamPos_t          in_diff_curPos=0,
-                                   hpatch_StreamPos_t          out_diff_curPos=0);
+                                   hpatch_StreamPos_t          out_diff_curPos=0,size_t threadNum=1);
+
 
+//serialize diffData by covers (got by get_match_covers_by_*() or other way)
+//  covers must sorted by newPos & not overlap in newData;
+//  isZeroSubDiff: if all covers are exactly matched (newData's datas same as oldData's), set true;
+//  throw std::runtime_error when I/O error,etc.
+void create_compressed_diff_by_covers(const hpatch_TStreamInput*  newData,
+                                      const hpatch_TStreamInput*  oldData,
+                                      const hpatch_TCover* covers,size_t coverCount,bool isZeroSubDiff,
+                                      const hpatch_TStreamOutput* out_diff,
+                                      const hdiff_TCompress* compressPlugin=0);
+void create_single_compressed_diff_by_covers(const hpatch_TStreamInput*  newData,
+                                             const hpatch_TStreamInput*  oldData,
+                                             const hpatch_TCover* covers,size_t coverCount,bool isZeroSubDiff,
+                                             const hpatch_TStreamOutput* out_diff,
+                                             const hdiff_TCompress* compressPlugin=0,
+                                             size_t patchStepMemSize=kDefaultPatchStepMemSize);
 
 //same as create?compressed_diff_stream(), but not serialize diffData, only got covers
 void get_match_covers_by_block(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
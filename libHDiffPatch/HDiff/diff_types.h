@@ -155,6 +155,16 @@ extern "C"
         hpatch_StreamPos_t endPos;
     } hdiff_TRange;
 
+    //estimate compressed size of new data, for select covers;
+    //  a model opened for every select region, used by one thread; add_chars() the data selected before.
+    typedef struct hdiff_ICoverCostModel{
+        void*   (*open)(const struct hdiff_ICoverCostModel* costModel);
+        void    (*close)(const struct hdiff_ICoverCostModel* costModel,void* model);
+        //sub!=0 when data cover by old data, cost of (d-sub)
+        void    (*add_chars)(void* model,const unsigned char* d,size_t n,const unsigned char* sub);
+        size_t  (*cost)(const void* model,const unsigned char* d,size_t n,const unsigned char* sub);
+    } hdiff_ICoverCostModel;
+
     struct ICoverLinesListener {
         bool (*search_cover_limit)(ICoverLinesListener* listener,const void* pcovers,size_t coverCount,bool isCover32);
         void (*research_cover)(ICoverLinesListener* listener,IDiffResearchCover* diffi,const void* pcovers,size_t coverCount,bool isCover32);
@@ -169,6 +179,8 @@ extern "C"
         hpatch_BOOL (*next_search_block_MT)(ICoverLinesListener* listener,hdiff_TRange* out_newRange);//must thread safe
         hpatch_StreamPos_t (*get_limit_cover_length)(const ICoverLinesListener* listener); //if null, default kDefaultLimitCoverLen 
         void (*map_streams_befor_serialize)(ICoverLinesListener* listener,const hpatch_TStreamInput** pnewData,const hpatch_TStreamInput** poldData);
+        //if null, select covers by default cost model: adaptive order-1 model (TCompressDetect)
+        const struct hdiff_ICoverCostModel* (*get_cover_cost_model)(const ICoverLinesListener* listener);
     };
 
     struct hdiff_TMTSets_s{ // used by $hdiff -s
@@ -383,22 +383,24 @@ void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_
                                   unsigned char* oldData,unsigned char* oldData_end,
                                   std::vector<unsigned char>& out_diff,const hdiff_TCompress* compressPlugin,
                                   int kMinSingleMatchScore,bool isUseBigCacheMatch,
-                                  size_t matchBlockSize,size_t threadNum){
+                                  size_t matchBlockSize,size_t threadNum,const hdiff_ICoverCostModel* coverCostModel){
     TVectorAsStreamOutput outDiffStream(out_diff);
     create_compressed_diff_block(newData,newData_end,oldData,oldData_end,
-                                 &outDiffStream,compressPlugin,kMinSingleMatchScore,isUseBigCacheMatch,matchBlockSize,threadNum);
+                                 &outDiffStream,compressPlugin,kMinSingleMatchScore,isUseBigCacheMatch,matchBlockSize,
+                                 threadNum,coverCostModel);
 }
 void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_end,
                                   unsigned char* oldData,unsigned char* oldData_end,
                                   const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
                                   int kMinSingleMatchScore,bool isUseBigCacheMatch,
-                                  size_t matchBlockSize,size_t threadNum){
+                                  size_t matchBlockSize,size_t threadNum,const hdiff_ICoverCostModel* coverCostModel){
     if (matchBlockSize==0){
+        TCoverCostListener costListener(coverCostModel);
         create_compressed_diff(newData,newData_end,oldData,oldData_end,
-                               out_diff,compressPlugin,kMinSingleMatchScore,isUseBigCacheMatch,0,threadNum);
+                               out_diff,compressPlugin,kMinSingleMatchScore,isUseBigCacheMatch,&costListener,threadNum);
         return;
     }
-    TCoversOptimMem coversOp(newData,newData_end,oldData,oldData_end,matchBlockSize,threadNum);
+    TCoversOptimMem coversOp(newData,newData_end,oldData,oldData_end,matchBlockSize,threadNum,coverCostModel);
     create_compressed_diff(coversOp.matchBlock->newData,coversOp.matchBlock->newData_end_cur,
                            coversOp.matchBlock->oldData,coversOp.matchBlock->oldData_end_cur,
                            out_diff,compressPlugin,kMinSingleMatchScore,isUseBigCacheMatch,&coversOp,threadNum);
@@ -406,19 +408,21 @@ void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_
 void create_compressed_diff_block(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
                                   const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
                                   int kMinSingleMatchScore,bool isUseBigCacheMatch,size_t matchBlockSize,
-                                  size_t threadNumForMem,size_t threadNumForStream){
+                                  size_t threadNumForMem,size_t threadNumForStream,
+                                  const hdiff_ICoverCostModel* coverCostModel){
     if (matchBlockSize==0){
         TAutoMem oldAndNewData;
         loadOldAndNewStream(oldAndNewData,oldData,newData);
         size_t old_size=oldData?(size_t)oldData->streamSize:0;
         unsigned char* pOldData=oldAndNewData.data();
         unsigned char* pNewData=pOldData+old_size;
+        TCoverCostListener costListener(coverCostModel);
         create_compressed_diff(pNewData,pNewData+(size_t)newData->streamSize,pOldData,pOldData+old_size,
                                out_diff,compressPlugin,kMinSingleMatchScore,
-                               isUseBigCacheMatch,0,threadNumForMem);
+                               isUseBigCacheMatch,&costListener,threadNumForMem);
         return;
     }
-    TCoversOptimStream coversOp(newData,oldData,matchBlockSize,threadNumForMem,threadNumForStream);
+    TCoversOptimStream coversOp(newData,oldData,matchBlockSize,threadNumForMem,threadNumForStream,coverCostModel);
     create_compressed_diff(coversOp.matchBlock->newData,coversOp.matchBlock->newData_end_cur,
                            coversOp.matchBlock->oldData,coversOp.matchBlock->oldData_end_cur,
                            out_diff,compressPlugin,kMinSingleMatchScore,
@@ -430,14 +434,16 @@ void create_single_compressed_diff_block(unsigned char* newData,unsigned char* n
                                          unsigned char* oldData,unsigned char* oldData_end,
                                          const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
                                          int kMinSingleMatchScore,size_t patchStepMemSize,
-                                         bool isUseBigCacheMatch,size_t matchBlockSize,size_t threadNum){
+                                         bool isUseBigCacheMatch,size_t matchBlockSize,size_t threadNum,
+                                         const hdiff_ICoverCostModel* coverCostModel){
     if (matchBlockSize==0){
+        TCoverCostListener costListener(coverCostModel);
         create_single_compressed_diff(newData,newData_end,oldData,oldData_end,
                                       out_diff,compressPlugin,kMinSingleMatchScore,
-                                      patchStepMemSize,isUseBigCacheMatch,0,threadNum);
+                                      patchStepMemSize,isUseBigCacheMatch,&costListener,threadNum);
         return;
     }
-    TCoversOptimMem coversOp(newData,newData_end,oldData,oldData_end,matchBlockSize,threadNum);
+    TCoversOptimMem coversOp(newData,newData_end,oldData,oldData_end,matchBlockSize,threadNum,coverCostModel);
     create_single_compressed_diff(coversOp.matchBlock->newData,coversOp.matchBlock->newData_end_cur,
                                   coversOp.matchBlock->oldData,coversOp.matchBlock->oldData_end_cur,
                                   out_diff,compressPlugin,kMinSingleMatchScore,
@@ -447,29 +453,32 @@ void create_single_compressed_diff_block(unsigned char* newData,unsigned char* n
                                          unsigned char* oldData,unsigned char* oldData_end,
                                          std::vector<unsigned char>& out_diff,const hdiff_TCompress* compressPlugin,
                                          int kMinSingleMatchScore,size_t patchStepMemSize,
-                                         bool isUseBigCacheMatch,size_t matchBlockSize,size_t threadNum){
+                                         bool isUseBigCacheMatch,size_t matchBlockSize,size_t threadNum,
+                                         const hdiff_ICoverCostModel* coverCostModel){
     TVectorAsStreamOutput outDiffStream(out_diff);
     create_single_compressed_diff_block(newData,newData_end,oldData,oldData_end,
                                         &outDiffStream,compressPlugin,kMinSingleMatchScore,
-                                        patchStepMemSize,isUseBigCacheMatch,matchBlockSize,threadNum);
+                                        patchStepMemSize,isUseBigCacheMatch,matchBlockSize,threadNum,coverCostModel);
 }
 void create_single_compressed_diff_block(const hpatch_TStreamInput* newData,const hpatch_TStreamInput* oldData,
                                          const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
                                          int kMinSingleMatchScore,size_t patchStepMemSize,
                                          bool isUseBigCacheMatch,size_t matchBlockSize,
-                                         size_t threadNumForMem,size_t threadNumForStream){
+                                         size_t threadNumForMem,size_t threadNumForStream,
+                                         const hdiff_ICoverCostModel* coverCostModel){
     if (matchBlockSize==0){
         TAutoMem oldAndNewData;
         loadOldAndNewStream(oldAndNewData,oldData,newData);
         size_t old_size=oldData?(size_t)oldData->streamSize:0;
         unsigned char* pOldData=oldAndNewData.data();
         unsigned char* pNewData=pOldData+old_size;
+        TCoverCostListener costListener(coverCostModel);
         create_single_compressed_diff(pNewData,pNewData+(size_t)newData->streamSize,pOldData,pOldData+old_size,
                                       out_diff,compressPlugin,kMinSingleMatchScore,
-                                      patchStepMemSize,isUseBigCacheMatch,0,threadNumForMem);
+                                      patchStepMemSize,isUseBigCacheMatch,&costListener,threadNumForMem);
         return;
     }
-    TCoversOptimStream coversOp(newData,oldData,matchBlockSize,threadNumForMem,threadNumForStream);
+    TCoversOptimStream coversOp(newData,oldData,matchBlockSize,threadNumForMem,threadNumForStream,coverCostModel);
     create_single_compressed_diff(coversOp.matchBlock->newData,coversOp.matchBlock->newData_end_cur,
                                   coversOp.matchBlock->oldData,coversOp.matchBlock->oldData_end_cur,
                                   out_diff,compressPlugin,kMinSingleMatchScore,
@@ -105,11 +105,24 @@ namespace hdiff_private{
         bool            _isUnpacked;
     };
 
-    template<class _TMatchBlock>
-    struct TCoversOptim:public ICoverLinesListener{
-        explicit TCoversOptim(_TMatchBlock* _matchBlock):matchBlock(_matchBlock){
+    //select covers by coverCostModel; if null, by default cost model
+    struct TCoverCostListener:public ICoverLinesListener{
+        explicit TCoverCostListener(const hdiff_ICoverCostModel* _coverCostModel):coverCostModel(_coverCostModel){
             ICoverLinesListener* listener=this;
             memset(listener,0,sizeof(*listener));
+            if (coverCostModel) get_cover_cost_model=_get_cover_cost_model;
+        }
+        const hdiff_ICoverCostModel* coverCostModel;
+    protected:
+        static const hdiff_ICoverCostModel* _get_cover_cost_model(const ICoverLinesListener* listener){
+            return ((const TCoverCostListener*)listener)->coverCostModel;
+        }
+    };
+
+    template<class _TMatchBlock>
+    struct TCoversOptim:public TCoverCostListener{
+        explicit TCoversOptim(_TMatchBlock* _matchBlock,const hdiff_ICoverCostModel* _coverCostModel)
+        :TCoverCostListener(_coverCostModel),matchBlock(_matchBlock){
             insert_cover=_insert_cover;
         }
         _TMatchBlock* matchBlock;
@@ -135,8 +148,8 @@ namespace hdiff_private{
     struct TCoversOptimMem:public TCoversOptim<TMatchBlockMem>{
         TCoversOptimMem(unsigned char* newData,unsigned char* newData_end,
                        unsigned char* oldData,unsigned char* oldData_end,
-                       size_t matchBlockSize,size_t threadNum)
-        :TCoversOptim<TMatchBlockMem>(&_matchBlock),
+                       size_t matchBlockSize,size_t threadNum,const hdiff_ICoverCostModel* coverCostModel=0)
+        :TCoversOptim<TMatchBlockMem>(&_matchBlock,coverCostModel),
          _matchBlock(newData,newData_end,oldData,oldData_end,matchBlockSize,threadNum){
             _doPack();
         }
@@ -146,8 +159,9 @@ namespace hdiff_private{
 
     struct TCoversOptimStream:public TCoversOptim<TMatchBlockStream>{
         TCoversOptimStream(const hpatch_TStreamInput* newStream,const hpatch_TStreamInput* oldStream,
-                       size_t matchBlockSize,size_t threadNumForMem,size_t threadNumForStream)
-        :TCoversOptim<TMatchBlockStream>(&_matchBlock),
+                       size_t matchBlockSize,size_t threadNumForMem,size_t threadNumForStream,
+                       const hdiff_ICoverCostModel* coverCostModel=0)
+        :TCoversOptim<TMatchBlockStream>(&_matchBlock,coverCostModel),
          _matchBlock(newStream,oldStream,matchBlockSize,threadNumForMem,threadNumForStream){
             map_streams_befor_serialize=_map_streams_befor_serialize;//for ICoverLinesListener
             _doPack();
@@ -168,6 +182,7 @@ namespace hdiff_private{
 //optimize diff speed by match block
 //note: newData&oldData in memory will be changed
 //see create_compressed_diff | create_single_compressed_diff
+//coverCostModel: for select covers, can null for default; see getOrder0CoverCostModel()
 
 void create_compressed_diff_block(const hpatch_TStreamInput* newData,//will load needed in memory
                                   const hpatch_TStreamInput* oldData,//will load needed in memory
@@ -176,7 +191,8 @@ void create_compressed_diff_block(const hpatch_TStreamInput* newData,//will load
                                   int kMinSingleMatchScore=kMinSingleMatchScore_default,
                                   bool isUseBigCacheMatch=false,
                                   size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                  size_t threadNumForMem=1,size_t threadNumForStream=1);
+                                  size_t threadNumForMem=1,size_t threadNumForStream=1,
+                                  const hdiff_ICoverCostModel* coverCostModel=0);
 void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_end,
                                   unsigned char* oldData,unsigned char* oldData_end,
                                   const hpatch_TStreamOutput* out_diff,
@@ -184,7 +200,7 @@ void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_
                                   int kMinSingleMatchScore=kMinSingleMatchScore_default,
                                   bool isUseBigCacheMatch=false,
                                   size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                  size_t threadNum=1);
+                                  size_t threadNum=1,const hdiff_ICoverCostModel* coverCostModel=0);
 void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_end,
                                   unsigned char* oldData,unsigned char* oldData_end,
                                   std::vector<unsigned char>& out_diff,
@@ -192,7 +208,7 @@ void create_compressed_diff_block(unsigned char* newData,unsigned char* newData_
                                   int kMinSingleMatchScore=kMinSingleMatchScore_default,
                                   bool isUseBigCacheMatch=false,
                                   size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                  size_t threadNum=1);
+                                  size_t threadNum=1,const hdiff_ICoverCostModel* coverCostModel=0);
 
 void create_single_compressed_diff_block(const hpatch_TStreamInput* newData,//will load needed in memory
                                          const hpatch_TStreamInput* oldData,//will load needed in memory
@@ -201,7 +217,8 @@ void create_single_compressed_diff_block(const hpatch_TStreamInput* newData,//wi
                                          size_t patchStepMemSize=kDefaultPatchStepMemSize,
                                          bool isUseBigCacheMatch=false,
                                          size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                         size_t threadNumForMem=1,size_t threadNumForStream=1);
+                                         size_t threadNumForMem=1,size_t threadNumForStream=1,
+                                  const hdiff_ICoverCostModel* coverCostModel=0);
 void create_single_compressed_diff_block(unsigned char* newData,unsigned char* newData_end,
                                          unsigned char* oldData,unsigned char* oldData_end,
                                          const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin=0,
@@ -209,7 +226,7 @@ void create_single_compressed_diff_block(unsigned char* newData,unsigned char* n
                                          size_t patchStepMemSize=kDefaultPatchStepMemSize,
                                          bool isUseBigCacheMatch=false,
                                          size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                         size_t threadNum=1);
+                                         size_t threadNum=1,const hdiff_ICoverCostModel* coverCostModel=0);
 void create_single_compressed_diff_block(unsigned char* newData,unsigned char* newData_end,
                                          unsigned char* oldData,unsigned char* oldData_end,
                                          std::vector<unsigned char>& out_diff,const hdiff_TCompress* compressPlugin=0,
@@ -217,6 +234,6 @@ void create_single_compressed_diff_block(unsigned char* newData,unsigned char* n
                                          size_t patchStepMemSize=kDefaultPatchStepMemSize,
                                          bool isUseBigCacheMatch=false,
                                          size_t matchBlockSize=kDefaultFastMatchBlockSize,
-                                         size_t threadNum=1);
+                                         size_t threadNum=1,const hdiff_ICoverCostModel* coverCostModel=0);
 
 #endif //hdiff_match_block_h
@@ -28,6 +28,7 @@
 
 #include "compress_detect.h"
 #include <string.h> //memset
+#include <math.h> //log2
 #include <stdexcept> //std::runtime_error
 namespace hdiff_private{
 
@@ -181,4 +182,51 @@ size_t TCompressDetect::cost(const unsigned char* d,size_t n,const unsigned char
     return result+rleCtrlCost;
 }
 
+TCompressDetectOrder0::TCompressDetectOrder0():m_sum(0){
+    memset(m_count,0,sizeof(m_count));
+    for (size_t i=0;i<256;++i)
+        m_bits[i]=0;
+    m_bits[256]=8;
+}
+
+void TCompressDetectOrder0::_add_rle(const unsigned char* d,size_t n){
+    for (size_t i=0;i<n;++i){
+        unsigned char cur=d[i];
+        m_bits[cur]=log2((double)(++m_count[cur]+1));
+    }
+    m_sum+=n;
+    m_bits[256]=log2((double)(m_sum+256));
+}
+
+double TCompressDetectOrder0::_cost_rle(const unsigned char* d,size_t n)const{
+    double bits=0;
+    for (size_t i=0;i<n;++i)
+        bits+=m_bits[256]-m_bits[d[i]];
+    return bits;
+}
+
+void TCompressDetectOrder0::add_chars(const unsigned char* d,size_t n,const unsigned char* sub){
+    by_step(this->_add_rle);
+}
+
+size_t TCompressDetectOrder0::cost(const unsigned char* d,size_t n,const unsigned char* sub)const{
+    double bits=0;
+    by_step(bits+=this->_cost_rle);
+    return rleCtrlCost+(size_t)(bits*(1.0/8)+0.5);
+}
+
+TCoverCost::TCoverCost(const hdiff_ICoverCostModel* costModel)
+:m_costModel(costModel),m_model(0),m_detect(0){
+    if (m_costModel){
+        m_model=m_costModel->open(m_costModel);
+        if (m_model==0) throw std::runtime_error("TCoverCost() costModel->open() error!");
+    }else{
+        m_detect=new TCompressDetect();
+    }
+}
+TCoverCost::~TCoverCost(){
+    if (m_model) m_costModel->close(m_costModel,m_model);
+    if (m_detect) delete m_detect;
+}
+
 }//namespace hdiff_private
@@ -34,6 +34,7 @@
 #include <stddef.h> //for size_t
 #include "../../HPatch/patch_types.h" //for hpatch_uint32_t
 #include "mem_buf.h"
+#include "../diff_types.h" //for hdiff_ICoverCostModel
 namespace hdiff_private{
 
 template<class _UInt>
@@ -83,6 +84,37 @@ private:
     size_t _cost_rle(const unsigned char* d,size_t n)const;
 };
 
+//adaptive order-0 model: rle first, then byte frequency cost of not rle coded bytes
+class TCompressDetectOrder0{
+public:
+    TCompressDetectOrder0();
+    void   add_chars(const unsigned char* d,size_t n,const unsigned char* sub=0);
+    size_t cost(const unsigned char* d,size_t n,const unsigned char* sub=0)const;
+private:
+    size_t  m_sum;
+    size_t  m_count[256];
+    double  m_bits[256+1]; //log2(count+1); m_bits[256]==log2(sum+256)
+    void   _add_rle(const unsigned char* d,size_t n);
+    double _cost_rle(const unsigned char* d,size_t n)const;
+};
+
+//cost model used by select covers: costModel if not null, else TCompressDetect
+class TCoverCost{
+public:
+    explicit TCoverCost(const hdiff_ICoverCostModel* costModel=0);
+    ~TCoverCost();
+    inline void   add_chars(const unsigned char* d,size_t n,const unsigned char* sub=0){
+        if (m_costModel) m_costModel->add_chars(m_model,d,n,sub); else m_detect->add_chars(d,n,sub); }
+    inline size_t cost(const unsigned char* d,size_t n,const unsigned char* sub=0)const{
+        return m_costModel?m_costModel->cost(m_model,d,n,sub):m_detect->cost(d,n,sub); }
+private:
+    const hdiff_ICoverCostModel* m_costModel;
+    void*            m_model;
+    TCompressDetect* m_detect;
+    TCoverCost(const TCoverCost&); //no copy
+    TCoverCost& operator=(const TCoverCost&);
+};
+
 }//namespace hdiff_private
 
 #endif
@@ -29,6 +29,9 @@
 #include <stdexcept> //std::runtime_error
 #include "../../diff.h" //for stream type
 #include <algorithm>
+#if (_IS_USED_MULTITHREAD)
+#include "../../../../libParallel/parallel_channel.h"
+#endif
 
 #define checki(value,info) { if (!(value)) { throw std::runtime_error(info); } }
 #define check(value) checki(value,"check "#value" error!")
@@ -865,6 +868,117 @@ hpatch_BOOL TStreamClip::_clip_read(const hpatch_TStreamInput* stream,hpatch_Str
 }
     
 
+#if (_IS_USED_MULTITHREAD)
+namespace {
+    struct TReadAheadBuf{
+        hpatch_StreamPos_t  pos;
+        size_t              size;
+        unsigned char*      data;
+    };
+}
+
+struct TStreamReadAhead_mt::TMt:public TMtByChannel{
+    const hpatch_TStreamInput*  src;
+    size_t                      bufSize;
+    hpatch_StreamPos_t          readPos;
+};
+
+void TStreamReadAhead_mt::_readThread(int threadIndex,void* workData){
+    TStreamReadAhead_mt::TMt& mt=*(TStreamReadAhead_mt::TMt*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(mt);
+    while (mt.readPos<mt.src->streamSize){
+        TReadAheadBuf* buf=(TReadAheadBuf*)mt.work_chan.accept(true);
+        if (buf==0) break; //closed
+        buf->pos=mt.readPos;
+        buf->size=mt.bufSize;
+        if (buf->size>mt.src->streamSize-mt.readPos)
+            buf->size=(size_t)(mt.src->streamSize-mt.readPos);
+        bool isReadOk=false;
+        try {
+            isReadOk=(0!=mt.src->read(mt.src,buf->pos,buf->data,buf->data+buf->size));
+        } catch (...) {
+            isReadOk=false;
+        }
+        if (!isReadOk){
+            mt.on_error();
+            break;
+        }
+        mt.readPos+=buf->size;
+        if (!mt.data_chan.send(buf,true)) break;
+    }
+}
+
+TStreamReadAhead_mt::TStreamReadAhead_mt(const hpatch_TStreamInput* srcStream,size_t bufSize,size_t bufCount)
+:_src(srcStream),_mt(0),_bufSize(bufSize),_bufCount(bufCount),_curBuf(0),_nextBufPos(0){
+    assert((bufSize>0)&&(bufCount>0));
+    _mem.realloc((sizeof(TReadAheadBuf)+bufSize)*bufCount);
+    this->streamImport=this;
+    this->streamSize=srcStream->streamSize;
+    this->read=_read;
+}
+
+TStreamReadAhead_mt::~TStreamReadAhead_mt(){
+    _stop();
+}
+
+void TStreamReadAhead_mt::_stop(){
+    _curBuf=0;
+    if (_mt){
+        TMt* mt=_mt;
+        _mt=0;
+        mt->finish();
+        delete mt;
+    }
+}
+
+void TStreamReadAhead_mt::_restart(hpatch_StreamPos_t readFromPos){
+    _stop();
+    _mt=new TMt();
+    _mt->src=_src;
+    _mt->bufSize=_bufSize;
+    _mt->readPos=readFromPos;
+    TReadAheadBuf* bufs=(TReadAheadBuf*)_mem.data();
+    unsigned char* pdata=_mem.data()+sizeof(TReadAheadBuf)*_bufCount;
+    for (size_t i=0;i<_bufCount;++i,pdata+=_bufSize){
+        bufs[i].data=pdata;
+        check(_mt->work_chan.send(&bufs[i],true));
+    }
+    _nextBufPos=readFromPos;
+    check(_mt->start_threads(1,_readThread,_mt,false));
+}
+
+hpatch_BOOL TStreamReadAhead_mt::_read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                       unsigned char* out_data,unsigned char* out_data_end){
+    TStreamReadAhead_mt* self=(TStreamReadAhead_mt*)stream->streamImport;
+    assert(readFromPos+(size_t)(out_data_end-out_data)<=self->streamSize);
+    while (out_data<out_data_end){
+        TReadAheadBuf* buf=(TReadAheadBuf*)self->_curBuf;
+        if ((buf!=0)&&(buf->pos<=readFromPos)&&(readFromPos<buf->pos+buf->size)){
+            size_t bufPos=(size_t)(readFromPos-buf->pos);
+            size_t len=buf->size-bufPos;
+            if (len>(size_t)(out_data_end-out_data))
+                len=(size_t)(out_data_end-out_data);
+            memcpy(out_data,buf->data+bufPos,len);
+            out_data+=len;
+            readFromPos+=len;
+            continue;
+        }
+        if ((self->_mt==0)||(readFromPos!=self->_nextBufPos)){
+            self->_restart(readFromPos);
+        }else if (buf){ //buf used, free it
+            self->_curBuf=0;
+            if (!self->_mt->work_chan.send(buf,true)) return hpatch_FALSE;
+        }
+        buf=(TReadAheadBuf*)self->_mt->data_chan.accept(true);
+        if (buf==0) return hpatch_FALSE; //error
+        assert(buf->pos==self->_nextBufPos);
+        self->_nextBufPos+=buf->size;
+        self->_curBuf=buf;
+    }
+    return hpatch_TRUE;
+}
+#endif //_IS_USED_MULTITHREAD
+
 static hpatch_BOOL _TVectorAsStreamOutput_write(const hpatch_TStreamOutput* stream,const hpatch_StreamPos_t writeToPos,
                                                 const unsigned char* data,const unsigned char* data_end){
     TVectorAsStreamOutput* self=(TVectorAsStreamOutput*)stream->streamImport;
@@ -31,6 +31,7 @@
 #include "../pack_uint.h" //for packUInt_fixSize
 #include "../mem_buf.h"
 #include "../bytes_rle.h"
+#include "../../../../libParallel/parallel_import.h"
 
 struct hdiff_TCompress;
 namespace hdiff_private{
@@ -164,6 +165,32 @@ private:
                                   unsigned char* out_data,unsigned char* out_data_end);
 };
 
+#if (_IS_USED_MULTITHREAD)
+//read ahead srcStream by a thread, for slow sequential read stream (like TStreamClip with decompressPlugin);
+//  if readFromPos not continuous, restart read ahead from readFromPos.
+class TStreamReadAhead_mt:public hpatch_TStreamInput{
+public:
+    explicit TStreamReadAhead_mt(const hpatch_TStreamInput* srcStream,
+                                 size_t bufSize=kReadAheadBufSize,size_t bufCount=kReadAheadBufCount);
+    ~TStreamReadAhead_mt();
+    enum{ kReadAheadBufSize=hdiff_kFileIOBufBestSize*4, kReadAheadBufCount=4 };
+private:
+    struct TMt;
+    const hpatch_TStreamInput*  _src;
+    TMt*                        _mt;
+    size_t                      _bufSize;
+    size_t                      _bufCount;
+    TAutoMem                    _mem;
+    void*                       _curBuf;
+    hpatch_StreamPos_t          _nextBufPos;
+    void _stop();
+    void _restart(hpatch_StreamPos_t readFromPos);
+    static void _readThread(int threadIndex,void* workData);
+    static hpatch_BOOL _read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                             unsigned char* out_data,unsigned char* out_data_end);
+};
+#endif
+
 struct TStepStream:public hpatch_TStreamInput{
     TStepStream(const hpatch_TStreamInput* newStream,const hpatch_TStreamInput* oldStream,
                 bool isZeroSubDiff,const TCovers& covers,size_t patchStepMemSize);
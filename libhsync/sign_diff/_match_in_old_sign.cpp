@@ -28,6 +28,7 @@
  */
 #include "_match_in_old_sign.h"
 #include "../sync_client/match_in_types.h"
+#include <vector>
 namespace sync_private{
 
     #define check(value,info) { if (!(value)) { throw std::runtime_error(info); } }
@@ -42,15 +43,14 @@ namespace sync_private{
             inline explicit TMt(struct _TMatchSDatas& _matchDatas)
                 :matchDatas(_matchDatas),workIndex(0){}
             CHLocker readLocker;
-            CHLocker writeLocker;
             std::atomic<size_t>  workIndex;
             struct _TMatchSDatas& matchDatas;
         };
     }
 #endif //_IS_USED_MULTITHREAD
 
-static bool matchRange(hpatch_TOutputCovers* out_covers,const uint32_t* range_begin,const uint32_t* range_end,
-                       TStreamDataCache_base& newData,const TNewDataSyncInfo* oldSyncInfo,uint32_t& oldBlockIndex_bck,void* _mt){
+static bool matchRange(const uint32_t* range_begin,const uint32_t* range_end,
+                       TStreamDataCache_base& newData,const TNewDataSyncInfo* oldSyncInfo,uint32_t& oldBlockIndex_bck){
     const TByte* newPartStrongChecksum=0;
     const size_t outPartChecksumSize=_bitsToBytes(oldSyncInfo->savedStrongChecksumBits);
     int hitOutLimit=kMatchHitOutLimit;
@@ -79,24 +79,49 @@ static bool matchRange(hpatch_TOutputCovers* out_covers,const uint32_t* range_be
     return false;
 }
 
-    inline static bool _tryCombine(hpatch_TCover& lastCover,const hpatch_TCover& cover){
-        if ((lastCover.oldPos+lastCover.length==cover.oldPos)
-          &&(lastCover.newPos+lastCover.length==cover.newPos)){
-            lastCover.length+=cover.length;
-            return true;
-        }else
+    struct TMatchedRun{ //continuous matched blocks
+        hpatch_StreamPos_t  newPos;
+        uint32_t            oldBlockIndex;
+        uint32_t            blockCount;
+    };
+    struct TMatchedRuns{
+        std::vector<TMatchedRun> runs;
+        void push(hpatch_StreamPos_t newPos,uint32_t oldBlockIndex,uint32_t kSyncBlockSize){
+            if (!runs.empty()){
+                TMatchedRun& back=runs.back();
+                if ((back.newPos+back.blockCount*(hpatch_StreamPos_t)kSyncBlockSize==newPos)
+                  &&(back.oldBlockIndex+back.blockCount==oldBlockIndex)){
+                    ++back.blockCount;
+                    return;
+                }
+            }
+            TMatchedRun run={newPos,oldBlockIndex,1};
+            runs.push_back(run);
+        }
+        inline uint32_t lastOldBlockIndex(uint32_t defaultIndex)const{
+            return runs.empty()?defaultIndex:(runs.back().oldBlockIndex+runs.back().blockCount-1); }
+        inline hpatch_StreamPos_t skipEnd(hpatch_StreamPos_t defaultPos,uint32_t kSyncBlockSize)const{
+            return runs.empty()?defaultPos:(runs.back().newPos+runs.back().blockCount*(hpatch_StreamPos_t)kSyncBlockSize); }
+        //the roll of these runs at newPos: isFree: not skipped; else if isBlockBegin, out matched oldBlockIndex
+        bool isFreeAt(hpatch_StreamPos_t newPos,uint32_t kSyncBlockSize,bool* out_isBlockBegin,uint32_t* out_oldBlockIndex)const{
+            size_t left=0;
+            size_t right=runs.size();
+            while (left<right){ //find the last run newPos<=newPos
+                size_t mid=left+(right-left)/2;
+                if (runs[mid].newPos<=newPos) left=mid+1; else right=mid;
+            }
+            *out_isBlockBegin=false;
+            if (left==0) return true;
+            const TMatchedRun& run=runs[left-1];
+            const hpatch_StreamPos_t offset=newPos-run.newPos;
+            if (offset>=run.blockCount*(hpatch_StreamPos_t)kSyncBlockSize) return true;
+            if ((offset%kSyncBlockSize)==0){
+                *out_isBlockBegin=true;
+                *out_oldBlockIndex=run.oldBlockIndex+(uint32_t)(offset/kSyncBlockSize);
+            }
             return false;
-    }
-    
-    inline static void _outACover(hpatch_TOutputCovers* out_covers,hpatch_TCover& cover,void *_mt){
-        if (cover.length>=kMinMatchedLength){
-    #if (_IS_USED_MULTITHREAD)
-            TMt* mt=(TMt*)_mt;
-            CAutoLocker _autoLocker(mt?mt->writeLocker.locker:0);
-    #endif
-            out_covers->push_cover(out_covers,&cover);
         }
-    }
+    };
 
     struct _TMatchSDatas{
         hpatch_TOutputCovers*       out_covers;
@@ -107,15 +132,17 @@ static bool matchRange(hpatch_TOutputCovers* out_covers,const uint32_t* range_be
         const uint32_t*     sorted_oldIndexs_table;
         size_t              kMatchBlockCount;
         unsigned int        kTableHashShlBit;
-        uint32_t            threadNum;
+        hpatch_StreamPos_t  clipSize;
+        TMatchedRuns*       clipRuns;
+        size_t              clipCount;
     };
 
-static void _rollMatch(_TMatchSDatas& rd,hpatch_StreamPos_t newRollBegin,
-                       hpatch_StreamPos_t newRollEnd,void* _mt=0){
+//roll new data in [newRollBegin,newRollEnd) & out matched runs; return roll end pos;
+//  if syncRuns!=0: it's a re-roll from the seam, stop at the pos where this roll is same as syncRuns's roll.
+static hpatch_StreamPos_t _rollMatch(_TMatchSDatas& rd,hpatch_StreamPos_t newRollBegin,hpatch_StreamPos_t newRollEnd,
+                                     TMatchedRuns& out_runs,uint32_t oldBlockIndex_bck=~(uint32_t)0,
+                                     const TMatchedRuns* syncRuns=0,void* _mt=0){
     const hpatch_uint32_t kSyncBlockSize=rd.oldSyncInfo->kSyncBlockSize;
-    const hpatch_StreamPos_t oldSize=rd.oldSyncInfo->newDataSize;
-    const hpatch_StreamPos_t newSize=rd.newStream->streamSize;
-    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(rd.oldSyncInfo);
     TIndex_comp0 icomp0(rd.oldSyncInfo->rollHashs,rd.oldSyncInfo->savedRollHashByteSize);
     TStreamDataRoll newData(rd.newStream,newRollBegin,newRollEnd,kSyncBlockSize,rd.oldSyncInfo->strongChecksumPlugin
                         #if (_IS_USED_MULTITHREAD)
@@ -126,9 +153,14 @@ static void _rollMatch(_TMatchSDatas& rd,hpatch_StreamPos_t newRollBegin,
     const size_t savedRollHashBits=rd.oldSyncInfo->savedRollHashBits;
     const TBloomFilter<tm_roll_uint>& filter=*(TBloomFilter<tm_roll_uint>*)rd.filter;
     tm_roll_uint digestFull_back=~newData.hashValue(); //not same digest
-    uint32_t oldBlockIndex_bck=-1;
-    hpatch_TCover cover_prev={0};
+    bool     isSyncBlockBegin=false;
+    uint32_t syncOldBlockIndex=0;
     while (true) {
+        if (syncRuns){
+            const hpatch_StreamPos_t newPos=newData.curStreamPos();
+            if (syncRuns->isFreeAt(newPos,kSyncBlockSize,&isSyncBlockBegin,&syncOldBlockIndex))
+                return newPos; //synced
+        }
         tm_roll_uint digest=newData.hashValue();
         if (digestFull_back!=digest){
             digestFull_back=digest;
@@ -143,32 +175,91 @@ static void _rollMatch(_TMatchSDatas& rd,hpatch_StreamPos_t newRollBegin,
         writeRollHashBytes(part,digest,rd.oldSyncInfo->savedRollHashByteSize);
         TIndex_comp0::TDigest digest_value(part);
         std::pair<const uint32_t*,const uint32_t*>
-        //range=std::equal_range(rd.sorted_oldIndexs,rd.sorted_oldIndexs+(kBlockCount-rd.oldSyncInfo->samePairCount),digest_value,icomp0);
         range=std::equal_range(rd.sorted_oldIndexs+ti_pos[0],
                                rd.sorted_oldIndexs+ti_pos[1],digest_value,icomp0);
         if (range.first==range.second)
             { if (newData.roll()) continue; else break; }//finish
 
-        bool isMatched=matchRange(rd.out_covers,range.first,range.second,
-                                  newData,rd.oldSyncInfo,oldBlockIndex_bck,_mt);
+        bool isMatched=matchRange(range.first,range.second,newData,rd.oldSyncInfo,oldBlockIndex_bck);
         if (isMatched){
+            const hpatch_StreamPos_t newPos=newData.curStreamPos();
+            if (isSyncBlockBegin&&(syncOldBlockIndex==oldBlockIndex_bck))
+                return newPos; //synced
+            out_runs.push(newPos,oldBlockIndex_bck,kSyncBlockSize);
+            if (newData.nextBlock()){ digestFull_back=~newData.hashValue(); continue; } else break;
+        }//else roll
+        if (newData.roll()) continue; else break;
+    }
+    return newRollEnd;
+}
+
+//every clip rolled from it's begin without the state of the prev clip's roll;
+//  re-roll from the prev clip's skipped end at the seam with it's last matched block, until synced with the clip's roll.
+static void _fixClipSeams(_TMatchSDatas& rd){
+    const hpatch_uint32_t kSyncBlockSize=rd.oldSyncInfo->kSyncBlockSize;
+    const hpatch_StreamPos_t newSize=rd.newStream->streamSize;
+    uint32_t oldBlockIndex_bck=~(uint32_t)0;
+    hpatch_StreamPos_t skipEnd=0;
+    for (size_t k=1;k<rd.clipCount;++k){
+        const TMatchedRuns& prev=rd.clipRuns[k-1];
+        TMatchedRuns& cur=rd.clipRuns[k];
+        const hpatch_StreamPos_t clipBegin=rd.clipSize*k;
+        hpatch_StreamPos_t clipEnd=clipBegin+rd.clipSize;
+        if (clipEnd>newSize) clipEnd=newSize;
+        oldBlockIndex_bck=prev.lastOldBlockIndex(oldBlockIndex_bck);
+        skipEnd=prev.skipEnd(skipEnd,kSyncBlockSize);
+        hpatch_StreamPos_t rollBegin=(skipEnd>clipBegin)?skipEnd:clipBegin;
+        if (rollBegin>=clipEnd){ //a short last clip, all skipped by the prev matched block
+            cur.runs.clear();
+            continue;
+        }
+
+        TMatchedRuns reRuns;
+        hpatch_StreamPos_t syncPos;
+        bool isBlockBegin;
+        uint32_t oldBlockIndex;
+        if (cur.isFreeAt(rollBegin,kSyncBlockSize,&isBlockBegin,&oldBlockIndex))
+            syncPos=rollBegin;
+        else
+            syncPos=_rollMatch(rd,rollBegin,clipEnd,reRuns,oldBlockIndex_bck,&cur);
+        //runs = reRuns + cur's runs from syncPos; if not synced, all runs are reRuns
+        for (size_t i=0;(syncPos<clipEnd)&&(i<cur.runs.size());++i){
+            TMatchedRun run=cur.runs[i];
+            const hpatch_StreamPos_t runEnd=run.newPos+run.blockCount*(hpatch_StreamPos_t)kSyncBlockSize;
+            if (runEnd<=syncPos) continue;
+            if (run.newPos<syncPos){ //split at synced block
+                const uint32_t skipCount=(uint32_t)((syncPos-run.newPos)/kSyncBlockSize);
+                assert(run.newPos+skipCount*(hpatch_StreamPos_t)kSyncBlockSize==syncPos);
+                run.newPos=syncPos;
+                run.oldBlockIndex+=skipCount;
+                run.blockCount-=skipCount;
+            }
+            reRuns.runs.push_back(run);
+        }
+        cur.runs.swap(reRuns.runs);
+    }
+}
+
+static void _outCovers(_TMatchSDatas& rd){
+    const hpatch_uint32_t kSyncBlockSize=rd.oldSyncInfo->kSyncBlockSize;
+    const hpatch_StreamPos_t oldSize=rd.oldSyncInfo->newDataSize;
+    const hpatch_StreamPos_t newSize=rd.newStream->streamSize;
+    for (size_t k=0;k<rd.clipCount;++k){
+        const TMatchedRuns& clip=rd.clipRuns[k];
+        for (size_t i=0;i<clip.runs.size();++i){
+            const TMatchedRun& run=clip.runs[i];
             hpatch_TCover cover;
-            cover.oldPos=oldBlockIndex_bck*(hpatch_StreamPos_t)kSyncBlockSize;
-            cover.newPos=newData.curStreamPos();
-            cover.length=kSyncBlockSize;
+            cover.oldPos=run.oldBlockIndex*(hpatch_StreamPos_t)kSyncBlockSize;
+            cover.newPos=run.newPos;
+            cover.length=run.blockCount*(hpatch_StreamPos_t)kSyncBlockSize;
             assert(cover.oldPos<oldSize);
             assert(cover.newPos<newSize);
             if (cover.oldPos+cover.length>oldSize) cover.length=oldSize-cover.oldPos;
             if (cover.newPos+cover.length>newSize) cover.length=newSize-cover.newPos;
-            if (!_tryCombine(cover_prev,cover)){
-                _outACover(rd.out_covers,cover_prev,_mt);
-                cover_prev=cover;
-            }
-            if (newData.nextBlock()){ digestFull_back=~newData.hashValue(); continue; } else break;
-        }//else roll
-        if (newData.roll()) continue; else break;
+            if (cover.length>=kMinMatchedLength)
+                rd.out_covers->push_cover(rd.out_covers,&cover);
+        }
     }
-    _outACover(rd.out_covers,cover_prev,_mt);
 }
 
 
@@ -177,24 +268,17 @@ static void _rollMatch_mt(int threadIndex,void* workData){
     TMt& mt=*(TMt*)workData;
     TMtByChannel::TAutoThreadEnd __auto_thread_end(mt);
 
-    hpatch_StreamPos_t clipSize=kBestMTClipSize;
-    hpatch_StreamPos_t _minClipSize=(hpatch_StreamPos_t)(mt.matchDatas.oldSyncInfo->kSyncBlockSize)*4;
-    if (clipSize<_minClipSize) clipSize=_minClipSize;
-    uint32_t threadNum=mt.matchDatas.threadNum;
-    hpatch_StreamPos_t newSize=mt.matchDatas.newStream->streamSize;
-    hpatch_StreamPos_t _maxClipSize=(newSize+threadNum-1)/threadNum;
-    if (clipSize>_maxClipSize) clipSize=_maxClipSize;
-    size_t workCount=(size_t)((newSize+clipSize-1)/clipSize);
-    assert(workCount*clipSize>=newSize);
+    _TMatchSDatas& rd=mt.matchDatas;
+    hpatch_StreamPos_t newSize=rd.newStream->streamSize;
     try{
         std::atomic<size_t>& workIndex=*(std::atomic<size_t>*)&mt.workIndex;
         while (true){
             size_t curWorkIndex=workIndex++;
-            if (curWorkIndex>=workCount) break;
-            hpatch_StreamPos_t newPosBegin=curWorkIndex*clipSize;
-            hpatch_StreamPos_t newPosEnd = newPosBegin+clipSize;
+            if (curWorkIndex>=rd.clipCount) break;
+            hpatch_StreamPos_t newPosBegin=curWorkIndex*rd.clipSize;
+            hpatch_StreamPos_t newPosEnd = newPosBegin+rd.clipSize;
             if (newPosEnd>newSize) newPosEnd=newSize;
-            _rollMatch(mt.matchDatas,newPosBegin,newPosEnd,&mt);
+            _rollMatch(rd,newPosBegin,newPosEnd,rd.clipRuns[curWorkIndex],~(uint32_t)0,0,&mt);
         }
     }catch(...){
         mt.on_error();
@@ -223,20 +307,35 @@ static void _matchNewDataInOldSign(_TMatchSDatas& matchDatas,int threadNum){
     matchDatas.sorted_oldIndexs=sorted_oldIndexs;
     matchDatas.sorted_oldIndexs_table=sorted_oldIndexs_table;
     matchDatas.kTableHashShlBit=kTableHashShlBit;
+    matchDatas.clipSize=newDataSize;
 #if (_IS_USED_MULTITHREAD)
-    const hpatch_StreamPos_t _bestWorkCount=matchDatas.newStream->streamSize/kBestMTClipSize;
-    threadNum=(_bestWorkCount<=threadNum)?(int)_bestWorkCount:threadNum;
+    const hpatch_StreamPos_t _bestWorkCount=newDataSize/kBestMTClipSize;
+    threadNum=(_bestWorkCount<=(hpatch_StreamPos_t)threadNum)?(int)_bestWorkCount:threadNum;
     if (threadNum>1){
-        matchDatas.threadNum=threadNum;
+        hpatch_StreamPos_t clipSize=kBestMTClipSize;
+        hpatch_StreamPos_t _minClipSize=(hpatch_StreamPos_t)(oldSyncInfo->kSyncBlockSize)*4;
+        if (clipSize<_minClipSize) clipSize=_minClipSize;
+        hpatch_StreamPos_t _maxClipSize=(newDataSize+threadNum-1)/threadNum;
+        if (clipSize>_maxClipSize) clipSize=_maxClipSize;
+        matchDatas.clipSize=clipSize;
+    }
+#endif
+    std::vector<TMatchedRuns> clipRuns((size_t)((newDataSize+matchDatas.clipSize-1)/matchDatas.clipSize));
+    matchDatas.clipRuns=clipRuns.data();
+    matchDatas.clipCount=clipRuns.size();
+#if (_IS_USED_MULTITHREAD)
+    if (matchDatas.clipCount>1){
         TMt mt(matchDatas);
         checkv(mt.start_threads(threadNum,_rollMatch_mt,&mt,true));
         mt.wait_all_thread_end();
         checkv(!mt.is_on_error());
+        _fixClipSeams(matchDatas);
     }else
 #endif
     {
-        _rollMatch(matchDatas,0,matchDatas.newStream->streamSize);
+        _rollMatch(matchDatas,0,newDataSize,clipRuns[0]);
     }
+    _outCovers(matchDatas);
     matchDatas.out_covers->collate_covers(matchDatas.out_covers);
 }
 
@@ -36,6 +36,8 @@
 //  oldSyncInfo: oldData's hsyni_file, is created by hsign_diff cmdline; oldData can't dir, can't compressed 
 //  out_diff: output diff stream for hpatchz, i.e newData=hpatchz(oldData,out_diff); or call patch_single_stream() or patch_single_compressed_diff()
 //  compressPlugin: for compress diff data, if null, not compress
+//  threadNum: match new data by parallel clips; compressPlugin's thread number is not changed,
+//    caller can set it by compressPlugin->setParallelThreadNumber() before call
 //  throw std::runtime_error when I/O error,etc.
 void create_hdiff_by_sign(const hpatch_TStreamInput* newData,const TOldDataSyncInfo* oldSyncInfo,
                           const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin=0,
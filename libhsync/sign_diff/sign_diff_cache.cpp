@@ -0,0 +1,228 @@
+//sign_diff_cache.cpp
+//sign_diff
+//Created by housisong on 2026-10-19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2025-2026 HouSisong
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "sign_diff_cache.h"
+#include <stdexcept>
+#include <string.h> //memset strlen
+#include <assert.h>
+#include "../../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../../libParallel/parallel_channel.h"
+using namespace hdiff_private;
+
+#define check(value,info) { if (!(value)) { throw std::runtime_error(info); } }
+#define checkv(value)     check(value,"check "#value" error!")
+
+enum{ kEntry_creating=0, kEntry_created, kEntry_createFail };
+
+#if (_IS_USED_MULTITHREAD)
+#   define _cacheLocker(self)   CAutoLocker _locker((HLocker)(self)->m_locker)
+#   define _cacheWait(self)     condvar_wait_at((HCondvar)(self)->m_condvar,(HLocker)(self)->m_locker)
+#   define _cacheNotify(self)   condvar_broadcast((HCondvar)(self)->m_condvar)
+#else
+#   define _cacheLocker(self)
+#   define _cacheWait(self)     check(false,"TSignDiffCache wait error!") //no other thread can creating
+#   define _cacheNotify(self)
+#endif
+
+static void _pushKey(std::string& key,const void* data,size_t size){
+    key.append((const char*)data,size);
+}
+static void _pushKey(std::string& key,hpatch_StreamPos_t v){
+    unsigned char buf[8];
+    for (size_t i=0;i<sizeof(buf);++i,v>>=8)
+        buf[i]=(unsigned char)v;
+    _pushKey(key,buf,sizeof(buf));
+}
+static void _pushKey(std::string& key,const char* cstr){
+    if (cstr==0) cstr="";
+    _pushKey(key,cstr,strlen(cstr)+1);
+}
+
+static std::string _getCacheKey(const unsigned char* newDataKey,size_t newDataKeySize,const TOldDataSyncInfo* oldSyncInfo,
+                                const hdiff_TCompress* compressPlugin,const char* compressSets,size_t patchStepMemSize){
+    checkv(oldSyncInfo->strongChecksumPlugin!=0);
+    const size_t checksumByteSize=oldSyncInfo->strongChecksumPlugin->checksumByteSize();
+    std::string key;
+    _pushKey(key,oldSyncInfo->strongChecksumType);
+    _pushKey(key,oldSyncInfo->infoChecksum,checksumByteSize);
+    _pushKey(key,oldSyncInfo->infoPartHashChecksum,checksumByteSize);
+    _pushKey(key,compressPlugin?compressPlugin->compressType():"");
+    _pushKey(key,compressSets);
+    _pushKey(key,(hpatch_StreamPos_t)patchStepMemSize);
+    _pushKey(key,(hpatch_StreamPos_t)newDataKeySize);
+    _pushKey(key,newDataKey,newDataKeySize);
+    return key;
+}
+
+TSignDiffCache::TSignDiffCache(size_t cacheMaxSize)
+:m_cacheMaxSize(cacheMaxSize),m_locker(0),m_condvar(0){
+    memset(&m_statistics,0,sizeof(m_statistics));
+#if (_IS_USED_MULTITHREAD)
+    m_locker=locker_new();
+    try{
+        m_condvar=condvar_new();
+    }catch(...){
+        locker_delete((HLocker)m_locker);
+        throw;
+    }
+#endif
+}
+
+TSignDiffCache::~TSignDiffCache(){
+    clear();
+    assert(m_entrys.empty()); //all requests must be returned
+#if (_IS_USED_MULTITHREAD)
+    condvar_delete((HCondvar)m_condvar);
+    locker_delete((HLocker)m_locker);
+#endif
+}
+
+void TSignDiffCache::getStatistics(TStatistics* out_statistics){
+    _cacheLocker(this);
+    *out_statistics=m_statistics;
+}
+
+void TSignDiffCache::clear(){
+    _cacheLocker(this);
+    while (!m_lru.empty())
+        _evict(m_lru.back());
+}
+
+//remove from cache, the entry is deleted when no one used it
+void TSignDiffCache::_evict(TEntry* entry){
+    assert(entry->isInCache);
+    m_lru.erase(entry->lruIt);
+    m_entrys.erase(entry->key);
+    entry->isInCache=false;
+    m_statistics.cachedSize-=entry->diff.size();
+    --m_statistics.cachedCount;
+    ++m_statistics.evictCount;
+    if (entry->refCount==0)
+        delete entry;
+}
+
+void TSignDiffCache::_limitCacheSize(){
+    while (m_statistics.cachedSize>m_cacheMaxSize){
+        assert(!m_lru.empty());
+        _evict(m_lru.back());
+    }
+}
+
+//return a created entry, or a new creating entry (*out_isCreator=true);
+TSignDiffCache::TEntry* TSignDiffCache::_acquire(const std::string& key,bool* out_isCreator){
+    _cacheLocker(this);
+    while (true){
+        TEntryMap::iterator it=m_entrys.find(key);
+        if (it==m_entrys.end()){
+            TEntry* entry=new TEntry();
+            entry->key=key;
+            entry->refCount=1;
+            entry->state=kEntry_creating;
+            entry->isInCache=false;
+            m_entrys[key]=entry;
+            ++m_statistics.createCount;
+            *out_isCreator=true;
+            return entry;
+        }
+        TEntry* entry=it->second;
+        ++entry->refCount;
+        if (entry->state==kEntry_creating){
+            ++m_statistics.waitCount;
+            do {
+                _cacheWait(this);
+            } while (entry->state==kEntry_creating);
+        }else{
+            assert(entry->isInCache);
+            m_lru.splice(m_lru.begin(),m_lru,entry->lruIt);
+            ++m_statistics.hitCount;
+        }
+        if (entry->state==kEntry_created){
+            *out_isCreator=false;
+            return entry;
+        }
+        //creator failed, retry by this thread
+        --entry->refCount;
+        if (entry->refCount==0)
+            delete entry;
+    }
+}
+
+void TSignDiffCache::_setCreated(TEntry* entry,bool isCreateOk){
+    _cacheLocker(this);
+    assert(entry->state==kEntry_creating);
+    entry->state=isCreateOk?kEntry_created:kEntry_createFail;
+    m_entrys.erase(entry->key);
+    if (isCreateOk&&(entry->diff.size()<=m_cacheMaxSize)){
+        m_entrys[entry->key]=entry;
+        entry->lruIt=m_lru.insert(m_lru.begin(),entry);
+        entry->isInCache=true;
+        m_statistics.cachedSize+=entry->diff.size();
+        ++m_statistics.cachedCount;
+        _limitCacheSize();
+    }
+    _cacheNotify(this);
+}
+
+void TSignDiffCache::_release(TEntry* entry){
+    _cacheLocker(this);
+    assert(entry->refCount>0);
+    --entry->refCount;
+    if ((entry->refCount==0)&&(!entry->isInCache))
+        delete entry;
+}
+
+bool TSignDiffCache::get_hdiff_by_sign(const unsigned char* newDataKey,size_t newDataKeySize,
+                                       const hpatch_TStreamInput* newData,const TOldDataSyncInfo* oldSyncInfo,
+                                       const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin,
+                                       const char* compressSets,size_t patchStepMemSize,size_t threadNum){
+    const std::string key=_getCacheKey(newDataKey,newDataKeySize,oldSyncInfo,compressPlugin,compressSets,patchStepMemSize);
+    bool isCreator=false;
+    TEntry* entry=_acquire(key,&isCreator);
+    if (isCreator){
+        try{
+            TVectorAsStreamOutput diffStream(entry->diff);
+            create_hdiff_by_sign(newData,oldSyncInfo,&diffStream,compressPlugin,patchStepMemSize,threadNum);
+        }catch(...){
+            entry->diff.clear();
+            _setCreated(entry,false);
+            _release(entry);
+            throw;
+        }
+        _setCreated(entry,true);
+    }
+    //entry->diff is read only now, output it without lock
+    try{
+        const unsigned char* diff=entry->diff.data();
+        checkv(out_diff->write(out_diff,0,diff,diff+entry->diff.size()));
+    }catch(...){
+        _release(entry);
+        throw;
+    }
+    _release(entry);
+    return !isCreator;
+}
@@ -0,0 +1,100 @@
+//sign_diff_cache.h
+//sign_diff
+//Created by housisong on 2026-10-19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2025-2026 HouSisong
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef hsign_diff_cache_h
+#define hsign_diff_cache_h
+#include "sign_diff.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+static const size_t kDefaultSignDiffCacheSize = 256*(1<<20);
+
+//cache diff datas created by create_hdiff_by_sign(), for a server answer many clients with same old .hsyni;
+//  cache key: old .hsyni's infoChecksum & infoPartHashChecksum + newDataKey + compressType + compressSets
+//    + patchStepMemSize;
+//  cached diffs are LRU evicted when sum of their size > cacheMaxSize;
+//  concurrent identical requests only create the diff once (single-flight), others wait & share it.
+//  all functions are thread safe when _IS_USED_MULTITHREAD;
+class TSignDiffCache{
+public:
+    struct TStatistics{
+        hpatch_StreamPos_t  hitCount;    // found a created diff in cache
+        hpatch_StreamPos_t  waitCount;   // waited for a same request's creating
+        hpatch_StreamPos_t  createCount; // called create_hdiff_by_sign()
+        hpatch_StreamPos_t  evictCount;
+        size_t              cachedSize;
+        size_t              cachedCount;
+    };
+    explicit TSignDiffCache(size_t cacheMaxSize=kDefaultSignDiffCacheSize);
+    ~TSignDiffCache();
+    //same as create_hdiff_by_sign(), but out_diff by cached data if have;
+    //  newDataKey: identity of newData (eg. new version's checksum); same key must be same newData;
+    //  compressSets: compressPlugin's setting (like "zstd-20-23" for level & dictBits), can null;
+    //    compressPlugin only give compressType, so different compress level or dict must give different compressSets;
+    //  threadNum: for match new data by parallel clips; compressPlugin is shared by concurrent requests,
+    //    so its parallel thread number is not changed here, caller can set it once before requests;
+    //  return true if out_diff by cached data (not call create_hdiff_by_sign());
+    //  throw std::runtime_error when I/O error,etc.
+    bool get_hdiff_by_sign(const unsigned char* newDataKey,size_t newDataKeySize,
+                           const hpatch_TStreamInput* newData,const TOldDataSyncInfo* oldSyncInfo,
+                           const hpatch_TStreamOutput* out_diff,const hdiff_TCompress* compressPlugin=0,
+                           const char* compressSets=0,size_t patchStepMemSize=kDefaultPatchStepMemSize,
+                           size_t threadNum=1);
+    void getStatistics(TStatistics* out_statistics);
+    void clear(); //remove all cached diffs, not break creating or outputting diffs
+private:
+    struct TEntry;
+    typedef std::list<TEntry*>                      TLru;
+    typedef std::unordered_map<std::string,TEntry*> TEntryMap;
+    struct TEntry{
+        std::string                 key;
+        std::vector<unsigned char>  diff;
+        size_t                      refCount;
+        int                         state;
+        bool                        isInCache;
+        TLru::iterator              lruIt;
+    };
+    const size_t    m_cacheMaxSize;
+    TEntryMap       m_entrys; // cached & creating entrys
+    TLru            m_lru;    // cached entrys, front is most recently used
+    TStatistics     m_statistics;
+    void*           m_locker;
+    void*           m_condvar;
+    TEntry* _acquire(const std::string& key,bool* out_isCreator);
+    void    _setCreated(TEntry* entry,bool isCreateOk);
+    void    _release(TEntry* entry);
+    void    _evict(TEntry* entry);
+    void    _limitCacheSize();
+    TSignDiffCache(const TSignDiffCache&); //no copy
+    TSignDiffCache& operator=(const TSignDiffCache&);
+};
+
+#endif
@@ -0,0 +1,95 @@
+//  cdc_chunker.h
+//  sync_client
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef cdc_chunker_h
+#define cdc_chunker_h
+#include "sync_client_type.h"
+namespace sync_private{
+
+//content-defined chunking (FastCDC: gear hash + normalized chunking) for hsync's variable size blocks;
+//  chunk size in [avg/4,avg*4]; a cut point only depends on the data after the prev cut point,
+//  so an insert or delete in data only changes the chunks near it.
+//  NOTE: maker & client must cut by same algorithm & avgBlockSize, don't change it.
+
+hpatch_inline static
+uint32_t cdcMinBlockSize(uint32_t cdcAvgBlockSize){ return cdcAvgBlockSize>>2; }
+hpatch_inline static
+uint32_t cdcMaxBlockSize(uint32_t cdcAvgBlockSize){ return cdcAvgBlockSize<<2; }
+hpatch_inline static
+bool cdcIsValidAvgBlockSize(uint32_t cdcAvgBlockSize){
+    return (cdcAvgBlockSize>=_kSyncBlockSize_min_limit)&&(cdcAvgBlockSize<=((uint32_t)1<<28))
+            &&(0==(cdcAvgBlockSize&(cdcAvgBlockSize-1))); }
+
+class TCdcChunker{
+public:
+    explicit TCdcChunker(uint32_t cdcAvgBlockSize)
+    :kMinSize(cdcMinBlockSize(cdcAvgBlockSize)),kAvgSize(cdcAvgBlockSize),
+     kMaxSize(cdcMaxBlockSize(cdcAvgBlockSize)){
+        unsigned int bits=0;
+        while (((uint32_t)1<<bits)<cdcAvgBlockSize) ++bits;
+        //normalized chunking: harder to cut before avg size, easier after it
+        m_maskS=(~(uint64_t)0)<<(64-(bits+2));
+        m_maskL=(~(uint64_t)0)<<(64-(bits-2));
+        uint64_t seed=0x9E3779B97F4A7C15ull; //splitmix64
+        for (size_t i=0;i<256;++i){
+            uint64_t z=(seed+=0x9E3779B97F4A7C15ull);
+            z=(z^(z>>30))*0xBF58476D1CE4E5B9ull;
+            z=(z^(z>>27))*0x94D049BB133111EBull;
+            m_gear[i]=z^(z>>31);
+        }
+    }
+    inline uint32_t maxBlockSize()const{ return kMaxSize; }
+    //return size of the chunk at the begin of data;
+    //  dataSize must >= maxBlockSize(), except at the end of data.
+    inline size_t cut(const unsigned char* data,size_t dataSize)const{
+        if (dataSize<=kMinSize) return dataSize;
+        const size_t end=(dataSize<kMaxSize)?dataSize:kMaxSize;
+        const size_t normal=(end<kAvgSize)?end:kAvgSize;
+        uint64_t h=0;
+        size_t i=kMinSize;
+        for (;i<normal;++i){
+            h=(h<<1)+m_gear[data[i]];
+            if (0==(h&m_maskS)) return i+1;
+        }
+        for (;i<end;++i){
+            h=(h<<1)+m_gear[data[i]];
+            if (0==(h&m_maskL)) return i+1;
+        }
+        return end;
+    }
+private:
+    const size_t kMinSize;
+    const size_t kAvgSize;
+    const size_t kMaxSize;
+    uint64_t     m_maskS;
+    uint64_t     m_maskL;
+    uint64_t     m_gear[256];
+};
+
+} //namespace sync_private
+#endif // cdc_chunker_h
@@ -29,6 +29,7 @@
 #include "match_in_old.h"
 #include "match_in_types.h"
 #include "sync_client_private.h"
+#include "cdc_chunker.h"
 namespace sync_private{
 
     #define check(value,info) { if (!(value)) { throw std::runtime_error(info); } }
@@ -156,8 +157,32 @@ static inline uint32_t _indexMapFrom(hpatch_StreamPos_t pos){
 
 typedef volatile hpatch_StreamPos_t volStreamPos_t;
 
-bool _matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* range_begin,const uint32_t* range_end,
-                 TStreamDataCache_base& oldData,const TNewDataSyncInfo* newSyncInfo,hpatch_StreamPos_t kMinRevSameIndex,void* _mt){
+//publish matched oldPos to the first block of a same blocks chain;
+//  only one thread can win the block, other same blocks in the chain are set by _resolveSameBlocks() after roll;
+static inline bool _publishMatched(volStreamPos_t* pNewBlockDataInOldPos,hpatch_StreamPos_t newBlockOldPosBack,
+                                   hpatch_StreamPos_t curPos,hpatch_StreamPos_t kMinRevSameIndex,void* _mt){
+#if (_IS_USED_MULTITHREAD)
+    TMt* mt=(TMt*)_mt;
+    if (mt){
+    #if ((_IS_USED_CPP_ATOMIC) && (!_IS_NO_ATOMIC_U64))
+        std::atomic<hpatch_StreamPos_t>& pos=*(std::atomic<hpatch_StreamPos_t>*)pNewBlockDataInOldPos;
+        return pos.compare_exchange_strong(newBlockOldPosBack,curPos);
+    #else
+        CAutoLocker _autoLocker(mt->writeLocker.locker);
+        if ((*pNewBlockDataInOldPos)<kMinRevSameIndex) return false; // other thread done
+        (*pNewBlockDataInOldPos)=curPos;
+        return true;
+    #endif
+    }
+#endif
+    (*pNewBlockDataInOldPos)=curPos;
+    return true;
+}
+
+template<class TOldData_t> static
+bool _tm_matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* range_begin,const uint32_t* range_end,
+                    TOldData_t& oldData,const TNewDataSyncInfo* newSyncInfo,hpatch_StreamPos_t kMinRevSameIndex,
+                    unsigned char* checkChecksumBuf,void* _mt){
     const TByte* oldPartStrongChecksum=0;
     const size_t savedStrongChecksumByteSize=newSyncInfo->savedStrongChecksumByteSize;
     bool isMatched=false;
@@ -166,38 +191,24 @@ bool _matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* r
         size_t newBlockIndex=*range_begin;
         volStreamPos_t* pNewBlockDataInOldPos=&out_newBlockDataInOldPoss[newBlockIndex];
         hpatch_StreamPos_t newBlockOldPosBack=*pNewBlockDataInOldPos;   
-        if (newBlockOldPosBack>=kMinRevSameIndex){
+        if ((newBlockOldPosBack>=kMinRevSameIndex)&&oldData.isBlockSizeMatched(newSyncInfo,newBlockIndex)){
             if (oldPartStrongChecksum==0)
                 oldPartStrongChecksum=oldData.calcPartStrongChecksum(newSyncInfo->savedStrongChecksumBits);
             const TByte* newPairStrongChecksum=newSyncInfo->partChecksums+newBlockIndex*savedStrongChecksumByteSize;
             if (0==memcmp(oldPartStrongChecksum,newPairStrongChecksum,savedStrongChecksumByteSize)){
                 isMatched=true;
-                hpatch_StreamPos_t curPos=oldData.curStreamPos();
-                {
-#if (_IS_USED_MULTITHREAD)
-                    TMt* mt=(TMt*)_mt;
-                    CAutoLocker _autoLocker(mt?mt->writeLocker.locker:0);
-                    newBlockOldPosBack=*pNewBlockDataInOldPos;
-                    if (newBlockOldPosBack<kMinRevSameIndex){// other thread done
-                        if ((--hitOutLimit)<=0) break;
-                    }else
-#endif
-                    {
-                        while(true){ //hit
-                            (*pNewBlockDataInOldPos)=curPos;
-                            if (!newSyncInfo->isNotCChecksumNewMTParallel) //note: checkChecksumAppendData() is only for hsynz
-                                checkChecksumAppendData(newSyncInfo->savedNewDataCheckChecksum,(uint32_t)newBlockIndex,
-                                                        oldData.strongChecksumPlugin(),oldData.checkChecksum(),
-                                                        oldData.strongChecksum(),0,0);
-                            if (isNeedSyncByOldPos(newBlockOldPosBack))
-                                break;
-                            //next same block
-                            newBlockIndex=_indexMapFrom(newBlockOldPosBack);
-                            //assert(newBlockIndex<kBlockCount);
-                            pNewBlockDataInOldPos=&out_newBlockDataInOldPoss[newBlockIndex];
-                            newBlockOldPosBack=*pNewBlockDataInOldPos;
-                        }
-                        //continue;
+                if (!_publishMatched(pNewBlockDataInOldPos,newBlockOldPosBack,oldData.curStreamPos(),kMinRevSameIndex,_mt)){
+                    if ((--hitOutLimit)<=0) break; // other thread done
+                }else if (checkChecksumBuf){ //note: checkChecksumAppendData() is only for hsynz
+                    while(true){ //hit; the chain after first block is not changed when roll
+                        checkChecksumAppendData(checkChecksumBuf,(uint32_t)newBlockIndex,
+                                                oldData.strongChecksumPlugin(),oldData.checkChecksum(),
+                                                oldData.strongChecksum(),0,0);
+                        if (isNeedSyncByOldPos(newBlockOldPosBack))
+                            break;
+                        //next same block
+                        newBlockIndex=_indexMapFrom(newBlockOldPosBack);
+                        newBlockOldPosBack=out_newBlockDataInOldPoss[newBlockIndex];
                     }
                 }
             }else{
@@ -210,6 +221,24 @@ bool _matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* r
     return isMatched;
 }
 
+bool _matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* range_begin,const uint32_t* range_end,
+                 TStreamDataCache_base& oldData,const TNewDataSyncInfo* newSyncInfo,hpatch_StreamPos_t kMinRevSameIndex,
+                 unsigned char* checkChecksumBuf,void* _mt){
+    return _tm_matchRange(out_newBlockDataInOldPoss,range_begin,range_end,oldData,newSyncInfo,
+                          kMinRevSameIndex,checkChecksumBuf,_mt);
+}
+
+//set matched oldPos to all same blocks; samePairList is sorted by curIndex, sameIndex<curIndex
+static void _resolveSameBlocks(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const TNewDataSyncInfo* newSyncInfo,
+                               hpatch_StreamPos_t kMinRevSameIndex){
+    for (uint32_t i=0;i<newSyncInfo->samePairCount;++i){
+        const TSameNewBlockPair& pair=newSyncInfo->samePairList[i];
+        hpatch_StreamPos_t pos=out_newBlockDataInOldPoss[pair.sameIndex];
+        if (pos<kMinRevSameIndex)
+            out_newBlockDataInOldPoss[pair.curIndex]=pos;
+    }
+}
+
 #if (_IS_USED_MULTITHREAD)
 void _rollMatch_mt(int threadIndex,void* workData){
     TMt& mt=*(TMt*)workData;
@@ -298,6 +327,7 @@ void _matchNewDataInOld(_TMatchDatas& matchDatas,int threadNum){
     {
         matchDatas.rollMatch(matchDatas,0,oldDataSize,0);
     }
+    _resolveSameBlocks(out_newBlockDataInOldPoss,newSyncInfo,kBlockType_needSync-1-kBlockCount);
 
     _end_newBlockDataInOldPoss(out_newBlockDataInOldPoss,kBlockCount,oldDataSize);
 }
@@ -307,6 +337,166 @@ static void _rollMatch(_TMatchDatas& rd,hpatch_StreamPos_t oldRollBegin,hpatch_S
             (rd,oldRollBegin,oldRollEnd,toSavedPartRollHash,_mt);
 }
 
+    //a chunk of oldData cut by cdc, matched to new blocks by _tm_matchRange()
+    struct TCdcChunkData{
+        explicit TCdcChunkData(hpatch_TChecksum* strongChecksumPlugin)
+        :chunk(0),chunkSize(0),chunkPos(0),m_strongChecksumPlugin(strongChecksumPlugin),
+        m_checksumHandle(0),m_checkChecksum(0){
+            m_checksumByteSize=strongChecksumPlugin->checksumByteSize();
+            m_strongChecksum_buf.realloc(m_checksumByteSize*2);
+            m_checksumHandle=strongChecksumPlugin->open(strongChecksumPlugin);
+            checkv(m_checksumHandle!=0);
+            m_checkChecksum=strongChecksumPlugin->open(strongChecksumPlugin);
+            checkv(m_checkChecksum!=0);
+        }
+        ~TCdcChunkData(){
+            if (m_checksumHandle) m_strongChecksumPlugin->close(m_strongChecksumPlugin,m_checksumHandle);
+            if (m_checkChecksum) m_strongChecksumPlugin->close(m_strongChecksumPlugin,m_checkChecksum);
+        }
+        const TByte*        chunk;
+        size_t              chunkSize;
+        hpatch_StreamPos_t  chunkPos;
+        inline bool isBlockSizeMatched(const TNewDataSyncInfo* newSyncInfo,size_t newBlockIndex)const{
+            return chunkSize==TNewDataSyncInfo_newDataBlockSize(newSyncInfo,(uint32_t)newBlockIndex); }
+        const TByte* calcPartStrongChecksum(size_t outPartBits){
+            TByte* strongChecksum=m_strongChecksum_buf.data()+m_checksumByteSize;
+            m_strongChecksumPlugin->begin(m_checksumHandle);
+            m_strongChecksumPlugin->append(m_checksumHandle,chunk,chunk+chunkSize);
+            m_strongChecksumPlugin->end(m_checksumHandle,strongChecksum,strongChecksum+m_checksumByteSize);
+            toPartChecksum(m_strongChecksum_buf.data(),outPartBits,strongChecksum,m_checksumByteSize);
+            return m_strongChecksum_buf.data();
+        }
+        inline const TByte* strongChecksum()const{ return m_strongChecksum_buf.data()+m_checksumByteSize; }
+        inline hpatch_TChecksum* strongChecksumPlugin()const{ return m_strongChecksumPlugin; }
+        inline hpatch_checksumHandle checkChecksum()const{ return m_checkChecksum; }
+        inline hpatch_StreamPos_t curStreamPos()const{ return chunkPos; }
+    private:
+        hpatch_TChecksum*       m_strongChecksumPlugin;
+        hpatch_checksumHandle   m_checksumHandle;
+        hpatch_checksumHandle   m_checkChecksum;
+        size_t                  m_checksumByteSize;
+        TAutoMem                m_strongChecksum_buf;
+    };
+
+    //read oldData for cdc cut; keep data from keepPos, & can read one max chunk at pos
+    struct TCdcOldReader{
+        TCdcOldReader(const hpatch_TStreamInput* oldStream,size_t kMaxSize,void* _mt)
+        :m_oldStream(oldStream),m_kMaxSize(kMaxSize),m_mem(kBestReadSize+kMaxSize*2),m_bufPos(0),m_bufLen(0)
+    #if (_IS_USED_MULTITHREAD)
+        ,m_readLocker(_mt?((TMt*)_mt)->readLocker.locker:0)
+    #endif
+        {}
+        //return data at pos, dataSize=min(kMaxSize,streamSize-pos); keepPos<=pos && pos-keepPos<=kMaxSize
+        const TByte* data(hpatch_StreamPos_t pos,hpatch_StreamPos_t keepPos,size_t* out_dataSize){
+            assert((m_bufPos<=keepPos)&&(keepPos<=pos)&&(pos-keepPos<=m_kMaxSize));
+            hpatch_StreamPos_t needEnd=pos+m_kMaxSize;
+            if (needEnd>m_oldStream->streamSize) needEnd=m_oldStream->streamSize;
+            if (needEnd>m_bufPos+m_bufLen){ //read more data
+                if (keepPos<m_bufPos+m_bufLen){
+                    const size_t keepLen=(size_t)(m_bufPos+m_bufLen-keepPos);
+                    memmove(m_mem.data(),m_mem.data()+(size_t)(keepPos-m_bufPos),keepLen);
+                    m_bufLen=keepLen;
+                }else{
+                    m_bufLen=0;
+                }
+                m_bufPos=keepPos;
+                size_t readLen=m_mem.size()-m_bufLen;
+                const hpatch_StreamPos_t readPos=m_bufPos+m_bufLen;
+                if (readLen>m_oldStream->streamSize-readPos) readLen=(size_t)(m_oldStream->streamSize-readPos);
+                {
+                #if (_IS_USED_MULTITHREAD)
+                    CAutoLocker _autoLocker(m_readLocker);
+                #endif
+                    TByte* buf=m_mem.data()+m_bufLen;
+                    checkv(m_oldStream->read(m_oldStream,readPos,buf,buf+readLen));
+                }
+                m_bufLen+=readLen;
+            }
+            *out_dataSize=(size_t)(needEnd-pos);
+            return m_mem.data()+(size_t)(pos-m_bufPos);
+        }
+    private:
+        const hpatch_TStreamInput*  m_oldStream;
+        const size_t                m_kMaxSize;
+        TAutoMem                    m_mem;
+        hpatch_StreamPos_t          m_bufPos;
+        size_t                      m_bufLen;
+    #if (_IS_USED_MULTITHREAD)
+        HLocker                     m_readLocker;
+    #endif
+    };
+
+//cdc blocks: cut oldData into chunks by the same chunker as newData, & only match new blocks at these chunks;
+//  a cut point depends on the prev cut point, so a thread's clip [oldRollBegin,oldRollEnd) starts cut at oldRollBegin,
+//  and after oldRollEnd, continue cut until the cut point same as the next clip's cut points (started at oldRollEnd);
+//  cut points of the two chains meet soon, then all chunks of the sequential cut are matched.
+static void _cdcMatch(_TMatchDatas& rd,hpatch_StreamPos_t oldRollBegin,hpatch_StreamPos_t oldRollEnd,void* _mt){
+    const TNewDataSyncInfo* newSyncInfo=rd.newSyncInfo;
+    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(newSyncInfo);
+    const hpatch_StreamPos_t kMinRevSameIndex=kBlockType_needSync-1-kBlockCount;
+    const size_t savedRollHashByteSize=newSyncInfo->savedRollHashByteSize;
+    const size_t savedRollHashBits=newSyncInfo->savedRollHashBits;
+    const TBloomFilter<tm_roll_uint>& filter=*(const TBloomFilter<tm_roll_uint>*)rd.filter;
+    const hpatch_StreamPos_t oldSize=rd.oldStream->streamSize;
+    TIndex_comp0 icomp0(newSyncInfo->rollHashs,savedRollHashByteSize);
+    uint8_t part[sizeof(tm_roll_uint)]={0};
+    const TCdcChunker chunker(newSyncInfo->cdcAvgBlockSize);
+    TCdcChunkData oldData(newSyncInfo->strongChecksumPlugin);
+    TCdcOldReader reader(rd.oldStream,chunker.maxBlockSize(),_mt);
+    unsigned char* checkChecksumBuf=0; //note: checkChecksum is only for hsynz
+    TAutoMem _mem_checkChecksum;
+    if (!newSyncInfo->isNotCChecksumNewMTParallel){
+        checkChecksumBuf=newSyncInfo->savedNewDataCheckChecksum;
+    #if (_IS_USED_MULTITHREAD)
+        if (_mt){ //thread local xor checksum, merge to savedNewDataCheckChecksum when match end
+            _mem_checkChecksum.realloc(checkChecksumBufByteSize(newSyncInfo->strongChecksumPlugin->checksumByteSize()));
+            checkChecksumBuf=_mem_checkChecksum.data();
+            memset(checkChecksumBuf,0,_mem_checkChecksum.size());
+        }
+    #endif
+    }
+    hpatch_StreamPos_t curOldPos=oldRollBegin;
+    hpatch_StreamPos_t nextClipPos=oldRollEnd; //cut point of the next clip's chain
+    size_t dataSize;
+    while (curOldPos<oldSize){
+        if (curOldPos>=oldRollEnd){
+            while (nextClipPos<curOldPos){
+                const TByte* data=reader.data(nextClipPos,nextClipPos,&dataSize);
+                nextClipPos+=chunker.cut(data,dataSize);
+            }
+            if (nextClipPos==curOldPos) break; //same cut points, next clip do the rest
+        }
+        const TByte* chunk=reader.data(curOldPos,(nextClipPos<curOldPos)?nextClipPos:curOldPos,&dataSize);
+        const size_t chunkSize=chunker.cut(chunk,dataSize);
+        const tm_roll_uint digest=toSavedPartRollHash(roll_hash_start(chunk,chunkSize),savedRollHashBits);
+        if (filter.is_hit(digest)){
+            const uint32_t* ti_pos=&rd.sorted_newIndexs_table[digest>>rd.kTableHashShlBit];
+            writeRollHashBytes(part,digest,savedRollHashByteSize);
+            TIndex_comp0::TDigest digest_value(part);
+            std::pair<const uint32_t*,const uint32_t*>
+            range=std::equal_range(rd.sorted_newIndexs+ti_pos[0],rd.sorted_newIndexs+ti_pos[1],digest_value,icomp0);
+            if (range.first!=range.second){
+                oldData.chunk=chunk;
+                oldData.chunkSize=chunkSize;
+                oldData.chunkPos=curOldPos;
+                _tm_matchRange(rd.out_newBlockDataInOldPoss,range.first,range.second,oldData,
+                               newSyncInfo,kMinRevSameIndex,checkChecksumBuf,_mt);
+            }
+        }
+        curOldPos+=chunkSize;
+    }
+#if (_IS_USED_MULTITHREAD)
+    if (_mt&&checkChecksumBuf){
+        const size_t kStrongChecksumByteSize=newSyncInfo->strongChecksumPlugin->checksumByteSize();
+        const unsigned char* d_xor=checkChecksumBuf+kStrongChecksumByteSize;
+        unsigned char* dst=newSyncInfo->savedNewDataCheckChecksum+kStrongChecksumByteSize;
+        CAutoLocker _autoLocker(((TMt*)_mt)->writeLocker.locker);
+        for (size_t i=0;i<kStrongChecksumByteSize;++i)
+            dst[i]^=d_xor[i];
+    }
+#endif
+}
+
 const uint32_t* getSortedIndexs(TAutoMem& _mem_sorted,const TNewDataSyncInfo* newSyncInfo,TBloomFilter<tm_roll_uint>& filter){
     return _tm_getSortedIndexs(_mem_sorted,newSyncInfo,filter);
 }
@@ -326,6 +516,10 @@ void matchNewDataInOld(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const TNewD
     matchDatas.oldStream=oldStream;
     matchDatas.rollMatch=_rollMatch;
     matchDatas.getSortedIndexs=_getSortedIndexs;
+    if (newSyncInfo->cdcAvgBlockSize){
+        checkv(!newSyncInfo->isSeqMatch);
+        matchDatas.rollMatch=_cdcMatch;
+    }
     _matchNewDataInOld(matchDatas,threadNum);
 }
 
@@ -127,6 +127,7 @@ struct TStreamDataCache_base {
     inline hpatch_checksumHandle checkChecksum()const{ return m_checkChecksum; }
     inline hpatch_StreamPos_t curStreamPos()const{ return m_readedPos-(m_cache.data_end()-m_cur); }
     inline hpatch_uint32_t  getSyncBlockSize()const{ return m_kSyncBlockSize; }
+    inline bool isBlockSizeMatched(const TNewDataSyncInfo* newSyncInfo,size_t newBlockIndex)const{ return true; } //fixed size
     inline hpatch_StreamPos_t getStreamSize()const{ return m_baseStream->streamSize; }
 protected:
     const hpatch_TStreamInput* m_baseStream;
@@ -178,6 +179,20 @@ struct TStreamDataRoll:public TStreamDataCache_base {
         m_rollHash=roll_hash_start(m_cur,m_kSyncBlockSize);
         return true;
     }
+    //out hashValue() of next positions in cache (out_hashs[0] is cur), not roll self; result>=1
+    size_t getRollHashs(tm_roll_uint* out_hashs,size_t maxCount)const{
+        size_t count=(size_t)(m_cache.data_end()-(m_cur+m_kSyncBlockSize))+1;
+        if (count>maxCount) count=maxCount;
+        out_hashs[0]=m_rollHash;
+        roll_hash_roll_n(m_rollHash,m_kSyncBlockSize,m_cur,count-1,out_hashs+1);
+        return count;
+    }
+    //roll step by the hashs got by getRollHashs()
+    hpatch_force_inline void skipRoll(size_t step,tm_roll_uint rollHash){
+        assert(m_cur+step+m_kSyncBlockSize<=m_cache.data_end());
+        m_cur+=step;
+        m_rollHash=rollHash;
+    }
     inline const uint8_t* partHashNext(size_t savedRollHashByteSize){ return 0; } //not used
 protected:
     tm_roll_uint            m_rollHash;
@@ -121,10 +121,11 @@ static void _indexOfCompressedSyncBlock(uint32_t* _followCompressedIndex,const T
 
     
 #define _checkSumNewDataBuf() { \
-    if (newDataSize<kSyncBlockSize)/*for backZeroLen*/ \
-        memset(dataBuf+newDataSize,0,kSyncBlockSize-newDataSize);  \
+    const uint32_t _hashSize=newSyncInfo->cdcAvgBlockSize?newDataSize:kSyncBlockSize; /*cdc block not padded*/ \
+    if (newDataSize<_hashSize)/*for backZeroLen*/ \
+        memset(dataBuf+newDataSize,0,_hashSize-newDataSize);  \
     strongChecksumPlugin->begin(checksumSync);  \
-    strongChecksumPlugin->append(checksumSync,dataBuf,dataBuf+kSyncBlockSize); \
+    strongChecksumPlugin->append(checksumSync,dataBuf,dataBuf+_hashSize); \
     strongChecksumPlugin->end(checksumSync,checksumSync_buf+newSyncInfo->savedStrongChecksumByteSize,    \
                               checksumSync_buf+newSyncInfo->savedStrongChecksumByteSize \
                                   +kStrongChecksumByteSize);\
@@ -137,6 +138,237 @@ static void _indexOfCompressedSyncBlock(uint32_t* _followCompressedIndex,const T
 }
 
 
+static void _getRangesPlan(TSyncRangesPlan* out_plan,const TSyncRangesPlan* plan){
+    *out_plan=*plan;
+    if (out_plan->rangeOverheadSize==0) out_plan->rangeOverheadSize=kSyncRangesPlan_rangeOverheadSize_default;
+    if (out_plan->maxRequestSize==0) out_plan->maxRequestSize=kSyncRangesPlan_maxRequestSize_default;
+    if (out_plan->maxRangeCount==0) out_plan->maxRangeCount=kSyncRangesPlan_maxRangeCount_default;
+}
+
+    //download by readSyncDataRanges(), one request for many need sync blocks
+    struct _TSyncDataRangesReader{
+        inline _TSyncDataRangesReader():ranges(0),dataBuf(0),dataBufSize(0),rangeCount(0),curRange(0),curRangeDataPos(0){}
+        inline ~_TSyncDataRangesReader(){ if (ranges) free(ranges); if (dataBuf) free(dataBuf); }
+        hpatch_StreamPos_t* ranges;
+        unsigned char*      dataBuf;
+        size_t              dataBufSize;
+        size_t              rangeCount;
+        size_t              curRange;
+        size_t              curRangeDataPos; //ranges[curRange]'s data pos in dataBuf
+    };
+
+static bool _TSyncDataRangesReader_loadRequest(IReadSyncDataListener* listener,const hpatch_StreamPos_t* ranges,size_t rangeCount,
+                                               unsigned char** pdataBuf,size_t* pdataBufSize){
+    hpatch_StreamPos_t dataSize=0;
+    for (size_t i=0;i<rangeCount;++i)
+        dataSize+=ranges[i*2+1]-ranges[i*2]+1;
+    if ((dataSize==0)||(dataSize!=(size_t)dataSize)) return false;
+    if (dataSize>*pdataBufSize){
+        if (*pdataBuf) { free(*pdataBuf); *pdataBuf=0; *pdataBufSize=0; }
+        *pdataBuf=(unsigned char*)malloc((size_t)dataSize);
+        if (*pdataBuf==0) return false;
+        *pdataBufSize=(size_t)dataSize;
+    }
+    return 0!=listener->readSyncDataRanges(listener,ranges,rangeCount,*pdataBuf,(size_t)dataSize);
+}
+
+static bool _TSyncDataRangesReader_read(_TSyncDataRangesReader* self,IReadSyncDataListener* listener,
+                                        const TNeedSyncInfos* nsi,uint32_t blockIndex,hpatch_StreamPos_t posInNewSyncData,
+                                        uint32_t isReLoadNewHalf,unsigned char* out_syncDataBuf,uint32_t syncDataSize){
+    if (syncDataSize==0) return true;
+    const hpatch_StreamPos_t first=posInNewSyncData-isReLoadNewHalf;
+    const hpatch_StreamPos_t last=first+syncDataSize-1;
+    for (bool isLoaded=false;;isLoaded=true){
+        while (self->curRange<self->rangeCount){
+            const hpatch_StreamPos_t* range=&self->ranges[self->curRange*2];
+            if (range[1]>=first){
+                if ((range[0]>first)||(range[1]<last)) break;
+                memcpy(out_syncDataBuf,self->dataBuf+self->curRangeDataPos+(size_t)(first-range[0]),syncDataSize);
+                return true;
+            }
+            self->curRangeDataPos+=(size_t)(range[1]-range[0]+1);
+            ++self->curRange;
+        }
+        if (isLoaded) return false;
+
+        //load next request
+        if (self->ranges==0){
+            TSyncRangesPlan plan;
+            _getRangesPlan(&plan,&listener->rangesPlan);
+            self->ranges=(hpatch_StreamPos_t*)malloc(plan.maxRangeCount*2*sizeof(hpatch_StreamPos_t));
+            if (self->ranges==0) return false;
+        }
+        self->curRange=0;
+        self->curRangeDataPos=0;
+        self->rangeCount=TNeedSyncInfos_getNextRequestRanges(nsi,&listener->rangesPlan,self->ranges,
+                                                             &blockIndex,&posInNewSyncData,isReLoadNewHalf);
+        if (!_TSyncDataRangesReader_loadRequest(listener,self->ranges,self->rangeCount,&self->dataBuf,&self->dataBufSize))
+            return false;
+    }
+}
+
+#if (_IS_USED_MULTITHREAD)
+    //download by readSyncDataRanges() with maxRequestsInFlight threads;
+    //  requests are planned in order, but complete out of order into a ring of requests (the reorder buffer);
+    //  blocks are consumed in order by sync thread (decompress need blocks in order as dict).
+    struct _TRangesRequest{
+        hpatch_StreamPos_t* ranges;
+        unsigned char*      dataBuf;
+        size_t              dataBufSize;
+        size_t              rangeCount;
+        bool                isLoaded;
+    };
+    struct _TSyncDataRangesReaderMt:public TMtByChannel{
+        IReadSyncDataListener*  listener;
+        const TNeedSyncInfos*   nsi;
+        TSyncRangesPlan         plan;
+        _TRangesRequest*        requests;
+        size_t                  requestCount; //ring size
+        size_t                  nextPlanSeq;  //requests[seq%requestCount]
+        size_t                  consumeSeq;
+        uint32_t                planBlockIndex;
+        hpatch_StreamPos_t      planPosInNewSyncData;
+        uint32_t                planIsReLoadNewHalf;
+        bool                    isPlanEnd;
+        bool                    isOnError;
+        bool                    isStop;
+        size_t                  threadNum;
+        size_t                  curRange;
+        size_t                  curRangeDataPos;
+        CHLocker                locker;
+        HCondvar                condvar;
+        inline _TSyncDataRangesReaderMt():listener(0),nsi(0),requests(0),requestCount(0),nextPlanSeq(0),consumeSeq(0),
+            planBlockIndex(0),planPosInNewSyncData(0),planIsReLoadNewHalf(0),isPlanEnd(false),isOnError(false),
+            isStop(false),threadNum(0),curRange(0),curRangeDataPos(0),condvar(0){}
+        inline ~_TSyncDataRangesReaderMt(){
+            if (threadNum>0){
+                {
+                    CAutoLocker _autoLocker(locker.locker);
+                    isStop=true;
+                    c_condvar_broadcast(condvar);
+                }
+                wait_all_thread_end();
+            }
+            if (condvar) c_condvar_delete(condvar);
+            if (requests){
+                for (size_t i=0;i<requestCount;++i){
+                    if (requests[i].ranges) free(requests[i].ranges);
+                    if (requests[i].dataBuf) free(requests[i].dataBuf);
+                }
+                free(requests);
+            }
+        }
+    };
+
+static void _rangesDownload_thread(int threadIndex,void* workData){
+    _TSyncDataRangesReaderMt& self=*(_TSyncDataRangesReaderMt*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(self);
+    while (true) {
+        _TRangesRequest* req;
+        {//plan next request
+            CAutoLocker _autoLocker(self.locker.locker);
+            while ((!self.isStop)&&(!self.isOnError)&&(!self.isPlanEnd)
+                   &&(self.nextPlanSeq>=self.consumeSeq+self.requestCount))
+                c_condvar_wait(self.condvar,self.locker.locker);
+            if (self.isStop||self.isOnError||self.isPlanEnd) break;
+            req=&self.requests[self.nextPlanSeq%self.requestCount];
+            req->rangeCount=TNeedSyncInfos_getNextRequestRanges(self.nsi,&self.plan,req->ranges,&self.planBlockIndex,
+                                                                &self.planPosInNewSyncData,self.planIsReLoadNewHalf);
+            self.planIsReLoadNewHalf=1; //next request may begin with a half byte; a superset of need
+            if (req->rangeCount==0){
+                self.isPlanEnd=true;
+                c_condvar_broadcast(self.condvar);
+                break;
+            }
+            ++self.nextPlanSeq;
+        }
+        const bool isOk=_TSyncDataRangesReader_loadRequest(self.listener,req->ranges,req->rangeCount,
+                                                           &req->dataBuf,&req->dataBufSize);
+        {
+            CAutoLocker _autoLocker(self.locker.locker);
+            if (isOk)
+                req->isLoaded=true;
+            else
+                self.isOnError=true;
+            c_condvar_broadcast(self.condvar);
+            if (!isOk) break;
+        }
+    }
+}
+
+static bool _TSyncDataRangesReaderMt_start(_TSyncDataRangesReaderMt* self,IReadSyncDataListener* listener,
+                                           const TNeedSyncInfos* nsi,uint32_t blockIndex,
+                                           hpatch_StreamPos_t posInNewSyncData,uint32_t isReLoadNewHalf){
+    assert(listener->maxRequestsInFlight>1);
+    self->listener=listener;
+    self->nsi=nsi;
+    _getRangesPlan(&self->plan,&listener->rangesPlan);
+    self->planBlockIndex=blockIndex;
+    self->planPosInNewSyncData=posInNewSyncData;
+    self->planIsReLoadNewHalf=isReLoadNewHalf;
+    self->requestCount=listener->maxRequestsInFlight*2;
+    self->requests=(_TRangesRequest*)malloc(self->requestCount*sizeof(_TRangesRequest));
+    if (self->requests==0) return false;
+    memset(self->requests,0,self->requestCount*sizeof(_TRangesRequest));
+    for (size_t i=0;i<self->requestCount;++i){
+        self->requests[i].ranges=(hpatch_StreamPos_t*)malloc(self->plan.maxRangeCount*2*sizeof(hpatch_StreamPos_t));
+        if (self->requests[i].ranges==0) return false;
+    }
+    self->condvar=c_condvar_new();
+    if (self->condvar==0) return false;
+    self->threadNum=listener->maxRequestsInFlight;
+    return self->start_threads((int)self->threadNum,_rangesDownload_thread,self,false);
+}
+
+static _TSyncDataRangesReaderMt* _TSyncDataRangesReaderMt_open(IReadSyncDataListener* listener,const TNeedSyncInfos* nsi,
+                                                               uint32_t blockIndex,hpatch_StreamPos_t posInNewSyncData,
+                                                               uint32_t isReLoadNewHalf){
+    _TSyncDataRangesReaderMt* self=0;
+    try{
+        self=new _TSyncDataRangesReaderMt();
+        if (_TSyncDataRangesReaderMt_start(self,listener,nsi,blockIndex,posInNewSyncData,isReLoadNewHalf))
+            return self;
+    }catch(...){
+    }
+    if (self) delete self;
+    return 0;
+}
+
+static bool _TSyncDataRangesReaderMt_read(_TSyncDataRangesReaderMt* self,uint32_t isReLoadNewHalf,hpatch_StreamPos_t posInNewSyncData,
+                                          unsigned char* out_syncDataBuf,uint32_t syncDataSize){
+    if (syncDataSize==0) return true;
+    const hpatch_StreamPos_t first=posInNewSyncData-isReLoadNewHalf;
+    const hpatch_StreamPos_t last=first+syncDataSize-1;
+    while (true) {
+        _TRangesRequest* req=&self->requests[self->consumeSeq%self->requestCount];
+        {//wait request loaded
+            CAutoLocker _autoLocker(self->locker.locker);
+            while ((!req->isLoaded)&&(!self->isOnError)&&(!(self->isPlanEnd&&(self->consumeSeq>=self->nextPlanSeq))))
+                c_condvar_wait(self->condvar,self->locker.locker);
+            if (!req->isLoaded) return false;
+        }
+        while (self->curRange<req->rangeCount){
+            const hpatch_StreamPos_t* range=&req->ranges[self->curRange*2];
+            if (range[1]>=first){
+                if ((range[0]>first)||(range[1]<last)) return false;
+                memcpy(out_syncDataBuf,req->dataBuf+self->curRangeDataPos+(size_t)(first-range[0]),syncDataSize);
+                return true;
+            }
+            self->curRangeDataPos+=(size_t)(range[1]-range[0]+1);
+            ++self->curRange;
+        }
+        {//request consumed, reuse it for download
+            CAutoLocker _autoLocker(self->locker.locker);
+            req->isLoaded=false;
+            ++self->consumeSeq;
+            self->curRange=0;
+            self->curRangeDataPos=0;
+            c_condvar_broadcast(self->condvar);
+        }
+    }
+}
+#endif
+
 static TSyncClient_resultType writeToNewOrDiff(_TWriteDatas& wd) {
     _IWriteToNewOrDiff_by wr_by={0};
     wr_by.checkChecksumAppendData=checkChecksumAppendData;
@@ -160,6 +392,10 @@ TSyncClient_resultType _writeToNewOrDiff_by(_IWriteToNewOrDiff_by* wr_by,_TWrite
     hsync_dictDecompressHandle decompressHandle=0;
     bool                       isNeedDecompress=(wd.decompressPlugin!=0);  
     hpatch_checksumHandle checksumSync=0;
+    _TSyncDataRangesReader rangesReader;
+#if (_IS_USED_MULTITHREAD)
+    _TSyncDataRangesReaderMt* rangesReaderMt=0;
+#endif
     hpatch_StreamPos_t posInNewSyncData=newSyncInfo->newSyncDataOffsert;
     hpatch_StreamPos_t posInNeedSyncData=0;
     hpatch_StreamPos_t outNewDataPos=0;
@@ -226,8 +462,24 @@ TSyncClient_resultType _writeToNewOrDiff_by(_IWriteToNewOrDiff_by* wr_by,_TWrite
                             check(syncDataListener->readSyncDataBegin(syncDataListener,wd.needSyncInfo,i,
                                                         posInNewSyncData,_isReLoadNewHalf,posInNeedSyncData,_isReLoadDiffHalf),kSyncClient_readSyncDataBeginError);
                     }
-                    check(syncDataListener->readSyncData(syncDataListener,i,posInNewSyncData,_isReLoadNewHalf,
-                                                posInNeedSyncData,_isReLoadDiffHalf,buf,syncSize-_isBackupedHalf),kSyncClient_readSyncDataError);
+                #if (_IS_USED_MULTITHREAD)
+                    if (syncDataListener->readSyncDataRanges&&(syncDataListener->maxRequestsInFlight>1)){
+                        if (rangesReaderMt==0){
+                            rangesReaderMt=_TSyncDataRangesReaderMt_open(syncDataListener,wd.needSyncInfo,i,
+                                                                         posInNewSyncData,_isReLoadNewHalf);
+                            check(rangesReaderMt!=0,kSyncClient_readSyncDataBeginError);
+                        }
+                        check(_TSyncDataRangesReaderMt_read(rangesReaderMt,_isReLoadNewHalf,posInNewSyncData,
+                                                            buf,syncSize-_isBackupedHalf),kSyncClient_readSyncDataError);
+                    }else
+                #endif
+                    if (syncDataListener->readSyncDataRanges){
+                        check(_TSyncDataRangesReader_read(&rangesReader,syncDataListener,wd.needSyncInfo,i,posInNewSyncData,
+                                                          _isReLoadNewHalf,buf,syncSize-_isBackupedHalf),kSyncClient_readSyncDataError);
+                    }else{
+                        check(syncDataListener->readSyncData(syncDataListener,i,posInNewSyncData,_isReLoadNewHalf,
+                                                    posInNeedSyncData,_isReLoadDiffHalf,buf,syncSize-_isBackupedHalf),kSyncClient_readSyncDataError);
+                    }
                 }
                 if (wd.out_diffStream){ //write diff
                     if (!isOnDiffContinue){ //save downloaded data
@@ -292,6 +544,9 @@ TSyncClient_resultType _writeToNewOrDiff_by(_IWriteToNewOrDiff_by* wr_by,_TWrite
         assert(posInNewSyncData<=newSyncInfo->newSyncDataSize);//checked in readSavedSizesTo()
 clear:
     _inClear=1;
+#if (_IS_USED_MULTITHREAD)
+    if (rangesReaderMt) delete rangesReaderMt;
+#endif
     if (decompressHandle) wd.decompressPlugin->dictDecompressClose(wd.decompressPlugin,decompressHandle);
     if (checksumSync) strongChecksumPlugin->close(strongChecksumPlugin,checksumSync);
     if (_memBuf) free(_memBuf);
@@ -464,7 +719,7 @@ TSyncClient_resultType
         syncDataListener->onNeedSyncInfo(syncDataListener,&needSyncInfo);
     
     if (isNeedOut) 
-        check(syncDataListener->readSyncData!=0,kSyncClient_noReadSyncDataError);
+        check((syncDataListener->readSyncData!=0)||(syncDataListener->readSyncDataRanges!=0),kSyncClient_noReadSyncDataError);
     if (isNeedOut){
         _TWriteDatas writeDatas;
         writeDatas.out_newStream=out_newStream;
@@ -505,7 +760,8 @@ clear:
 
 static TSyncClient_resultType
     _sync_patch_file2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
-                          TSyncDiffData* diffData,const char* oldFile,const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
+                          TSyncDiffData* diffData,const char* const* oldFiles,size_t oldFileCount,
+                          const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
                           const char* outNewFile,hpatch_BOOL isOutNewContinue,
                           const hpatch_TStreamOutput* out_diffStream,TSyncDiffType diffType,
                           const hpatch_TStreamInput* diffContinue,int threadNum){
@@ -513,21 +769,42 @@ static TSyncClient_resultType
     int _inClear=0;
     TNewDataSyncInfo            newSyncInfo;
     hpatch_TFileStreamInput     oldData;
+    hpatch_TFileStreamInput*    oldSeedDatas=0; //for oldFileCount>1
+    const hpatch_TStreamInput** oldSeedList=0;
+    TSyncSeeds                  oldSeeds;
     hpatch_TFileStreamOutput    out_newData;
     const hpatch_TStreamInput*  newDataContinue=0;
     hpatch_TStreamInput         _newDataContinue;
     const hpatch_TStreamInput*  oldStream=0;
+    const char* oldFile=(oldFileCount==1)?oldFiles[0]:0;
     bool isOldPathInputEmpty=(oldFile==0)||(strlen(oldFile)==0);
     
     TNewDataSyncInfo_init(&newSyncInfo);
     hpatch_TFileStreamInput_init(&oldData);
+    TSyncSeeds_init(&oldSeeds);
     hpatch_TFileStreamOutput_init(&out_newData);
     result=TNewDataSyncInfo_open_by_file(&newSyncInfo,newSyncInfoFile,isIgnoreCompressInfo,listener);
     check(result==kSyncClient_ok,result);
     
-    if (!isOldPathInputEmpty)
-        check(hpatch_TFileStreamInput_open(&oldData,oldFile),kSyncClient_oldFileOpenError);
-    oldStream=&oldData.base;
+    if (oldFileCount>1){
+        oldSeedDatas=(hpatch_TFileStreamInput*)malloc(oldFileCount*sizeof(hpatch_TFileStreamInput));
+        oldSeedList=(const hpatch_TStreamInput**)malloc(oldFileCount*sizeof(const hpatch_TStreamInput*));
+        check((oldSeedDatas!=0)&&(oldSeedList!=0),kSyncClient_memError);
+        for (size_t i=0;i<oldFileCount;++i){
+            hpatch_TFileStreamInput_init(&oldSeedDatas[i]);
+            oldSeedList[i]=&oldSeedDatas[i].base;
+        }
+        for (size_t i=0;i<oldFileCount;++i){
+            if ((oldFiles[i]!=0)&&(strlen(oldFiles[i])>0))
+                check(hpatch_TFileStreamInput_open(&oldSeedDatas[i],oldFiles[i]),kSyncClient_oldFileOpenError);
+        }
+        check(TSyncSeeds_open(&oldSeeds,oldSeedList,oldFileCount),kSyncClient_memError);
+        oldStream=oldSeeds.stream;
+    }else{
+        if (!isOldPathInputEmpty)
+            check(hpatch_TFileStreamInput_open(&oldData,oldFile),kSyncClient_oldFileOpenError);
+        oldStream=&oldData.base;
+    }
     if (outNewFile){
         check(_open_continue_out(isOutNewContinue,outNewFile,&out_newData,&_newDataContinue,newSyncInfo.newDataSize),
               isOutNewContinue?kSyncClient_newFileReopenWriteError:kSyncClient_newFileCreateError);
@@ -541,6 +818,13 @@ clear:
     _inClear=1;
     check(hpatch_TFileStreamOutput_close(&out_newData),kSyncClient_newFileCloseError);
     check(hpatch_TFileStreamInput_close(&oldData),kSyncClient_oldFileCloseError);
+    TSyncSeeds_close(&oldSeeds);
+    if (oldSeedDatas){
+        for (size_t i=0;i<oldFileCount;++i)
+            check(hpatch_TFileStreamInput_close(&oldSeedDatas[i]),kSyncClient_oldFileCloseError);
+        free(oldSeedDatas);
+    }
+    if (oldSeedList) free((void*)oldSeedList);
     TNewDataSyncInfo_close(&newSyncInfo);
     return result;
 }
@@ -599,6 +883,115 @@ size_t TNeedSyncInfos_getNextRanges(const TNeedSyncInfos* nsi,hpatch_StreamPos_t
     return result;
 }
 
+size_t TNeedSyncInfos_getNextRequestRanges(const TNeedSyncInfos* nsi,const TSyncRangesPlan* _plan,
+                                           hpatch_StreamPos_t* _dstRanges,uint32_t* _curBlockIndex,
+                                           hpatch_StreamPos_t* _curPosInNewSyncData,uint32_t isReLoadNewHalf){
+    TSyncRangesPlan plan;
+    _getRangesPlan(&plan,_plan);
+    _TValidRange* out_ranges=(_TValidRange*)_dstRanges;
+    uint32_t& blockIndex=*_curBlockIndex;
+    hpatch_StreamPos_t& posInNewSyncData=*_curPosInNewSyncData;
+    hpatch_StreamPos_t requestSize=0;
+    size_t result=0;
+    while (blockIndex<nsi->blockCount){
+        hpatch_BOOL isNeedSync;
+        uint32_t    syncSize;
+        hpatch_byte skipBitsInFirstCodeByte;
+        nsi->getBlockInfoByIndex(nsi,blockIndex,&isNeedSync,&syncSize,&skipBitsInFirstCodeByte,0);
+        const uint32_t incNewSyncSize=syncSize-(skipBitsInFirstCodeByte?1:0);//delete one byte when adjacent blocks have half byte
+
+        if (isNeedSync){
+            _TValidRange* backRange=(result>0)?&out_ranges[result-1]:0;
+            const hpatch_StreamPos_t rangeEnd=posInNewSyncData+incNewSyncSize;
+            if (backRange&&(posInNewSyncData>backRange->last)
+                &&(posInNewSyncData-(backRange->last+1)<=plan.rangeOverheadSize)){ //merge gap
+                const hpatch_StreamPos_t incSize=rangeEnd-(backRange->last+1);
+                if (requestSize+incSize>plan.maxRequestSize)
+                    break; //finish
+                requestSize+=incSize;
+                backRange->last=rangeEnd-1;
+            }else{
+                const hpatch_StreamPos_t rangeBegin=posInNewSyncData-((isReLoadNewHalf&&skipBitsInFirstCodeByte)?1:0);
+                if (result>0){
+                    if ((result>=plan.maxRangeCount)||(requestSize+(rangeEnd-rangeBegin)>plan.maxRequestSize))
+                        break; //finish
+                }
+                requestSize+=rangeEnd-rangeBegin;
+                _setRange(out_ranges[result++],rangeBegin,rangeEnd);
+            }
+        }
+        isReLoadNewHalf=-1; //only first block actual effect
+        posInNewSyncData+=incNewSyncSize;
+        ++blockIndex;
+    }
+    return result;
+}
+
+hpatch_StreamPos_t TNeedSyncInfos_getBlockOldPos(const TNeedSyncInfos* nsi,uint32_t blockIndex){
+    const TNeedSyncInfosImport* self=(const TNeedSyncInfosImport*)nsi->import;
+    assert(blockIndex<nsi->blockCount);
+    return self->newBlockDataInOldPoss[blockIndex];
+}
+
+static hpatch_BOOL _TSyncSeeds_read(const hpatch_TStreamInput* stream,hpatch_StreamPos_t readFromPos,
+                                    unsigned char* out_data,unsigned char* out_data_end){
+    const TSyncSeeds* self=(const TSyncSeeds*)stream->streamImport;
+    if ((readFromPos>stream->streamSize)||((size_t)(out_data_end-out_data)>stream->streamSize-readFromPos))
+        return hpatch_FALSE;
+    size_t i=TSyncSeeds_seedIndex(self,readFromPos);
+    while (out_data<out_data_end){ //no cache state, thread safe if all seeds are thread safe
+        const hpatch_StreamPos_t seedBegin=(i>0)?self->_seedEndList[i-1]:0;
+        const hpatch_StreamPos_t seedEnd=self->_seedEndList[i];
+        size_t readLen=(size_t)(out_data_end-out_data);
+        if (readLen>seedEnd-readFromPos) readLen=(size_t)(seedEnd-readFromPos);
+        if (readLen>0){
+            const hpatch_TStreamInput* seed=self->_seedList[i];
+            if (!seed->read(seed,readFromPos-seedBegin,out_data,out_data+readLen)) return hpatch_FALSE;
+            out_data+=readLen;
+            readFromPos+=readLen;
+        }
+        ++i;
+    }
+    return hpatch_TRUE;
+}
+
+hpatch_BOOL TSyncSeeds_open(TSyncSeeds* self,const hpatch_TStreamInput* const* seedList,size_t seedCount){
+    hpatch_StreamPos_t sumSize=0;
+    assert(self->_seedEndList==0);
+    self->_seedEndList=(hpatch_StreamPos_t*)malloc((seedCount?seedCount:1)*sizeof(hpatch_StreamPos_t));
+    if (self->_seedEndList==0) return hpatch_FALSE;
+    for (size_t i=0;i<seedCount;++i){
+        sumSize+=seedList[i]->streamSize;
+        self->_seedEndList[i]=sumSize;
+    }
+    self->seedCount=seedCount;
+    self->_seedList=seedList;
+    self->_stream.streamImport=self;
+    self->_stream.streamSize=sumSize;
+    self->_stream.read=_TSyncSeeds_read;
+    self->stream=&self->_stream;
+    return hpatch_TRUE;
+}
+
+void TSyncSeeds_close(TSyncSeeds* self){
+    if (self->_seedEndList) free(self->_seedEndList);
+    TSyncSeeds_init(self);
+}
+
+size_t TSyncSeeds_seedIndex(const TSyncSeeds* self,hpatch_StreamPos_t posInSeeds){
+    //binary search first seed with seedEnd>posInSeeds
+    size_t left=0;
+    size_t right=self->seedCount;
+    while (left<right){
+        const size_t mid=left+(right-left)/2;
+        if (self->_seedEndList[mid]<=posInSeeds)
+            left=mid+1;
+        else
+            right=mid;
+    }
+    return left; //==seedCount if posInSeeds not in seeds
+}
+
 TSyncClient_resultType sync_patch(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
                                   const hpatch_TStreamInput* oldStream,const TNewDataSyncInfo* newSyncInfo,
                                   const hpatch_TStreamOutput* out_newStream,const hpatch_TStreamInput* newDataContinue,
@@ -626,10 +1019,12 @@ TSyncClient_resultType sync_local_patch(ISyncInfoListener* listener,const hpatch
 }
 
 
-TSyncClient_resultType sync_patch_file2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
-                                            const char* oldFile,const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
-                                            const char* outNewFile,hpatch_BOOL isOutNewContinue,
-                                            const char* cacheDiffInfoFile,int threadNum){
+static TSyncClient_resultType
+    _sync_patch_cache2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
+                           const char* const* oldFiles,size_t oldFileCount,
+                           const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
+                           const char* outNewFile,hpatch_BOOL isOutNewContinue,
+                           const char* cacheDiffInfoFile,int threadNum){
     TSyncClient_resultType result=kSyncClient_ok;
     int _inClear=0;
     hpatch_TFileStreamOutput out_diffInfo;
@@ -643,7 +1038,7 @@ TSyncClient_resultType sync_patch_file2file(ISyncInfoListener* listener,IReadSyn
         if (isOutDiffContinue) diffContinue=&_diffContinue;
     }
 
-    result=_sync_patch_file2file(listener,syncDataListener,0,oldFile,newSyncInfoFile,isIgnoreCompressInfo,
+    result=_sync_patch_file2file(listener,syncDataListener,0,oldFiles,oldFileCount,newSyncInfoFile,isIgnoreCompressInfo,
                                  outNewFile,isOutNewContinue,
                                  cacheDiffInfoFile?&out_diffInfo.base:0,kSyncDiff_info,diffContinue,threadNum);
 clear:
@@ -652,6 +1047,23 @@ clear:
     return result;
 }
 
+TSyncClient_resultType sync_patch_file2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
+                                            const char* oldFile,const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
+                                            const char* outNewFile,hpatch_BOOL isOutNewContinue,
+                                            const char* cacheDiffInfoFile,int threadNum){
+    return _sync_patch_cache2file(listener,syncDataListener,&oldFile,1,newSyncInfoFile,isIgnoreCompressInfo,
+                                  outNewFile,isOutNewContinue,cacheDiffInfoFile,threadNum);
+}
+
+TSyncClient_resultType sync_patch_seeds2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
+                                             const char* const* oldSeedFiles,size_t seedCount,
+                                             const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
+                                             const char* outNewFile,hpatch_BOOL isOutNewContinue,
+                                             const char* cacheDiffInfoFile,int threadNum){
+    return _sync_patch_cache2file(listener,syncDataListener,oldSeedFiles,seedCount,newSyncInfoFile,isIgnoreCompressInfo,
+                                  outNewFile,isOutNewContinue,cacheDiffInfoFile,threadNum);
+}
+
 
 TSyncClient_resultType sync_local_diff_file2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
                                                  const char* oldFile,const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
@@ -668,7 +1080,7 @@ TSyncClient_resultType sync_local_diff_file2file(ISyncInfoListener* listener,IRe
           isOutDiffContinue?kSyncClient_diffFileReopenWriteError:kSyncClient_diffFileCreateError);
     if (isOutDiffContinue) diffContinue=&_diffContinue;
     
-    result=_sync_patch_file2file(listener,syncDataListener,0,oldFile,newSyncInfoFile,isIgnoreCompressInfo,0,hpatch_FALSE,
+    result=_sync_patch_file2file(listener,syncDataListener,0,&oldFile,1,newSyncInfoFile,isIgnoreCompressInfo,0,hpatch_FALSE,
                                  &out_diff.base,diffType,diffContinue,threadNum);
     
 clear:
@@ -688,7 +1100,7 @@ TSyncClient_resultType sync_local_patch_file2file(ISyncInfoListener* listener,co
     check(hpatch_TFileStreamInput_open(&in_diffData,inDiffFile),
           kSyncClient_diffFileOpenError);
     check(_TSyncDiffData_load(&diffData,&in_diffData.base),kSyncClient_loadDiffError);
-    result=_sync_patch_file2file(listener,0,&diffData,oldFile,newSyncInfoFile,isIgnoreCompressInfo,outNewFile,isOutNewContinue,
+    result=_sync_patch_file2file(listener,0,&diffData,&oldFile,1,newSyncInfoFile,isIgnoreCompressInfo,outNewFile,isOutNewContinue,
                                  0,kSyncDiff_default,0,threadNum);
 clear:
     _inClear=1;
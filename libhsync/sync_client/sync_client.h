@@ -31,17 +31,45 @@
 #include "sync_info_client.h"
 
 //sync_patch(oldStream+syncDataListener) to out_newStream
+//  one dictDecompressOpen() for every thread; if sync many files in a process, and dict plugin alloc
+//  memory by decompress_plugin_demo.h's _dec_malloc, caller can open hpatch_decompressPool for reuse.
 TSyncClient_resultType sync_patch(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
                                   const hpatch_TStreamInput* oldStream,const TNewDataSyncInfo* newSyncInfo,
                                   const hpatch_TStreamOutput* out_newStream,const hpatch_TStreamInput* newDataContinue,
                                   const hpatch_TStreamOutput* out_diffInfoStream,const hpatch_TStreamInput* diffInfoContinue,int threadNum);
 
+//old seeds (like zsync's -i): several local old files used as one oldStream, seed0+seed1+...;
+//  new blocks are matched in all seeds by one matchNewDataInOld (parallel by threadNum);
+//  use TSyncSeeds.stream as oldStream for sync_patch|sync_local_diff|sync_local_patch,
+//  sync_local_patch must use same seeds in same order as sync_local_diff.
+typedef struct TSyncSeeds{
+    const hpatch_TStreamInput*          stream;
+    size_t                              seedCount;
+//private:
+    hpatch_TStreamInput                 _stream;
+    const hpatch_TStreamInput* const*   _seedList;
+    hpatch_StreamPos_t*                 _seedEndList;
+} TSyncSeeds;
+hpatch_inline static
+void        TSyncSeeds_init(TSyncSeeds* self) { memset(self,0,sizeof(*self)); }
+hpatch_BOOL TSyncSeeds_open(TSyncSeeds* self,const hpatch_TStreamInput* const* seedList,size_t seedCount);
+void        TSyncSeeds_close(TSyncSeeds* self);
+//which seed the pos in; pos is TNeedSyncInfos_getBlockOldPos()'s result
+size_t      TSyncSeeds_seedIndex(const TSyncSeeds* self,hpatch_StreamPos_t posInSeeds);
+
 //sync patch(oldFile+syncDataListener) to outNewFile
 TSyncClient_resultType sync_patch_file2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
                                             const char* oldFile,const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
                                             const char* outNewFile,hpatch_BOOL isOutNewContinue,
                                             const char* cacheDiffInfoFile,int threadNum);
 
+//sync patch(oldSeedFiles+syncDataListener) to outNewFile
+TSyncClient_resultType sync_patch_seeds2file(ISyncInfoListener* listener,IReadSyncDataListener* syncDataListener,
+                                             const char* const* oldSeedFiles,size_t seedCount,
+                                             const char* newSyncInfoFile,hpatch_BOOL isIgnoreCompressInfo,
+                                             const char* outNewFile,hpatch_BOOL isOutNewContinue,
+                                             const char* cacheDiffInfoFile,int threadNum);
+
 
 //sync_patch can split to two steps: sync_local_diff + sync_local_patch
 
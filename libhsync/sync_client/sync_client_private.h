@@ -172,9 +172,49 @@ namespace sync_private{
 
     struct TStreamDataCache_base;
     bool _matchRange(hpatch_StreamPos_t* out_newBlockDataInOldPoss,const uint32_t* range_begin,const uint32_t* range_end,
-                     TStreamDataCache_base& oldData,const TNewDataSyncInfo* newSyncInfo,hpatch_StreamPos_t kMinRevSameIndex,void* _mt);
+                     TStreamDataCache_base& oldData,const TNewDataSyncInfo* newSyncInfo,hpatch_StreamPos_t kMinRevSameIndex,
+                     unsigned char* checkChecksumBuf,void* _mt);
 
 
+    static const size_t kRollBatchSize=256;
+    struct TRollHashBatch{
+        tm_roll_uint        hashs[kRollBatchSize];
+        hpatch_StreamPos_t  pos; //stream pos of hashs[0]
+        size_t              count;
+        inline TRollHashBatch():pos(0),count(0){}
+    };
+
+    //roll to the next pos which digest may be hit by filter (& not same as digestFull_back);
+    //  roll hashs got by batch, then check filter by batch; the batch can continue used after roll() when not hit.
+    template<class TOldDataRoll_t,class TFilter_t,class TFunc_savedPartRollHash>
+    static hpatch_inline
+    bool _tm_rollToFilterHit(TOldDataRoll_t& oldData,TRollHashBatch& batch,const TFilter_t& filter,
+                             TFunc_savedPartRollHash f_toSavedPartRollHash,size_t savedRollHashBits,
+                             tm_roll_uint& digestFull_back,tm_roll_uint* out_digest){
+        typedef typename TFilter_t::value_type filter_value_t;
+        while (true){
+            const hpatch_StreamPos_t curPos=oldData.curStreamPos();
+            if ((curPos<batch.pos)||(curPos>=batch.pos+batch.count)){
+                batch.count=oldData.getRollHashs(batch.hashs,kRollBatchSize);
+                batch.pos=curPos;
+            }
+            const size_t curi=(size_t)(curPos-batch.pos);
+            for (size_t i=curi;i<batch.count;++i){
+                const tm_roll_uint digest=batch.hashs[i];
+                if (digest==digestFull_back) continue;
+                digestFull_back=digest;
+                const tm_roll_uint partDigest=f_toSavedPartRollHash(digest,savedRollHashBits);
+                if (filter.is_hit((filter_value_t)partDigest)){
+                    oldData.skipRoll(i-curi,digest);
+                    *out_digest=partDigest;
+                    return true;
+                }
+            }
+            oldData.skipRoll(batch.count-1-curi,batch.hashs[batch.count-1]);
+            if (!oldData.roll()) return false; //finish
+        }
+    }
+
     template<class TOldDataRoll_t,class TFilter_t,bool isSeqMatch,class TFunc_savedPartRollHash>
     static hpatch_inline
     void _tm_rollMatch(_TMatchDatas& rd,hpatch_StreamPos_t oldRollBegin,hpatch_StreamPos_t oldRollEnd,
@@ -193,6 +233,19 @@ namespace sync_private{
                                 ,_mt?((TMt*)_mt)->readLocker.locker:0
                             #endif
                                 );
+        unsigned char* checkChecksumBuf=0; //note: checkChecksum is only for hsynz
+        TAutoMem _mem_checkChecksum;
+        if (!rd.newSyncInfo->isNotCChecksumNewMTParallel){
+            checkChecksumBuf=rd.newSyncInfo->savedNewDataCheckChecksum;
+        #if (_IS_USED_MULTITHREAD)
+            if (_mt){ //thread local xor checksum, merge to savedNewDataCheckChecksum when roll end
+                const size_t kStrongChecksumByteSize=oldData.strongChecksumByteSize();
+                _mem_checkChecksum.realloc(checkChecksumBufByteSize(kStrongChecksumByteSize));
+                checkChecksumBuf=_mem_checkChecksum.data();
+                memset(checkChecksumBuf,0,_mem_checkChecksum.size());
+            }
+        #endif
+        }
         uint8_t part[sizeof(tm_roll_uint)]={0};
         const size_t savedRollHashBits=rd.newSyncInfo->savedRollHashBits;
         const TFilter_t& filter=*(TFilter_t*)rd.filter;
@@ -200,18 +253,25 @@ namespace sync_private{
         tm_roll_uint digestFull_back=~oldData.hashValue(); //not same digest
         hpatch_StreamPos_t curOldPos=oldData.curStreamPos();
         hpatch_StreamPos_t _matchedPosBack=isSeqMatch?curOldPos:~(hpatch_StreamPos_t)0;
+        TRollHashBatch rollBatch;
         while (true) {
-            if (isSeqMatch) curOldPos=oldData.curStreamPos();
-            tm_roll_uint digest=oldData.hashValue();
-            if (digestFull_back!=digest){
-                digestFull_back=digest;
-                digest=f_toSavedPartRollHash(digest,savedRollHashBits);
-                if ((!isSeqMatch)||(_matchedPosBack!=curOldPos)){
-                    if (!filter.is_hit((filter_value_t)digest))
-                        { if (oldData.roll()) continue; else break; }//finish
-                }
+            tm_roll_uint digest;
+            if (!isSeqMatch){
+                if (!_tm_rollToFilterHit(oldData,rollBatch,filter,f_toSavedPartRollHash,savedRollHashBits,
+                                         digestFull_back,&digest)) break; //finish
             }else{
-                if (oldData.roll()) continue; else break; //finish
+                curOldPos=oldData.curStreamPos();
+                digest=oldData.hashValue();
+                if (digestFull_back!=digest){
+                    digestFull_back=digest;
+                    digest=f_toSavedPartRollHash(digest,savedRollHashBits);
+                    if (_matchedPosBack!=curOldPos){
+                        if (!filter.is_hit((filter_value_t)digest))
+                            { if (oldData.roll()) continue; else break; }//finish
+                    }
+                }else{
+                    if (oldData.roll()) continue; else break; //finish
+                }
             }
             
             const uint32_t* ti_pos0;
@@ -236,7 +296,7 @@ namespace sync_private{
                 { if (oldData.roll()) continue; else break; }//finish
 
             bool isMatched=_matchRange(rd.out_newBlockDataInOldPoss,range.first,range.second,oldData,
-                                       rd.newSyncInfo,kMinRevSameIndex,_mt);
+                                       rd.newSyncInfo,kMinRevSameIndex,checkChecksumBuf,_mt);
             if (isMatched){
                 if (!isSeqMatch) curOldPos=oldData.curStreamPos();
                 _matchedPosBack=curOldPos+rd.newSyncInfo->kSyncBlockSize;
@@ -246,6 +306,16 @@ namespace sync_private{
             }//else roll
             if (oldData.roll()) continue; else break;
         }
+    #if (_IS_USED_MULTITHREAD)
+        if (_mt&&checkChecksumBuf){
+            const size_t kStrongChecksumByteSize=oldData.strongChecksumByteSize();
+            const unsigned char* d_xor=checkChecksumBuf+kStrongChecksumByteSize;
+            unsigned char* dst=rd.newSyncInfo->savedNewDataCheckChecksum+kStrongChecksumByteSize;
+            CAutoLocker _autoLocker(((TMt*)_mt)->writeLocker.locker);
+            for (size_t i=0;i<kStrongChecksumByteSize;++i)
+                dst[i]^=d_xor[i];
+        }
+    #endif
     }
 
     void _matchNewDataInOld(_TMatchDatas& matchDatas,int threadNum);
@@ -82,7 +82,9 @@ typedef struct{
     size_t                  savedStrongChecksumBits;
     size_t                  savedRollHashBits;
     size_t                  dictSize;
-    uint32_t                kSyncBlockSize;
+    uint32_t                kSyncBlockSize;   // if cdcAvgBlockSize>0, it's the max size of blocks
+    uint32_t                cdcAvgBlockSize;  // default 0: blocks are fixed size; else blocks are content-defined chunks (variable size)
+    uint32_t                cdcBlockCount;
     uint32_t                samePairCount;
     uint8_t                 isDirSyncInfo;
     uint8_t                 isNotCChecksumNewMTParallel; // not run checkChecksum newData in parallel? default is false(run parallel)
@@ -103,6 +105,7 @@ typedef struct{
         uint32_t*           savedSizes;
         savedBitsInfo_t*    savedBitsInfos;
     };
+    uint32_t*               cdcBlockSizes; // newData size of every block when cdcAvgBlockSize>0
     uint8_t*                rollHashs;
     uint8_t*                partChecksums;
 #if (_IS_NEED_DIR_DIFF_PATCH)
@@ -114,6 +117,8 @@ typedef struct{
     hsync_TDictDecompress*  _decompressPlugin;
     void*                   _import;
     void*                   _extraMem;
+    void*                   _mapped;     // mapped view of mappable .hsyni, unmap by close
+    size_t                  _mappedSize;
 } TNewDataSyncInfo;
 
 #define _bitsToBytes(bits) (((bits)+7)>>3)
@@ -139,11 +144,32 @@ typedef struct TNeedSyncInfos{
 
 size_t TNeedSyncInfos_getNextRanges(const TNeedSyncInfos* nsi,hpatch_StreamPos_t* dstRanges,size_t maxGetRangeLen,
                                     uint32_t* curBlockIndex,hpatch_StreamPos_t* curPosInNewSyncData,uint32_t isReLoadNewHalf);
+//block's data pos in oldStream, or ~0 if the block need download
+hpatch_StreamPos_t TNeedSyncInfos_getBlockOldPos(const TNeedSyncInfos* nsi,uint32_t blockIndex);
 static hpatch_inline
 size_t TNeedSyncInfos_getRangeCount(const TNeedSyncInfos* nsi,uint32_t curBlockIndex,
                                     hpatch_StreamPos_t curPosInNewSyncData,uint32_t isReLoadNewHalf){
     return TNeedSyncInfos_getNextRanges(nsi,0,~(size_t)0,&curBlockIndex,&curPosInNewSyncData,isReLoadNewHalf); }
 
+//cost model for merge need sync blocks into multi-range download requests; 0 value means default;
+//  near-adjacent ranges are merged when the gap between them <= rangeOverheadSize, gap data is downloaded & discarded;
+//  a request has at most maxRangeCount ranges & maxRequestSize bytes (include gaps, at least one block).
+typedef struct TSyncRangesPlan{
+    hpatch_StreamPos_t  rangeOverheadSize; // cost of one more range in a request as bytes, eg: http multipart head
+    hpatch_StreamPos_t  maxRequestSize;
+    size_t              maxRangeCount;     // server's limit of ranges in one request
+} TSyncRangesPlan;
+#define kSyncRangesPlan_rangeOverheadSize_default   256
+#define kSyncRangesPlan_maxRequestSize_default      (1024*1024*4)
+#define kSyncRangesPlan_maxRangeCount_default       64
+
+//get next request's ranges by plan, from curBlockIndex; result is ranges count (0 when finish);
+//  dstRanges's size must >= maxRangeCount*2, out (first,last) pairs same as http range definition;
+//  isReLoadNewHalf same as IReadSyncDataListener::readSyncData;
+size_t TNeedSyncInfos_getNextRequestRanges(const TNeedSyncInfos* nsi,const TSyncRangesPlan* plan,
+                                           hpatch_StreamPos_t* dstRanges,uint32_t* curBlockIndex,
+                                           hpatch_StreamPos_t* curPosInNewSyncData,uint32_t isReLoadNewHalf);
+
 typedef struct IReadSyncDataListener{
     void*       readSyncDataImport;
     //onNeedSyncInfo can null
@@ -159,6 +185,17 @@ typedef struct IReadSyncDataListener{
                                      unsigned char* out_syncDataBuf,uint32_t syncDataSize);
     //readSyncDataEnd can null
     void        (*readSyncDataEnd)  (struct IReadSyncDataListener* listener);
+    //readSyncDataRanges can null; if not null, download by it instead of readSyncData,
+    //  ranges planned by TNeedSyncInfos_getNextRequestRanges() with rangesPlan;
+    //  out all ranges's data in order to out_syncDataBuf, syncDataSize is sum of ranges's len.
+    hpatch_BOOL (*readSyncDataRanges)(struct IReadSyncDataListener* listener,const hpatch_StreamPos_t* ranges,
+                                      size_t rangeCount,unsigned char* out_syncDataBuf,size_t syncDataSize);
+    TSyncRangesPlan rangesPlan;
+    //requests in flight for readSyncDataRanges, 0 or 1 means one by one;
+    //  if >1, readSyncDataRanges will be called by threads at the same time (must thread safe),
+    //  requests complete out of order, and be consumed in blocks order by a reorder buffer
+    //  of maxRequestsInFlight*2 requests (memory <= maxRequestsInFlight*2*rangesPlan.maxRequestSize).
+    size_t          maxRequestsInFlight;
 } IReadSyncDataListener;
 
 typedef enum TSyncDiffType{
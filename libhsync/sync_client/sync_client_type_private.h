@@ -35,10 +35,15 @@ namespace sync_private{
     
 hpatch_inline static
 hpatch_StreamPos_t TNewDataSyncInfo_blockCount(const TNewDataSyncInfo* self){
+        if (self->cdcAvgBlockSize) return self->cdcBlockCount;
         return getSyncBlockCount(self->newDataSize,self->kSyncBlockSize); }
 
 hpatch_inline static
 uint32_t TNewDataSyncInfo_newDataBlockSize(const TNewDataSyncInfo* self,uint32_t blockIndex){
+    if (self->cdcAvgBlockSize){
+        assert(blockIndex<self->cdcBlockCount);
+        return self->cdcBlockSizes[blockIndex];
+    }
     const uint32_t kSyncBlockSize=self->kSyncBlockSize;
     const hpatch_StreamPos_t endPos=kSyncBlockSize*((hpatch_StreamPos_t)blockIndex+1);
     if (endPos<=self->newDataSize){
@@ -58,7 +63,7 @@ hpatch_inline static
 //out_skipBitsInFirstCodeByte&out_lastByteHalfBits can null, only for zsync;
 uint32_t TNewDataSyncInfo_syncBlockSize(const TNewDataSyncInfo* self,uint32_t blockIndex,
                                         hpatch_byte* out_skipBitsInFirstCodeByte,hpatch_byte* out_lastByteHalfBits){
-    assert((self->kSyncBlockSize*(hpatch_StreamPos_t)blockIndex)<self->newDataSize);
+    assert(blockIndex<TNewDataSyncInfo_blockCount(self));
     if (self->isSavedBitsSizes){
         assert(self->savedBitsInfos);
         const savedBitsInfo_t& bitsInfo=self->savedBitsInfos[blockIndex];
@@ -80,6 +85,20 @@ inline static hpatch_uint64_t roll_hash_start(const adler_data_t* pdata,size_t n
 hpatch_force_inline static uint64_t roll_hash_roll(uint64_t adler,size_t blockSize,
                                                    adler_data_t out_data,adler_data_t in_data){
                                         return fast_adler64_roll(adler,blockSize,out_data,in_data); }
+//same as call roll_hash_roll() n times & out every rolled hash, but sum & adler not packed in the loop
+static hpatch_inline void roll_hash_roll_n(hpatch_uint64_t adler,size_t blockSize,const adler_data_t* pdata,
+                                           size_t n,hpatch_uint64_t* out_hashs){
+    const uint32_t* table=_private_fast_adler64_table;
+    const adler_data_t* pdata_in=pdata+blockSize;
+    uint32_t radler=(uint32_t)adler;
+    uint32_t sum=(uint32_t)(adler>>32);
+    for (size_t i=0;i<n;++i){
+        const uint32_t out_v=table[(unsigned char)pdata[i]];
+        radler+=table[(unsigned char)pdata_in[i]]-out_v;
+        sum+=radler-(ADLER_INITIAL+((uint32_t)blockSize)*out_v);
+        out_hashs[i]=radler|(((hpatch_uint64_t)sum)<<32);
+    }
+}
     
 #define kStrongChecksumByteSize_min    (4*8/8)
     
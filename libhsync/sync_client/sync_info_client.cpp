@@ -28,8 +28,15 @@
  */
 #include "sync_info_client.h"
 #include "sync_client_type_private.h"
+#include "cdc_chunker.h"
 #include "../../file_for_patch.h"
 #include "../../libHDiffPatch/HPatch/patch_private.h"
+#ifdef _WIN32
+#   include <windows.h> //MapViewOfFile
+#   include <io.h> //_get_osfhandle
+#else
+#   include <sys/mman.h> //mmap
+#endif
 #if (_IS_NEED_DIR_DIFF_PATCH)
 #include "../../dirDiffPatch/dir_patch/dir_patch_tools.h"
 #include "../../dirDiffPatch/dir_diff/dir_diff_tools.h"
@@ -165,15 +172,27 @@ hpatch_BOOL _clip_readUIntTo(TUInt* result,TStreamCacheClip* sclip){
 } //namespace sync_private
 using namespace sync_private;
 
+static const char* kMappableSyncInfoType="HSyniMap23";
+
 static
-TSyncClient_resultType _checkNewSyncInfoType(TStreamCacheClip* newSyncInfo_clip,hpatch_BOOL* out_newIsDir){
+TSyncClient_resultType _checkNewSyncInfoType(TStreamCacheClip* newSyncInfo_clip,hpatch_BOOL* out_newIsDir,
+                                             hpatch_BOOL* out_isCdc=0,hpatch_BOOL* out_isMappable=0){
     char  tempType[hpatch_kMaxPluginTypeLength+1];
     TSyncClient_resultType result=kSyncClient_ok;
     int _inClear=0;
     check(_TStreamCacheClip_readType_end(newSyncInfo_clip,'&',tempType),
           kSyncClient_newSyncInfoTypeError);
+    if (out_isCdc) *out_isCdc=hpatch_FALSE;
+    if (out_isMappable) *out_isMappable=hpatch_FALSE;
     if (0==strcmp(tempType,"HSyni23"))
         *out_newIsDir=hpatch_FALSE;
+    else if (0==strcmp(tempType,"HCdcSyni23")){
+        *out_newIsDir=hpatch_FALSE;
+        if (out_isCdc) *out_isCdc=hpatch_TRUE;
+    }else if (0==strcmp(tempType,kMappableSyncInfoType)){
+        *out_newIsDir=hpatch_FALSE;
+        if (out_isMappable) *out_isMappable=hpatch_TRUE;
+    }
 #if (_IS_NEED_DIR_DIFF_PATCH)
     else if (0==strcmp(tempType,"HDirSyni23"))
         *out_newIsDir=hpatch_TRUE;
@@ -222,6 +241,20 @@ static bool readSamePairListTo(TStreamCacheClip* codeClip,TSameNewBlockPair* sam
     return true;
 }
 
+static bool readCdcBlockSizesTo(TStreamCacheClip* codeClip,TNewDataSyncInfo* self){
+    const uint32_t kMinSize=cdcMinBlockSize(self->cdcAvgBlockSize);
+    hpatch_StreamPos_t sumSize=0;
+    for (uint32_t i=0; i<self->cdcBlockCount; ++i){
+        uint32_t v;
+        if (!_clip_unpackToUInt32(&v,codeClip)) return false;
+        if ((v==0)||(v>self->kSyncBlockSize)) return false;
+        if ((v<kMinSize)&&(i+1<self->cdcBlockCount)) return false; //only last block can less than min size
+        self->cdcBlockSizes[i]=v;
+        sumSize+=v;
+    }
+    return (sumSize==self->newDataSize);
+}
+
 static bool _clip_readSavedSize(uint32_t* value,uint32_t* tag,TStreamCacheClip* codeClip){
     const hpatch_byte* buf=_TStreamCacheClip_accessData(codeClip,1);
     if (buf==0) return false;
@@ -306,6 +339,368 @@ static hpatch_BOOL _readDirHead(TNewDataSyncInfo_dir* dirInfo,TStreamCacheClip*
 }
 #endif
 
+//mappable .hsyni ("HSyniMap23"): uncompressed & aligned layout, all values saved as little-endian;
+//  types string "HSyniMap23&compressType&strongChecksumType\0", head fields (fixed size),
+//  [savedNewDataCheckChecksum,infoChecksum,infoPartHashChecksum], samePairList, [cdcBlockSizes], [savedSizes],
+//  rollHashs & partChecksums (every block, same blocks not skipped), checksum of the all data before it.
+static const size_t kMappableAlign=8;
+static const size_t kMappableHeadFieldsSize=8*6+4*7+4+kDecompressInfoMaxSize;
+
+struct TMappableLayout{
+    hpatch_StreamPos_t  fieldsPos;
+    hpatch_StreamPos_t  checksumsPos;
+    hpatch_StreamPos_t  samePairListPos;
+    hpatch_StreamPos_t  cdcBlockSizesPos;
+    hpatch_StreamPos_t  savedSizesPos;
+    hpatch_StreamPos_t  rollHashsPos;
+    hpatch_StreamPos_t  partChecksumsPos;
+    hpatch_StreamPos_t  mappedChecksumPos;
+    hpatch_StreamPos_t  mappedSize;
+};
+
+hpatch_inline static
+hpatch_StreamPos_t _mappableAlign(hpatch_StreamPos_t pos){
+    return (pos+(kMappableAlign-1))&(~(hpatch_StreamPos_t)(kMappableAlign-1)); }
+
+static void _getMappableLayout(TMappableLayout* out,size_t typesSize,const TNewDataSyncInfo* self,size_t kStrongChecksumByteSize,
+                               uint32_t kBlockCount,bool isSavedSizes){
+    out->fieldsPos=_mappableAlign(typesSize);
+    out->checksumsPos=out->fieldsPos+kMappableHeadFieldsSize;
+    out->samePairListPos=_mappableAlign(out->checksumsPos+kStrongChecksumByteSize*3);
+    out->cdcBlockSizesPos=out->samePairListPos+sizeof(TSameNewBlockPair)*(hpatch_StreamPos_t)self->samePairCount;
+    out->savedSizesPos=out->cdcBlockSizesPos+(self->cdcAvgBlockSize?sizeof(uint32_t)*(hpatch_StreamPos_t)kBlockCount:0);
+    out->rollHashsPos=_mappableAlign(out->savedSizesPos+(isSavedSizes?sizeof(uint32_t)*(hpatch_StreamPos_t)kBlockCount:0));
+    out->partChecksumsPos=_mappableAlign(out->rollHashsPos+self->savedRollHashByteSize*(hpatch_StreamPos_t)kBlockCount);
+    out->mappedChecksumPos=_mappableAlign(out->partChecksumsPos+self->savedStrongChecksumByteSize*(hpatch_StreamPos_t)kBlockCount);
+    out->mappedSize=out->mappedChecksumPos+kStrongChecksumByteSize;
+}
+
+hpatch_inline static
+bool _isHostLittleEndian(){ const uint32_t v=1; return 1==*(const TByte*)&v; }
+hpatch_inline static
+hpatch_StreamPos_t _readLE(const TByte* p,size_t byteSize){
+    hpatch_StreamPos_t v=0;
+    while (byteSize>0) v=(v<<8)|p[--byteSize];
+    return v;
+}
+hpatch_inline static
+void _writeLE(TByte* p,hpatch_StreamPos_t v,size_t byteSize){
+    for (size_t i=0;i<byteSize;++i,v>>=8) p[i]=(TByte)v;
+}
+template<class TUInt>
+hpatch_inline static
+bool _readLETo(TUInt* out_v,const TByte* p,size_t byteSize){
+    hpatch_StreamPos_t v=_readLE(p,byteSize);
+    *out_v=(TUInt)v;
+    return (*out_v)==v;
+}
+static void _readLEsTo(uint32_t* dst,const TByte* src,size_t count){
+    for (size_t i=0;i<count;++i,src+=4)
+        dst[i]=(uint32_t)_readLE(src,4);
+}
+
+struct TMappableWriter{
+    inline TMappableWriter(const hpatch_TStreamOutput* _out,hpatch_TChecksum* _checksumPlugin,hpatch_checksumHandle _checksum)
+        :out(_out),checksumPlugin(_checksumPlugin),checksum(_checksum),pos(0){}
+    bool write(const TByte* data,size_t size){
+        if (size==0) return true;
+        if (!out->write(out,pos,data,data+size)) return false;
+        checksumPlugin->append(checksum,data,data+size);
+        pos+=size;
+        return true;
+    }
+    bool writeUInt(hpatch_StreamPos_t v,size_t byteSize){
+        TByte buf[sizeof(hpatch_StreamPos_t)];
+        _writeLE(buf,v,byteSize);
+        return write(buf,byteSize);
+    }
+    bool writeUInt32s(const uint32_t* values,size_t count){
+        TByte buf[4*256];
+        while (count>0){
+            size_t n=(count<256)?count:256;
+            for (size_t i=0;i<n;++i)
+                _writeLE(buf+i*4,values[i],4);
+            if (!write(buf,n*4)) return false;
+            values+=n;
+            count-=n;
+        }
+        return true;
+    }
+    bool padTo(hpatch_StreamPos_t dstPos){
+        static const TByte _zeros[kMappableAlign]={0};
+        assert(dstPos>=pos);
+        while (pos<dstPos){
+            size_t n=(dstPos-pos<kMappableAlign)?(size_t)(dstPos-pos):kMappableAlign;
+            if (!write(_zeros,n)) return false;
+        }
+        return true;
+    }
+    const hpatch_TStreamOutput* out;
+    hpatch_TChecksum*           checksumPlugin;
+    hpatch_checksumHandle       checksum;
+    hpatch_StreamPos_t          pos;
+};
+
+//map the file data to memory (read only); the view is valid after the file closed
+static const TByte* _mmapFile(hpatch_FileHandle file,hpatch_StreamPos_t fileSize){
+    if ((fileSize==0)||(fileSize!=(size_t)fileSize)) return 0;
+#ifdef _WIN32
+    HANDLE hFile=(HANDLE)_get_osfhandle(_fileno(file));
+    if (hFile==INVALID_HANDLE_VALUE) return 0;
+    HANDLE hMap=CreateFileMappingW(hFile,0,PAGE_READONLY,0,0,0);
+    if (hMap==0) return 0;
+    void* view=MapViewOfFile(hMap,FILE_MAP_READ,0,0,(SIZE_T)fileSize);
+    CloseHandle(hMap); //the view keep the mapping
+    return (const TByte*)view;
+#else
+    void* view=mmap(0,(size_t)fileSize,PROT_READ,MAP_SHARED,fileno(file),0);
+    return (view!=MAP_FAILED)?(const TByte*)view:0;
+#endif
+}
+static void _munmapFile(void* view,size_t viewSize){
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view,viewSize);
+#endif
+}
+
+static TSyncClient_resultType
+    _TNewDataSyncInfo_open_by_mappable(TNewDataSyncInfo* self,const TByte* data,size_t dataSize,hpatch_BOOL isIgnoreCompressInfo,
+                                       hpatch_BOOL isCheckMappedChecksum,ISyncInfoListener* listener){
+    assert((self->_import==0)&&(self->_extraMem==0));
+    hpatch_TChecksum*   strongChecksumPlugin=0;
+    hpatch_checksumHandle checksumHandle=0;
+    TSyncClient_resultType result=kSyncClient_ok;
+    int _inClear=0;
+
+    hpatch_BOOL newIsDir=hpatch_FALSE;
+    hpatch_BOOL isMappable=hpatch_FALSE;
+    const char* checksumType=0;
+    char  compressType[hpatch_kMaxPluginTypeLength+1];
+    size_t typesSize=0;
+    uint32_t kBlockCount=0;
+    size_t kStrongChecksumByteSize=0;
+    uint8_t isSavedSizes=0;
+    TMappableLayout layout;
+    //the uint32 lists used in place when the data is aligned little-endian, else copy them to _import
+    const bool isInPlace=_isHostLittleEndian()&&(0==(((size_t)data)&(kMappableAlign-1)));
+    {//types
+        char  tempType[hpatch_kMaxPluginTypeLength+1];
+        TByte temp_cache[hpatch_kStreamCacheSize];
+        hpatch_TStreamInput  memStream;
+        TStreamCacheClip     clip;
+        mem_as_hStreamInput(&memStream,data,data+dataSize);
+        _TStreamCacheClip_init(&clip,&memStream,0,memStream.streamSize,temp_cache,sizeof(temp_cache));
+        result=_checkNewSyncInfoType(&clip,&newIsDir,0,&isMappable);
+        check(result==kSyncClient_ok,result);
+        check(isMappable,kSyncClient_newSyncInfoTypeError);
+        check(_TStreamCacheClip_readType_end(&clip,'&',compressType),kSyncClient_noDecompressPluginError);
+        check(_TStreamCacheClip_readType_end(&clip,'\0',tempType),kSyncClient_noStrongChecksumPluginError);
+        strongChecksumPlugin=listener->findChecksumPlugin(listener,tempType);
+        check(strongChecksumPlugin!=0,kSyncClient_noStrongChecksumPluginError);
+        checksumType=strongChecksumPlugin->checksumType();
+        check(0==strcmp(tempType,checksumType),kSyncClient_noStrongChecksumPluginError);
+        self->strongChecksumPlugin=strongChecksumPlugin;
+        self->fileChecksumPlugin=strongChecksumPlugin;
+        typesSize=(size_t)_TStreamCacheClip_readPosOfSrcStream(&clip);
+    }
+    {//head fields
+        const TByte* p=data+_mappableAlign(typesSize);
+        hpatch_StreamPos_t mappedSize;
+        uint32_t v32;
+        check(_mappableAlign(typesSize)+kMappableHeadFieldsSize<=dataSize,kSyncClient_newSyncInfoDataError);
+        mappedSize=_readLE(p,8); p+=8;
+        check(mappedSize==dataSize,kSyncClient_newSyncInfoDataError);
+        self->newSyncInfoSize=_readLE(p,8); p+=8;
+        self->newDataSize=_readLE(p,8); p+=8;
+        self->newSyncDataSize=_readLE(p,8); p+=8;
+        self->newSyncDataOffsert=_readLE(p,8); p+=8;
+        check(_readLETo(&self->dictSize,p,8),kSyncClient_newSyncInfoDataError); p+=8;
+        self->kSyncBlockSize=(uint32_t)_readLE(p,4); p+=4;
+        self->cdcAvgBlockSize=(uint32_t)_readLE(p,4); p+=4;
+        self->cdcBlockCount=(uint32_t)_readLE(p,4); p+=4;
+        self->samePairCount=(uint32_t)_readLE(p,4); p+=4;
+        kStrongChecksumByteSize=(uint32_t)_readLE(p,4); p+=4;
+        v32=(uint32_t)_readLE(p,4); p+=4;
+        self->savedStrongChecksumBits=v32;
+        v32=(uint32_t)_readLE(p,4); p+=4;
+        self->savedRollHashBits=v32;
+        isSavedSizes=p[0];
+        self->decompressInfoSize=p[1];
+        p+=4;
+        check(self->decompressInfoSize<=kDecompressInfoMaxSize,kSyncClient_newSyncInfoDataError);
+        memcpy(self->decompressInfo,p,self->decompressInfoSize);
+
+        if (strlen(compressType)>0){
+            hsync_TDictDecompress* decompressPlugin=listener->findDecompressPlugin(listener,compressType,self->dictSize);
+            check(decompressPlugin!=0,kSyncClient_noDecompressPluginError);
+            self->_decompressPlugin=decompressPlugin;
+        }else{
+            check(!isSavedSizes,kSyncClient_newSyncInfoDataError);
+        }
+        if (self->cdcAvgBlockSize){
+            check(self->_decompressPlugin==0,kSyncClient_newSyncInfoDataError);
+            check(cdcIsValidAvgBlockSize(self->cdcAvgBlockSize)
+                  &&(self->kSyncBlockSize==cdcMaxBlockSize(self->cdcAvgBlockSize)),kSyncClient_newSyncInfoDataError);
+            check((self->cdcBlockCount<=self->newDataSize/cdcMinBlockSize(self->cdcAvgBlockSize)+1)
+                  &&((self->cdcBlockCount>0)==(self->newDataSize>0)),kSyncClient_newSyncInfoDataError);
+        }else{
+            check((self->kSyncBlockSize<=(self->newDataSize<=_kSyncBlockSize_min_limit?_kSyncBlockSize_min_limit:self->newDataSize))
+                  &&(self->kSyncBlockSize>=_kSyncBlockSize_min_limit),kSyncClient_newSyncInfoDataError);
+            check(self->cdcBlockCount==0,kSyncClient_newSyncInfoDataError);
+        }
+        check(strongChecksumPlugin->checksumByteSize()==kStrongChecksumByteSize,
+              kSyncClient_strongChecksumByteSizeError);
+        self->savedStrongChecksumByteSize=_bitsToBytes(self->savedStrongChecksumBits);
+        check((self->savedStrongChecksumByteSize<=kStrongChecksumByteSize),
+              kSyncClient_strongChecksumByteSizeError);
+        check((size_t)(self->savedRollHashBits-1)<sizeof(uint64_t)*8,kSyncClient_newSyncInfoDataError);
+        self->savedRollHashByteSize=_bitsToBytes(self->savedRollHashBits);
+        {
+            hpatch_StreamPos_t v=TNewDataSyncInfo_blockCount(self);
+            kBlockCount=(uint32_t)v;
+            check((kBlockCount==v),kSyncClient_newSyncInfoDataError);
+        }
+        check(self->samePairCount<=kBlockCount,kSyncClient_newSyncInfoDataError);
+        _getMappableLayout(&layout,typesSize,self,kStrongChecksumByteSize,kBlockCount,isSavedSizes!=0);
+        check(layout.mappedSize==dataSize,kSyncClient_newSyncInfoDataError);
+    }
+    if (isCheckMappedChecksum){
+        TByte strongChecksumInfo[hpatch_kStreamCacheSize];
+        check(kStrongChecksumByteSize<=sizeof(strongChecksumInfo),kSyncClient_strongChecksumByteSizeError);
+        checksumHandle=strongChecksumPlugin->open(strongChecksumPlugin);
+        check(checksumHandle!=0,kSyncClient_strongChecksumOpenError);
+        strongChecksumPlugin->begin(checksumHandle);
+        strongChecksumPlugin->append(checksumHandle,data,data+(size_t)layout.mappedChecksumPos);
+        strongChecksumPlugin->end(checksumHandle,strongChecksumInfo,strongChecksumInfo+kStrongChecksumByteSize);
+        check(0==memcmp(strongChecksumInfo,data+(size_t)layout.mappedChecksumPos,kStrongChecksumByteSize),
+              kSyncClient_newSyncInfoChecksumError);
+    }
+    {//mem
+        const bool isLoadSavedSizes=isSavedSizes&&(!isIgnoreCompressInfo);
+        size_t memSize=strlen(compressType)+1+strlen(checksumType)+1+sizeof(hpatch_StreamPos_t)*2
+                      +kStrongChecksumByteSize*2+checkChecksumBufByteSize(kStrongChecksumByteSize);
+        if (!isInPlace){
+            memSize+=sizeof(TSameNewBlockPair)*(size_t)self->samePairCount;
+            if (self->cdcAvgBlockSize)
+                memSize+=sizeof(uint32_t)*(size_t)kBlockCount;
+            if (isLoadSavedSizes)
+                memSize+=sizeof(uint32_t)*(size_t)kBlockCount;
+        }
+        TByte* curMem=(TByte*)malloc(memSize);
+        check(curMem!=0,kSyncClient_memError);
+        self->_import=curMem;
+        if (self->_decompressPlugin!=0){
+            self->compressType=(const char*)curMem;
+            curMem+=strlen(compressType)+1;
+            memcpy((TByte*)self->compressType,compressType,strlen(compressType)+1);
+        }
+        self->strongChecksumType=(const char*)curMem;
+        curMem+=strlen(checksumType)+1;
+        memcpy((TByte*)self->strongChecksumType,checksumType,curMem-(TByte*)self->strongChecksumType);
+
+        curMem=(TByte*)_hpatch_align_upper(curMem,sizeof(hpatch_StreamPos_t));
+        self->infoChecksum=curMem;
+        curMem+=kStrongChecksumByteSize;
+        self->infoPartHashChecksum=curMem;
+        curMem+=kStrongChecksumByteSize;
+        self->savedNewDataCheckChecksum=curMem; //it's a work buf
+        curMem+=checkChecksumBufByteSize(kStrongChecksumByteSize);
+        {
+            const TByte* checksums=data+(size_t)layout.checksumsPos;
+            memcpy(self->savedNewDataCheckChecksum,checksums,kStrongChecksumByteSize);
+            memcpy(self->infoChecksum,checksums+kStrongChecksumByteSize,kStrongChecksumByteSize);
+            memcpy(self->infoPartHashChecksum,checksums+kStrongChecksumByteSize*2,kStrongChecksumByteSize);
+        }
+
+        if (isInPlace){
+            self->samePairList=(TSameNewBlockPair*)(data+(size_t)layout.samePairListPos);
+            if (self->cdcAvgBlockSize)
+                self->cdcBlockSizes=(uint32_t*)(data+(size_t)layout.cdcBlockSizesPos);
+            if (isLoadSavedSizes)
+                self->savedSizes=(uint32_t*)(data+(size_t)layout.savedSizesPos);
+        }else{
+            curMem=(TByte*)_hpatch_align_upper(curMem,sizeof(hpatch_StreamPos_t));
+            self->samePairList=(TSameNewBlockPair*)curMem;
+            _readLEsTo((uint32_t*)curMem,data+(size_t)layout.samePairListPos,self->samePairCount*(size_t)2);
+            curMem+=sizeof(TSameNewBlockPair)*(size_t)self->samePairCount;
+            if (self->cdcAvgBlockSize){
+                self->cdcBlockSizes=(uint32_t*)curMem;
+                _readLEsTo(self->cdcBlockSizes,data+(size_t)layout.cdcBlockSizesPos,kBlockCount);
+                curMem+=sizeof(uint32_t)*(size_t)kBlockCount;
+            }
+            if (isLoadSavedSizes){
+                self->savedSizes=(uint32_t*)curMem;
+                _readLEsTo(self->savedSizes,data+(size_t)layout.savedSizesPos,kBlockCount);
+                curMem+=sizeof(uint32_t)*(size_t)kBlockCount;
+            }
+        }
+        assert(curMem<=(TByte*)self->_import+memSize);
+        self->rollHashs=(uint8_t*)(data+(size_t)layout.rollHashsPos);
+        self->partChecksums=(uint8_t*)(data+(size_t)layout.partChecksumsPos);
+    }
+    {//check lists, match & sync index blocks by them
+        uint32_t pre=0;
+        for (size_t i=0;i<self->samePairCount;++i){
+            const TSameNewBlockPair& sp=self->samePairList[i];
+            check((sp.curIndex>=pre)&&(sp.curIndex<kBlockCount)&&(sp.sameIndex<=sp.curIndex),
+                  kSyncClient_newSyncInfoDataError);
+            pre=sp.curIndex;
+        }
+        if (self->cdcAvgBlockSize){
+            const uint32_t kMinSize=cdcMinBlockSize(self->cdcAvgBlockSize);
+            hpatch_StreamPos_t sumSize=0;
+            for (uint32_t i=0;i<kBlockCount;++i){
+                const uint32_t v=self->cdcBlockSizes[i];
+                check((v>0)&&(v<=self->kSyncBlockSize)&&((v>=kMinSize)||(i+1==kBlockCount)),
+                      kSyncClient_newSyncInfoDataError);
+                sumSize+=v;
+            }
+            check(sumSize==self->newDataSize,kSyncClient_newSyncInfoDataError);
+        }
+        if (self->savedSizes){
+            hpatch_StreamPos_t sumSavedSize=0;
+            for (uint32_t i=0;i<kBlockCount;++i){
+                const uint32_t savedSize=self->savedSizes[i];
+                sumSavedSize+=(savedSize>0)?savedSize:TNewDataSyncInfo_newDataBlockSize(self,i);
+            }
+            check(sumSavedSize<=self->newSyncDataSize,kSyncClient_newSyncInfoDataError);
+        }
+    }
+    if (isIgnoreCompressInfo){
+        self->compressType=0;
+        self->_decompressPlugin=0;
+    }
+
+clear:
+    _inClear=1;
+    if (checksumHandle) strongChecksumPlugin->close(strongChecksumPlugin,checksumHandle);
+    if (result!=kSyncClient_ok) TNewDataSyncInfo_close(self);
+    return result;
+}
+
+static TSyncClient_resultType
+    _TNewDataSyncInfo_open_by_mappable_stream(TNewDataSyncInfo* self,const hpatch_TStreamInput* newSyncInfo,
+                                              hpatch_BOOL isIgnoreCompressInfo,ISyncInfoListener *listener){
+    TSyncClient_resultType result=kSyncClient_ok;
+    int _inClear=0;
+    TByte* buf=0;
+    check(newSyncInfo->streamSize==(size_t)newSyncInfo->streamSize,kSyncClient_memError);
+    buf=(TByte*)malloc((size_t)newSyncInfo->streamSize);
+    check(buf!=0,kSyncClient_memError);
+    check(newSyncInfo->read(newSyncInfo,0,buf,buf+(size_t)newSyncInfo->streamSize),kSyncClient_newSyncInfoDataError);
+    result=_TNewDataSyncInfo_open_by_mappable(self,buf,(size_t)newSyncInfo->streamSize,isIgnoreCompressInfo,hpatch_TRUE,listener);
+    if (result==kSyncClient_ok){
+        self->_extraMem=buf; //free mem by close
+        buf=0;
+    }
+clear:
+    _inClear=1;
+    if (buf) free(buf);
+    return result;
+}
+
 static TSyncClient_resultType
     _TNewDataSyncInfo_open(TNewDataSyncInfo* self,const hpatch_TStreamInput* newSyncInfo,hpatch_BOOL isIgnoreCompressInfo,
                            ISyncInfoListener *listener){
@@ -317,6 +712,8 @@ static TSyncClient_resultType
     int _inClear=0;
 
     hpatch_BOOL newIsDir_byType=hpatch_FALSE;
+    hpatch_BOOL isCdc_byType=hpatch_FALSE;
+    hpatch_BOOL isMappable_byType=hpatch_FALSE;
     uint32_t    kBlockCount=0;
     const char* checksumType=0;
     char  compressType[hpatch_kMaxPluginTypeLength+1];
@@ -341,8 +738,12 @@ static TSyncClient_resultType
         _TStreamCacheClip_init(&clip,newSyncInfo,0,newSyncInfo->streamSize,
                                temp_cache,isChecksumNewSyncInfo?kHeadCacheSize:kFileIOBufBetterSize);
         {//type
-            result=_checkNewSyncInfoType(&clip,&newIsDir_byType);
+            result=_checkNewSyncInfoType(&clip,&newIsDir_byType,&isCdc_byType,&isMappable_byType);
             check(result==kSyncClient_ok,result);
+            if (isMappable_byType){ //not mmap by stream, load all data to mem & use it in place
+                result=_TNewDataSyncInfo_open_by_mappable_stream(self,newSyncInfo,isIgnoreCompressInfo,listener);
+                goto clear;
+            }
         }
         {//read compressType
             check(_TStreamCacheClip_readType_end(&clip,'&',compressType),kSyncClient_noDecompressPluginError);
@@ -379,8 +780,18 @@ static TSyncClient_resultType
         }
 
         check(_clip_unpackToUInt32(&self->kSyncBlockSize,&clip),kSyncClient_newSyncInfoDataError);
-        check((self->kSyncBlockSize<=(self->newDataSize<=_kSyncBlockSize_min_limit?_kSyncBlockSize_min_limit:self->newDataSize))
-              &&(self->kSyncBlockSize>=_kSyncBlockSize_min_limit),kSyncClient_newSyncInfoDataError);
+        if (isCdc_byType){
+            check(decompressPlugin==0,kSyncClient_newSyncInfoDataError); //now cdc blocks not support compressed
+            check(_clip_unpackToUInt32(&self->cdcAvgBlockSize,&clip),kSyncClient_newSyncInfoDataError);
+            check(cdcIsValidAvgBlockSize(self->cdcAvgBlockSize)
+                  &&(self->kSyncBlockSize==cdcMaxBlockSize(self->cdcAvgBlockSize)),kSyncClient_newSyncInfoDataError);
+            check(_clip_unpackToUInt32(&self->cdcBlockCount,&clip),kSyncClient_newSyncInfoDataError);
+            check((self->cdcBlockCount<=self->newDataSize/cdcMinBlockSize(self->cdcAvgBlockSize)+1)
+                  &&((self->cdcBlockCount>0)==(self->newDataSize>0)),kSyncClient_newSyncInfoDataError);
+        }else{
+            check((self->kSyncBlockSize<=(self->newDataSize<=_kSyncBlockSize_min_limit?_kSyncBlockSize_min_limit:self->newDataSize))
+                  &&(self->kSyncBlockSize>=_kSyncBlockSize_min_limit),kSyncClient_newSyncInfoDataError);
+        }
         check(_clip_unpackToSize_t(&kStrongChecksumByteSize,&clip),kSyncClient_newSyncInfoDataError);
         check(strongChecksumPlugin->checksumByteSize()==kStrongChecksumByteSize,
               kSyncClient_strongChecksumByteSizeError);
@@ -431,6 +842,8 @@ static TSyncClient_resultType
         memSize+=self->samePairCount*sizeof(TSameNewBlockPair);
         if (isSavedSizes&&(!isIgnoreCompressInfo))
             memSize+=sizeof(uint32_t)*(hpatch_StreamPos_t)kBlockCount;
+        if (self->cdcAvgBlockSize)
+            memSize+=sizeof(uint32_t)*(hpatch_StreamPos_t)kBlockCount;
 #if (_IS_NEED_DIR_DIFF_PATCH)
         if (self->isDirSyncInfo){
             self->dirInfo.dir_newNameList_isCString=hpatch_TRUE;
@@ -473,6 +886,10 @@ static TSyncClient_resultType
             self->savedSizes=(uint32_t*)curMem;
             curMem+=sizeof(uint32_t)*(size_t)kBlockCount;
         }
+        if (self->cdcAvgBlockSize){
+            self->cdcBlockSizes=(uint32_t*)curMem;
+            curMem+=sizeof(uint32_t)*(size_t)kBlockCount;
+        }
 #if (_IS_NEED_DIR_DIFF_PATCH)
         if (self->isDirSyncInfo){
             curMem=(TByte*)_hpatch_align_upper(curMem,sizeof(hpatch_StreamPos_t));
@@ -550,6 +967,8 @@ static TSyncClient_resultType
         //samePairList
         check(readSamePairListTo(codeClip,self->samePairList,self->samePairCount,kBlockCount),
               kSyncClient_newSyncInfoDataError);
+        if (self->cdcAvgBlockSize) //cdcBlockSizes
+            check(readCdcBlockSizesTo(codeClip,self),kSyncClient_newSyncInfoDataError);
         if (isSavedSizes) //savedSizes
             check(readSavedSizesTo(codeClip,self,isIgnoreCompressInfo),kSyncClient_newSyncInfoDataError);
         else
@@ -651,6 +1070,7 @@ void TNewDataSyncInfo_close(TNewDataSyncInfo* self){
     if (self==0) return;
     if (self->_import!=0) free(self->_import);
     if (self->_extraMem!=0) free(self->_extraMem);
+    if (self->_mapped!=0) _munmapFile(self->_mapped,self->_mappedSize);
     TNewDataSyncInfo_init(self);
 }
 
@@ -678,3 +1098,120 @@ clear:
     return result;
 }
 
+TSyncClient_resultType TNewDataSyncInfo_open_by_mappable(TNewDataSyncInfo* self,const hpatch_byte* mappableData,size_t mappableSize,
+                                                         hpatch_BOOL isIgnoreCompressInfo,hpatch_BOOL isCheckMappedChecksum,
+                                                         ISyncInfoListener* listener){
+    TSyncClient_resultType result=_TNewDataSyncInfo_open_by_mappable(self,mappableData,mappableSize,isIgnoreCompressInfo,
+                                                                     isCheckMappedChecksum,listener);
+    if ((result==kSyncClient_ok)&&listener->onLoadedNewSyncInfo)
+        listener->onLoadedNewSyncInfo(listener,self);
+    return result;
+}
+
+TSyncClient_resultType TNewDataSyncInfo_open_by_mmap_file(TNewDataSyncInfo* self,const char* mappableFile,hpatch_BOOL isIgnoreCompressInfo,
+                                                          hpatch_BOOL isCheckMappedChecksum,ISyncInfoListener* listener){
+    hpatch_TFileStreamInput  newSyncInfo;
+    hpatch_TFileStreamInput_init(&newSyncInfo);
+    TSyncClient_resultType result=kSyncClient_ok;
+    int _inClear=0;
+    const TByte* mapped=0;
+    check(hpatch_TFileStreamInput_open(&newSyncInfo,mappableFile), kSyncClient_newSyncInfoOpenError);
+    mapped=_mmapFile(newSyncInfo.m_file,newSyncInfo.base.streamSize);
+    check(mapped!=0,kSyncClient_newSyncInfoOpenError);
+    result=_TNewDataSyncInfo_open_by_mappable(self,mapped,(size_t)newSyncInfo.base.streamSize,isIgnoreCompressInfo,
+                                              isCheckMappedChecksum,listener);
+    if (result==kSyncClient_ok){
+        self->_mapped=(void*)mapped; //unmap by close
+        self->_mappedSize=(size_t)newSyncInfo.base.streamSize;
+        mapped=0;
+    }
+clear:
+    _inClear=1;
+    if (mapped) _munmapFile((void*)mapped,(size_t)newSyncInfo.base.streamSize);
+    check(hpatch_TFileStreamInput_close(&newSyncInfo), kSyncClient_newSyncInfoCloseError);
+    if ((result==kSyncClient_ok)&&listener->onLoadedNewSyncInfo)
+        listener->onLoadedNewSyncInfo(listener,self);
+    return result;
+}
+
+TSyncClient_resultType TNewDataSyncInfo_saveMappableTo(const TNewDataSyncInfo* self,const hpatch_TStreamOutput* out_stream){
+    hpatch_TChecksum*     strongChecksumPlugin=self->strongChecksumPlugin;
+    hpatch_checksumHandle checksumHandle=0;
+    TSyncClient_resultType result=kSyncClient_ok;
+    int _inClear=0;
+    const char* compressType=self->compressType?self->compressType:"";
+    const size_t kStrongChecksumByteSize=strongChecksumPlugin->checksumByteSize();
+    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(self);
+    const bool isSavedSizes=(self->savedSizes!=0);
+    TMappableLayout layout;
+    check(!self->isDirSyncInfo,kSyncClient_newSyncInfoTypeError); //now not support dir
+    check(!self->isSavedBitsSizes,kSyncClient_newSyncInfoTypeError);
+    checksumHandle=strongChecksumPlugin->open(strongChecksumPlugin);
+    check(checksumHandle!=0,kSyncClient_strongChecksumOpenError);
+    strongChecksumPlugin->begin(checksumHandle);
+    {
+        TMappableWriter wr(out_stream,strongChecksumPlugin,checksumHandle);
+        check(wr.write((const TByte*)kMappableSyncInfoType,strlen(kMappableSyncInfoType))
+              &&wr.write((const TByte*)"&",1)&&wr.write((const TByte*)compressType,strlen(compressType))
+              &&wr.write((const TByte*)"&",1)
+              &&wr.write((const TByte*)self->strongChecksumType,strlen(self->strongChecksumType)+1),
+              kSyncClient_newSyncInfoCreateError);
+        _getMappableLayout(&layout,(size_t)wr.pos,self,kStrongChecksumByteSize,kBlockCount,isSavedSizes);
+        {//head fields
+            TByte tags[4]={(TByte)(isSavedSizes?1:0),self->decompressInfoSize,0,0};
+            TByte decompressInfo[kDecompressInfoMaxSize]={0};
+            memcpy(decompressInfo,self->decompressInfo,self->decompressInfoSize);
+            check(wr.padTo(layout.fieldsPos)&&wr.writeUInt(layout.mappedSize,8)
+                  &&wr.writeUInt(self->newSyncInfoSize,8)&&wr.writeUInt(self->newDataSize,8)
+                  &&wr.writeUInt(self->newSyncDataSize,8)&&wr.writeUInt(self->newSyncDataOffsert,8)
+                  &&wr.writeUInt(self->dictSize,8)&&wr.writeUInt(self->kSyncBlockSize,4)
+                  &&wr.writeUInt(self->cdcAvgBlockSize,4)&&wr.writeUInt(self->cdcBlockCount,4)
+                  &&wr.writeUInt(self->samePairCount,4)&&wr.writeUInt(kStrongChecksumByteSize,4)
+                  &&wr.writeUInt(self->savedStrongChecksumBits,4)&&wr.writeUInt(self->savedRollHashBits,4)
+                  &&wr.write(tags,sizeof(tags))&&wr.write(decompressInfo,sizeof(decompressInfo)),
+                  kSyncClient_newSyncInfoCreateError);
+            assert(wr.pos==layout.checksumsPos);
+        }
+        check(wr.write(self->savedNewDataCheckChecksum,kStrongChecksumByteSize)
+              &&wr.write(self->infoChecksum,kStrongChecksumByteSize)
+              &&wr.write(self->infoPartHashChecksum,kStrongChecksumByteSize),kSyncClient_newSyncInfoCreateError);
+        check(wr.padTo(layout.samePairListPos)
+              &&wr.writeUInt32s((const uint32_t*)self->samePairList,self->samePairCount*(size_t)2),
+              kSyncClient_newSyncInfoCreateError);
+        if (self->cdcAvgBlockSize)
+            check(wr.writeUInt32s(self->cdcBlockSizes,kBlockCount),kSyncClient_newSyncInfoCreateError);
+        if (isSavedSizes)
+            check(wr.writeUInt32s(self->savedSizes,kBlockCount),kSyncClient_newSyncInfoCreateError);
+        check(wr.padTo(layout.rollHashsPos)
+              &&wr.write(self->rollHashs,self->savedRollHashByteSize*(size_t)kBlockCount)
+              &&wr.padTo(layout.partChecksumsPos)
+              &&wr.write(self->partChecksums,self->savedStrongChecksumByteSize*(size_t)kBlockCount)
+              &&wr.padTo(layout.mappedChecksumPos),kSyncClient_newSyncInfoCreateError);
+        {//mapped checksum
+            TByte strongChecksumInfo[hpatch_kStreamCacheSize];
+            check(kStrongChecksumByteSize<=sizeof(strongChecksumInfo),kSyncClient_strongChecksumByteSizeError);
+            strongChecksumPlugin->end(checksumHandle,strongChecksumInfo,strongChecksumInfo+kStrongChecksumByteSize);
+            check(out_stream->write(out_stream,wr.pos,strongChecksumInfo,strongChecksumInfo+kStrongChecksumByteSize),
+                  kSyncClient_newSyncInfoCreateError);
+            assert(wr.pos+kStrongChecksumByteSize==layout.mappedSize);
+        }
+    }
+clear:
+    _inClear=1;
+    if (checksumHandle) strongChecksumPlugin->close(strongChecksumPlugin,checksumHandle);
+    return result;
+}
+
+TSyncClient_resultType TNewDataSyncInfo_saveMappable_by_file(const TNewDataSyncInfo* self,const char* outMappableFile){
+    hpatch_TFileStreamOutput out_stream;
+    hpatch_TFileStreamOutput_init(&out_stream);
+    TSyncClient_resultType result=kSyncClient_ok;
+    int _inClear=0;
+    check(hpatch_TFileStreamOutput_open(&out_stream,outMappableFile,~(hpatch_StreamPos_t)0),
+          kSyncClient_newSyncInfoCreateError);
+    result=TNewDataSyncInfo_saveMappableTo(self,&out_stream.base);
+clear:
+    _inClear=1;
+    check(hpatch_TFileStreamOutput_close(&out_stream),kSyncClient_newSyncInfoCloseError);
+    return result;
+}
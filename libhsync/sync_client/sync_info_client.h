@@ -126,6 +126,21 @@ TSyncClient_resultType TNewDataSyncInfo_open(TNewDataSyncInfo* self,const hpatch
                                              ISyncInfoListener* listener);
 void TNewDataSyncInfo_close(TNewDataSyncInfo* self);
 
+//mappable .hsyni: uncompressed & aligned layout of a loaded newSyncInfo, saved by client (or maker) once;
+//  open it by mmap, the rollHashs,partChecksums,... are used in place without parse & decompress,
+//  and the mapped pages are shared by concurrent clients in page cache.
+//  NOTE: self must opened with isIgnoreCompressInfo=false, for save the compress info.
+//  TNewDataSyncInfo_open() & TNewDataSyncInfo_open_by_file() also can open it (load all to memory).
+TSyncClient_resultType TNewDataSyncInfo_saveMappableTo(const TNewDataSyncInfo* self,const hpatch_TStreamOutput* out_stream);
+TSyncClient_resultType TNewDataSyncInfo_saveMappable_by_file(const TNewDataSyncInfo* self,const char* outMappableFile);
+//  mappableData must be valid until close self;
+//  isCheckMappedChecksum: if false, not read all data for checksum, only check index lists for safe.
+TSyncClient_resultType TNewDataSyncInfo_open_by_mappable(TNewDataSyncInfo* self,const hpatch_byte* mappableData,size_t mappableSize,
+                                                         hpatch_BOOL isIgnoreCompressInfo,hpatch_BOOL isCheckMappedChecksum,
+                                                         ISyncInfoListener* listener);
+TSyncClient_resultType TNewDataSyncInfo_open_by_mmap_file(TNewDataSyncInfo* self,const char* mappableFile,hpatch_BOOL isIgnoreCompressInfo,
+                                                          hpatch_BOOL isCheckMappedChecksum,ISyncInfoListener* listener);
+
 TSyncClient_resultType  checkNewSyncInfoType_by_file(const char* newSyncInfoFile,hpatch_BOOL* out_newIsDir);
 TSyncClient_resultType  checkNewSyncInfoType(const hpatch_TStreamInput* newSyncInfo,hpatch_BOOL* out_newIsDir);
 
@@ -131,7 +131,9 @@ void matchNewDataInNew(TNewDataSyncInfo* newSyncInfo){
             uint32_t newBlockIndex=*range.first;
             assert(newBlockIndex<i);
             const unsigned char* newChecksum=partChecksums+newBlockIndex*newSyncInfo->savedStrongChecksumByteSize;
-            if (0==memcmp(newChecksum,curChecksum,newSyncInfo->savedStrongChecksumByteSize)){
+            if ((0==memcmp(newChecksum,curChecksum,newSyncInfo->savedStrongChecksumByteSize))
+                &&((!newSyncInfo->cdcAvgBlockSize) //cdc blocks have different sizes
+                    ||(TNewDataSyncInfo_newDataBlockSize(newSyncInfo,newBlockIndex)==TNewDataSyncInfo_newDataBlockSize(newSyncInfo,i)))){
                 samePairList[matchedCount].curIndex=i;
                 samePairList[matchedCount].sameIndex=newBlockIndex;
                 ++matchedCount;
@@ -143,5 +145,99 @@ void matchNewDataInNew(TNewDataSyncInfo* newSyncInfo){
     newSyncInfo->samePairCount=matchedCount;
 }
 
+
+    static hpatch_inline uint8_t _firstByteMask(size_t savedBits){
+        return ((savedBits&7)==0)?0xFF:(uint8_t)((1<<(savedBits&7))-1); }
+
+//compare partChecksum saved by different savedStrongChecksumBits
+struct TPrevIndex_comp{
+    inline explicit TPrevIndex_comp(const uint8_t* _prevChecksums,size_t _prevByteSize,
+                                    size_t _cmpByteSize,uint8_t _firstByteMask)
+    :prevChecksums(_prevChecksums),prevByteSize(_prevByteSize),
+     cmpByteSize(_cmpByteSize),firstByteMask(_firstByteMask){ }
+    typedef uint32_t TIndex;
+    struct TDigest{
+        const uint8_t*  checksum;
+        inline explicit TDigest(const uint8_t* _checksum):checksum(_checksum){}
+    };
+    inline bool operator()(const TIndex x,const TDigest& y)const { //for equal_range
+        return _cmp(prevChecksums+x*prevByteSize,y.checksum)<0; }
+    inline bool operator()(const TDigest& x,const TIndex y)const { //for equal_range
+        return _cmp(x.checksum,prevChecksums+y*prevByteSize)<0; }
+    inline bool operator()(const TIndex x, const TIndex y)const {//for sort
+        int cmp=_cmp(prevChecksums+x*prevByteSize,prevChecksums+y*prevByteSize);
+        if (cmp!=0)
+            return cmp<0; //value sort
+        else
+            return x<y; //index sort
+    }
+    inline int _cmp(const uint8_t* px,const uint8_t* py)const{
+        int sub=(int)(px[0]&firstByteMask)-(py[0]&firstByteMask);
+        if ((sub!=0)||(cmpByteSize<=1)) return sub;
+        return memcmp(px+1,py+1,cmpByteSize-1);
+    }
+protected:
+    const uint8_t*  prevChecksums;
+    size_t          prevByteSize;
+    size_t          cmpByteSize;
+    uint8_t         firstByteMask;
+};
+
+bool isSameBlockInPrev(const TNewDataSyncInfo* newSyncInfo,uint32_t newBlockIndex,
+                       const TNewDataSyncInfo* prevSyncInfo,uint32_t prevBlockIndex){
+    if (TNewDataSyncInfo_newDataBlockSize(newSyncInfo,newBlockIndex)
+        !=TNewDataSyncInfo_newDataBlockSize(prevSyncInfo,prevBlockIndex)) return false;
+    if (newSyncInfo->savedRollHashBits==prevSyncInfo->savedRollHashBits){
+        const size_t byteSize=newSyncInfo->savedRollHashByteSize;
+        if (0!=memcmp(newSyncInfo->rollHashs+newBlockIndex*byteSize,
+                      prevSyncInfo->rollHashs+prevBlockIndex*byteSize,byteSize)) return false;
+    }
+    const size_t newByteSize=newSyncInfo->savedStrongChecksumByteSize;
+    const size_t prevByteSize=prevSyncInfo->savedStrongChecksumByteSize;
+    TPrevIndex_comp comp(prevSyncInfo->partChecksums,prevByteSize,(newByteSize<prevByteSize)?newByteSize:prevByteSize,
+                         _firstByteMask(newSyncInfo->savedStrongChecksumBits)&_firstByteMask(prevSyncInfo->savedStrongChecksumBits));
+    return 0==comp._cmp(newSyncInfo->partChecksums+newBlockIndex*newByteSize,
+                        prevSyncInfo->partChecksums+prevBlockIndex*prevByteSize);
+}
+
+void matchNewDataInPrev(const TNewDataSyncInfo* newSyncInfo,const TNewDataSyncInfo* prevSyncInfo,
+                        uint32_t* out_prevIndexs){
+    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(newSyncInfo);
+    const uint32_t kPrevBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(prevSyncInfo);
+    assert(newSyncInfo->kSyncBlockSize==prevSyncInfo->kSyncBlockSize);
+    TAutoMem _mem(kPrevBlockCount*(size_t)sizeof(uint32_t));
+    uint32_t* sorted_prevIndexs=(uint32_t*)_mem.data();
+    for (uint32_t i=0; i<kPrevBlockCount; ++i){
+        sorted_prevIndexs[i]=i;
+    }
+    const size_t newByteSize=newSyncInfo->savedStrongChecksumByteSize;
+    const size_t prevByteSize=prevSyncInfo->savedStrongChecksumByteSize;
+    TPrevIndex_comp icomp(prevSyncInfo->partChecksums,prevByteSize,(newByteSize<prevByteSize)?newByteSize:prevByteSize,
+                          _firstByteMask(newSyncInfo->savedStrongChecksumBits)&_firstByteMask(prevSyncInfo->savedStrongChecksumBits));
+    std::sort(sorted_prevIndexs,sorted_prevIndexs+kPrevBlockCount,icomp);
+
+    uint32_t prevIndexBack=kNoPrevBlockIndex;
+    const unsigned char* curChecksum=newSyncInfo->partChecksums;
+    for (uint32_t i=0; i<kBlockCount; ++i,curChecksum+=newByteSize){
+        uint32_t prevIndex=kNoPrevBlockIndex;
+        if ((prevIndexBack!=kNoPrevBlockIndex)&&(prevIndexBack+1<kPrevBlockCount)
+              &&isSameBlockInPrev(newSyncInfo,i,prevSyncInfo,prevIndexBack+1)){
+            prevIndex=prevIndexBack+1; //continue prev match first
+        }else{
+            TPrevIndex_comp::TDigest digest_value(curChecksum);
+            std::pair<const uint32_t*,const uint32_t*>
+                range=std::equal_range(sorted_prevIndexs,sorted_prevIndexs+kPrevBlockCount,digest_value,icomp);
+            for (;range.first!=range.second; ++range.first) {
+                if (isSameBlockInPrev(newSyncInfo,i,prevSyncInfo,*range.first)){
+                    prevIndex=*range.first;
+                    break;
+                }
+            }
+        }
+        out_prevIndexs[i]=prevIndex;
+        prevIndexBack=prevIndex;
+    }
+}
+
 }//namespace sync_private
 
@@ -34,5 +34,14 @@ namespace sync_private{
     //get samePairList\samePairCount
     void matchNewDataInNew(TNewDataSyncInfo* newSyncInfo);
 
+    static const uint32_t kNoPrevBlockIndex=~(uint32_t)0;
+    //block newBlockIndex in newSyncInfo same as block prevBlockIndex in prevSyncInfo? (by saved hashs)
+    bool isSameBlockInPrev(const TNewDataSyncInfo* newSyncInfo,uint32_t newBlockIndex,
+                           const TNewDataSyncInfo* prevSyncInfo,uint32_t prevBlockIndex);
+    //get out_prevIndexs[newBlockCount]: same block's index in prevSyncInfo, or kNoPrevBlockIndex;
+    //  newSyncInfo&prevSyncInfo need same kSyncBlockSize & strongChecksumType;
+    void matchNewDataInPrev(const TNewDataSyncInfo* newSyncInfo,const TNewDataSyncInfo* prevSyncInfo,
+                            uint32_t* out_prevIndexs);
+
 }//namespace sync_private
 #endif // match_in_new_h
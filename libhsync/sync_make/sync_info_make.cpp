@@ -29,6 +29,7 @@
 #include "sync_info_make.h"
 #include "sync_make_hash_clash.h"
 #include "../sync_client/sync_info_client.h" // TNewDataSyncInfo_dir_saveHeadTo
+#include "../sync_client/cdc_chunker.h"
 using namespace hdiff_private;
 namespace sync_private{
 
@@ -70,6 +71,11 @@ const size_t _kBestFlushSize=hpatch_kFileIOBufBetterSize*2-16;
         }
     }
     
+    static void saveCdcBlockSizes(std::vector<TByte> &buf,const TNewDataSyncInfo* self) {
+        for (uint32_t i=0; i<self->cdcBlockCount; ++i)
+            packUInt(buf,self->cdcBlockSizes[i]);
+    }
+    
     static void _compressBuf(std::vector<TByte> &buf,hsync_TDictCompress* compressPlugin) {
         std::vector<TByte> cmbuf;
         cmbuf.resize((size_t)compressPlugin->maxCompressedSize(buf.size()));
@@ -147,7 +153,8 @@ void TNewDataSyncInfo_saveTo(TNewDataSyncInfo* self,const hpatch_TStreamOutput*
 #else
     checkv(!self->isDirSyncInfo);
 #endif
-    const char* kVersionType=self->isDirSyncInfo?"HDirSyni23":"HSyni23";
+    checkv(!(self->isDirSyncInfo&&self->cdcAvgBlockSize));
+    const char* kVersionType=self->isDirSyncInfo?"HDirSyni23":(self->cdcAvgBlockSize?"HCdcSyni23":"HSyni23");
     if (compressPlugin)
         checkv(0==strcmp(compressPlugin->compressType(),self->compressType));
     else
@@ -162,6 +169,8 @@ void TNewDataSyncInfo_saveTo(TNewDataSyncInfo* self,const hpatch_TStreamOutput*
     std::vector<TByte> buf;
     
     saveSamePairList(buf,self->samePairList,self->samePairCount);
+    if (self->cdcAvgBlockSize)
+        saveCdcBlockSizes(buf,self);
     if (isSavedSizes)
         saveSavedSizes(buf,self);
 
@@ -186,6 +195,10 @@ void TNewDataSyncInfo_saveTo(TNewDataSyncInfo* self,const hpatch_TStreamOutput*
         packUInt(head,self->newSyncDataOffsert);
         packUInt(head,self->newDataSize);
         packUInt(head,self->kSyncBlockSize);
+        if (self->cdcAvgBlockSize){
+            packUInt(head,self->cdcAvgBlockSize);
+            packUInt(head,self->cdcBlockCount);
+        }
         packUInt(head,kStrongChecksumByteSize);
         packUInt(head,self->savedStrongChecksumBits);
         packUInt(head,self->savedRollHashBits);
@@ -275,10 +288,58 @@ CNewDataSyncInfo::CNewDataSyncInfo(hpatch_TChecksum* _strongChecksumPlugin,const
              newDataSize,syncBlockSize,kSafeHashClashBit);
 }
 
+    static void _cdcCutBlocks(std::vector<uint32_t>& out_blockSizes,const hpatch_TStreamInput* newData,
+                              uint32_t cdcAvgBlockSize){
+        const TCdcChunker chunker(cdcAvgBlockSize);
+        const size_t kMaxSize=chunker.maxBlockSize();
+        TAutoMem _mem(hpatch_kFileIOBufBetterSize*4+kMaxSize);
+        TByte* const buf=_mem.data();
+        size_t dataBegin=0;
+        size_t dataEnd=0;
+        hpatch_StreamPos_t readedPos=0;
+        hpatch_StreamPos_t curPos=0;
+        out_blockSizes.clear();
+        while (curPos<newData->streamSize){
+            if ((dataEnd-dataBegin<kMaxSize)&&(readedPos<newData->streamSize)){
+                memmove(buf,buf+dataBegin,dataEnd-dataBegin);
+                dataEnd-=dataBegin;
+                dataBegin=0;
+                size_t readLen=_mem.size()-dataEnd;
+                if (readLen>newData->streamSize-readedPos) readLen=(size_t)(newData->streamSize-readedPos);
+                checkv(newData->read(newData,readedPos,buf+dataEnd,buf+dataEnd+readLen));
+                dataEnd+=readLen;
+                readedPos+=readLen;
+            }
+            const size_t chunkSize=chunker.cut(buf+dataBegin,dataEnd-dataBegin);
+            out_blockSizes.push_back((uint32_t)chunkSize);
+            dataBegin+=chunkSize;
+            curPos+=chunkSize;
+        }
+        checkv(out_blockSizes.size()==(uint32_t)out_blockSizes.size());
+    }
+
+CNewDataSyncInfo::CNewDataSyncInfo(hpatch_TChecksum* _strongChecksumPlugin,const hpatch_TStreamInput* newData,
+                                   uint32_t cdcAvgBlockSize,size_t kSafeHashClashBit){
+    checkv(cdcIsValidAvgBlockSize(cdcAvgBlockSize));
+    _cdcCutBlocks(_cdcBlockSizes,newData,cdcAvgBlockSize);
+    _ISyncInfo_by si_by={0};
+    si_by.getSavedHashBits=_getSavedHashBits;
+    si_by.isNeedSamePair=_isNeedSamePair;
+    _init_by(&si_by,_strongChecksumPlugin,_strongChecksumPlugin,0,newData->streamSize,
+             cdcMaxBlockSize(cdcAvgBlockSize),kSafeHashClashBit,cdcAvgBlockSize);
+}
+
 void CNewDataSyncInfo::_init_by(_ISyncInfo_by* si_by,hpatch_TChecksum* _fileChecksumPlugin,
                                 hpatch_TChecksum* _strongChecksumPlugin,const hsync_TDictCompress* compressPlugin,
-                                hpatch_StreamPos_t newDataSize,uint32_t syncBlockSize,size_t kSafeHashClashBit){
+                                hpatch_StreamPos_t newDataSize,uint32_t syncBlockSize,size_t kSafeHashClashBit,
+                                uint32_t cdcAvgBlockSize){
     TNewDataSyncInfo_init(this);
+    if (cdcAvgBlockSize){ //blocks cut by cdc before
+        checkv(compressPlugin==0); //now not support compress cdc blocks
+        this->cdcAvgBlockSize=cdcAvgBlockSize;
+        this->cdcBlockCount=(uint32_t)_cdcBlockSizes.size();
+        this->cdcBlockSizes=_cdcBlockSizes.data();
+    }
     if (compressPlugin){
         this->_compressType.assign(compressPlugin->compressType());
         this->compressType=this->_compressType.c_str();
@@ -288,11 +349,14 @@ void CNewDataSyncInfo::_init_by(_ISyncInfo_by* si_by,hpatch_TChecksum* _fileChec
     this->_strongChecksumType.assign(_strongChecksumPlugin->checksumType());
     this->strongChecksumType=this->_strongChecksumType.c_str();
     this->kStrongChecksumByteSize=_strongChecksumPlugin->checksumByteSize();
-    syncBlockSize=(syncBlockSize<=newDataSize)?syncBlockSize:(uint32_t)newDataSize;
-    syncBlockSize=(syncBlockSize<=_kSyncBlockSize_min_limit)?_kSyncBlockSize_min_limit:syncBlockSize;
+    if (!cdcAvgBlockSize){
+        syncBlockSize=(syncBlockSize<=newDataSize)?syncBlockSize:(uint32_t)newDataSize;
+        syncBlockSize=(syncBlockSize<=_kSyncBlockSize_min_limit)?_kSyncBlockSize_min_limit:syncBlockSize;
+    }
     this->kSyncBlockSize=syncBlockSize;
     this->newDataSize=newDataSize;
-    si_by->getSavedHashBits(kSafeHashClashBit,newDataSize,this->kSyncBlockSize,this->kStrongChecksumByteSize*8,
+    si_by->getSavedHashBits(kSafeHashClashBit,newDataSize,cdcAvgBlockSize?cdcAvgBlockSize:this->kSyncBlockSize,
+                            this->kStrongChecksumByteSize*8,
                             &this->savedRollHashBits,&this->savedStrongChecksumBits,&this->isSeqMatch);
     this->savedRollHashByteSize=_bitsToBytes(this->savedRollHashBits);
     this->savedStrongChecksumByteSize=_bitsToBytes(this->savedStrongChecksumBits);
@@ -49,11 +49,15 @@ void TNewDataSyncInfo_dirWithHead_saveTo(TNewDataSyncInfo_dir* self,std::vector<
 class CNewDataSyncInfo :public TNewDataSyncInfo{
 public:
     inline uint32_t blockCount()const{
+        if (this->cdcAvgBlockSize) return this->cdcBlockCount;
         hpatch_StreamPos_t result=getSyncBlockCount(this->newDataSize,this->kSyncBlockSize);
         checkv(result==(uint32_t)result);
         return (uint32_t)result; }
     CNewDataSyncInfo(hpatch_TChecksum* strongChecksumPlugin,const hsync_TDictCompress* compressPlugin,
                      hpatch_StreamPos_t newDataSize,uint32_t syncBlockSize,size_t kSafeHashClashBit);
+    //content-defined blocks, cut newData into variable size chunks by cdcAvgBlockSize
+    CNewDataSyncInfo(hpatch_TChecksum* strongChecksumPlugin,const hpatch_TStreamInput* newData,
+                     uint32_t cdcAvgBlockSize,size_t kSafeHashClashBit);
     ~CNewDataSyncInfo(){}
 protected:
     CNewDataSyncInfo():kStrongChecksumByteSize(){}
@@ -64,11 +68,13 @@ protected:
     };
     void _init_by(_ISyncInfo_by* si_by,hpatch_TChecksum* fileChecksumPlugin,
                   hpatch_TChecksum* strongChecksumPlugin,const hsync_TDictCompress* compressPlugin,
-                  hpatch_StreamPos_t newDataSize,uint32_t syncBlockSize,size_t kSafeHashClashBit);
+                  hpatch_StreamPos_t newDataSize,uint32_t syncBlockSize,size_t kSafeHashClashBit,
+                  uint32_t cdcAvgBlockSize=0);
 private:
     size_t                      kStrongChecksumByteSize;
     std::string                 _compressType;
     std::string                 _strongChecksumType;
+    std::vector<uint32_t>       _cdcBlockSizes;
     hdiff_private::TAutoMem     _mem;
 };
 
@@ -47,6 +47,13 @@ struct _TCreateDatas {
     hpatch_StreamPos_t          curOutPos;
     hpatch_checksumHandle       checkChecksum;
     const _ICreateSync_by*      cs_by;
+    bool                        isHashed; //rollHashs,partChecksums & checkChecksum already created
+    //for reuse compressed data of same block in prev hsynz
+    const uint32_t*             prevIndexs;
+    const TNewDataSyncInfo*     prevSyncInfo;
+    const hpatch_TStreamInput*  prevHsynz;
+    const hpatch_StreamPos_t*   prevSyncDataPoss;
+    const hpatch_StreamPos_t*   cdcBlockPoss; //begin pos of cdc blocks in newData, blockCount+1 values
 };
 
 struct _TCompress{
@@ -99,6 +106,18 @@ struct _TCompress{
         }
         return result;
     }
+    //copy a same block's data from prev; the dict need reset when compress next block
+    inline void doCopy(const TByte* in_data,size_t in_dataSize){
+        hpatch_byte* curBuf=cmBuf+cmBufPos;
+        memcpy(curBuf,in_data,in_dataSize);
+        cmBufPos+=in_dataSize;
+    }
+    inline void doCopy(const hpatch_TStreamInput* cmData,hpatch_StreamPos_t cmPos,size_t cmSize){
+        checkv(cmSize<=kMaxCompressedSize);
+        hpatch_byte* curBuf=cmBuf+cmBufPos;
+        checkv(cmData->read(cmData,cmPos,curBuf,curBuf+cmSize));
+        cmBufPos+=cmSize;
+    }
     
     inline void  resertDict(const hpatch_TStreamInput* data,hpatch_StreamPos_t curReadPos,size_t blockIndex){
         if (dictCompressHandle==0)
@@ -201,9 +220,29 @@ namespace{
 #endif
 
 
+//newData range of blocks in workData; fixed size blocks padded with zero at the end of newData
+static hpatch_StreamPos_t _getWorkDataRange(const _TCreateDatas& cd,const TWorkBuf* workData,
+                                            size_t* out_dataLens,size_t* out_backZeroLen){
+    if (cd.cdcBlockPoss){
+        const hpatch_StreamPos_t curReadPos=cd.cdcBlockPoss[workData->blockBegin];
+        *out_dataLens=(size_t)(cd.cdcBlockPoss[workData->blockEnd]-curReadPos);
+        *out_backZeroLen=0;
+        return curReadPos;
+    }
+    const uint32_t kSyncBlockSize=cd.out_hsyni->kSyncBlockSize;
+    const hpatch_StreamPos_t curReadPos=(hpatch_StreamPos_t)workData->blockBegin*kSyncBlockSize;
+    const size_t dataLens=(size_t)kSyncBlockSize*(workData->blockEnd-workData->blockBegin);
+    *out_dataLens=dataLens;
+    *out_backZeroLen=0;
+    if (curReadPos+dataLens>cd.newData->streamSize){
+        *out_backZeroLen=(size_t)(curReadPos+dataLens-cd.newData->streamSize);
+        assert(*out_backZeroLen<kSyncBlockSize);
+    }
+    return curReadPos;
+}
+
 static void _saveCompressedData(_TCreateDatas& cd,TWorkBuf* workData,void* _mt=0){
     const bool is_hsynz_readed_data=(cd.out_hsynz&&cd.hsynzPlugin&&cd.hsynzPlugin->hsynz_readed_data);
-    const uint32_t kSyncBlockSize=cd.out_hsyni->kSyncBlockSize;
 #if (_IS_USED_MULTITHREAD)
   TMt* mt=(TMt*)_mt;
   TWorkBuf* delWorkBufList=0;
@@ -224,14 +263,9 @@ static void _saveCompressedData(_TCreateDatas& cd,TWorkBuf* workData,void* _mt=0
 #endif 
         if (workData==0) break;
 
-        size_t backZeroLen=0;
-        const uint32_t kSyncBlockCount=(workData->blockEnd-workData->blockBegin);
-        const size_t dataLens=(size_t)kSyncBlockSize*kSyncBlockCount;
-        {
-            const hpatch_StreamPos_t curReadPos=(hpatch_StreamPos_t)workData->blockBegin*kSyncBlockSize;
-            if (curReadPos+dataLens>cd.newData->streamSize)
-                backZeroLen=(size_t)(curReadPos+dataLens-cd.newData->streamSize);
-        }
+        size_t dataLens;
+        size_t backZeroLen;
+        _getWorkDataRange(cd,workData,&dataLens,&backZeroLen);
         if (is_hsynz_readed_data)
             cd.hsynzPlugin->hsynz_readed_data(cd.hsynzPlugin,workData->buf,dataLens-backZeroLen);
         if (cd.out_hsynz){
@@ -269,19 +303,14 @@ static void _create_sync_data_part(_TCreateDatas& cd,TWorkBuf* workData,
                                    CChecksum& checksumBlockData,_TCompress& compress,void* _mt=0){
     TNewDataSyncInfo*   out_hsyni=cd.out_hsyni;
     const uint32_t      kSyncBlockSize=out_hsyni->kSyncBlockSize;
-    const uint32_t      kSyncBlockCount=(workData->blockEnd-workData->blockBegin);
-    hpatch_StreamPos_t curReadPos=(hpatch_StreamPos_t)workData->blockBegin*kSyncBlockSize;
-    const bool isCCheckByOrder=_mt&&cd.out_hsyni->isNotCChecksumNewMTParallel;
+    const bool isCCheckByOrder=_mt&&cd.out_hsyni->isNotCChecksumNewMTParallel&&(!cd.isHashed);
 
-    size_t backZeroLen=0;
-    const size_t dataLens=(size_t)kSyncBlockSize*kSyncBlockCount;
+    size_t dataLens;
+    size_t backZeroLen;
+    hpatch_StreamPos_t curReadPos=_getWorkDataRange(cd,workData,&dataLens,&backZeroLen);
     compress.cmBuf=workData->buf+dataLens+workData->in_borderSize;
     compress.cmBufPos=0;
     {//read data
-        if (curReadPos+dataLens>cd.newData->streamSize){
-            backZeroLen=(size_t)(curReadPos+dataLens-cd.newData->streamSize);
-            assert(backZeroLen<kSyncBlockSize);
-        }
         {
             size_t readLen=dataLens-backZeroLen+workData->in_borderSize;
             if (curReadPos+readLen>cd.newData->streamSize)
@@ -306,7 +335,7 @@ static void _create_sync_data_part(_TCreateDatas& cd,TWorkBuf* workData,
             memset(workData->buf+dataLens-backZeroLen,0,backZeroLen);
     }
 
-    if (cd.out_hsyni->isNotCChecksumNewMTParallel){//check new data by order(like single thread), & not used checksumBlockData  
+    if (cd.out_hsyni->isNotCChecksumNewMTParallel&&(!cd.isHashed)){//check new data by order(like single thread), & not used checksumBlockData  
     #if (_IS_USED_MULTITHREAD)
         TMt* mt=(TMt*)_mt;
         if (mt){
@@ -323,21 +352,48 @@ static void _create_sync_data_part(_TCreateDatas& cd,TWorkBuf* workData,
     }
 
     hpatch_byte* dataBuf=workData->buf;
-    for (uint32_t i=workData->blockBegin;i<workData->blockEnd;++i,dataBuf+=kSyncBlockSize,curReadPos+=kSyncBlockSize) {
-        size_t srcDataLen=(i+1<workData->blockEnd)?kSyncBlockSize:kSyncBlockSize-backZeroLen;
+    for (uint32_t i=workData->blockBegin;i<workData->blockEnd;++i) {
+        //hash size; cdc block not padded
+        const size_t blockSize=cd.cdcBlockPoss?(size_t)(cd.cdcBlockPoss[i+1]-cd.cdcBlockPoss[i]):kSyncBlockSize;
+        size_t srcDataLen=(i+1<workData->blockEnd)?blockSize:blockSize-backZeroLen;
         size_t cur_borderSize=workData->in_borderSize;
         if (curReadPos+srcDataLen+cur_borderSize>cd.newData->streamSize)
             cur_borderSize=(size_t)(cd.newData->streamSize-(curReadPos+srcDataLen));
         //compress
-        size_t compressedSize=compress.doCompress(i,dataBuf,srcDataLen,cur_borderSize);
+        size_t compressedSize;
+        const uint32_t prevIndex=cd.prevIndexs?cd.prevIndexs[i]:kNoPrevBlockIndex;
+        if (prevIndex!=kNoPrevBlockIndex){//reuse prev compressed data
+            compressedSize=cd.prevSyncInfo->savedSizes[prevIndex];
+        #if (_IS_USED_MULTITHREAD)
+            TMt* mt=(TMt*)_mt;
+            CAutoLocker _autoLocker((mt&&(compressedSize>0))?mt->readLocker.locker:0);
+        #endif
+            if (compressedSize>0)
+                compress.doCopy(cd.prevHsynz,cd.prevSyncDataPoss[prevIndex],compressedSize);
+            else
+                compress.doCopy(dataBuf,srcDataLen);
+        }else{
+            if (cd.prevIndexs){
+            #if (_IS_USED_MULTITHREAD)
+                TMt* mt=(TMt*)_mt;
+                CAutoLocker _autoLocker(mt?mt->readLocker.locker:0);
+            #endif
+                compress.resertDict(cd.newData,curReadPos,i);
+            }
+            compressedSize=compress.doCompress(i,dataBuf,srcDataLen,cur_borderSize);
+        }
         checkv(compressedSize==(uint32_t)compressedSize);
         if (out_hsyni->savedSizes) //save compressedSize
             out_hsyni->savedSizes[i]=(uint32_t)compressedSize;
+        const hpatch_byte* blockData=dataBuf;
+        dataBuf+=blockSize;
+        curReadPos+=blockSize;
+        if (cd.isHashed) continue;
 
-        const uint64_t rollHash=cd.cs_by->roll_hash_start(dataBuf,kSyncBlockSize);
+        const uint64_t rollHash=cd.cs_by->roll_hash_start(blockData,blockSize);
         //strong hash
         checksumBlockData.appendBegin();
-        checksumBlockData.append(dataBuf,dataBuf+kSyncBlockSize);
+        checksumBlockData.append(blockData,blockData+blockSize);
         checksumBlockData.appendEnd();
         {//save hash
             const uint64_t _partRollHash=cd.cs_by->toSavedPartRollHash(rollHash,out_hsyni->savedRollHashBits);
@@ -381,47 +437,10 @@ static void _create_sync_data_mt(int threadIndex,void* _mt){
 }
 #endif
 
-void _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
-                          const hpatch_TStreamInput* newData,const hpatch_TStreamOutput* out_hsynz,
-                          hsync_TDictCompress* compressPlugin,hsync_THsynz* hsynzPlugin,size_t threadNum){
+static void _create_sync_data_parts(_TCreateDatas& createDatas,hsync_TDictCompress* compressPlugin,
+                                    uint32_t kBlockCount,size_t threadNum){
+    TNewDataSyncInfo* newSyncInfo=createDatas.out_hsyni;
     const uint32_t kSyncBlockSize= newSyncInfo->kSyncBlockSize;
-    hpatch_TChecksum* checksumPlugin=newSyncInfo->fileChecksumPlugin;
-    checkv(kSyncBlockSize>=_kSyncBlockSize_min_limit);
-    if (compressPlugin) checkv(out_hsynz!=0);
-    hsync_THsynz _hsynzPlugin;
-    if ((hsynzPlugin==0)&&((compressPlugin!=0)||newSyncInfo->isDirSyncInfo)){
-        getHsynzPluginDefault(&_hsynzPlugin);
-        hsynzPlugin=&_hsynzPlugin;
-    }
-    {//check checksumByteSize
-        const size_t checksumByteSize=checksumPlugin->checksumByteSize();
-        checkv((checksumByteSize<=_kStrongChecksumByteSize_max_limit)&&(checksumByteSize>=kStrongChecksumByteSize_min));
-    }
-
-    assert(cs_by->create_sync_data_part==0);
-    cs_by->create_sync_data_part=_create_sync_data_part;
-    CChecksum      _checkChecksum(checksumPlugin,false);
-    _TCreateDatas  createDatas;
-    createDatas.newData=newData;
-    createDatas.compressPlugin=compressPlugin;
-    createDatas.out_hsyni=newSyncInfo;
-    createDatas.out_hsynz=out_hsynz;
-    createDatas.hsynzPlugin=hsynzPlugin;
-    createDatas.curOutPos=0;
-    createDatas.checkChecksum=_checkChecksum._handle;
-    createDatas.cs_by=cs_by;
-    const bool is_hsynzPlugin=(out_hsynz&&hsynzPlugin);
-    if (is_hsynzPlugin){
-        createDatas.curOutPos=hsynzPlugin->hsynz_write_head(hsynzPlugin,out_hsynz,createDatas.curOutPos,newSyncInfo->isDirSyncInfo,
-                                                            newData->streamSize,kSyncBlockSize,checksumPlugin,compressPlugin);
-        newSyncInfo->newSyncDataOffsert=createDatas.curOutPos;
-    }
-    const uint32_t kBlockCount=(uint32_t)getSyncBlockCount(newData->streamSize,kSyncBlockSize);
-    newSyncInfo->dictSize=compressPlugin?compressPlugin->limitDictSizeByData(compressPlugin,kBlockCount,kSyncBlockSize):0;
-
-    cs_by->checkChecksumInit(createDatas.out_hsyni->savedNewDataCheckChecksum,
-                             checksumPlugin->checksumByteSize());
-    
     const size_t in_borderSize=(compressPlugin&&compressPlugin->getDictCompressBorder)?compressPlugin->getDictCompressBorder():0;
     const hpatch_StreamPos_t kMaxCompressedSize=compressPlugin?compressPlugin->maxCompressedSize(kSyncBlockSize):0;
     const size_t _kBestWorkBufSize=2*(1<<20);
@@ -471,9 +490,153 @@ void _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
         for (uint32_t ib=0; ib<kBlockCount; ib+=bestWorkBlockCount){
             workData.blockBegin=ib;
             workData.blockEnd=(ib+bestWorkBlockCount<=kBlockCount)?ib+bestWorkBlockCount:kBlockCount;
-            cs_by->create_sync_data_part(createDatas,&workData,checksumBlockData,compress,0);
+            createDatas.cs_by->create_sync_data_part(createDatas,&workData,checksumBlockData,compress,0);
+        }
+    }
+}
+
+static bool _isCanReusePrev(const TNewDataSyncInfo* newSyncInfo,const TNewDataSyncInfo* prevSyncInfo,
+                            const hpatch_TStreamInput* prevHsynz,hsync_TDictCompress* compressPlugin){
+    if ((compressPlugin==0)||(prevHsynz==0)) return false;
+    if (newSyncInfo->isDirSyncInfo||prevSyncInfo->isDirSyncInfo) return false;
+    if ((prevSyncInfo->savedSizes==0)||prevSyncInfo->isSavedBitsSizes) return false;
+    if (prevHsynz->streamSize<prevSyncInfo->newSyncDataSize) return false;
+    if (newSyncInfo->kSyncBlockSize!=prevSyncInfo->kSyncBlockSize) return false;
+    if (newSyncInfo->dictSize!=prevSyncInfo->dictSize) return false;
+    if ((prevSyncInfo->compressType==0)||(0!=strcmp(compressPlugin->compressType(),prevSyncInfo->compressType)))
+        return false;
+    if (0!=strcmp(newSyncInfo->strongChecksumType,prevSyncInfo->strongChecksumType)) return false;
+    if ((newSyncInfo->decompressInfoSize!=prevSyncInfo->decompressInfoSize)
+        ||(0!=memcmp(newSyncInfo->decompressInfo,prevSyncInfo->decompressInfo,newSyncInfo->decompressInfoSize)))
+        return false;
+    return true;
+}
+
+//a same block can reuse prev compressed data only if the dict data before it & the border data after it are same too
+static uint32_t _getReusePrevBlocks(const TNewDataSyncInfo* newSyncInfo,const TNewDataSyncInfo* prevSyncInfo,
+                                    size_t in_borderSize,uint32_t* prevIndexs){
+    matchNewDataInPrev(newSyncInfo,prevSyncInfo,prevIndexs);
+    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(newSyncInfo);
+    const uint32_t kPrevBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(prevSyncInfo);
+    const uint32_t kSyncBlockSize=newSyncInfo->kSyncBlockSize;
+    const uint32_t borderBlockCount=(uint32_t)((in_borderSize+kSyncBlockSize-1)/kSyncBlockSize);
+    uint32_t reuseCount=0;
+    for (uint32_t i=0;i<kBlockCount;++i){
+        const uint32_t pi=prevIndexs[i];
+        if (pi==kNoPrevBlockIndex) continue;
+        const hpatch_StreamPos_t dictSize=newSyncInfo->dictSize;
+        hpatch_StreamPos_t newDictSize=(hpatch_StreamPos_t)i*kSyncBlockSize;
+        hpatch_StreamPos_t prevDictSize=(hpatch_StreamPos_t)pi*kSyncBlockSize;
+        newDictSize=(newDictSize<=dictSize)?newDictSize:dictSize;
+        prevDictSize=(prevDictSize<=dictSize)?prevDictSize:dictSize;
+        bool isReuse=(newDictSize==prevDictSize);
+        const uint32_t dictBlockCount=(uint32_t)((newDictSize+kSyncBlockSize-1)/kSyncBlockSize);
+        for (uint32_t t=1;isReuse&&(t<=dictBlockCount);++t)
+            isReuse=isSameBlockInPrev(newSyncInfo,i-t,prevSyncInfo,pi-t);
+        for (uint32_t t=1;isReuse&&(t<=borderBlockCount);++t){
+            if (i+t<kBlockCount){
+                isReuse=(pi+t<kPrevBlockCount)&&isSameBlockInPrev(newSyncInfo,i+t,prevSyncInfo,pi+t);
+            }else{
+                isReuse=(pi+t>=kPrevBlockCount);
+                break;
+            }
         }
+        if (isReuse)
+            ++reuseCount;
+        else
+            prevIndexs[i]=kNoPrevBlockIndex;
+    }
+    return reuseCount;
+}
+
+uint32_t _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
+                              const hpatch_TStreamInput* newData,const hpatch_TStreamOutput* out_hsynz,
+                              hsync_TDictCompress* compressPlugin,hsync_THsynz* hsynzPlugin,size_t threadNum,
+                              const TNewDataSyncInfo* prevSyncInfo,const hpatch_TStreamInput* prevHsynz){
+    const uint32_t kSyncBlockSize= newSyncInfo->kSyncBlockSize;
+    hpatch_TChecksum* checksumPlugin=newSyncInfo->fileChecksumPlugin;
+    checkv(kSyncBlockSize>=_kSyncBlockSize_min_limit);
+    if (compressPlugin) checkv(out_hsynz!=0);
+    hsync_THsynz _hsynzPlugin;
+    if ((hsynzPlugin==0)&&((compressPlugin!=0)||newSyncInfo->isDirSyncInfo)){
+        getHsynzPluginDefault(&_hsynzPlugin);
+        hsynzPlugin=&_hsynzPlugin;
+    }
+    {//check checksumByteSize
+        const size_t checksumByteSize=checksumPlugin->checksumByteSize();
+        checkv((checksumByteSize<=_kStrongChecksumByteSize_max_limit)&&(checksumByteSize>=kStrongChecksumByteSize_min));
     }
+
+    assert(cs_by->create_sync_data_part==0);
+    cs_by->create_sync_data_part=_create_sync_data_part;
+    CChecksum      _checkChecksum(checksumPlugin,false);
+    _TCreateDatas  createDatas;
+    memset(&createDatas,0,sizeof(createDatas));
+    createDatas.newData=newData;
+    createDatas.compressPlugin=compressPlugin;
+    createDatas.out_hsyni=newSyncInfo;
+    createDatas.out_hsynz=out_hsynz;
+    createDatas.hsynzPlugin=hsynzPlugin;
+    createDatas.curOutPos=0;
+    createDatas.checkChecksum=_checkChecksum._handle;
+    createDatas.cs_by=cs_by;
+    const bool is_hsynzPlugin=(out_hsynz&&hsynzPlugin);
+    if (is_hsynzPlugin){
+        createDatas.curOutPos=hsynzPlugin->hsynz_write_head(hsynzPlugin,out_hsynz,createDatas.curOutPos,newSyncInfo->isDirSyncInfo,
+                                                            newData->streamSize,kSyncBlockSize,checksumPlugin,compressPlugin);
+        newSyncInfo->newSyncDataOffsert=createDatas.curOutPos;
+    }
+    const uint32_t kBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(newSyncInfo);
+    std::vector<hpatch_StreamPos_t> cdcBlockPoss;
+    if (newSyncInfo->cdcAvgBlockSize){
+        checkv(compressPlugin==0); //not support compress cdc blocks, dict plugins need fixed size blocks
+        cdcBlockPoss.resize((size_t)kBlockCount+1);
+        hpatch_StreamPos_t pos=0;
+        for (uint32_t i=0;i<kBlockCount;++i){
+            cdcBlockPoss[i]=pos;
+            pos+=newSyncInfo->cdcBlockSizes[i];
+        }
+        cdcBlockPoss[kBlockCount]=pos;
+        checkv(pos==newData->streamSize);
+        createDatas.cdcBlockPoss=cdcBlockPoss.data();
+    }
+    newSyncInfo->dictSize=compressPlugin?compressPlugin->limitDictSizeByData(compressPlugin,kBlockCount,kSyncBlockSize):0;
+
+    cs_by->checkChecksumInit(createDatas.out_hsyni->savedNewDataCheckChecksum,
+                             checksumPlugin->checksumByteSize());
+    
+    uint32_t reuseCount=0;
+    std::vector<uint32_t>           prevIndexs;
+    std::vector<hpatch_StreamPos_t> prevSyncDataPoss;
+    if (prevSyncInfo&&(kBlockCount>0)){
+        { _TCompress _compress(compressPlugin,kBlockCount,kSyncBlockSize,newSyncInfo); } //for got decompressInfo
+        if (_isCanReusePrev(newSyncInfo,prevSyncInfo,prevHsynz,compressPlugin)){
+            //hash all blocks first (not compress & not out hsynz)
+            createDatas.out_hsynz=0;
+            _create_sync_data_parts(createDatas,0,kBlockCount,threadNum);
+            createDatas.out_hsynz=out_hsynz;
+            createDatas.isHashed=true;
+
+            const size_t in_borderSize=compressPlugin->getDictCompressBorder?compressPlugin->getDictCompressBorder():0;
+            prevIndexs.resize(kBlockCount);
+            reuseCount=_getReusePrevBlocks(newSyncInfo,prevSyncInfo,in_borderSize,prevIndexs.data());
+            if (reuseCount>0){
+                const uint32_t kPrevBlockCount=(uint32_t)TNewDataSyncInfo_blockCount(prevSyncInfo);
+                prevSyncDataPoss.resize(kPrevBlockCount);
+                hpatch_StreamPos_t pos=prevSyncInfo->newSyncDataOffsert;
+                for (uint32_t i=0;i<kPrevBlockCount;++i){
+                    prevSyncDataPoss[i]=pos;
+                    pos+=TNewDataSyncInfo_syncBlockSize(prevSyncInfo,i,0,0);
+                }
+                checkv(pos<=prevHsynz->streamSize);
+                createDatas.prevIndexs=prevIndexs.data();
+                createDatas.prevSyncInfo=prevSyncInfo;
+                createDatas.prevHsynz=prevHsynz;
+                createDatas.prevSyncDataPoss=prevSyncDataPoss.data();
+            }
+        }
+    }
+    _create_sync_data_parts(createDatas,compressPlugin,kBlockCount,threadNum);
     cs_by->checkChecksumEndTo(createDatas.out_hsyni->savedNewDataCheckChecksum,createDatas.out_hsyni->savedNewDataCheckChecksum,
                               checksumPlugin,createDatas.checkChecksum);
     if (is_hsynzPlugin){
@@ -481,20 +644,24 @@ void _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
                                 createDatas.out_hsyni->savedNewDataCheckChecksum,checksumPlugin->checksumByteSize());
     }
     newSyncInfo->newSyncDataSize=createDatas.curOutPos;
+    return reuseCount;
 }
 
-void _private_create_sync_data(TNewDataSyncInfo* newSyncInfo, const hpatch_TStreamInput*  newData,
-                               const hpatch_TStreamOutput* out_hsyni, const hpatch_TStreamOutput* out_hsynz,
-                               hsync_TDictCompress* compressPlugin, hsync_THsynz* hsynzPlugin,size_t threadNum){
+uint32_t _private_create_sync_data(TNewDataSyncInfo* newSyncInfo, const hpatch_TStreamInput*  newData,
+                                   const hpatch_TStreamOutput* out_hsyni, const hpatch_TStreamOutput* out_hsynz,
+                                   hsync_TDictCompress* compressPlugin, hsync_THsynz* hsynzPlugin,size_t threadNum,
+                                   const TNewDataSyncInfo* prevSyncInfo,const hpatch_TStreamInput* prevHsynz){
     _ICreateSync_by cs_by={0};
     cs_by.roll_hash_start=roll_hash_start;
     cs_by.toSavedPartRollHash=toSavedPartRollHash;
     cs_by.checkChecksumInit=checkChecksumInit;
     cs_by.checkChecksumAppendData=checkChecksumAppendData;
     cs_by.checkChecksumEndTo=checkChecksumEndTo;
-    _create_sync_data_by(&cs_by,newSyncInfo,newData,out_hsynz,compressPlugin,hsynzPlugin,threadNum);
+    uint32_t reuseCount=_create_sync_data_by(&cs_by,newSyncInfo,newData,out_hsynz,compressPlugin,hsynzPlugin,
+                                             threadNum,prevSyncInfo,prevHsynz);
     matchNewDataInNew(newSyncInfo);
     TNewDataSyncInfo_saveTo(newSyncInfo,out_hsyni,compressPlugin);//save to out_hsyni
+    return reuseCount;
 }
 
 }//namespace sync_private
@@ -519,3 +686,26 @@ void create_sync_data(const hpatch_TStreamInput*  newData,
     create_sync_data(newData,out_hsyni,0,strongChecksumPlugin,compressPlugin,0,
                      kSyncBlockSize,kSafeHashClashBit,threadNum);
 }
+
+uint32_t create_sync_data_by_prev(const hpatch_TStreamInput*  newData,
+                                  const hpatch_TStreamOutput* out_hsyni,
+                                  const hpatch_TStreamOutput* out_hsynz,
+                                  hpatch_TChecksum*           strongChecksumPlugin,
+                                  hsync_TDictCompress*        compressPlugin,
+                                  const TNewDataSyncInfo*     prevSyncInfo,
+                                  const hpatch_TStreamInput*  prevHsynz,
+                                  hsync_THsynz* hsynzPlugin,uint32_t kSyncBlockSize,
+                                  size_t kSafeHashClashBit,size_t threadNum){
+    CNewDataSyncInfo newSyncInfo(strongChecksumPlugin,compressPlugin,
+                                 newData->streamSize,kSyncBlockSize,kSafeHashClashBit);
+    return _private_create_sync_data(&newSyncInfo,newData,out_hsyni,out_hsynz,compressPlugin,hsynzPlugin,
+                                     threadNum,prevSyncInfo,prevHsynz);
+}
+
+void create_sync_data_cdc(const hpatch_TStreamInput*  newData,
+                          const hpatch_TStreamOutput* out_hsyni,
+                          hpatch_TChecksum*           strongChecksumPlugin,
+                          uint32_t cdcAvgBlockSize,size_t kSafeHashClashBit,size_t threadNum){
+    CNewDataSyncInfo newSyncInfo(strongChecksumPlugin,newData,cdcAvgBlockSize,kSafeHashClashBit);
+    _private_create_sync_data(&newSyncInfo,newData,out_hsyni,0,0,0,threadNum);
+}
@@ -66,4 +66,41 @@ void create_sync_data(const hpatch_TStreamInput*  newData,
                       size_t kSafeHashClashBit=kSafeHashClashBit_default,
                       size_t threadNum=1);
 
+//create out_hsyni & out_hsynz, and reuse the compressed data of unchanged blocks from the previous release
+//  prevSyncInfo: the previous release's hsyni, opened by TNewDataSyncInfo_open() (not ignore compress info);
+//  prevHsynz: the previous release's hsynz;
+//  a block reuse prev compressed data if it, the dict data before it and the border data after it
+//    all same as in prev (compared by saved hashs); the other blocks compressed as create_sync_data();
+//  if prev created by different kSyncBlockSize, compressPlugin or strongChecksumPlugin, then nothing reused;
+//  return count of reused blocks;
+uint32_t create_sync_data_by_prev(const hpatch_TStreamInput*  newData,
+                                  const hpatch_TStreamOutput* out_hsyni,
+                                  const hpatch_TStreamOutput* out_hsynz,
+                                  hpatch_TChecksum*           strongChecksumPlugin,
+                                  hsync_TDictCompress*        compressPlugin,
+                                  const TNewDataSyncInfo*     prevSyncInfo,
+                                  const hpatch_TStreamInput*  prevHsynz,
+                                  hsync_THsynz* hsynzPlugin=0,
+                                  uint32_t kSyncBlockSize=kSyncBlockSize_default,
+                                  size_t kSafeHashClashBit=kSafeHashClashBit_default,
+                                  size_t threadNum=1);
+
+//create out_hsyni with content-defined blocks (variable size chunks cut by FastCDC), not compressed;
+//  blocks cut by newData's content, size in [cdcAvgBlockSize/4,cdcAvgBlockSize*4], cdcAvgBlockSize must be power of 2;
+//  an insert or delete in newData only changes the blocks near it (fixed size blocks after it all shifted);
+//  client cut oldData by the same way & only match at these cut points, instead of rolling every byte;
+//    so sync_patch is faster, but an old block cut different from new (near changes) can't be matched;
+//  client match oldData parallel by threadNum, a thread's clip cut continue after the clip end until meet next clip's cut points;
+//  client download part of newData directly, same as create_sync_data() without compressPlugin;
+//    not support compress: dict compress plugins (hsync_TDictCompress & hsync_TDictDecompress) get the dict of a block
+//    from blocks before it by blockIndex*kSyncBlockSize (getResetDictBuffer, _CacheBlockDict), which is wrong for
+//    variable size blocks; compress cdc blocks need a plugin API with block positions.
+//  NOTE: out_hsyni need client support cdc blocks.
+void create_sync_data_cdc(const hpatch_TStreamInput*  newData,
+                          const hpatch_TStreamOutput* out_hsyni,
+                          hpatch_TChecksum*           strongChecksumPlugin,
+                          uint32_t cdcAvgBlockSize=kSyncBlockSize_default,
+                          size_t kSafeHashClashBit=kSafeHashClashBit_default,
+                          size_t threadNum=1);
+
 #endif // hsync_make_h
@@ -54,13 +54,16 @@ struct _ICreateSync_by{
     
 };
 
-void _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
-                          const hpatch_TStreamInput* newData,const hpatch_TStreamOutput* out_hsynz,
-                          hsync_TDictCompress* compressPlugin,hsync_THsynz* hsynzPlugin,size_t threadNum);
+//return count of blocks reused compressed data from prevHsynz
+uint32_t _create_sync_data_by(_ICreateSync_by* cs_by,TNewDataSyncInfo* newSyncInfo,
+                              const hpatch_TStreamInput* newData,const hpatch_TStreamOutput* out_hsynz,
+                              hsync_TDictCompress* compressPlugin,hsync_THsynz* hsynzPlugin,size_t threadNum,
+                              const TNewDataSyncInfo* prevSyncInfo=0,const hpatch_TStreamInput* prevHsynz=0);
 
-void _private_create_sync_data(TNewDataSyncInfo* newSyncInfo, const hpatch_TStreamInput*  newData,
-                               const hpatch_TStreamOutput* out_hsyni, const hpatch_TStreamOutput* out_hsynz,
-                               hsync_TDictCompress* compressPlugin, hsync_THsynz* hsynzPlugin,size_t threadNum);
+uint32_t _private_create_sync_data(TNewDataSyncInfo* newSyncInfo, const hpatch_TStreamInput*  newData,
+                                   const hpatch_TStreamOutput* out_hsyni, const hpatch_TStreamOutput* out_hsynz,
+                                   hsync_TDictCompress* compressPlugin, hsync_THsynz* hsynzPlugin,size_t threadNum,
+                                   const TNewDataSyncInfo* prevSyncInfo=0,const hpatch_TStreamInput* prevHsynz=0);
                
 }
 #endif // hsync_make_private_h
@@ -69,6 +69,38 @@ struct TStreamDataRoll_z:public TStreamDataCache_base{
         _startCurHash();
         return true;
     }
+    //out hashValue() of next positions in cache (out_hashs[0] is cur), not roll self; result>=1
+    size_t getRollHashs(tm_roll_uint* out_hashs,size_t maxCount)const{
+        const TByte* cur=m_cur;
+        const TByte* curIn=m_cur+m_kSyncBlockSize+(isSeqMatch?m_kSyncBlockSize:0);
+        size_t count=(size_t)(m_cache.data_end()-curIn)+1;
+        if (count>maxCount) count=maxCount;
+        uint32_t rollHash=m_rollHash;
+        uint32_t rollHashNext=isSeqMatch?m_rollHashNext:0;
+        out_hashs[0]=hashValue();
+        for (size_t i=1;i<count;++i){
+            rollHash=z_roll_hash32_roll(rollHash,m_kSyncBlockSize,cur[i-1],cur[i-1+m_kSyncBlockSize]);
+            if (isSeqMatch){
+                rollHashNext=z_roll_hash32_roll(rollHashNext,m_kSyncBlockSize,cur[i-1+m_kSyncBlockSize],
+                                                cur[i-1+m_kSyncBlockSize*2]);
+                out_hashs[i]=(((tm_roll_uint)rollHash)<<(sizeof(uint32_t)*8)) | rollHashNext;
+            }else{
+                out_hashs[i]=rollHash;
+            }
+        }
+        return count;
+    }
+    //roll step by the hashs got by getRollHashs()
+    hpatch_force_inline void skipRoll(size_t step,tm_roll_uint rollHash){
+        assert(m_cur+step+m_kSyncBlockSize+(isSeqMatch?m_kSyncBlockSize:0)<=m_cache.data_end());
+        m_cur+=step;
+        if (isSeqMatch){
+            m_rollHash=(uint32_t)(rollHash>>(sizeof(uint32_t)*8));
+            m_rollHashNext=(uint32_t)rollHash;
+        }else{
+            m_rollHash=(uint32_t)rollHash;
+        }
+    }
 protected:
     uint32_t    m_rollHash;
     uint32_t    m_rollHashNext;
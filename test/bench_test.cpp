@@ -0,0 +1,317 @@
+//bench_test.cpp
+// benchmarks for hsynz & patch; not run by unit_test
+//
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define  _IS_NEED_MAIN 0
+#include "unit_test.cpp"
+#include "../file_for_patch.h"
+
+//sync_local_diff() time by different threadNum, new data have many same blocks
+static long bench_hsynz_mt_local_diff(){
+    const size_t kDataSize=1024*1024*64;
+    const size_t kCopyLen=1024*16;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData(kDataSize);
+    _srand(1);
+    setRandData(oldData);
+    setRandData(newData);
+    for (size_t i=0;i+kCopyLen<=kDataSize;i+=kCopyLen*2){
+        size_t oldPos=(size_t)(_rand()*(1.0/RAND_MAX)*(kDataSize-kCopyLen));
+        if (i%(kCopyLen*8)==0) oldPos=0; //same blocks
+        memcpy(newData.data()+i,oldData.data()+oldPos,kCopyLen);
+    }
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const int threadNums[]={1,2,4,8,16,32};
+    std::vector<TByte> diffData;
+    printf("hsynz sync_local_diff() new:%ld old:%ld\n",(long)newData.size(),(long)oldData.size());
+    for (size_t i=0;i<sizeof(threadNums)/sizeof(threadNums[0]);++i){
+        double time0=clock_s();
+        _hsynz_local_diff(oldData.data(),oldData.data()+oldData.size(),diffData,threadNums[i]);
+        double time1=clock_s();
+        if (!_check_hsynz_local_patch(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                      oldData.data()+oldData.size(),diffData.data(),diffData.data()+diffData.size())){
+            printf("\n hsynz mt error!!! threadNum:%d\n",threadNums[i]);
+            ++result;
+            continue;
+        }
+        printf("  -p-%d diff:%ld time:%.3f s\n",threadNums[i],(long)diffData.size(),time1-time0);
+    }
+    return result;
+}
+
+//sync_patch() download by readSyncDataRanges(), out requests count & download overhead by different plans
+static long bench_hsynz_sync_ranges(){
+    const size_t kDataSize=1024*1024*16;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(2);
+    setRandData(oldData);
+    newData=oldData;
+    setScatteredEdits(newData,1024*32);
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const TSyncRangesPlan plans[]={{1,0,1},{1,0,0},{0,0,0},{1024*4,1024*1024*16,256}};
+    printf("hsynz sync_patch() by ranges, new:%ld old:%ld\n",(long)newData.size(),(long)oldData.size());
+    for (size_t i=0;i<sizeof(plans)/sizeof(plans[0]);++i){
+        TReadSyncDataRangesListener rangesListener(_hsynzData,&plans[i]);
+        if (!_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                     oldData.data(),oldData.data()+oldData.size(),&rangesListener)){
+            printf("\n hsynz ranges error!!! plan:%d\n",(int)i);
+            ++result;
+            continue;
+        }
+        if (i==0)
+            printf("  needSync blocks:%ld size:%ld\n",(long)rangesListener.needSyncBlockCount,(long)rangesListener.needSyncSumSize);
+        printf("  plan(gap:%ld,maxRequest:%ld,maxRanges:%ld) requests:%ld ranges:%ld download:%ld (+%.2f%%)\n",
+               (long)plans[i].rangeOverheadSize,(long)plans[i].maxRequestSize,(long)plans[i].maxRangeCount,
+               (long)rangesListener.requestCount,(long)rangesListener.rangeCount,(long)rangesListener.downloadSize,
+               (rangesListener.downloadSize-rangesListener.needSyncSumSize)*100.0/rangesListener.needSyncSumSize);
+    }
+    return result;
+}
+
+//sync_patch() download by readSyncDataRanges() with requests in flight, mock server have latency
+static long bench_hsynz_sync_ranges_mt(){
+    const size_t kDataSize=1024*1024*16;
+    const int    kLatencyMs=10;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(3);
+    setRandData(oldData);
+    newData=oldData;
+    setScatteredEdits(newData,1024*32);
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const TSyncRangesPlan plan={0,0,8}; //many little requests
+    const size_t inFlights[]={1,4,16};
+    printf("hsynz sync_patch() by ranges in flight, latency:%dms new:%ld old:%ld\n",
+           kLatencyMs,(long)newData.size(),(long)oldData.size());
+    for (size_t i=0;i<sizeof(inFlights)/sizeof(inFlights[0]);++i){
+        TReadSyncDataRangesListener rangesListener(_hsynzData,&plan,inFlights[i],false,kLatencyMs);
+        double time0=clock_s();
+        if (!_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                     oldData.data(),oldData.data()+oldData.size(),&rangesListener)){
+            printf("\n hsynz ranges in flight error!!! inFlight:%d\n",(int)inFlights[i]);
+            ++result;
+            continue;
+        }
+        double time1=clock_s();
+        printf("  inFlight:%d requests:%ld out of order:%ld time:%.3fs\n",(int)inFlights[i],
+               (long)rangesListener.requestCount,(long)rangesListener.outOfOrderCount,(time1-time0));
+    }
+    return result;
+}
+
+//create hsyni&hsynz time: full create vs reuse compressed data of unchanged blocks in prev release
+static long bench_hsynz_create_by_prev(){
+    const size_t kDataSize=1024*1024*32;
+    const uint32_t kSyncBlockSize=kSyncBlockSize_min;
+    std::vector<TByte> prevData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(5);
+    setRandData(prevData);
+    for (size_t i=0;i<kDataSize;i+=(size_t)(_rand()%(1024*4))+1)
+        prevData[i]=0; //some blocks cancel compress
+    newData=prevData;
+    setScatteredEdits(newData,1024*256);
+
+    long result=0;
+    std::vector<TByte> prev_hsyni,prev_hsynz;
+    std::vector<TByte> full_hsyni,full_hsynz;
+    _create_hsynz_by_prev(prevData,prev_hsyni,prev_hsynz,kSyncBlockSize,1);
+    const size_t threadNums[]={1,4};
+    printf("hsynz create by prev, new:%ld prev:%ld blocks:%ld\n",(long)newData.size(),
+           (long)prevData.size(),(long)getSyncBlockCount(newData.size(),kSyncBlockSize));
+    for (size_t t=0;t<sizeof(threadNums)/sizeof(threadNums[0]);++t){
+        double time0=clock_s();
+        _create_hsynz_by_prev(newData,full_hsyni,full_hsynz,kSyncBlockSize,threadNums[t]);
+        double time1=clock_s();
+        uint32_t reuseCount=0;
+        _create_hsynz_by_prev(newData,_hsyniData,_hsynzData,kSyncBlockSize,threadNums[t],
+                              &prev_hsyni,&prev_hsynz,&reuseCount);
+        double time2=clock_s();
+        if ((_hsyniData!=full_hsyni)||(_hsynzData!=full_hsynz)){
+            printf("\n hsynz create by prev error!!! threadNum:%d\n",(int)threadNums[t]);
+            ++result;
+            continue;
+        }
+        printf("  -p-%d full create time:%.3fs  by prev time:%.3fs (reused blocks:%d)\n",
+               (int)threadNums[t],time1-time0,time2-time1,(int)reuseCount);
+    }
+    return result;
+}
+
+//sync_patch() time by fixed blocks (roll every byte of old) & cdc blocks (only match at cut points)
+static long bench_hsynz_sync_cdc(){
+    const size_t kDataSize=1024*1024*128;
+    const uint32_t kBlockSize=kSyncBlockSize_default;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(6);
+    setRandData(oldData);
+    newData=oldData;
+    setScatteredEdits(newData,1024*32);
+    struct hpatch_TStreamInput  newStream;
+    mem_as_hStreamInput(&newStream,newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const int threadNums[]={1,4};
+    printf("hsynz sync_patch() fixed & cdc blocks, new:%ld old:%ld\n",(long)newData.size(),(long)oldData.size());
+    for (int isCdc=0;isCdc<=1;++isCdc){
+        _hsyniData.clear();
+        _hsynzData=newData; //not compressed, download from newData
+        TVectorAsStreamOutput hiStream(_hsyniData);
+        if (isCdc)
+            create_sync_data_cdc(&newStream,&hiStream,hsynzDefaultChecksum,kBlockSize);
+        else
+            create_sync_data(&newStream,&hiStream,hsynzDefaultChecksum,0,kBlockSize);
+        for (size_t t=0;t<sizeof(threadNums)/sizeof(threadNums[0]);++t){
+            TReadSyncDataRangesListener rangesListener(_hsynzData);
+            double time0=clock_s();
+            if (!_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                         oldData.data()+oldData.size(),&rangesListener,threadNums[t])){
+                printf("\n hsynz sync cdc error!!! isCdc:%d threadNum:%d\n",isCdc,threadNums[t]);
+                ++result;
+                continue;
+            }
+            double time1=clock_s();
+            printf("  %s -p-%d needSync size:%ld time:%.3fs\n",isCdc?"cdc  ":"fixed",threadNums[t],
+                   (long)rangesListener.needSyncSumSize,time1-time0);
+        }
+    }
+    _hsynzData.clear();
+    return result;
+}
+
+#if (_IS_NEED_DIR_DIFF_PATCH)
+//res list of temp files for hpatch_TResHandleLimit
+struct TFileResList{
+    std::vector<std::string>                fileNames;
+    std::vector<hpatch_TFileStreamInput>    files;
+    std::vector<hpatch_IResHandle>          resList;
+    static hpatch_BOOL _open(hpatch_IResHandle* res,hpatch_TStreamInput** out_stream){
+        TFileResList* self=(TFileResList*)res->resImport;
+        size_t i=res-self->resList.data();
+        hpatch_TFileStreamInput* file=&self->files[i];
+        hpatch_TFileStreamInput_init(file);
+        if (!hpatch_TFileStreamInput_open(file,self->fileNames[i].c_str())) return hpatch_FALSE;
+        *out_stream=&file->base;
+        return hpatch_TRUE;
+    }
+    static hpatch_BOOL _close(hpatch_IResHandle* res,const hpatch_TStreamInput* stream){
+        TFileResList* self=(TFileResList*)res->resImport;
+        return hpatch_TFileStreamInput_close(&self->files[res-self->resList.data()]);
+    }
+};
+
+//hpatch_TResHandleLimit read files by round-robin: open & reopen & time, with or without memory cache of small files
+static long bench_res_handle_limit(){
+    const size_t kFileCount=2000;
+    const size_t kLimitOpenCount=64;
+    const size_t kLoopCount=5;
+    const size_t kReadCount=4;
+    const size_t kReadSize=256;
+    const char*  kTempDir="_bench_res_handle_tmp";
+    _srand(7);
+    long result=0;
+    if (!hpatch_makeNewDir(kTempDir)) return 1;
+    TFileResList fres;
+    fres.fileNames.resize(kFileCount);
+    fres.files.resize(kFileCount);
+    fres.resList.resize(kFileCount);
+    hpatch_StreamPos_t sumSize=0;
+    for (size_t i=0;i<kFileCount;++i){
+        std::vector<TByte> data(((i%8)==0)?1024*256:(size_t)(_rand()%(1024*16))+kReadSize);
+        setRandData(data);
+        char fileName[256];
+        sprintf(fileName,"%s/%d.dat",kTempDir,(int)i);
+        fres.fileNames[i]=fileName;
+        FILE* f=fopen(fileName,"wb");
+        if ((f==0)||(fwrite(data.data(),1,data.size(),f)!=data.size())) ++result;
+        if (f) fclose(f);
+        hpatch_IResHandle& res=fres.resList[i];
+        res.resImport=&fres;
+        res.resStreamSize=data.size();
+        res.open=TFileResList::_open;
+        res.close=TFileResList::_close;
+        sumSize+=data.size();
+    }
+    printf("hpatch_TResHandleLimit files:%d size:%ld limitOpen:%d reads:%d\n",(int)kFileCount,
+           (long)sumSize,(int)kLimitOpenCount,(int)(kFileCount*kLoopCount*kReadCount));
+    const size_t memCacheSizes[]={0,1024*1024*64};
+    TByte buf[kReadSize];
+    for (size_t m=0;(result==0)&&(m<sizeof(memCacheSizes)/sizeof(memCacheSizes[0]));++m){
+        hpatch_TResHandleLimit limit;
+        hpatch_TResHandleLimit_init(&limit);
+        double time0=clock_s();
+        if (!hpatch_TResHandleLimit_open(&limit,kLimitOpenCount,fres.resList.data(),kFileCount)
+            ||((memCacheSizes[m]>0)&&!hpatch_TResHandleLimit_setMemCache(&limit,memCacheSizes[m],
+                                                                         hpatch_kResMemCacheSmallFileSize)))
+            ++result;
+        for (size_t loop=0;(result==0)&&(loop<kLoopCount);++loop){
+            for (size_t i=0;(result==0)&&(i<kFileCount);++i){
+                const hpatch_TStreamInput* stream=limit.streamList[i];
+                for (size_t r=0;r<kReadCount;++r){
+                    hpatch_StreamPos_t pos=(hpatch_StreamPos_t)(_rand()%(stream->streamSize-kReadSize+1));
+                    if (!stream->read(stream,pos,buf,buf+kReadSize)){ ++result; break; }
+                }
+            }
+        }
+        if (!hpatch_TResHandleLimit_close(&limit)) ++result;
+        double time1=clock_s();
+        const hpatch_TResHandleLimitInfo& info=limit.info;
+        printf("  memCache:%ld read:%ld hit:%ld open:%ld reopen:%ld cached:%ld time:%.3fs\n",(long)memCacheSizes[m],
+               (long)info.readCount,(long)info.hitCount,(long)info.openCount,(long)info.reopenCount,
+               (long)info.memCachedSize,time1-time0);
+    }
+    for (size_t i=0;i<kFileCount;++i)
+        hpatch_removeFile(fres.fileNames[i].c_str());
+    hpatch_removeDir(kTempDir);
+    if (result)
+        printf("\n res handle limit bench error!!!\n");
+    return result;
+}
+#endif
+
+int main(int argc, const char * argv[]){
+    long errorCount=0;
+    errorCount+=bench_hsynz_mt_local_diff();
+    errorCount+=bench_hsynz_sync_ranges();
+    errorCount+=bench_hsynz_sync_ranges_mt();
+    errorCount+=bench_hsynz_create_by_prev();
+    errorCount+=bench_hsynz_sync_cdc();
+#if (_IS_NEED_DIR_DIFF_PATCH)
+    errorCount+=bench_res_handle_limit();
+#endif
+    printf("\nbench errorCount:%ld\n",errorCount);
+    return (int)errorCount;
+}
@@ -0,0 +1,148 @@
+//  cover_cost_test.cpp
+//  test select covers by order-0 cost model: diffData must be right, and smaller for input binary files
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+  usage: cover_cost_test [oldFile newFile]
+    need ZLIB (Makefile default);
+    diff this test's executable file and a relinked like copy of it by order-1 & order-0 cost model,
+    diffData must be right;
+    if input oldFile newFile (big binary files, like libLLVM.so 14 & 15), order-0's diffData must smaller.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../libHDiffPatch/HDiff/diff.h"
+#include "../libHDiffPatch/HDiff/match_block.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include "../compress_plugin_demo.h"
+#include "../decompress_plugin_demo.h"
+typedef unsigned char TByte;
+
+static bool readFile(const char* fileName,std::vector<TByte>& out_data){
+    FILE* f=fopen(fileName,"rb");
+    if (f==0) return false;
+    fseek(f,0,SEEK_END);
+    long fileSize=ftell(f);
+    fseek(f,0,SEEK_SET);
+    out_data.resize((fileSize>0)?(size_t)fileSize:0);
+    bool result=(fileSize>=0)&&(fread(out_data.data(),1,out_data.size(),f)==out_data.size());
+    fclose(f);
+    return result;
+}
+
+//like a relinked new version: some functions inserted, so many 4-byte relative addresses changed
+static void setRelinkedData(std::vector<TByte>& newData,const std::vector<TByte>& oldData){
+    newData.clear();
+    for (size_t i=0;i<oldData.size();){
+        if ((i%(1024*16))==0){ //insert new code, copy from other place
+            size_t pos=(size_t)rand()%oldData.size();
+            size_t len=(size_t)rand()%256;
+            if (len>oldData.size()-pos) len=oldData.size()-pos;
+            newData.insert(newData.end(),oldData.begin()+pos,oldData.begin()+pos+len);
+        }
+        if ((i+5<=oldData.size())&&((oldData[i]==0xE8)||(oldData[i]==0xE9))){ //call|jmp rel32
+            hpatch_uint32_t v=oldData[i+1]|(oldData[i+2]<<8)|(oldData[i+3]<<16)|((hpatch_uint32_t)oldData[i+4]<<24);
+            v+=(hpatch_uint32_t)(i/(1024*16))*128;
+            newData.push_back(oldData[i]);
+            for (int b=0;b<4;++b,v>>=8)
+                newData.push_back((TByte)v);
+            i+=5;
+        }else{
+            newData.push_back(oldData[i++]);
+        }
+    }
+}
+
+//diff by coverCostModel & check; return diffData size, 0 when error
+static size_t getDiffSize(const std::vector<TByte>& newData,const std::vector<TByte>& oldData,
+                          const hdiff_ICoverCostModel* coverCostModel,bool isSingleCompressedDiff,size_t matchBlockSize){
+    std::vector<TByte> newBuf(newData); //match block will change data in memory
+    std::vector<TByte> oldBuf(oldData);
+    std::vector<TByte> diffData;
+    if (isSingleCompressedDiff)
+        create_single_compressed_diff_block(newBuf.data(),newBuf.data()+newBuf.size(),oldBuf.data(),oldBuf.data()+oldBuf.size(),
+                                            diffData,&zlibCompressPlugin.base,kMinSingleMatchScore_default,
+                                            kDefaultPatchStepMemSize,false,matchBlockSize,1,coverCostModel);
+    else
+        create_compressed_diff_block(newBuf.data(),newBuf.data()+newBuf.size(),oldBuf.data(),oldBuf.data()+oldBuf.size(),
+                                     diffData,&zlibCompressPlugin.base,kMinSingleMatchScore_default,
+                                     false,matchBlockSize,1,coverCostModel);
+    bool isOk=isSingleCompressedDiff?
+        check_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),oldData.data()+oldData.size(),
+                                     diffData.data(),diffData.data()+diffData.size(),&zlibDecompressPlugin)
+        :check_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),oldData.data()+oldData.size(),
+                               diffData.data(),diffData.data()+diffData.size(),&zlibDecompressPlugin);
+    return isOk?diffData.size():0;
+}
+
+//diff by default order-1 model & order-0 model;
+//  if isMustSmaller, order-0 model's diffData must smaller than order-1 model's
+static long test_order0(const char* name,const std::vector<TByte>& newData,const std::vector<TByte>& oldData,
+                        bool isMustSmaller){
+    long errorCount=0;
+    for (int m=0;m<(isMustSmaller?2:4);++m){
+        const bool isSingleCompressedDiff=(m&1)==0;
+        const size_t matchBlockSize=((m&2)==0)?kDefaultFastMatchBlockSize:0;
+        size_t order1Size=getDiffSize(newData,oldData,0,isSingleCompressedDiff,matchBlockSize);
+        size_t order0Size=getDiffSize(newData,oldData,getOrder0CoverCostModel(),isSingleCompressedDiff,matchBlockSize);
+        printf("  %s %s -block-%ld new:%ld old:%ld diffSize order-1:%ld order-0:%ld\n",name,
+               isSingleCompressedDiff?"-SD":"   ",(long)matchBlockSize,(long)newData.size(),(long)oldData.size(),
+               (long)order1Size,(long)order0Size);
+        if ((order1Size==0)||(order0Size==0)||(isMustSmaller&&(order0Size>=order1Size))){
+            printf("\n %s cover cost model order-0 error!!!\n",name);
+            ++errorCount;
+        }
+    }
+    return errorCount;
+}
+
+int main(int argc, const char * argv[]){
+    _hdiff_is_out_diff_info=0;
+    long errorCount=0;
+    srand(5);
+    {
+        std::vector<TByte> oldData,newData;
+        if (!readFile(argv[0],oldData)||oldData.empty()){
+            printf("\n read file error!!! \"%s\"\n",argv[0]);
+            return 1;
+        }
+        setRelinkedData(newData,oldData);
+        errorCount+=test_order0("self exe",newData,oldData,false);
+    }
+    if (argc>=3){
+        std::vector<TByte> oldData,newData;
+        if (!readFile(argv[1],oldData)||!readFile(argv[2],newData)){
+            printf("\n read file error!!! \"%s\" \"%s\"\n",argv[1],argv[2]);
+            return 1;
+        }
+        errorCount+=test_order0("input",newData,oldData,true);
+    }
+    printf("\ncover cost test errorCount:%ld\n",errorCount);
+    return (errorCount==0)?0:1;
+}
@@ -0,0 +1,169 @@
+//  decompress_pool_test.cpp
+//  test decompressor pool: patch many times by the same plugin, must reuse memory of closed decompressors
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+  usage: decompress_pool_test
+    used compress plugins selected by Makefile (ZLIB BZIP2 ZSTD ...)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../libHDiffPatch/HDiff/diff.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include "../compress_plugin_demo.h"
+#include "../decompress_plugin_demo.h"
+typedef unsigned char TByte;
+
+struct TTestPlugin{
+    const char*             name;
+    const hdiff_TCompress*  compressPlugin;
+    hpatch_TDecompress*     decompressPlugin;
+};
+
+static void setTestData(std::vector<TByte>& oldData,std::vector<TByte>& newData,size_t dataSize){
+    oldData.resize(dataSize);
+    for (size_t i=0;i<dataSize;++i)
+        oldData[i]=(TByte)('a'+rand()%16);
+    newData=oldData;
+    for (size_t i=0;i<dataSize;i+=(size_t)(rand()%4096)+1){
+        newData[i]=(TByte)rand();
+        if (i%64==0) newData.insert(newData.begin()+i,(TByte)rand());
+    }
+}
+
+static hpatch_TDecompressPoolInfo getPoolInfo(){
+    hpatch_TDecompressPoolInfo info;
+    hpatch_decompressPool_getInfo(&info);
+    return info;
+}
+
+//patch kPatchCount times with pool opened; return error count
+static long test_pool(const TTestPlugin& tp,size_t maxCachedSize,bool isMustReuse){
+    const size_t kPatchCount=5;
+    std::vector<TByte> oldData,newData,diffData,codeData;
+    setTestData(oldData,newData,1024*512);
+    create_compressed_diff(newData.data(),newData.data()+newData.size(),
+                           oldData.data(),oldData.data()+oldData.size(),diffData,tp.compressPlugin);
+    codeData.resize((size_t)tp.compressPlugin->maxCompressedSize(newData.size()));
+    codeData.resize(hdiff_compress_mem(tp.compressPlugin,codeData.data(),codeData.data()+codeData.size(),
+                                       newData.data(),newData.data()+newData.size()));
+    long errorCount=0;
+    if (codeData.empty()) ++errorCount;
+    std::vector<TByte> outData(newData.size());
+    if (!hpatch_decompressPool_open(maxCachedSize)) return errorCount+1;
+    hpatch_TDecompressPoolInfo info1; //after first patch
+    memset(&info1,0,sizeof(info1));
+    for (size_t i=0;i<kPatchCount;++i){
+        memset(outData.data(),0,outData.size());
+        if (!patch_decompress_mem(outData.data(),outData.data()+outData.size(),oldData.data(),
+                                  oldData.data()+oldData.size(),diffData.data(),diffData.data()+diffData.size(),
+                                  tp.decompressPlugin)||(outData!=newData))
+            ++errorCount;
+        memset(outData.data(),0,outData.size());
+        if (!hpatch_deccompress_mem(tp.decompressPlugin,codeData.data(),codeData.data()+codeData.size(),
+                                    outData.data(),outData.data()+outData.size())||(outData!=newData))
+            ++errorCount;
+        if (i==0) info1=getPoolInfo();
+    }
+    hpatch_TDecompressPoolInfo info=getPoolInfo();
+    hpatch_decompressPool_close();
+    hpatch_TDecompressPoolInfo closedInfo=getPoolInfo();
+    printf("  %s maxCachedSize:%" PRIu64 " malloc %" PRIu64 " reuse %" PRIu64 " free %" PRIu64 " cached %" PRIu64 "\n",
+           tp.name,(hpatch_StreamPos_t)info.maxCachedSize,info.mallocCount,info.reuseCount,
+           closedInfo.freeCount,(hpatch_StreamPos_t)info.cachedSize);
+    const hpatch_StreamPos_t allocCount1=info1.mallocCount+info1.reuseCount;
+    if (info1.mallocCount==0) ++errorCount;
+    if (isMustReuse){ //all memory of every later patch reused
+        if ((info.mallocCount!=info1.mallocCount)||(info.reuseCount!=info1.reuseCount+allocCount1*(kPatchCount-1)))
+            ++errorCount;
+    }else{
+        if ((info.reuseCount!=0)||(info.mallocCount!=allocCount1*kPatchCount))
+            ++errorCount;
+    }
+    if (info.cachedSize>info.maxCachedSize) ++errorCount;
+    if ((closedInfo.cachedSize!=0)||(closedInfo.freeCount!=closedInfo.mallocCount)) ++errorCount;
+    if (errorCount)
+        printf("\n %s decompressor pool error!!!\n",tp.name);
+    return errorCount;
+}
+
+//auto cap (maxCachedSize==0): memory of decompressors opened at same time all cached,
+//  though their size (big dictSize) > kDecompressPoolMaxCachedSize_default
+static long test_pool_autoCap(){
+    const size_t kMemCount=3;
+    const size_t kMemSize=kDecompressPoolMaxCachedSize_default/2+1024; //like lzma's 8MB dict + state
+    long errorCount=0;
+    if (!hpatch_decompressPool_open(0)) return 1;
+    for (size_t r=0;r<3;++r){
+        void* mems[kMemCount];
+        for (size_t i=0;i<kMemCount;++i){
+            mems[i]=_dec_malloc(kMemSize);
+            if (mems[i]==0) ++errorCount;
+        }
+        for (size_t i=0;i<kMemCount;++i)
+            _dec_free(mems[i]);
+    }
+    hpatch_TDecompressPoolInfo info=getPoolInfo();
+    hpatch_decompressPool_close();
+    printf("  auto maxCachedSize:%" PRIu64 " maxUsedSize:%" PRIu64 " malloc %" PRIu64 " reuse %" PRIu64 "\n",
+           (hpatch_StreamPos_t)info.maxCachedSize,(hpatch_StreamPos_t)info.maxUsedSize,info.mallocCount,info.reuseCount);
+    if ((info.mallocCount!=kMemCount)||(info.reuseCount!=kMemCount*2)) ++errorCount;
+    if ((info.maxUsedSize!=kMemSize*kMemCount)||(info.maxCachedSize!=info.maxUsedSize)||(info.usedSize!=0))
+        ++errorCount;
+    if (errorCount)
+        printf("\n auto cap decompressor pool error!!!\n");
+    return errorCount;
+}
+
+int main(int argc, const char * argv[]){
+    const TTestPlugin plugins[]={
+#ifdef  _CompressPlugin_zlib
+        {"zlib",&zlibCompressPlugin.base,&zlibDecompressPlugin},
+#endif
+#ifdef  _CompressPlugin_bz2
+        {"bz2",&bz2CompressPlugin.base,&bz2DecompressPlugin},
+#endif
+#ifdef  _CompressPlugin_lzma
+        {"lzma",&lzmaCompressPlugin.base,&lzmaDecompressPlugin},
+#endif
+#ifdef  _CompressPlugin_zstd
+        {"zstd",&zstdCompressPlugin.base,&zstdDecompressPlugin},
+#endif
+        {0,0,0}
+    };
+    _hdiff_is_out_diff_info=0;
+    long errorCount=0;
+    for (size_t i=0;plugins[i].name;++i){
+        errorCount+=test_pool(plugins[i],0,true);
+        errorCount+=test_pool(plugins[i],1,false); //cache nothing
+    }
+    errorCount+=test_pool_autoCap();
+    printf("\ndecompress pool test errorCount:%ld\n",errorCount);
+    return (errorCount==0)?0:1;
+}
@@ -0,0 +1,228 @@
+//  gzdiff_test.cpp
+//  test gzdiff: diff gzip files by inflated datas, patch must recompress new gzip file bit-exactly
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+  usage: gzdiff_test
+    need build with GZD=1 (ZLIB>0)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../libHDiffPatch/HDiff/diff.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include "../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../compress_plugin_demo.h"
+#include "../decompress_plugin_demo.h"
+#if (_IS_NEED_GZDIFF)
+#include "../gzdiff_wrapper/gzdiff_wrapper.h"
+#include "../gzdiff_wrapper/gzpatch_wrapper.h"
+#include "zlib.h"
+typedef unsigned char TByte;
+using namespace hdiff_private;
+
+static void setTextData(std::vector<TByte>& data,size_t dataSize){
+    static const char* kWords[]={"diff ","patch ","gzip ","deflate ","inflate ","stream ","cache ","zlib\n"};
+    data.clear();
+    while (data.size()<dataSize){
+        const char* w=kWords[rand()%8];
+        data.insert(data.end(),w,w+strlen(w));
+        if (rand()%16==0) data.push_back((TByte)('0'+rand()%10));
+    }
+    data.resize(dataSize);
+}
+static void setRandData(std::vector<TByte>& data,size_t dataSize){
+    data.resize(dataSize);
+    for (size_t i=0;i<dataSize;++i)
+        data[i]=(TByte)rand();
+}
+static void setEdits(std::vector<TByte>& data){
+    for (size_t i=0;i<data.size();i+=(size_t)(rand()%(1024*16))+1){
+        data[i]=(TByte)rand();
+        if (i%8==0) data.insert(data.begin()+i,(TByte)rand());
+    }
+}
+
+static bool gzCompress(std::vector<TByte>& out_gz,const std::vector<TByte>& data,
+                       int level,int memLevel,int strategy){
+    z_stream s;
+    memset(&s,0,sizeof(s));
+    if (Z_OK!=deflateInit2(&s,level,Z_DEFLATED,16+MAX_WBITS,memLevel,strategy)) return false;
+    out_gz.resize(deflateBound(&s,(uLong)data.size()));
+    s.next_in=(Bytef*)data.data();
+    s.avail_in=(uInt)data.size();
+    s.next_out=out_gz.data();
+    s.avail_out=(uInt)out_gz.size();
+    int ret=deflate(&s,Z_FINISH);
+    out_gz.resize(out_gz.size()-s.avail_out);
+    deflateEnd(&s);
+    return ret==Z_STREAM_END;
+}
+
+//patch by gzpatch_with_cache with cacheSize; return error count
+static long _patch(const std::vector<TByte>& newGz,const std::vector<TByte>& old,const std::vector<TByte>& diff,
+                   hpatch_TDecompress* decompressPlugin,size_t cacheSize){
+    hpatch_TStreamInput  oldStream;
+    hpatch_TStreamInput  diffStream;
+    hpatch_TStreamOutput outStream;
+    std::vector<TByte> out(newGz.size());
+    std::vector<TByte> cache(cacheSize);
+    mem_as_hStreamInput(&oldStream,old.data(),old.data()+old.size());
+    mem_as_hStreamInput(&diffStream,diff.data(),diff.data()+diff.size());
+    mem_as_hStreamOutput(&outStream,out.data(),out.data()+out.size());
+    if (!gzpatch_with_cache(&outStream,&oldStream,&diffStream,decompressPlugin,
+                            cache.data(),cache.data()+cache.size())) return 1;
+    return (out==newGz)?0:1;
+}
+
+struct TGzSets{
+    int     level;
+    int     memLevel;
+    bool    isOldGz;
+    bool    isRandData;
+};
+
+//diff->patch round trip; patch by big cache (inflate old into cache) & by small cache (inflate old when read)
+static long test_gzdiff(const TGzSets& gs,size_t dataSize){
+    std::vector<TByte> oldRaw,newRaw,oldData,newGz;
+    if (gs.isRandData) setRandData(oldRaw,dataSize); else setTextData(oldRaw,dataSize);
+    newRaw=oldRaw;
+    setEdits(newRaw);
+    if (!gzCompress(newGz,newRaw,gs.level,gs.memLevel,Z_DEFAULT_STRATEGY)) return 1;
+    if (gs.isOldGz){
+        if (!gzCompress(oldData,oldRaw,6,8,Z_DEFAULT_STRATEGY)) return 1;
+    }else{
+        oldData=oldRaw;
+    }
+    hpatch_TStreamInput oldStream;
+    hpatch_TStreamInput newStream;
+    mem_as_hStreamInput(&oldStream,oldData.data(),oldData.data()+oldData.size());
+    mem_as_hStreamInput(&newStream,newGz.data(),newGz.data()+newGz.size());
+    long errorCount=0;
+    for (int m=0;m<4;++m){
+        const bool isSingleDiff=(m&1)!=0;
+        const bool isDiffInMem=(m&2)!=0;
+        std::vector<TByte> diff;
+        TVectorAsStreamOutput diffStream(diff);
+        bool isOk=false;
+        try{
+            isOk=create_gzdiff(&newStream,&oldStream,&diffStream,&zlibCompressPlugin.base,isSingleDiff,isDiffInMem);
+            if (isOk){
+                hpatch_TStreamInput diffIn;
+                mem_as_hStreamInput(&diffIn,diff.data(),diff.data()+diff.size());
+                isOk=check_gzdiff(&newStream,&oldStream,&diffIn,&zlibDecompressPlugin);
+            }
+        }catch(const std::exception& e){
+            printf("  %s\n",e.what());
+            isOk=false;
+        }
+        long errors=isOk?0:1;
+        if (isOk){
+            errors+=_patch(newGz,oldData,diff,&zlibDecompressPlugin,oldRaw.size()*2+(1<<20));
+            errors+=_patch(newGz,oldData,diff,&zlibDecompressPlugin,1024*200+oldRaw.size()/4);
+        }
+        if (m==0)
+            printf("  level %d memLevel %d old %s %s %.2fMB: gzSize %ld diffSize %ld\n",gs.level,gs.memLevel,
+                   gs.isOldGz?"gzip":"raw ",gs.isRandData?"rand":"text",dataSize/(1024.0*1024),
+                   (long)newGz.size(),(long)diff.size());
+        if (errors){
+            printf("\n gzdiff error!!! isSingleDiff %d isDiffInMem %d\n",isSingleDiff,isDiffInMem);
+            errorCount+=errors;
+        }
+    }
+    return errorCount;
+}
+
+//new gzip can't recompress by zlib's deflate with default strategy: create_gzdiff return false
+static long test_gzdiff_notFound(){
+    std::vector<TByte> raw,gz;
+    setTextData(raw,1024*256);
+    if (!gzCompress(gz,raw,6,8,Z_HUFFMAN_ONLY)) return 1;
+    hpatch_TStreamInput newStream;
+    mem_as_hStreamInput(&newStream,gz.data(),gz.data()+gz.size());
+    std::vector<TByte> diff;
+    TVectorAsStreamOutput diffStream(diff);
+    if (create_gzdiff(&newStream,&newStream,&diffStream,&zlibCompressPlugin.base,false,true)||(!diff.empty())){
+        printf("\n gzdiff not found deflate sets error!!!\n");
+        return 1;
+    }
+    return 0;
+}
+
+//multi-member gzip: only the first member be diffed, the rest size reported & patch still bit-exact
+static long test_gzdiff_multiMember(){
+    std::vector<TByte> oldRaw,newRaw,oldGz,newGz,member2;
+    setTextData(oldRaw,1024*256);
+    newRaw=oldRaw;
+    setEdits(newRaw);
+    if (!gzCompress(oldGz,oldRaw,6,8,Z_DEFAULT_STRATEGY)) return 1;
+    if (!gzCompress(newGz,newRaw,6,8,Z_DEFAULT_STRATEGY)) return 1;
+    if (!gzCompress(member2,newRaw,9,8,Z_DEFAULT_STRATEGY)) return 1;
+    newGz.insert(newGz.end(),member2.begin(),member2.end());
+    oldGz.insert(oldGz.end(),member2.begin(),member2.begin()+member2.size()/2);
+    hpatch_TStreamInput oldStream;
+    hpatch_TStreamInput newStream;
+    mem_as_hStreamInput(&oldStream,oldGz.data(),oldGz.data()+oldGz.size());
+    mem_as_hStreamInput(&newStream,newGz.data(),newGz.data()+newGz.size());
+    std::vector<TByte> diff;
+    TVectorAsStreamOutput diffStream(diff);
+    TGzDiffRestInfo restInfo;
+    long errorCount=0;
+    if (!create_gzdiff(&newStream,&oldStream,&diffStream,&zlibCompressPlugin.base,false,true,
+                       kMinSingleMatchScore_default,kDefaultPatchStepMemSize,false,kMatchBlockSize_default,0,&restInfo))
+        return 1;
+    if ((restInfo.newRestSize!=member2.size())||(restInfo.oldRestSize!=member2.size()/2))
+        ++errorCount;
+    errorCount+=_patch(newGz,oldGz,diff,&zlibDecompressPlugin,1024*1024*2);
+    printf("  multi-member: newRestSize %ld oldRestSize %ld diffSize %ld\n",
+           (long)restInfo.newRestSize,(long)restInfo.oldRestSize,(long)diff.size());
+    if (errorCount)
+        printf("\n gzdiff multi-member error!!!\n");
+    return errorCount;
+}
+#endif //_IS_NEED_GZDIFF
+
+int main(int argc, const char * argv[]){
+    long errorCount=0;
+#if (_IS_NEED_GZDIFF)
+    _hdiff_is_out_diff_info=0;
+    srand(7);
+    const TGzSets kSets[]={
+        {6,8,true ,false}, {9,8,true ,false}, {1,8,false,false}, {4,5,true ,false},
+        {9,9,false,false}, {6,8,true ,true }, {2,3,true ,false} };
+    for (size_t i=0;i<sizeof(kSets)/sizeof(kSets[0]);++i)
+        errorCount+=test_gzdiff(kSets[i],1024*512);
+    errorCount+=test_gzdiff(kSets[0],1024*1024*5); //inflate old by some saved access points
+    errorCount+=test_gzdiff_notFound();
+    errorCount+=test_gzdiff_multiMember();
+#else
+    printf("gzdiff not supported, need build with GZD=1\n");
+#endif
+    printf("\ngzdiff test errorCount:%ld\n",errorCount);
+    return (errorCount==0)?0:1;
+}
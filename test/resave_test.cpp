@@ -0,0 +1,235 @@
+//  resave_test.cpp
+//  test parallel resave: read ahead decompress thread & batch resave by threads, same out as by single thread
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+  usage: resave_test
+    need ZLIB (Makefile default) and multithread (MT=1)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../libHDiffPatch/HDiff/diff.h"
+#include "../libHDiffPatch/HPatch/patch.h"
+#include "../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../compress_plugin_demo.h"
+#include "../decompress_plugin_demo.h"
+#if (_IS_USED_MULTITHREAD)
+#include "../libParallel/parallel_channel.h"
+#endif
+using namespace hdiff_private;
+typedef unsigned char TByte;
+
+static void setTestData(std::vector<TByte>& oldData,std::vector<TByte>& newData,size_t dataSize){
+    oldData.resize(dataSize);
+    for (size_t i=0;i<dataSize;++i)
+        oldData[i]=(TByte)('a'+rand()%16);
+    newData=oldData;
+    for (size_t i=0;i<dataSize;i+=(size_t)(rand()%4096)+1){
+        newData[i]=(TByte)rand();
+        if (i%64==0) newData.insert(newData.begin()+i,(TByte)rand());
+    }
+}
+
+#if (_IS_USED_MULTITHREAD)
+//read all data by TStreamReadAhead_mt with random read size & some jumps, same as src
+static long test_readAhead(){
+    const size_t kDataSize=1024*1024*3+100;
+    std::vector<TByte> data(kDataSize);
+    for (size_t i=0;i<kDataSize;++i)
+        data[i]=(TByte)rand();
+    hpatch_TStreamInput src;
+    mem_as_hStreamInput(&src,data.data(),data.data()+data.size());
+    long errorCount=0;
+    const size_t bufSizes[]={TStreamReadAhead_mt::kReadAheadBufSize,1024*3+1};
+    for (size_t b=0;b<sizeof(bufSizes)/sizeof(bufSizes[0]);++b){
+        TStreamReadAhead_mt stream(&src,bufSizes[b],(b==0)?TStreamReadAhead_mt::kReadAheadBufCount:2);
+        if (stream.streamSize!=src.streamSize) { ++errorCount; break; }
+        std::vector<TByte> buf(1024*64);
+        hpatch_StreamPos_t pos=0;
+        size_t readCount=0;
+        size_t jumpCount=0;
+        while (pos<kDataSize){
+            size_t readLen=(size_t)(rand()%buf.size())+1;
+            if (readLen>kDataSize-pos) readLen=(size_t)(kDataSize-pos);
+            if ((!stream.read(&stream,pos,buf.data(),buf.data()+readLen))
+                ||(0!=memcmp(buf.data(),data.data()+pos,readLen))){
+                ++errorCount;
+                break;
+            }
+            pos+=readLen;
+            if ((jumpCount<3)&&((++readCount)%16==0)){ //not continuous read, restart read ahead
+                pos=(hpatch_StreamPos_t)(rand()%kDataSize);
+                ++jumpCount;
+            }
+        }
+    }
+    if (errorCount)
+        printf("\n read ahead stream error!!!\n");
+    else
+        printf("  read ahead stream ok\n");
+    return errorCount;
+}
+#endif
+
+struct TResaveData{
+    std::vector<TByte> oldData;
+    std::vector<TByte> newData;
+    std::vector<TByte> inDiff;
+    bool               isSingle;
+};
+
+//resave by decompressPlugin's a copy; return false on error
+static bool resave(const TResaveData& rd,hpatch_TDecompress* decompressPlugin,
+                   const hdiff_TCompress* compressPlugin,std::vector<TByte>& out_diff,size_t threadNum){
+    hpatch_TDecompress workDecompressPlugin=*decompressPlugin;
+    hpatch_TStreamInput in;
+    mem_as_hStreamInput(&in,rd.inDiff.data(),rd.inDiff.data()+rd.inDiff.size());
+    out_diff.clear();
+    TVectorAsStreamOutput out(out_diff);
+    try{
+        if (rd.isSingle)
+            resave_single_compressed_diff(&in,&workDecompressPlugin,&out,compressPlugin,0,0,0,threadNum);
+        else
+            resave_compressed_diff(&in,&workDecompressPlugin,&out,compressPlugin,0,threadNum);
+    }catch(const std::exception& e){
+        printf("resave error: %s\n",e.what());
+        return false;
+    }
+    hpatch_TStreamInput newStream,oldStream,diffStream;
+    mem_as_hStreamInput(&newStream,rd.newData.data(),rd.newData.data()+rd.newData.size());
+    mem_as_hStreamInput(&oldStream,rd.oldData.data(),rd.oldData.data()+rd.oldData.size());
+    mem_as_hStreamInput(&diffStream,out_diff.data(),out_diff.data()+out_diff.size());
+    if (rd.isSingle)
+        return check_single_compressed_diff(&newStream,&oldStream,&diffStream,&workDecompressPlugin);
+    else
+        return check_compressed_diff(&newStream,&oldStream,&diffStream,&workDecompressPlugin);
+}
+
+#if (_IS_USED_MULTITHREAD)
+//like hdiffz's batch resave: workers share the compressPlugin, every worker has its own decompressPlugin copy
+struct TBatchResave{
+    const std::vector<TResaveData>*  datas;
+    std::vector<std::vector<TByte> > outDiffs;
+    hpatch_TDecompress*     decompressPlugin;
+    const hdiff_TCompress*  compressPlugin;
+    size_t                  curIndex;
+    size_t                  errorCount;
+    CHLocker                locker;
+    TMtByChannel            mt;
+};
+static void _batchResave_thread(int threadIndex,void* workData){
+    TBatchResave& br=*(TBatchResave*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(br.mt);
+    while (true){
+        size_t i;
+        {
+            CAutoLocker _autoLocker(br.locker.locker);
+            if (br.curIndex>=br.datas->size()) break;
+            i=br.curIndex++;
+        }
+        std::vector<TByte> outDiff;
+        bool isOk=resave((*br.datas)[i],br.decompressPlugin,br.compressPlugin,outDiff,1);
+        CAutoLocker _autoLocker(br.locker.locker);
+        if (!isOk) ++br.errorCount;
+        br.outDiffs[i].swap(outDiff);
+    }
+}
+#endif
+
+static long test_resave(const char* name,const hdiff_TCompress* inCompressPlugin,
+                        const hdiff_TCompress* compressPlugin,hpatch_TDecompress* decompressPlugin){
+    const size_t kDiffCount=6;
+    std::vector<TResaveData> datas(kDiffCount);
+    for (size_t i=0;i<kDiffCount;++i){
+        TResaveData& rd=datas[i];
+        rd.isSingle=((i%2)==1);
+        setTestData(rd.oldData,rd.newData,1024*(256+(i%3)*512)+i*33);
+        if (rd.isSingle)
+            create_single_compressed_diff(rd.newData.data(),rd.newData.data()+rd.newData.size(),
+                                          rd.oldData.data(),rd.oldData.data()+rd.oldData.size(),
+                                          rd.inDiff,inCompressPlugin);
+        else
+            create_compressed_diff(rd.newData.data(),rd.newData.data()+rd.newData.size(),
+                                   rd.oldData.data(),rd.oldData.data()+rd.oldData.size(),
+                                   rd.inDiff,inCompressPlugin);
+    }
+    long errorCount=0;
+    //resave by single thread
+    std::vector<std::vector<TByte> > outDiffs(kDiffCount);
+    for (size_t i=0;i<kDiffCount;++i){
+        if (!resave(datas[i],decompressPlugin,compressPlugin,outDiffs[i],1))
+            ++errorCount;
+    }
+#if (_IS_USED_MULTITHREAD)
+    //resave with read ahead decompress thread
+    for (size_t i=0;i<kDiffCount;++i){
+        std::vector<TByte> outDiff;
+        if ((!resave(datas[i],decompressPlugin,compressPlugin,outDiff,4))||(outDiff!=outDiffs[i]))
+            ++errorCount;
+    }
+    //batch resave by threads
+    const int kThreadNum=3;
+    TBatchResave br;
+    br.datas=&datas;
+    br.outDiffs.resize(kDiffCount);
+    br.decompressPlugin=decompressPlugin;
+    br.compressPlugin=compressPlugin;
+    br.curIndex=0;
+    br.errorCount=0;
+    if (!br.mt.start_threads(kThreadNum,_batchResave_thread,&br,true))
+        ++errorCount;
+    br.mt.wait_all_thread_end();
+    if ((br.errorCount!=0)||(br.outDiffs!=outDiffs))
+        ++errorCount;
+#endif
+    if (errorCount)
+        printf("\n %s resave error!!!\n",name);
+    else
+        printf("  %s resave %d diffs ok, same out by threads\n",name,(int)kDiffCount);
+    return errorCount;
+}
+
+int main(int argc, const char * argv[]){
+    _hdiff_is_out_diff_info=0;
+    long errorCount=0;
+#if (_IS_USED_MULTITHREAD)
+    errorCount+=test_readAhead();
+#endif
+#ifdef  _CompressPlugin_zlib
+    {
+        TCompressPlugin_zlib zlib9=zlibCompressPlugin;
+        TCompressPlugin_zlib zlib1=zlibCompressPlugin;
+        zlib9.compress_level=9;
+        zlib1.compress_level=1;
+        errorCount+=test_resave("zlib",&zlib9.base,&zlib1.base,&zlibDecompressPlugin);
+    }
+#endif
+    printf("\nresave test errorCount:%ld\n",errorCount);
+    return (errorCount==0)?0:1;
+}
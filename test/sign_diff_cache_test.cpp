@@ -0,0 +1,452 @@
+//  sign_diff_cache_test.cpp
+//  load test for TSignDiffCache: replay a request log local, by multi-thread clients
+//  Created by housisong on 2026/10/19.
+/*
+ The MIT License (MIT)
+ Copyright (c) 2012-2026 HouSisong
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+  usage: sign_diff_cache_test [-t#] [-p#] [-c#[k|m|g]] [-r#] [requestLog]
+    -t#  client thread count for replay requests, DEFAULT 8
+    -p#  threadNum for create a diff, DEFAULT 1
+    -c#  TSignDiffCache's cacheMaxSize, DEFAULT 256m; -c0 for only single-flight
+    -r#  replay all requests # times, DEFAULT 1
+    requestLog: a request per line: "oldSyncInfoFile newFile" (separated by '\t' or first ' ');
+      newFile's path used as newDataKey;
+    if no requestLog, replay a generated request log in memory, and check every diff by patch;
+      and check requests by different compressSets not share cached diff,
+      and check diffs created by threads same as by 1 thread.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <fstream>
+#include <stdexcept>
+#include "../libhsync/sign_diff/sign_diff_cache.h"
+#include "../libhsync/sync_client/sync_info_client.h"
+#include "../libhsync/sync_make/sync_make.h"
+#include "../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../libParallel/parallel_channel.h"
+#include "../file_for_patch.h"
+#include "../_clock_for_demo.h"
+#include "../_atosize.h"
+#define _ChecksumPlugin_fadler32
+#include "../checksum_plugin_demo.h"
+#include "../compress_plugin_demo.h"
+#include "../decompress_plugin_demo.h"
+using namespace hdiff_private;
+
+typedef unsigned char TByte;
+static hpatch_TChecksum* signChecksumPlugin=&fadler32ChecksumPlugin;
+
+struct TSyncInfoListener:public ISyncInfoListener{
+    inline TSyncInfoListener(){
+        memset((ISyncInfoListener*)this,0,sizeof(ISyncInfoListener));
+        infoImport=this;
+        findChecksumPlugin=_findChecksumPlugin;
+    }
+    static hpatch_TChecksum* _findChecksumPlugin(ISyncInfoListener* listener,const char* strongChecksumType){
+        if (0==strcmp(strongChecksumType,signChecksumPlugin->checksumType()))
+            return signChecksumPlugin;
+        return 0;
+    }
+};
+
+struct TOldSign{
+    TOldDataSyncInfo    info;
+    std::vector<TByte>  oldData; //only for check diff, can empty
+    TOldSign(){ TNewDataSyncInfo_init(&info); }
+    ~TOldSign(){ TNewDataSyncInfo_close(&info); }
+};
+struct TNewData{
+    std::string         fileName; //newDataKey; if empty, data in memory
+    std::vector<TByte>  data;
+};
+struct TRequest{
+    size_t oldIndex;
+    size_t newIndex;
+};
+
+struct TReplay{
+    std::vector<TOldSign*>  olds;
+    std::vector<TNewData>   news;
+    std::vector<TRequest>   requests;
+    size_t                  threadNum;
+    TSignDiffCache*         cache;
+    hpatch_StreamPos_t      outDiffSize;
+    size_t                  checkedCount;
+    size_t                  errorCount;
+#if (_IS_USED_MULTITHREAD)
+    CHLocker                locker;
+#endif
+    TReplay():threadNum(1),cache(0),outDiffSize(0),checkedCount(0),errorCount(0){}
+    ~TReplay(){ for (size_t i=0;i<olds.size();++i) delete olds[i]; }
+};
+
+static void _runRequest(TReplay& rp,const TRequest& req){
+    const TOldSign& old=*rp.olds[req.oldIndex];
+    const TNewData& newData=rp.news[req.newIndex];
+    std::vector<TByte> diff;
+    TVectorAsStreamOutput diffStream(diff);
+    if (newData.fileName.empty()){
+        hpatch_TStreamInput newStream;
+        mem_as_hStreamInput(&newStream,newData.data.data(),newData.data.data()+newData.data.size());
+        const TByte* key=(const TByte*)&req.newIndex;
+        rp.cache->get_hdiff_by_sign(key,sizeof(req.newIndex),&newStream,&old.info,&diffStream,0,0,
+                                    kDefaultPatchStepMemSize,rp.threadNum);
+    }else{
+        hpatch_TFileStreamInput newStream;
+        hpatch_TFileStreamInput_init(&newStream);
+        if (!hpatch_TFileStreamInput_open(&newStream,newData.fileName.c_str()))
+            throw std::runtime_error("open newFile \""+newData.fileName+"\" error!");
+        const TByte* key=(const TByte*)newData.fileName.c_str();
+        try{
+            rp.cache->get_hdiff_by_sign(key,newData.fileName.size(),&newStream.base,&old.info,&diffStream,0,0,
+                                        kDefaultPatchStepMemSize,rp.threadNum);
+        }catch(...){
+            hpatch_TFileStreamInput_close(&newStream);
+            throw;
+        }
+        hpatch_TFileStreamInput_close(&newStream);
+    }
+    bool isOk=true;
+    if (!old.oldData.empty()){
+        isOk=check_single_compressed_diff(newData.data.data(),newData.data.data()+newData.data.size(),
+                                          old.oldData.data(),old.oldData.data()+old.oldData.size(),
+                                          diff.data(),diff.data()+diff.size(),0);
+    }
+#if (_IS_USED_MULTITHREAD)
+    CAutoLocker _autoLocker(rp.locker);
+#endif
+    rp.outDiffSize+=diff.size();
+    if (!old.oldData.empty()) ++rp.checkedCount;
+    if (!isOk) ++rp.errorCount;
+}
+
+#if (_IS_USED_MULTITHREAD)
+struct TMt:public TMtByChannel{
+    explicit TMt(TReplay& _rp,size_t _requestCount):rp(_rp),requestCount(_requestCount),workIndex(0){}
+    TReplay&            rp;
+    const size_t        requestCount;
+    std::atomic<size_t> workIndex;
+};
+static void _replay_mt(int threadIndex,void* workData){
+    TMt& mt=*(TMt*)workData;
+    TMtByChannel::TAutoThreadEnd __auto_thread_end(mt);
+    try{
+        while (!mt.is_on_error()){
+            size_t curWorkIndex=mt.workIndex++;
+            if (curWorkIndex>=mt.requestCount) break;
+            _runRequest(mt.rp,mt.rp.requests[curWorkIndex%mt.rp.requests.size()]);
+        }
+    }catch(const std::exception& e){
+        printf("  request error: %s\n",e.what());
+        mt.on_error();
+    }
+}
+#endif
+
+static void replay(TReplay& rp,size_t clientThreadNum,size_t repeatCount){
+    const size_t requestCount=rp.requests.size()*repeatCount;
+    double time0=clock_s();
+#if (_IS_USED_MULTITHREAD)
+    if (clientThreadNum>1){
+        TMt mt(rp,requestCount);
+        if (!mt.start_threads((int)clientThreadNum,_replay_mt,&mt,true))
+            throw std::runtime_error("start_threads() error!");
+        mt.wait_all_thread_end();
+        if (mt.is_on_error())
+            throw std::runtime_error("replay requests error!");
+    }else
+#endif
+    {
+        for (size_t i=0;i<requestCount;++i)
+            _runRequest(rp,rp.requests[i%rp.requests.size()]);
+    }
+    double time1=clock_s();
+    TSignDiffCache::TStatistics st;
+    rp.cache->getStatistics(&st);
+    printf("requests: %" PRIu64 "  time: %.3f s  (%.1f requests/s)  out diff size: %" PRIu64 "\n",
+           (hpatch_StreamPos_t)requestCount,(time1-time0),requestCount/(time1-time0+1e-9),rp.outDiffSize);
+    printf("cache hit: %" PRIu64 "  wait: %" PRIu64 "  create: %" PRIu64 "  evict: %" PRIu64
+           "  cached: %" PRIu64 " diffs %" PRIu64 " bytes\n",st.hitCount,st.waitCount,st.createCount,st.evictCount,
+           (hpatch_StreamPos_t)st.cachedCount,(hpatch_StreamPos_t)st.cachedSize);
+    if (rp.checkedCount>0)
+        printf("checked diff: %" PRIu64 "  errorCount: %" PRIu64 "\n",
+               (hpatch_StreamPos_t)rp.checkedCount,(hpatch_StreamPos_t)rp.errorCount);
+}
+
+static void _openOldSign(TOldSign* old,const hpatch_TStreamInput* hsyni,const char* fileName){
+    TSyncInfoListener listener;
+    TSyncClient_resultType ret;
+    if (fileName)
+        ret=TNewDataSyncInfo_open_by_file(&old->info,fileName,hpatch_TRUE,&listener);
+    else
+        ret=TNewDataSyncInfo_open(&old->info,hsyni,hpatch_TRUE,&listener);
+    if (ret!=kSyncClient_ok)
+        throw std::runtime_error(std::string("open old .hsyni error! ")+(fileName?fileName:""));
+}
+
+static void loadRequestLog(TReplay& rp,const char* requestLog){
+    std::ifstream log(requestLog);
+    if (!log) throw std::runtime_error(std::string("open requestLog error! ")+requestLog);
+    std::map<std::string,size_t> oldIndexs;
+    std::map<std::string,size_t> newIndexs;
+    std::string line;
+    while (std::getline(log,line)){
+        if ((!line.empty())&&(line[line.size()-1]=='\r')) line.resize(line.size()-1);
+        if (line.empty()) continue;
+        size_t sp=line.find('\t');
+        if (sp==std::string::npos) sp=line.find(' ');
+        if (sp==std::string::npos) throw std::runtime_error("requestLog line error! "+line);
+        const std::string oldFile=line.substr(0,sp);
+        const std::string newFile=line.substr(sp+1);
+        TRequest req;
+        if (oldIndexs.find(oldFile)==oldIndexs.end()){
+            TOldSign* old=new TOldSign();
+            rp.olds.push_back(old);
+            _openOldSign(old,0,oldFile.c_str());
+            oldIndexs[oldFile]=rp.olds.size()-1;
+        }
+        req.oldIndex=oldIndexs[oldFile];
+        if (newIndexs.find(newFile)==newIndexs.end()){
+            rp.news.push_back(TNewData());
+            rp.news.back().fileName=newFile;
+            newIndexs[newFile]=rp.news.size()-1;
+        }
+        req.newIndex=newIndexs[newFile];
+        rp.requests.push_back(req);
+    }
+    if (rp.requests.empty()) throw std::runtime_error(std::string("no request in requestLog! ")+requestLog);
+}
+
+static unsigned int _rand(unsigned int& seed){
+    seed=seed*214013+2531011;
+    return seed>>8;
+}
+static void _randData(std::vector<TByte>& data,size_t size,unsigned int& seed){
+    data.resize(size);
+    for (size_t i=0;i<size;++i)
+        data[i]=(TByte)_rand(seed);
+}
+static void _randEdit(std::vector<TByte>& data,size_t editCount,unsigned int& seed){
+    for (size_t i=0;i<editCount;++i){
+        size_t pos=_rand(seed)%(data.size()+1);
+        std::vector<TByte> v;
+        _randData(v,_rand(seed)%1024,seed);
+        switch (_rand(seed)%3){
+            case 0: { data.insert(data.begin()+pos,v.begin(),v.end()); } break;
+            case 1: { data.erase(data.begin()+pos,data.begin()+std::min(data.size(),pos+v.size())); } break;
+            default: { for (size_t j=0;(j<v.size())&&(pos+j<data.size());++j) data[pos+j]=v[j]; }
+        }
+    }
+}
+
+//old versions & new versions of a data; most requests come from recent old versions
+static void generateRequestLog(TReplay& rp){
+    const size_t kOldCount=6;
+    const size_t kNewCount=2;
+    const size_t kRequestCount=1000;
+    const size_t kDataSize=1024*512;
+    const uint32_t kSyncBlockSize=1024;
+    unsigned int seed=20261019;
+    std::vector<TByte> data;
+    _randData(data,kDataSize,seed);
+    for (size_t i=0;i<kOldCount;++i){
+        _randEdit(data,8,seed);
+        TOldSign* old=new TOldSign();
+        rp.olds.push_back(old);
+        old->oldData=data;
+        std::vector<TByte> hsyni;
+        TVectorAsStreamOutput hsyniStream(hsyni);
+        hpatch_TStreamInput oldStream;
+        mem_as_hStreamInput(&oldStream,data.data(),data.data()+data.size());
+        create_sync_data(&oldStream,&hsyniStream,signChecksumPlugin,0,kSyncBlockSize);
+        hpatch_TStreamInput hsyniInput;
+        mem_as_hStreamInput(&hsyniInput,hsyni.data(),hsyni.data()+hsyni.size());
+        _openOldSign(old,&hsyniInput,0);
+    }
+    for (size_t i=0;i<kNewCount;++i){
+        _randEdit(data,8,seed);
+        rp.news.push_back(TNewData());
+        rp.news.back().data=data;
+    }
+    for (size_t i=0;i<kRequestCount;++i){
+        TRequest req;
+        size_t r0=_rand(seed)%kOldCount;
+        size_t r1=_rand(seed)%kOldCount;
+        req.oldIndex=kOldCount-1-std::min(r0,r1);
+        req.newIndex=((_rand(seed)%8)==0)?0:kNewCount-1;
+        rp.requests.push_back(req);
+    }
+}
+
+//create_hdiff_by_sign by parallel clips must out the same diff as by 1 thread;
+//  new data with odd tail size, a short last clip can all skipped by the prev clip's matched block
+static size_t test_sign_diff_threads(){
+    const uint32_t kSyncBlockSize=1024;
+    const size_t kNewSizes[]={1024*1024*3+100,1024*1024*3+100,1024*1024*2+1023,1024*1024*4+1};
+    const size_t threadNums[]={1,2,3,8};
+    unsigned int seed=49;
+    size_t errorCount=0;
+    const int _is_out_diff_info_bck=_hdiff_is_out_diff_info;
+    _hdiff_is_out_diff_info=0;
+    for (size_t t=0;t<sizeof(kNewSizes)/sizeof(kNewSizes[0]);++t){
+        TOldSign old;
+        std::vector<TByte> newData;
+        _randData(newData,kNewSizes[t],seed);
+        if (t==0){ //old is new without head 100 bytes, last matched block end at newData's end
+            old.oldData.assign(newData.begin()+100,newData.end());
+        }else{
+            old.oldData=newData;
+            _randEdit(old.oldData,16,seed);
+        }
+        std::vector<TByte> hsyni;
+        TVectorAsStreamOutput hsyniStream(hsyni);
+        hpatch_TStreamInput oldStream;
+        mem_as_hStreamInput(&oldStream,old.oldData.data(),old.oldData.data()+old.oldData.size());
+        create_sync_data(&oldStream,&hsyniStream,signChecksumPlugin,0,kSyncBlockSize);
+        hpatch_TStreamInput hsyniInput;
+        mem_as_hStreamInput(&hsyniInput,hsyni.data(),hsyni.data()+hsyni.size());
+        _openOldSign(&old,&hsyniInput,0);
+        hpatch_TStreamInput newStream;
+        mem_as_hStreamInput(&newStream,newData.data(),newData.data()+newData.size());
+        std::vector<TByte> diff0;
+        for (size_t i=0;i<sizeof(threadNums)/sizeof(threadNums[0]);++i){
+            std::vector<TByte> diff;
+            TVectorAsStreamOutput diffStream(diff);
+            create_hdiff_by_sign(&newStream,&old.info,&diffStream,0,kDefaultPatchStepMemSize,threadNums[i]);
+            if (i==0){
+                diff0.swap(diff);
+                if (!check_single_compressed_diff(newData.data(),newData.data()+newData.size(),
+                                                  old.oldData.data(),old.oldData.data()+old.oldData.size(),
+                                                  diff0.data(),diff0.data()+diff0.size(),0))
+                    ++errorCount;
+            }else if (diff!=diff0){
+                printf("\n sign diff by threads error!!! newSize:%" PRIu64 " threadNum:%" PRIu64 "\n",
+                       (hpatch_StreamPos_t)newData.size(),(hpatch_StreamPos_t)threadNums[i]);
+                ++errorCount;
+            }
+        }
+        printf("sign diff newSize:%" PRIu64 " diffSize:%" PRIu64 " same by threadNum 1,2,3,8\n",
+               (hpatch_StreamPos_t)newData.size(),(hpatch_StreamPos_t)diff0.size());
+    }
+    _hdiff_is_out_diff_info=_is_out_diff_info_bck;
+    return errorCount;
+}
+
+#ifdef _CompressPlugin_zlib
+//same request by different compressSets must miss each other's cached diff; return error count
+//  (new data is random, so zlib-1 & zlib-9 diffs can be same size)
+static size_t test_compressSets(const TReplay& rp){
+    const TOldSign& old=*rp.olds.back();
+    const TNewData& newData=rp.news.back();
+    TCompressPlugin_zlib zlib1=zlibCompressPlugin;
+    TCompressPlugin_zlib zlib9=zlibCompressPlugin;
+    zlib1.compress_level=1;
+    zlib9.compress_level=9;
+    const TCompressPlugin_zlib* plugins[]={&zlib1,&zlib9,&zlib1,&zlib9};
+    const char* compressSets[]={"zlib-1","zlib-9","zlib-1","zlib-9"};
+    std::vector<TByte> diffs[4];
+    hpatch_TStreamInput newStream;
+    mem_as_hStreamInput(&newStream,newData.data.data(),newData.data.data()+newData.data.size());
+    const TByte key[]={1};
+    TSignDiffCache cache;
+    size_t errorCount=0;
+    for (size_t i=0;i<4;++i){
+        TVectorAsStreamOutput diffStream(diffs[i]);
+        bool isHit=cache.get_hdiff_by_sign(key,sizeof(key),&newStream,&old.info,&diffStream,&plugins[i]->base,
+                                           compressSets[i],kDefaultPatchStepMemSize,1);
+        if (isHit!=(i>=2)) ++errorCount;
+        if (!check_single_compressed_diff(newData.data.data(),newData.data.data()+newData.data.size(),
+                                          old.oldData.data(),old.oldData.data()+old.oldData.size(),
+                                          diffs[i].data(),diffs[i].data()+diffs[i].size(),&zlibDecompressPlugin))
+            ++errorCount;
+    }
+    if ((diffs[0]!=diffs[2])||(diffs[1]!=diffs[3])) ++errorCount;
+    TSignDiffCache::TStatistics st;
+    cache.getStatistics(&st);
+    if ((st.createCount!=2)||(st.hitCount!=2)) ++errorCount;
+    printf("compressSets zlib-1 & zlib-9: diff size %" PRIu64 " & %" PRIu64 "  create: %" PRIu64 "  hit: %" PRIu64 "\n",
+           (hpatch_StreamPos_t)diffs[0].size(),(hpatch_StreamPos_t)diffs[1].size(),st.createCount,st.hitCount);
+    if (errorCount)
+        printf("\n compressSets in cache key error!!!\n");
+    return errorCount;
+}
+#endif
+
+int main(int argc,const char* argv[]){
+    size_t clientThreadNum=8;
+    size_t repeatCount=1;
+    size_t cacheMaxSize=kDefaultSignDiffCacheSize;
+    const char* requestLog=0;
+    TReplay rp;
+    for (int i=1;i<argc;++i){
+        const char* op=argv[i];
+        bool isOk=true;
+        if ((op[0]=='-')&&(op[1]=='t'))
+            isOk=a_to_size(op+2,strlen(op+2),&clientThreadNum)&&(clientThreadNum>0);
+        else if ((op[0]=='-')&&(op[1]=='p'))
+            isOk=a_to_size(op+2,strlen(op+2),&rp.threadNum)&&(rp.threadNum>0);
+        else if ((op[0]=='-')&&(op[1]=='c'))
+            isOk=kmg_to_size(op+2,strlen(op+2),&cacheMaxSize);
+        else if ((op[0]=='-')&&(op[1]=='r'))
+            isOk=a_to_size(op+2,strlen(op+2),&repeatCount)&&(repeatCount>0);
+        else if ((op[0]!='-')&&(requestLog==0))
+            requestLog=op;
+        else
+            isOk=false;
+        if (!isOk){
+            printf("unknown or error option: %s\n",op);
+            return 1;
+        }
+    }
+    try{
+        if (requestLog)
+            loadRequestLog(rp,requestLog);
+        else
+            generateRequestLog(rp);
+        printf("replay %" PRIu64 " requests, %" PRIu64 " old signs, %" PRIu64 " new datas; clients: %" PRIu64 "\n",
+               (hpatch_StreamPos_t)rp.requests.size(),(hpatch_StreamPos_t)rp.olds.size(),
+               (hpatch_StreamPos_t)rp.news.size(),(hpatch_StreamPos_t)clientThreadNum);
+        TSignDiffCache cache(cacheMaxSize);
+        rp.cache=&cache;
+        replay(rp,clientThreadNum,repeatCount);
+        rp.cache=0;
+        if (requestLog==0)
+            rp.errorCount+=test_sign_diff_threads();
+#ifdef _CompressPlugin_zlib
+        if (requestLog==0)
+            rp.errorCount+=test_compressSets(rp);
+#endif
+    }catch(const std::exception& e){
+        printf("error: %s\n",e.what());
+        return 1;
+    }
+    return (rp.errorCount==0)?0:1;
+}
@@ -30,6 +30,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
@@ -41,8 +42,27 @@
 #include "../libHDiffPatch/HPatch/patch.h"
 #include "../libHDiffPatch/HPatchLite/hpatch_lite.h"
 #include "../libHDiffPatch/HDiff/private_diff/limit_mem_diff/stream_serialize.h"
+#include "../libHDiffPatch/HDiff/private_diff/compress_detect.h"
 #include "../libhsync/sync_make/sync_make.h"
 #include "../libhsync/sync_client/sync_client.h"
+#include "../_clock_for_demo.h"
+#include "../dirDiffPatch/dir_patch/res_handle_limit.h"
+#include "../dirDiffPatch/dir_diff/dir_diff.h"
+#include "../dirDiffPatch/dir_patch/new_dir_output.h"
+#include "../file_for_patch.h"
+#include "../hpatch_dir_listener.h"
+#include "../_dir_ignore.h"
+#if (_IS_USED_MULTITHREAD)
+#include "../libParallel/parallel_channel.h"
+#endif
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#   include <utime.h>
+#endif
 using namespace hdiff_private;
 typedef unsigned char   TByte;
 typedef ptrdiff_t       TInt;
@@ -236,6 +256,94 @@ static bool check_diff_stream(const TByte* newData,const TByte* newData_end,
 
 static hpatch_TChecksum* hsynzDefaultChecksum=&fadler32ChecksumPlugin;
 
+//a dict "compress" plugin for test: code is tag+(data xor the data kTestDictSize bytes before it);
+//  not compress, but decompress need the right dict data; cancel compress if block's first byte is 0;
+static const char*  kTestDictCompressType="tdict";
+static const size_t kTestDictSize=1024;
+static const TByte  kTestDictTag=0xA5;
+struct TTestDictHandle{
+    size_t              blockSize;
+    std::vector<TByte>  dict;    //data before current block, size<=kTestDictSize
+    size_t              nextBlockIndex;
+    inline explicit TTestDictHandle(size_t _blockSize):blockSize(_blockSize),nextBlockIndex(0){}
+    inline TByte dictByte(const TByte* data,size_t i)const{ //data[i-kTestDictSize]
+        if (i>=kTestDictSize) return data[i-kTestDictSize];
+        const size_t back=kTestDictSize-i;
+        return (back<=dict.size())?dict[dict.size()-back]:0;
+    }
+    inline void appendDict(size_t blockIndex,const TByte* data,size_t dataSize){
+        if (blockIndex!=nextBlockIndex) dict.clear();
+        nextBlockIndex=blockIndex+1;
+        dict.insert(dict.end(),data,data+dataSize);
+        if (dict.size()>kTestDictSize)
+            dict.erase(dict.begin(),dict.end()-kTestDictSize);
+    }
+};
+static const char* _testDict_compressType(void){ return kTestDictCompressType; }
+static hpatch_StreamPos_t _testDict_maxCompressedSize(hpatch_StreamPos_t in_dataSize){ return in_dataSize+1; }
+static size_t _testDict_limitDictSizeByData(hsync_TDictCompress* compressPlugin,size_t blockCount,size_t blockSize){
+    return kTestDictSize; }
+static size_t _testDict_getBestWorkBlockCount(hsync_TDictCompress* compressPlugin,size_t blockCount,
+                                              size_t blockSize,size_t defaultWorkBlockCount){
+    return defaultWorkBlockCount; }
+static size_t _testDict_getDictSize(hsync_TDictCompress* compressPlugin){ return kTestDictSize; }
+static hsync_dictCompressHandle _testDict_compressOpen(hsync_TDictCompress* compressPlugin,size_t blockCount,size_t blockSize){
+    return new TTestDictHandle(blockSize); }
+static void _testDict_compressClose(hsync_TDictCompress* compressPlugin,hsync_dictCompressHandle dictHandle){
+    delete (TTestDictHandle*)dictHandle; }
+static hpatch_byte* _testDict_getResetDictBuffer(hsync_dictCompressHandle dictHandle,size_t blockIndex,size_t* out_dictSize){
+    TTestDictHandle* self=(TTestDictHandle*)dictHandle;
+    const hpatch_StreamPos_t prefixSize=(hpatch_StreamPos_t)blockIndex*self->blockSize;
+    self->dict.resize((prefixSize<kTestDictSize)?(size_t)prefixSize:kTestDictSize);
+    self->nextBlockIndex=blockIndex;
+    *out_dictSize=self->dict.size();
+    return self->dict.data();
+}
+static size_t _testDict_compress(hsync_dictCompressHandle dictHandle,size_t blockIndex,
+                                 hpatch_byte* out_code,hpatch_byte* out_codeEnd,
+                                 const hpatch_byte* in_dataBegin,size_t in_dataSize,size_t in_borderSize){
+    TTestDictHandle* self=(TTestDictHandle*)dictHandle;
+    if ((size_t)(out_codeEnd-out_code)<in_dataSize+1) return kDictCompressError;
+    const bool isCancel=(in_dataSize>0)&&(in_dataBegin[0]==0);
+    out_code[0]=kTestDictTag;
+    for (size_t i=0;i<in_dataSize;++i)
+        out_code[1+i]=in_dataBegin[i]^self->dictByte(in_dataBegin,i);
+    self->appendDict(blockIndex,in_dataBegin,in_dataSize);
+    return isCancel?kDictCompressCancel:in_dataSize+1;
+}
+static hsync_TDictCompress testDictCompressPlugin={_testDict_compressType,_testDict_maxCompressedSize,
+        _testDict_limitDictSizeByData,_testDict_getBestWorkBlockCount,_testDict_getDictSize,
+        _testDict_compressOpen,_testDict_compressClose,0,_testDict_getResetDictBuffer,_testDict_compress,0,0};
+
+static hpatch_BOOL _testDict_is_can_open(const char* compressType){
+    return (0==strcmp(compressType,kTestDictCompressType)); }
+static hsync_dictDecompressHandle _testDict_decompressOpen(hsync_TDictDecompress* decompressPlugin,size_t blockCount,size_t blockSize,
+                                                           const hpatch_byte* in_info,const hpatch_byte* in_infoEnd){
+    return new TTestDictHandle(blockSize); }
+static void _testDict_decompressClose(hsync_TDictDecompress* decompressPlugin,hsync_dictDecompressHandle dictHandle){
+    delete (TTestDictHandle*)dictHandle; }
+static hpatch_BOOL _testDict_decompress(hsync_dictDecompressHandle dictHandle,size_t blockIndex,
+                                        const hpatch_byte* in_code,const hpatch_byte* in_codeEnd,
+                                        hpatch_byte* out_dataBegin,hpatch_byte* out_dataEnd,hpatch_byte skipBitsInFirstCodeByte){
+    TTestDictHandle* self=(TTestDictHandle*)dictHandle;
+    const size_t dataSize=out_dataEnd-out_dataBegin;
+    if ((size_t)(in_codeEnd-in_code)!=dataSize+1) return hpatch_FALSE;
+    if ((in_code[0]!=kTestDictTag)||(skipBitsInFirstCodeByte!=0)) return hpatch_FALSE;
+    if (blockIndex!=self->nextBlockIndex) self->dict.clear();
+    const hpatch_StreamPos_t prefixSize=(hpatch_StreamPos_t)blockIndex*self->blockSize;
+    if (self->dict.size()<((prefixSize<kTestDictSize)?(size_t)prefixSize:kTestDictSize))
+        return hpatch_FALSE; //not have dict data
+    for (size_t i=0;i<dataSize;++i)
+        out_dataBegin[i]=in_code[1+i]^self->dictByte(out_dataBegin,i);
+    return hpatch_TRUE;
+}
+static void _testDict_uncompress(hsync_dictDecompressHandle dictHandle,size_t blockIndex,size_t lastCompressedBlockIndex,
+                                 const hpatch_byte* dataBegin,const hpatch_byte* dataEnd){
+    ((TTestDictHandle*)dictHandle)->appendDict(blockIndex,dataBegin,dataEnd-dataBegin);
+}
+static hsync_TDictDecompress testDictDecompressPlugin={_testDict_is_can_open,_testDict_maxCompressedSize,
+        _testDict_decompressOpen,_testDict_decompressClose,_testDict_decompress,_testDict_uncompress,0};
+
 struct TSyncInfoListener:public ISyncInfoListener{
     inline TSyncInfoListener(){
         infoImport=this;
@@ -248,6 +356,8 @@ struct TSyncInfoListener:public ISyncInfoListener{
         return hsynzDefaultChecksum;
     }
     static hsync_TDictDecompress* _findDecompressPlugin(ISyncInfoListener* listener,const char* compressType,size_t dictSize){
+        if (testDictDecompressPlugin.is_can_open(compressType))
+            return &testDictDecompressPlugin;
 #if defined(_CompressPlugin_ldef)
         static TDictDecompressPlugin_ldef _ldefDictDecompressPlugin=ldefDictDecompressPlugin;
         _ldefDictDecompressPlugin.dict_bits=(hpatch_byte)_dictSizeToDictBits(dictSize);
@@ -274,6 +384,9 @@ struct TReadSyncDataListener:public IReadSyncDataListener{
         readSyncDataBegin=0;
         readSyncData=_readSyncData;
         readSyncDataEnd=0;
+        readSyncDataRanges=0;
+        memset(&rangesPlan,0,sizeof(rangesPlan));
+        maxRequestsInFlight=0;
     }
     static hpatch_BOOL _readSyncData(struct IReadSyncDataListener* listener,uint32_t blockIndex,
                                      hpatch_StreamPos_t posInNewSyncData,uint32_t isReLoadNewHalf,
@@ -288,14 +401,120 @@ struct TReadSyncDataListener:public IReadSyncDataListener{
     }
 };
 
+static void _sleep_ms(int ms){
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms*1000);
+#endif
+}
+
+//mock range server: download data by multi-range requests, and count requests & downloaded bytes;
+//  isReorder: when requests in flight, an even request wait the next request complete first (out of order completions);
+//  latencyMs>0 for inject latency (only for bench), requests have different latency.
+struct TReadSyncDataRangesListener:public TReadSyncDataListener{
+    hpatch_StreamPos_t  requestCount;
+    hpatch_StreamPos_t  rangeCount;
+    hpatch_StreamPos_t  downloadSize;
+    hpatch_StreamPos_t  needSyncSumSize;
+    uint32_t            needSyncBlockCount;
+    size_t              maxRequestRangeCount;
+    hpatch_StreamPos_t  overMaxRequestSizeCount; //request size > maxRequestSize & ranges>1
+    hpatch_StreamPos_t  outOfOrderCount; //completed after a later request
+    bool                isReorder;
+    int                 latencyMs;
+    std::vector<bool>   _completed;
+    hpatch_StreamPos_t  _maxCompletedIndex;
+#if (_IS_USED_MULTITHREAD)
+    CHLocker            _locker;
+#endif
+    inline explicit TReadSyncDataRangesListener(const std::vector<TByte>& hsynzData,const TSyncRangesPlan* plan=0,
+                                                size_t _maxRequestsInFlight=1,bool _isReorder=false,int _latencyMs=0)
+    :TReadSyncDataListener(hsynzData),requestCount(0),rangeCount(0),downloadSize(0),needSyncSumSize(0),
+    needSyncBlockCount(0),maxRequestRangeCount(0),overMaxRequestSizeCount(0),outOfOrderCount(0),
+    isReorder(_isReorder&&(_maxRequestsInFlight>1)),latencyMs(_latencyMs),_maxCompletedIndex(0){
+        onNeedSyncInfo=_onNeedSyncInfo;
+        readSyncData=0;
+        readSyncDataRanges=_readSyncDataRanges;
+        if (plan) rangesPlan=*plan;
+        maxRequestsInFlight=_maxRequestsInFlight;
+    }
+    static void _onNeedSyncInfo(struct IReadSyncDataListener* listener,const TNeedSyncInfos* needSyncInfo){
+        TReadSyncDataRangesListener* self=(TReadSyncDataRangesListener*)listener->readSyncDataImport;
+        self->needSyncSumSize=needSyncInfo->needSyncSumSize;
+        self->needSyncBlockCount=needSyncInfo->needSyncBlockCount;
+    }
+    static hpatch_BOOL _readSyncDataRanges(struct IReadSyncDataListener* listener,const hpatch_StreamPos_t* ranges,
+                                           size_t rangeCount,unsigned char* out_syncDataBuf,size_t syncDataSize){
+        TReadSyncDataRangesListener* self=(TReadSyncDataRangesListener*)listener->readSyncDataImport;
+        const std::vector<TByte>& src=self->_hzData;
+        const TSyncRangesPlan plan=self->getPlan();
+        if ((rangeCount==0)||(rangeCount>plan.maxRangeCount)) return hpatch_FALSE;
+        const unsigned char* out_syncDataBuf_end=out_syncDataBuf+syncDataSize;
+        for (size_t i=0;i<rangeCount;++i){
+            const hpatch_StreamPos_t first=ranges[i*2];
+            const hpatch_StreamPos_t last=ranges[i*2+1];
+            if ((first>last)||(last>=src.size())) return hpatch_FALSE;
+            if ((i>0)&&(first<=ranges[i*2-1])) return hpatch_FALSE;
+            const size_t len=(size_t)(last-first+1);
+            if (len>(size_t)(out_syncDataBuf_end-out_syncDataBuf)) return hpatch_FALSE;
+            memcpy(out_syncDataBuf,src.data()+(size_t)first,len);
+            out_syncDataBuf+=len;
+        }
+        if (out_syncDataBuf!=out_syncDataBuf_end) return hpatch_FALSE;
+        hpatch_StreamPos_t requestIndex;
+        {
+        #if (_IS_USED_MULTITHREAD)
+            CAutoLocker _autoLocker(self->_locker.locker);
+        #endif
+            requestIndex=self->requestCount++;
+            self->_completed.push_back(false);
+            self->rangeCount+=rangeCount;
+            self->downloadSize+=syncDataSize;
+            if (rangeCount>self->maxRequestRangeCount) self->maxRequestRangeCount=rangeCount;
+            if ((syncDataSize>plan.maxRequestSize)&&(rangeCount>1)) ++self->overMaxRequestSizeCount;
+        }
+        if (self->latencyMs>0)
+            _sleep_ms(self->latencyMs/2+(int)((requestIndex*7)%(self->latencyMs+1)));
+    #if (_IS_USED_MULTITHREAD)
+        if (self->isReorder&&(requestIndex%2==0))
+            self->_waitCompleted(requestIndex+1);
+        {
+            CAutoLocker _autoLocker(self->_locker.locker);
+            self->_completed[(size_t)requestIndex]=true;
+            if (requestIndex<self->_maxCompletedIndex) ++self->outOfOrderCount;
+            else self->_maxCompletedIndex=requestIndex;
+        }
+    #endif
+        return hpatch_TRUE;
+    }
+    inline TSyncRangesPlan getPlan()const{
+        TSyncRangesPlan plan=rangesPlan;
+        if (plan.rangeOverheadSize==0) plan.rangeOverheadSize=kSyncRangesPlan_rangeOverheadSize_default;
+        if (plan.maxRequestSize==0) plan.maxRequestSize=kSyncRangesPlan_maxRequestSize_default;
+        if (plan.maxRangeCount==0) plan.maxRangeCount=kSyncRangesPlan_maxRangeCount_default;
+        return plan;
+    }
+#if (_IS_USED_MULTITHREAD)
+    void _waitCompleted(hpatch_StreamPos_t requestIndex){
+        const double kMaxWaitTime=0.02; //the last request have no next
+        double time0=clock_s();
+        while (clock_s()-time0<kMaxWaitTime){
+            {
+                CAutoLocker _autoLocker(_locker.locker);
+                if ((requestIndex<_completed.size())&&_completed[(size_t)requestIndex]) return;
+            }
+            this_thread_yield();
+        }
+    }
+#endif
+};
+
 static std::vector<TByte> _hsyniData;
 static std::vector<TByte> _hsynzData;
 static std::vector<TByte> _new_hsyniData;
 static std::vector<TByte> _new_hsynzData;
-static void _create_hsynz_diff(const TByte* newData,const TByte* newData_end,
-                               const TByte* oldData,const TByte* oldData_end,
-                               std::vector<TByte>& out_diff){
-    TSyncClient_resultType ret=kSyncClient_ok;
+static void _create_hsynz_data(const TByte* newData,const TByte* newData_end){
     struct hpatch_TStreamInput  newStream;
     mem_as_hStreamInput(&newStream,newData,newData_end);
     _hsyniData.clear();
@@ -306,8 +525,11 @@ static void _create_hsynz_diff(const TByte* newData,const TByte* newData_end,
     TVectorAsStreamOutput hzStream(_hsynzData);
     create_sync_data(&newStream,&hiStream,&hzStream,
                      hsynzDefaultChecksum,_getDictCompressPlugin(),0,kSyncBlockSize_min);
+}
 
-    //local diff
+static void _hsynz_local_diff(const TByte* oldData,const TByte* oldData_end,
+                              std::vector<TByte>& out_diff,int threadNum=1){
+    TSyncClient_resultType ret=kSyncClient_ok;
     struct hpatch_TStreamInput  oldStream;
     mem_as_hStreamInput(&oldStream,oldData,oldData_end);
     out_diff.clear();
@@ -315,15 +537,23 @@ static void _create_hsynz_diff(const TByte* newData,const TByte* newData_end,
     TSyncInfoListener syncInfoListener;
     TReadSyncDataListener readSyncDataListener(_hsynzData);
     TNewDataSyncInfo newSyncInfo={0};
-    hiStream.streamSize=hiStream.dst.size();
-    ret=TNewDataSyncInfo_open(&newSyncInfo,(const hpatch_TStreamInput*)&hiStream,hpatch_FALSE,&syncInfoListener);
+    struct hpatch_TStreamInput  hiStream;
+    mem_as_hStreamInput(&hiStream,_hsyniData.data(),_hsyniData.data()+_hsyniData.size());
+    ret=TNewDataSyncInfo_open(&newSyncInfo,&hiStream,hpatch_FALSE,&syncInfoListener);
     if (ret!=0) throw std::runtime_error("TNewDataSyncInfo_open() error!");
     ret=sync_local_diff(&syncInfoListener,&readSyncDataListener,&oldStream,
-                        &newSyncInfo,&diffStream,kSyncDiff_default,0,1);
+                        &newSyncInfo,&diffStream,kSyncDiff_default,0,threadNum);
     TNewDataSyncInfo_close(&newSyncInfo);
     if (ret!=0) throw std::runtime_error("sync_local_diff() error!");
 }
 
+static void _create_hsynz_diff(const TByte* newData,const TByte* newData_end,
+                               const TByte* oldData,const TByte* oldData_end,
+                               std::vector<TByte>& out_diff){
+    _create_hsynz_data(newData,newData_end);
+    _hsynz_local_diff(oldData,oldData_end,out_diff);
+}
+
 static hpatch_BOOL _hsynz_local_patch(unsigned char* out_newData,unsigned char* out_newData_end,
                                       const unsigned char* oldData,const unsigned char* oldData_end,
                                       const unsigned char* diff,const unsigned char* diff_end){
@@ -360,7 +590,8 @@ static hpatch_BOOL _hsynz_local_patch(unsigned char* out_newData,unsigned char*
 }
 
 static hpatch_BOOL _hsynz_sync_patch(unsigned char* out_newData,unsigned char* out_newData_end,
-                                     const unsigned char* oldData,const unsigned char* oldData_end){
+                                     const unsigned char* oldData,const unsigned char* oldData_end,
+                                     TReadSyncDataListener* rangesListener=0,int threadNum=1){
     TSyncClient_resultType ret=kSyncClient_ok;
     struct hpatch_TStreamOutput out_newStream;
     struct hpatch_TStreamInput  oldStream;
@@ -381,7 +612,8 @@ static hpatch_BOOL _hsynz_sync_patch(unsigned char* out_newData,unsigned char* o
         throw std::runtime_error("TNewDataSyncInfo_open() error!");
 #endif
     }
-    ret=sync_patch(&syncInfoListener,&readSyncDataListener,&oldStream,&newSyncInfo,&out_newStream,0,0,0,1);
+    ret=sync_patch(&syncInfoListener,rangesListener?rangesListener:&readSyncDataListener,
+                   &oldStream,&newSyncInfo,&out_newStream,0,0,0,threadNum);
     TNewDataSyncInfo_close(&newSyncInfo);
     if (ret!=0){
 #ifdef _AttackPacth_ON
@@ -411,11 +643,12 @@ bool _check_hsynz_local_patch(const TByte* newData,const TByte* newData_end,
 }
 
 bool _check_hsynz_sync_patch(const TByte* newData,const TByte* newData_end,
-                             const TByte* oldData,const TByte* oldData_end){
+                             const TByte* oldData,const TByte* oldData_end,
+                             TReadSyncDataListener* rangesListener=0,int threadNum=1){
     _newTempData.resize(newData_end-newData);
     memset(_newTempData.data(),0,_newTempData.size());
     if (!_hsynz_sync_patch(_newTempData.data(),_newTempData.data()+_newTempData.size(),
-                           oldData,oldData_end))  return false;
+                           oldData,oldData_end,rangesListener,threadNum))  return false;
     if (0!=memcmp(_newTempData.data(),newData,_newTempData.size()))
 #ifdef _AttackPacth_ON
         return false;
@@ -746,11 +979,14 @@ long test(const TByte* newData,const TByte* newData_end,
         }
     }
     {//test hsynz
+        const TSyncRangesPlan rangesPlan={256,1024*4,3}; //small plan for test requests split
+        TReadSyncDataRangesListener _rangesListener(_hsynzData,&rangesPlan,3);
         std::vector<TByte> diffData;
         _create_hsynz_diff(newData,newData_end,oldData,oldData_end,diffData);
         if (out_diffSizes) out_diffSizes[kHSynz]+=diffData.size();
         if ((!_check_hsynz_local_patch(newData,newData_end,oldData,oldData_end,diffData.data(),diffData.data()+diffData.size()))
-            ||(!_check_hsynz_sync_patch(newData,newData_end,oldData,oldData_end))){
+            ||(!_check_hsynz_sync_patch(newData,newData_end,oldData,oldData_end))
+            ||(!_check_hsynz_sync_patch(newData,newData_end,oldData,oldData_end,&_rangesListener))){
             printf("\n hsynz error!!! tag:%s\n",tag);
             ++result;
         }else{
@@ -787,6 +1023,1227 @@ void setRandData(std::vector<TByte>& data){
 }
 
 
+//scattered little edits: change 1..64 bytes every 1K..1K+maxStep bytes
+static void setScatteredEdits(std::vector<TByte>& data,size_t maxStep){
+    for (size_t i=0;i<data.size();i+=(size_t)(_rand()%maxStep)+1024){
+        const size_t len=(size_t)(_rand()%64)+1;
+        for (size_t j=i;(j<i+len)&&(j<data.size());++j)
+            data[j]=(TByte)_rand();
+    }
+}
+
+//sync_patch() download by readSyncDataRanges(), check requests & download overhead planned by different plans
+static long test_hsynz_sync_ranges(){
+    const size_t kDataSize=1024*1024*4;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(2);
+    setRandData(oldData);
+    newData=oldData;
+    setScatteredEdits(newData,1024*32);
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const TSyncRangesPlan plans[]={{1,0,1},{1,0,0},{0,0,0},{1024*4,1024*1024*16,256}};
+    const size_t kPlanCount=sizeof(plans)/sizeof(plans[0]);
+    hpatch_StreamPos_t requestCounts[kPlanCount];
+    hpatch_StreamPos_t rangeCounts[kPlanCount];
+    hpatch_StreamPos_t downloadSizes[kPlanCount];
+    for (size_t i=0;i<kPlanCount;++i){
+        TReadSyncDataRangesListener rangesListener(_hsynzData,&plans[i]);
+        const TSyncRangesPlan plan=rangesListener.getPlan();
+        bool isOk=_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                          oldData.data(),oldData.data()+oldData.size(),&rangesListener);
+        //every request follow the plan; only merged gaps & reloaded half bytes are downloaded more than need
+        isOk=isOk&&(rangesListener.needSyncBlockCount>0)
+            &&(rangesListener.maxRequestRangeCount<=plan.maxRangeCount)
+            &&(rangesListener.overMaxRequestSizeCount==0)
+            &&(rangesListener.downloadSize>=rangesListener.needSyncSumSize)
+            &&(rangesListener.downloadSize-rangesListener.needSyncSumSize
+                <=(hpatch_StreamPos_t)rangesListener.needSyncBlockCount*(plan.rangeOverheadSize+1));
+        requestCounts[i]=rangesListener.requestCount;
+        rangeCounts[i]=rangesListener.rangeCount;
+        downloadSizes[i]=rangesListener.downloadSize;
+        if (!isOk){
+            printf("\n hsynz ranges error!!! plan:%d\n",(int)i);
+            ++result;
+        }
+    }
+    if (result) return result;
+    //one range per request; more ranges per request -> less requests; bigger overhead -> merge more ranges
+    if ((requestCounts[0]!=rangeCounts[0])||(rangeCounts[1]!=rangeCounts[0])
+        ||(requestCounts[1]*kSyncRangesPlan_maxRangeCount_default<rangeCounts[1])
+        ||(requestCounts[1]>=requestCounts[0])
+        ||(rangeCounts[2]>rangeCounts[1])||(downloadSizes[2]<downloadSizes[1])
+        ||(rangeCounts[3]>=rangeCounts[2])||(downloadSizes[3]<=downloadSizes[2])
+        ||(requestCounts[3]>requestCounts[2])){
+        printf("\n hsynz ranges plan error!!!\n");
+        ++result;
+    }
+    return result;
+}
+
+//sync_patch() download by readSyncDataRanges() with requests in flight, requests complete out of order
+static long test_hsynz_sync_ranges_mt(){
+    const size_t kDataSize=1024*1024*4;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(3);
+    setRandData(oldData);
+    newData=oldData;
+    setScatteredEdits(newData,1024*32);
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    const TSyncRangesPlan plan={0,1024*16,8}; //many little requests
+    const size_t inFlights[]={1,2,4,16};
+    hpatch_StreamPos_t requestCount0=0;
+    for (size_t i=0;i<sizeof(inFlights)/sizeof(inFlights[0]);++i){
+        TReadSyncDataRangesListener rangesListener(_hsynzData,&plan,inFlights[i],true);
+        bool isOk=_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                          oldData.data(),oldData.data()+oldData.size(),&rangesListener);
+        if (i==0) requestCount0=rangesListener.requestCount;
+        //planed as one by one (except reload half bytes), & the reorder buffer consumed out of order completions
+        isOk=isOk&&(rangesListener.requestCount>16)
+            &&(rangesListener.requestCount<=requestCount0+requestCount0/8)
+            &&(rangesListener.overMaxRequestSizeCount==0);
+    #if (_IS_USED_MULTITHREAD)
+        isOk=isOk&&((inFlights[i]==1)==(rangesListener.outOfOrderCount==0));
+    #endif
+        if (!isOk){
+            printf("\n hsynz ranges in flight error!!! inFlight:%d\n",(int)inFlights[i]);
+            ++result;
+        }
+    }
+    return result;
+}
+
+//count matched blocks of every seed
+struct TSeedsSyncInfoListener:public TSyncInfoListener{
+    const TSyncSeeds*           seeds;
+    std::vector<uint32_t>       seedBlockCounts;
+    uint32_t                    needSyncBlockCount;
+    inline explicit TSeedsSyncInfoListener(const TSyncSeeds* _seeds):seeds(_seeds),needSyncBlockCount(0){
+        onNeedSyncInfo=_onNeedSyncInfo;
+    }
+    static void _onNeedSyncInfo(ISyncInfoListener* listener,const TNeedSyncInfos* needSyncInfo){
+        TSeedsSyncInfoListener* self=(TSeedsSyncInfoListener*)listener->infoImport;
+        self->seedBlockCounts.assign(self->seeds->seedCount,0);
+        self->needSyncBlockCount=needSyncInfo->needSyncBlockCount;
+        for (uint32_t i=0;i<needSyncInfo->blockCount;++i){
+            size_t seedIndex=TSyncSeeds_seedIndex(self->seeds,TNeedSyncInfos_getBlockOldPos(needSyncInfo,i));
+            if (seedIndex<self->seeds->seedCount)
+                ++self->seedBlockCounts[seedIndex];
+        }
+    }
+};
+
+//sync_patch() with several old seeds, new data copy from all seeds
+static long test_hsynz_sync_seeds(){
+    const size_t kSeedSize=1024*1024*4;
+    const size_t kCopyLen=1024*16;
+    const size_t kSeedCount=3;
+    std::vector<TByte> seedDatas[kSeedCount];
+    std::vector<TByte> newData(kSeedSize*2);
+    _srand(4);
+    for (size_t s=0;s<kSeedCount;++s){
+        seedDatas[s].resize(kSeedSize-s*1000); //not aligned seeds
+        setRandData(seedDatas[s]);
+    }
+    setRandData(newData);
+    for (size_t i=0;i+kCopyLen<=newData.size();i+=kCopyLen+(size_t)(_rand()%1024)){
+        const std::vector<TByte>& seed=seedDatas[(size_t)_rand()%kSeedCount];
+        size_t pos=(size_t)(_rand()*(1.0/RAND_MAX)*(seed.size()-kCopyLen));
+        memcpy(newData.data()+i,seed.data()+pos,kCopyLen);
+    }
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+
+    long result=0;
+    hpatch_TStreamInput seedStreams[kSeedCount];
+    const hpatch_TStreamInput* seedList[kSeedCount];
+    for (size_t s=0;s<kSeedCount;++s){
+        mem_as_hStreamInput(&seedStreams[s],seedDatas[s].data(),seedDatas[s].data()+seedDatas[s].size());
+        seedList[s]=&seedStreams[s];
+    }
+    uint32_t lastNeedSyncBlockCount=~(uint32_t)0;
+    for (size_t seedCount=1;seedCount<=kSeedCount;++seedCount){
+        TSyncSeeds seeds;
+        TSyncSeeds_init(&seeds);
+        if (!TSyncSeeds_open(&seeds,seedList,seedCount)){
+            printf("\n TSyncSeeds_open() error!!!\n");
+            return result+1;
+        }
+        struct hpatch_TStreamInput  hiStream;
+        struct hpatch_TStreamOutput out_newStream;
+        mem_as_hStreamInput(&hiStream,_hsyniData.data(),_hsyniData.data()+_hsyniData.size());
+        _newTempData.assign(newData.size(),0);
+        mem_as_hStreamOutput(&out_newStream,_newTempData.data(),_newTempData.data()+_newTempData.size());
+        TSeedsSyncInfoListener syncInfoListener(&seeds);
+        TReadSyncDataListener readSyncDataListener(_hsynzData);
+        TNewDataSyncInfo newSyncInfo={0};
+        TSyncClient_resultType ret=TNewDataSyncInfo_open(&newSyncInfo,&hiStream,hpatch_FALSE,&syncInfoListener);
+        if (ret==kSyncClient_ok)
+            ret=sync_patch(&syncInfoListener,&readSyncDataListener,seeds.stream,&newSyncInfo,&out_newStream,0,0,0,4);
+        TNewDataSyncInfo_close(&newSyncInfo);
+        TSyncSeeds_close(&seeds);
+        //every seed matched blocks, & more seeds less download
+        bool isOk=(ret==kSyncClient_ok)&&(_newTempData==newData)
+                  &&(syncInfoListener.needSyncBlockCount<lastNeedSyncBlockCount);
+        for (size_t s=0;isOk&&(s<seedCount);++s)
+            isOk=(syncInfoListener.seedBlockCounts[s]>0);
+        lastNeedSyncBlockCount=syncInfoListener.needSyncBlockCount;
+        if (!isOk){
+            printf("\n hsynz seeds error!!! seedCount:%d\n",(int)seedCount);
+            ++result;
+        }
+    }
+    return result;
+}
+
+static void _create_hsynz_by_prev(const std::vector<TByte>& newData,std::vector<TByte>& out_hsyni,
+                                  std::vector<TByte>& out_hsynz,uint32_t kSyncBlockSize,size_t threadNum,
+                                  const std::vector<TByte>* prev_hsyni=0,const std::vector<TByte>* prev_hsynz=0,
+                                  uint32_t* out_reuseCount=0){
+    struct hpatch_TStreamInput  newStream;
+    mem_as_hStreamInput(&newStream,newData.data(),newData.data()+newData.size());
+    out_hsyni.clear();
+    out_hsynz.clear();
+    TVectorAsStreamOutput hiStream(out_hsyni);
+    TVectorAsStreamOutput hzStream(out_hsynz);
+    if (prev_hsyni==0){
+        create_sync_data(&newStream,&hiStream,&hzStream,hsynzDefaultChecksum,&testDictCompressPlugin,
+                         0,kSyncBlockSize,kSafeHashClashBit_default,threadNum);
+        return;
+    }
+    TSyncInfoListener syncInfoListener;
+    TNewDataSyncInfo prevSyncInfo={0};
+    struct hpatch_TStreamInput  prevHiStream;
+    struct hpatch_TStreamInput  prevHzStream;
+    mem_as_hStreamInput(&prevHiStream,prev_hsyni->data(),prev_hsyni->data()+prev_hsyni->size());
+    mem_as_hStreamInput(&prevHzStream,prev_hsynz->data(),prev_hsynz->data()+prev_hsynz->size());
+    if (TNewDataSyncInfo_open(&prevSyncInfo,&prevHiStream,hpatch_FALSE,&syncInfoListener)!=kSyncClient_ok)
+        throw std::runtime_error("TNewDataSyncInfo_open() error!");
+    uint32_t reuseCount=create_sync_data_by_prev(&newStream,&hiStream,&hzStream,hsynzDefaultChecksum,&testDictCompressPlugin,
+                                                 &prevSyncInfo,&prevHzStream,0,kSyncBlockSize,kSafeHashClashBit_default,threadNum);
+    TNewDataSyncInfo_close(&prevSyncInfo);
+    if (out_reuseCount) *out_reuseCount=reuseCount;
+}
+
+//create hsyni&hsynz by reuse compressed data of unchanged blocks in prev release
+static long test_hsynz_create_by_prev(){
+    const size_t kDataSize=1024*1024*4;
+    const uint32_t kSyncBlockSize=kSyncBlockSize_min;
+    std::vector<TByte> prevData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(5);
+    setRandData(prevData);
+    for (size_t i=0;i<kDataSize;i+=(size_t)(_rand()%(1024*4))+1)
+        prevData[i]=0; //some blocks cancel compress
+    newData=prevData;
+    setScatteredEdits(newData,1024*256);
+    newData.resize(kDataSize+1000+(size_t)(_rand()%1000)); //append data
+    for (size_t i=kDataSize;i<newData.size();++i)
+        newData[i]=(TByte)_rand();
+    size_t unchangedBlockCount=0; //block & the block before it not changed
+    for (size_t i=kSyncBlockSize;i+kSyncBlockSize<=kDataSize;i+=kSyncBlockSize){
+        if (0==memcmp(prevData.data()+i-kSyncBlockSize,newData.data()+i-kSyncBlockSize,kSyncBlockSize*2))
+            ++unchangedBlockCount;
+    }
+
+    long result=0;
+    std::vector<TByte> prev_hsyni,prev_hsynz;
+    std::vector<TByte> full_hsyni,full_hsynz;
+    _create_hsynz_by_prev(prevData,prev_hsyni,prev_hsynz,kSyncBlockSize,1);
+    _create_hsynz_by_prev(newData,full_hsyni,full_hsynz,kSyncBlockSize,1);
+    const size_t threadNums[]={1,4};
+    uint32_t reuseCount0=0;
+    for (size_t t=0;t<sizeof(threadNums)/sizeof(threadNums[0]);++t){
+        uint32_t reuseCount=0;
+        _create_hsynz_by_prev(newData,_hsyniData,_hsynzData,kSyncBlockSize,threadNums[t],
+                              &prev_hsyni,&prev_hsynz,&reuseCount);
+        _new_hsyniData.clear();
+        _new_hsynzData.clear();
+        if (t==0) reuseCount0=reuseCount;
+        //same output as full create; most unchanged blocks reused
+        if ((_hsyniData!=full_hsyni)||(_hsynzData!=full_hsynz)||(reuseCount!=reuseCount0)
+            ||(reuseCount>getSyncBlockCount(newData.size(),kSyncBlockSize))||(reuseCount<unchangedBlockCount/2)
+            ||(!_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                        prevData.data(),prevData.data()+prevData.size()))){
+            printf("\n hsynz create by prev error!!! threadNum:%d reused:%d unchanged:%d\n",
+                   (int)threadNums[t],(int)reuseCount,(int)unchangedBlockCount);
+            ++result;
+        }
+    }
+    {//prev created by other kSyncBlockSize, not reuse
+        uint32_t reuseCount=~(uint32_t)0;
+        _create_hsynz_by_prev(prevData,prev_hsyni,prev_hsynz,kSyncBlockSize*2,1);
+        _create_hsynz_by_prev(newData,_hsyniData,_hsynzData,kSyncBlockSize,1,&prev_hsyni,&prev_hsynz,&reuseCount);
+        if ((reuseCount!=0)||(_hsyniData!=full_hsyni)||(_hsynzData!=full_hsynz)){
+            printf("\n hsynz create by diffrent prev error!!!\n");
+            ++result;
+        }
+    }
+    return result;
+}
+
+//data blocks cut by a hsyni
+static bool _getSyncBlocks(const std::vector<TByte>& hsyniData,const std::vector<TByte>& data,
+                           std::vector<std::string>& out_blocks){
+    TSyncInfoListener syncInfoListener;
+    TNewDataSyncInfo newSyncInfo={0};
+    struct hpatch_TStreamInput hiStream;
+    mem_as_hStreamInput(&hiStream,hsyniData.data(),hsyniData.data()+hsyniData.size());
+    if (kSyncClient_ok!=TNewDataSyncInfo_open(&newSyncInfo,&hiStream,hpatch_FALSE,&syncInfoListener))
+        return false;
+    const size_t kBlockCount=newSyncInfo.cdcAvgBlockSize?newSyncInfo.cdcBlockCount:
+                    (size_t)((newSyncInfo.newDataSize+newSyncInfo.kSyncBlockSize-1)/newSyncInfo.kSyncBlockSize);
+    out_blocks.resize(kBlockCount);
+    size_t pos=0;
+    for (size_t i=0;i<kBlockCount;++i){
+        size_t blockSize=newSyncInfo.cdcAvgBlockSize?newSyncInfo.cdcBlockSizes[i]:newSyncInfo.kSyncBlockSize;
+        if (blockSize>data.size()-pos) blockSize=data.size()-pos;
+        out_blocks[i].assign((const char*)data.data()+pos,blockSize);
+        pos+=blockSize;
+    }
+    TNewDataSyncInfo_close(&newSyncInfo);
+    std::sort(out_blocks.begin(),out_blocks.end());
+    return (pos==data.size());
+}
+
+//content-defined blocks: new data inserted & deleted bytes at scattered positions;
+//  fixed blocks after an insert or delete are all shifted, cdc blocks only changed near it
+static long test_hsynz_sync_cdc(){
+    const size_t kDataSize=1024*1024*4;
+    const uint32_t kBlockSize=kSyncBlockSize_default;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(6);
+    setRandData(oldData);
+    for (size_t i=0;i<kDataSize;){ //insert or delete some bytes
+        const size_t len=(size_t)(_rand()%(1024*64))+1024;
+        newData.insert(newData.end(),oldData.begin()+i,oldData.begin()+std::min(i+len,kDataSize));
+        i+=len;
+        if (_rand()%2)
+            i+=(size_t)(_rand()%16)+1; //delete
+        else
+            for (size_t n=(size_t)(_rand()%16)+1;n>0;--n) newData.push_back((TByte)_rand()); //insert
+    }
+    newData.insert(newData.end(),newData.begin()+1024*64,newData.begin()+1024*96); //same blocks in new
+    struct hpatch_TStreamInput  newStream;
+    struct hpatch_TStreamInput  oldStream;
+    mem_as_hStreamInput(&newStream,newData.data(),newData.data()+newData.size());
+    mem_as_hStreamInput(&oldStream,oldData.data(),oldData.data()+oldData.size());
+
+    long result=0;
+    double unchangedRates[2]={0,0};
+    printf("hsynz sync_patch() cdc blocks, new:%ld old:%ld\n",(long)newData.size(),(long)oldData.size());
+    for (int isCdc=0;isCdc<=1;++isCdc){
+        std::vector<TByte> oldHsyniData;
+        TVectorAsStreamOutput oldHiStream(oldHsyniData);
+        _hsyniData.clear();
+        _new_hsyniData.clear();
+        _new_hsynzData.clear();
+        _hsynzData=newData; //not compressed, download from newData
+        TVectorAsStreamOutput hiStream(_hsyniData);
+        if (isCdc){
+            create_sync_data_cdc(&newStream,&hiStream,hsynzDefaultChecksum,kBlockSize);
+            create_sync_data_cdc(&oldStream,&oldHiStream,hsynzDefaultChecksum,kBlockSize);
+        }else{
+            create_sync_data(&newStream,&hiStream,hsynzDefaultChecksum,0,kBlockSize);
+            create_sync_data(&oldStream,&oldHiStream,hsynzDefaultChecksum,0,kBlockSize);
+        }
+        std::vector<std::string> oldBlocks,newBlocks;
+        bool isOk=_getSyncBlocks(oldHsyniData,oldData,oldBlocks)&&_getSyncBlocks(_hsyniData,newData,newBlocks);
+        size_t unchangedCount=0; //new blocks same as old's blocks, not changed by shift
+        for (size_t i=0;isOk&&(i<newBlocks.size());++i){
+            if (std::binary_search(oldBlocks.begin(),oldBlocks.end(),newBlocks[i]))
+                ++unchangedCount;
+        }
+        if (isOk) unchangedRates[isCdc]=unchangedCount*1.0/newBlocks.size();
+        hpatch_StreamPos_t needSyncSizes[2]={0,0};
+        for (int t=0;isOk&&(t<2);++t){ //match in old by 1 & 4 threads
+            TReadSyncDataRangesListener rangesListener(_hsynzData);
+            isOk=_check_hsynz_sync_patch(newData.data(),newData.data()+newData.size(),
+                                         oldData.data(),oldData.data()+oldData.size(),&rangesListener,t?4:1);
+            needSyncSizes[t]=rangesListener.needSyncSumSize;
+            if (isOk&&(t==0))
+                printf("  %s hsyni:%ld needSync blocks:%d size:%ld unchanged blocks:%.1f%%\n",isCdc?"cdc  ":"fixed",
+                       (long)_hsyniData.size(),(int)rangesListener.needSyncBlockCount,(long)rangesListener.needSyncSumSize,
+                       unchangedRates[isCdc]*100);
+        }
+        if (isOk&&isCdc) //cdc cut of threads meet the sequential cut points, matched all blocks of one thread
+            isOk=(needSyncSizes[1]<=needSyncSizes[0]);
+        if (isOk){
+            std::vector<TByte> diff;
+            _hsynz_local_diff(oldData.data(),oldData.data()+oldData.size(),diff,4);
+            isOk=_check_hsynz_local_patch(newData.data(),newData.data()+newData.size(),
+                                          oldData.data(),oldData.data()+oldData.size(),diff.data(),diff.data()+diff.size());
+        }
+        if (!isOk){
+            printf("\n hsynz sync cdc error!!! isCdc:%d\n",isCdc);
+            ++result;
+            continue;
+        }
+    }
+    _hsynzData.clear();
+    if ((unchangedRates[1]<0.75)||(unchangedRates[0]>0.2)){
+        printf("\n hsynz sync cdc error!!! unchanged blocks cdc:%.1f%% fixed:%.1f%%\n",
+               unchangedRates[1]*100,unchangedRates[0]*100);
+        ++result;
+    }
+    return result;
+}
+
+//mappable .hsyni: save a loaded newSyncInfo as mappable, open it in place (mem & mmap) and sync by it
+static bool _sync_patch_by_info(TNewDataSyncInfo* newSyncInfo,const std::vector<TByte>& hsynzData,
+                                const std::vector<TByte>& oldData,const std::vector<TByte>& newData){
+    std::vector<TByte> outData(newData.size());
+    struct hpatch_TStreamOutput out_newStream;
+    struct hpatch_TStreamInput  oldStream;
+    mem_as_hStreamOutput(&out_newStream,outData.data(),outData.data()+outData.size());
+    mem_as_hStreamInput(&oldStream,oldData.data(),oldData.data()+oldData.size());
+    TSyncInfoListener syncInfoListener;
+    TReadSyncDataListener readSyncDataListener(hsynzData);
+    TSyncClient_resultType ret=sync_patch(&syncInfoListener,&readSyncDataListener,&oldStream,newSyncInfo,
+                                          &out_newStream,0,0,0,1);
+    return (ret==kSyncClient_ok)&&(outData==newData);
+}
+static long test_hsynz_mappable(){
+    const size_t kDataSize=1024*1024*2;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData(kDataSize);
+    _srand(8);
+    setRandData(oldData);
+    setRandData(newData);
+    for (size_t i=0;i+1024*8<=kDataSize;i+=1024*16) //same blocks in old
+        memcpy(newData.data()+i,oldData.data()+(i+1024*3)%(kDataSize-1024*8),1024*8);
+    memcpy(newData.data()+kDataSize/2,newData.data(),1024*64); //same blocks in new
+    struct hpatch_TStreamInput  newStream;
+    mem_as_hStreamInput(&newStream,newData.data(),newData.data()+newData.size());
+    const char* kMappableFile="_unit_test_hsyni.map";
+
+    long result=0;
+    printf("hsynz mappable .hsyni new:%ld old:%ld\n",(long)newData.size(),(long)oldData.size());
+    for (int isCdc=0;isCdc<=1;++isCdc){
+        std::vector<TByte> hsyniData;
+        std::vector<TByte> hsynzData;
+        std::vector<TByte> mappableData;
+        TVectorAsStreamOutput hiStream(hsyniData);
+        TVectorAsStreamOutput hzStream(hsynzData);
+        if (isCdc){
+            create_sync_data_cdc(&newStream,&hiStream,hsynzDefaultChecksum,1024);
+            hsynzData=newData;
+        }else{
+            create_sync_data(&newStream,&hiStream,&hzStream,hsynzDefaultChecksum,_getDictCompressPlugin(),0,1024);
+        }
+        TSyncInfoListener syncInfoListener;
+        TNewDataSyncInfo newSyncInfo={0};
+        TNewDataSyncInfo mappedSyncInfo={0};
+        struct hpatch_TStreamInput hiInStream;
+        mem_as_hStreamInput(&hiInStream,hsyniData.data(),hsyniData.data()+hsyniData.size());
+        bool isOk=(kSyncClient_ok==TNewDataSyncInfo_open(&newSyncInfo,&hiInStream,hpatch_FALSE,&syncInfoListener));
+        if (isOk){
+            TVectorAsStreamOutput mapStream(mappableData);
+            isOk=(kSyncClient_ok==TNewDataSyncInfo_saveMappableTo(&newSyncInfo,&mapStream))
+                &&(kSyncClient_ok==TNewDataSyncInfo_saveMappable_by_file(&newSyncInfo,kMappableFile));
+        }
+        for (int openType=0;isOk&&(openType<4);++openType){
+            TSyncClient_resultType ret;
+            std::vector<TByte> unalignedData(mappableData.size()+1);
+            if (openType==0){ //in place
+                const size_t blockCount=isCdc?newSyncInfo.cdcBlockCount:
+                            (size_t)((newSyncInfo.newDataSize+newSyncInfo.kSyncBlockSize-1)/newSyncInfo.kSyncBlockSize);
+                ret=TNewDataSyncInfo_open_by_mappable(&mappedSyncInfo,mappableData.data(),mappableData.size(),
+                                                      hpatch_FALSE,hpatch_TRUE,&syncInfoListener);
+                isOk=(ret==kSyncClient_ok)&&(mappedSyncInfo.rollHashs>mappableData.data())
+                    &&(mappedSyncInfo.rollHashs<mappableData.data()+mappableData.size())
+                    &&(0==memcmp(mappedSyncInfo.rollHashs,newSyncInfo.rollHashs,
+                                 newSyncInfo.savedRollHashByteSize*blockCount))
+                    &&(0==memcmp(mappedSyncInfo.partChecksums,newSyncInfo.partChecksums,
+                                 newSyncInfo.savedStrongChecksumByteSize*blockCount))
+                    &&(mappedSyncInfo.samePairCount==newSyncInfo.samePairCount)&&(mappedSyncInfo.samePairCount>0);
+            }else if (openType==1){ //copy lists when unaligned
+                memcpy(unalignedData.data()+1,mappableData.data(),mappableData.size());
+                ret=TNewDataSyncInfo_open_by_mappable(&mappedSyncInfo,unalignedData.data()+1,mappableData.size(),
+                                                      hpatch_FALSE,hpatch_TRUE,&syncInfoListener);
+                isOk=(ret==kSyncClient_ok);
+            }else if (openType==2){ //load by stream
+                struct hpatch_TStreamInput mapInStream;
+                mem_as_hStreamInput(&mapInStream,mappableData.data(),mappableData.data()+mappableData.size());
+                ret=TNewDataSyncInfo_open(&mappedSyncInfo,&mapInStream,hpatch_FALSE,&syncInfoListener);
+                isOk=(ret==kSyncClient_ok);
+            }else{ //mmap
+                ret=TNewDataSyncInfo_open_by_mmap_file(&mappedSyncInfo,kMappableFile,hpatch_FALSE,hpatch_FALSE,&syncInfoListener);
+                isOk=(ret==kSyncClient_ok);
+            }
+            if (isOk)
+                isOk=_sync_patch_by_info(&mappedSyncInfo,hsynzData,oldData,newData);
+            TNewDataSyncInfo_close(&mappedSyncInfo);
+            if (!isOk) printf("\n hsynz mappable error!!! isCdc:%d openType:%d\n",isCdc,openType);
+        }
+        if (isOk){ //damaged data
+            mappableData[mappableData.size()/2]^=1;
+            isOk=(kSyncClient_newSyncInfoChecksumError==TNewDataSyncInfo_open_by_mappable(&mappedSyncInfo,
+                    mappableData.data(),mappableData.size(),hpatch_FALSE,hpatch_TRUE,&syncInfoListener));
+            TNewDataSyncInfo_close(&mappedSyncInfo);
+        }
+        TNewDataSyncInfo_close(&newSyncInfo);
+        remove(kMappableFile);
+        if (!isOk){
+            printf("\n hsynz mappable error!!! isCdc:%d\n",isCdc);
+            ++result;
+            continue;
+        }
+        printf("  %s hsyni:%ld mappable:%ld\n",isCdc?"cdc  ":"fixed",(long)hsyniData.size(),(long)mappableData.size());
+    }
+    return result;
+}
+
+//sync_local_diff() by multi-thread, new data have many same blocks; out diff same as single thread
+static long test_hsynz_mt_local_diff(){
+    const size_t kDataSize=1024*1024*4;
+    const size_t kCopyLen=1024*16;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData(kDataSize);
+    _srand(1);
+    setRandData(oldData);
+    setRandData(newData);
+    for (size_t i=0;i+kCopyLen<=kDataSize;i+=kCopyLen*2){
+        size_t oldPos=(size_t)(_rand()*(1.0/RAND_MAX)*(kDataSize-kCopyLen));
+        if (i%(kCopyLen*8)==0) oldPos=0; //same blocks
+        memcpy(newData.data()+i,oldData.data()+oldPos,kCopyLen);
+    }
+    _create_hsynz_data(newData.data(),newData.data()+newData.size());
+    
+    long result=0;
+    const int threadNums[]={1,3,16};
+    std::vector<TByte> diffData0;
+    std::vector<TByte> diffData;
+    for (size_t i=0;i<sizeof(threadNums)/sizeof(threadNums[0]);++i){
+        _hsynz_local_diff(oldData.data(),oldData.data()+oldData.size(),diffData,threadNums[i]);
+        if (i==0) diffData0=diffData;
+        if ((diffData!=diffData0)||(diffData.size()>=kDataSize*3/4)
+            ||(!_check_hsynz_local_patch(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                         oldData.data()+oldData.size(),diffData.data(),diffData.data()+diffData.size()))){
+            printf("\n hsynz mt error!!! threadNum:%d\n",threadNums[i]);
+            ++result;
+        }
+    }
+    return result;
+}
+
+#if (_IS_NEED_DIR_DIFF_PATCH)
+//res list in memory for hpatch_TResHandleLimit
+struct TMemResList{
+    std::vector<std::vector<TByte> >         resDatas;
+    std::vector<hpatch_TStreamInput>         streams;
+    std::vector<hpatch_IResHandle>           resList;
+    size_t  curOpenCount;
+    size_t  maxOpenCount;
+    TMemResList(size_t resCount,size_t smallSize,size_t bigSize)
+    :resDatas(resCount),streams(resCount),resList(resCount),curOpenCount(0),maxOpenCount(0){
+        for (size_t i=0;i<resCount;++i){
+            resDatas[i].resize(((i%2)==0)?(size_t)(_rand()%smallSize)+1:bigSize);
+            setRandData(resDatas[i]);
+            hpatch_IResHandle& res=resList[i];
+            res.resImport=this;
+            res.resStreamSize=resDatas[i].size();
+            res.open=_open;
+            res.close=_close;
+        }
+    }
+    static hpatch_BOOL _open(hpatch_IResHandle* res,hpatch_TStreamInput** out_stream){
+        TMemResList* self=(TMemResList*)res->resImport;
+        size_t i=res-self->resList.data();
+        const std::vector<TByte>& data=self->resDatas[i];
+        *out_stream=(hpatch_TStreamInput*)mem_as_hStreamInput(&self->streams[i],data.data(),data.data()+data.size());
+        ++self->curOpenCount;
+        if (self->curOpenCount>self->maxOpenCount) self->maxOpenCount=self->curOpenCount;
+        return hpatch_TRUE;
+    }
+    static hpatch_BOOL _close(hpatch_IResHandle* res,const hpatch_TStreamInput* stream){
+        TMemResList* self=(TMemResList*)res->resImport;
+        --self->curOpenCount;
+        return hpatch_TRUE;
+    }
+};
+
+//hpatch_TResHandleLimit: read res by round-robin, small res resident in memory after first open
+static long test_res_handle_limit(){
+    const size_t kResCount=40;
+    const size_t kLimitOpenCount=8;
+    const size_t kSmallSize=1024*10;
+    const size_t kBigSize=1024*100;
+    const size_t kLoopCount=3;
+    const size_t kReadSize=100;
+    _srand(6);
+    TMemResList mres(kResCount,kSmallSize,kBigSize);
+    hpatch_TResHandleLimit limit;
+    hpatch_TResHandleLimit_init(&limit);
+    long result=0;
+    if (!hpatch_TResHandleLimit_open(&limit,kLimitOpenCount,mres.resList.data(),kResCount)
+        ||!hpatch_TResHandleLimit_setMemCache(&limit,kSmallSize*kResCount,kSmallSize))
+        ++result;
+    TByte buf[kReadSize];
+    for (size_t loop=0;(result==0)&&(loop<kLoopCount);++loop){
+        for (size_t i=0;i<kResCount;++i){
+            const hpatch_TStreamInput* stream=limit.streamList[i];
+            const std::vector<TByte>& data=mres.resDatas[i];
+            size_t readSize=(data.size()<kReadSize)?data.size():kReadSize;
+            size_t pos=(size_t)(_rand()%(data.size()-readSize+1));
+            if ((!stream->read(stream,pos,buf,buf+readSize))
+                ||(0!=memcmp(buf,data.data()+pos,readSize))){
+                ++result;
+                break;
+            }
+        }
+    }
+    //small res: open once, then always hit memory; big res: reopen every loop after first
+    const hpatch_TResHandleLimitInfo& info=limit.info;
+    const size_t kSmallCount=kResCount/2;
+    const size_t kBigCount=kResCount-kSmallCount;
+    if ((result==0)&&((info.readCount!=kResCount*kLoopCount)
+                      ||(info.openCount!=kSmallCount+kBigCount*kLoopCount)
+                      ||(info.reopenCount!=kBigCount*(kLoopCount-1))
+                      ||(info.hitCount!=kSmallCount*(kLoopCount-1))
+                      ||(mres.maxOpenCount>kLimitOpenCount)))
+        ++result;
+    if (!hpatch_TResHandleLimit_close(&limit)||(mres.curOpenCount!=0))
+        ++result;
+    if (result)
+        printf("\n res handle limit error!!!\n");
+    return result;
+}
+
+    static bool _writeFile(const std::string& fileName,const TByte* data,const TByte* data_end){
+        FILE* f=fopen(fileName.c_str(),"wb");
+        if (f==0) return false;
+        bool result=(fwrite(data,1,data_end-data,f)==(size_t)(data_end-data));
+        return (0==fclose(f))&&result;
+    }
+    static bool _writeFile(const std::string& fileName,const std::vector<TByte>& data){
+        return _writeFile(fileName,data.data(),data.data()+data.size()); }
+    struct TNoPathIgnore:public IDirPathIgnore{
+        virtual bool isNeedIgnore(const std::string& path,size_t rootPathNameLen){ return false; }
+    };
+    //remove all paths in a sorted path list (sub paths before their dir)
+    static bool _removePathList(const std::vector<std::string>& pathList){
+        bool result=true;
+        for (size_t i=pathList.size();i>0;--i){
+            const std::string& path=pathList[i-1];
+            if (hpatch_getIsDirName(path.c_str()))
+                result&=(hpatch_removeDir(path.c_str())!=0);
+            else
+                result&=(hpatch_removeFile(path.c_str())!=0);
+        }
+        return result;
+    }
+
+    static bool _readFile(const std::string& fileName,std::vector<TByte>& out_data){
+        hpatch_TFileStreamInput f;
+        hpatch_TFileStreamInput_init(&f);
+        if (!hpatch_TFileStreamInput_open(&f,fileName.c_str())) return false;
+        out_data.resize((size_t)f.base.streamSize);
+        bool result=(out_data.empty())||f.base.read(&f.base,0,out_data.data(),out_data.data()+out_data.size());
+        return hpatch_TFileStreamInput_close(&f)&&result;
+    }
+
+//copy same file by reflink or copy_file_range or read & write: data & copy counters;
+//  when system copy fail (fd_out opened for append, like EXDEV EINVAL ...), fallback to copy by user
+static long test_file_copy_by_system(){
+    const std::string srcFile="_unit_test_copy_src.dat";
+    const std::string dstFile="_unit_test_copy_dst.dat";
+    const size_t kFileSize=(1<<20)*3+100;
+    long result=0;
+    _srand(36);
+    std::vector<TByte> data(kFileSize);
+    setRandData(data);
+    std::vector<TByte> dstData;
+    if (!_writeFile(srcFile,data)) ++result;
+
+    //copy file by best type
+    hpatch_TFileCopyCounts counts;
+    memset(&counts,0,sizeof(counts));
+    hpatch_FileError_t fileError=0;
+    for (int i=0;(result==0)&&(i<2);++i){
+        if (!TDirPatcher_copyFile(srcFile.c_str(),dstFile.c_str(),0,&fileError,&counts)
+            ||!_readFile(dstFile,dstData)||(dstData!=data))
+            ++result;
+    }
+    if ((result==0)&&(counts.clonedSize+counts.kernelCopiedSize+counts.userCopiedSize!=kFileSize*2))
+        ++result;
+#if (defined(__linux__))
+    if ((result==0)&&(counts.userCopiedSize!=0)&&(counts.userCopiedSize!=kFileSize*2))
+        ++result; //same file on same filesystem, copy type must not change
+#endif
+
+    //system copy fail, fallback
+#ifndef _WIN32
+    if (result==0){
+        hpatch_TFileStreamInput  src;
+        hpatch_TFileStreamOutput dst;
+        hpatch_TFileStreamInput_init(&src);
+        hpatch_TFileStreamOutput_init(&dst);
+        if (!hpatch_TFileStreamInput_open(&src,srcFile.c_str())
+            ||!hpatch_TFileStreamOutput_open(&dst,dstFile.c_str(),src.base.streamSize))
+            ++result;
+        int fd=(result==0)?fileno(dst.m_file):-1;
+        if ((fd==-1)||(0!=fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_APPEND)))
+            ++result;
+        if ((result==0)&&((hpatch_TFileStreamOutput_copyBySystem(&dst,&src)!=hpatch_kFileCopy_byUser)
+                          ||(dst.out_length!=0)))
+            ++result;
+        for (size_t pos=0;(result==0)&&(pos<kFileSize);){ //caller copy by user
+            size_t len=(kFileSize-pos<(1<<16))?(kFileSize-pos):(1<<16);
+            if (!dst.base.write(&dst.base,pos,data.data()+pos,data.data()+pos+len)) ++result;
+            pos+=len;
+        }
+        if (!hpatch_TFileStreamOutput_close(&dst)) ++result;
+        if (!hpatch_TFileStreamInput_close(&src)) ++result;
+        if ((result==0)&&(!_readFile(dstFile,dstData)||(dstData!=data)))
+            ++result;
+    }
+#endif
+    hpatch_removeFile(dstFile.c_str());
+    hpatch_removeFile(srcFile.c_str());
+    if (result)
+        printf("\n file copy by system error!!!\n");
+    else
+        printf("file copy by system: cloned:%ld kernel:%ld user:%ld\n",(long)counts.clonedSize,
+               (long)counts.kernelCopiedSize,(long)counts.userCopiedSize);
+    return result;
+}
+
+#ifndef _WIN32
+    static bool _setFileMTime(const std::string& fileName,time_t mtime){
+        struct utimbuf t;
+        t.actime=mtime;
+        t.modtime=mtime;
+        return 0==utime(fileName.c_str(),&t);
+    }
+#endif
+
+//CManifestCache: reuse cached checksum only if file's stat not changed & not racy; save & load round trip
+static long test_manifest_cache(){
+#ifdef _WIN32
+    return 0;
+#else
+    const std::string dir=std::string("_unit_test_manifest_cache")+kPatch_dirSeparator;
+    const std::string cacheFile=dir+"cache.txt";
+    const std::string file0=dir+"f0.dat";
+    const std::string file1=dir+"f1.dat";
+    const time_t oldTime=time(0)-100;
+    hpatch_TChecksum* checksumPlugin=&fadler32ChecksumPlugin;
+    const std::string checksumType=checksumPlugin->checksumType();
+    const size_t checksumByteSize=checksumPlugin->checksumByteSize();
+    _srand(32);
+    std::vector<TByte> data0(1024*33),data1(1024*7);
+    setRandData(data0); setRandData(data1);
+    long result=0;
+    if (!(hpatch_makeNewDir(dir.c_str())&&_writeFile(file0,data0)&&_writeFile(file1,data1)
+          &&_setFileMTime(file0,oldTime)))  //file1 modified now, racy with cache saved time
+        ++result;
+    std::vector<TByte> checksum0,checksum1,checksum;
+    std::vector<TByte> cached(checksumByteSize);
+    hpatch_TFileStatTag tag0,tag1;
+    if ((result==0)&&!(hpatch_getFileStatTag(file0.c_str(),&tag0)&&hpatch_getFileStatTag(file1.c_str(),&tag1)))
+        ++result;
+    try{
+        if (result==0){ //no cache file, empty
+            CManifestCache cache(cacheFile);
+            if (cache.find(checksumType,file0,tag0,cached.data(),checksumByteSize)) ++result;
+            getFileChecksum(checksum0,file0,checksumPlugin,&cache);
+            getFileChecksum(checksum1,file1,checksumPlugin,&cache);
+            if (cache.updatedCount()!=2) ++result;
+            if ((!cache.find(checksumType,file0,tag0,cached.data(),checksumByteSize))||(cached!=checksum0))
+                ++result; //just updated, not racy
+            cache.save();
+        }
+        if (result==0){ //load saved cache
+            CManifestCache cache(cacheFile);
+            if ((!cache.find(checksumType,file0,tag0,cached.data(),checksumByteSize))||(cached!=checksum0))
+                ++result;
+            if (cache.find(checksumType,file1,tag1,cached.data(),checksumByteSize))
+                ++result; //racy: file1 modified at the time when cache saved
+            if (cache.find("crc32",file0,tag0,cached.data(),checksumByteSize))
+                ++result; //other checksumType
+            getFileChecksum(checksum,file1,checksumPlugin,&cache); //re-read racy file1
+            if ((checksum!=checksum1)||(cache.updatedCount()!=1)) ++result;
+            //stale mtime: same size & data, but file changed after cached
+            if (!_setFileMTime(file0,oldTime+1)) ++result;
+            hpatch_TFileStatTag newTag0;
+            if ((!hpatch_getFileStatTag(file0.c_str(),&newTag0))
+                ||cache.find(checksumType,file0,newTag0,cached.data(),checksumByteSize))
+                ++result;
+            hpatch_TFileStatTag sizeTag0=tag0;
+            sizeTag0.fileSize+=1;
+            if (cache.find(checksumType,file0,sizeTag0,cached.data(),checksumByteSize)) ++result;
+            getFileChecksum(checksum,file0,checksumPlugin,&cache);
+            if ((checksum!=checksum0)||(cache.updatedCount()!=2)) ++result;
+            tag0=newTag0;
+        }
+        if (result==0){ //force verify
+            CManifestCache cache(cacheFile,true);
+            if (cache.find(checksumType,file0,tag0,cached.data(),checksumByteSize)) ++result;
+        }
+        if (result==0){ //damaged cache file as empty cache; save by temp file & rename
+            std::vector<TByte> cacheData;
+            if (!_readFile(cacheFile,cacheData)) ++result;
+            cacheData.resize(cacheData.size()/2);
+            if (!_writeFile(cacheFile,cacheData)) ++result;
+            CManifestCache cache(cacheFile);
+            if (cache.find(checksumType,file0,tag0,cached.data(),checksumByteSize)) ++result;
+            getFileChecksum(checksum,file0,checksumPlugin,&cache);
+            cache.save();
+            CManifestCache cache2(cacheFile);
+            if (!cache2.find(checksumType,file0,tag0,cached.data(),checksumByteSize)) ++result;
+            TNoPathIgnore pathIgnore;
+            std::vector<std::string> pathList;
+            getDirAllPathList(dir,pathList,&pathIgnore,1);
+            if (pathList.size()!=4) ++result; //dir cache.txt f0.dat f1.dat, no temp file left
+        }
+    }catch(const std::exception& e){
+        printf("%s\n",e.what());
+        ++result;
+    }
+    hpatch_removeFile(cacheFile.c_str());
+    hpatch_removeFile(file0.c_str());
+    hpatch_removeFile(file1.c_str());
+    if (!hpatch_removeDir(dir.c_str())) ++result;
+    if (result)
+        printf("\n manifest cache error!!!\n");
+    return result;
+#endif
+}
+
+//walk a nested dir tree by threads, same sorted path list as walk by 1 thread
+static long test_dir_list_mt(){
+    const std::string rootDir=std::string("_unit_test_dir_list")+kPatch_dirSeparator;
+    std::vector<std::string> dirs;
+    dirs.push_back(rootDir);
+    long result=0;
+    for (size_t i=0;(result==0)&&(i<dirs.size());++i){
+        const std::string dir=dirs[i];
+        if (!hpatch_makeNewDir(dir.c_str())) { ++result; break; }
+        const size_t deep=std::count(dir.begin(),dir.end(),kPatch_dirSeparator);
+        for (size_t f=0;f<(i%5)+1;++f){ //files, some names are prefix of dirs
+            const std::string fileName=dir+((f%2)?"f":"sub")+(char)('0'+f)+((f%2)?"":".dat");
+            const TByte data=(TByte)f;
+            if (!_writeFile(fileName,&data,&data+1)) { ++result; break; }
+        }
+        if (deep<4){
+            for (size_t d=0;d<3;++d)
+                dirs.push_back(dir+"sub"+(char)('0'+d)+kPatch_dirSeparator);
+        }
+    }
+    std::vector<std::string> list1;
+    std::vector<std::string> list4;
+    if (result==0){
+        TNoPathIgnore pathIgnore;
+        getDirAllPathList(rootDir,list1,&pathIgnore,1);
+        getDirAllPathList(rootDir,list4,&pathIgnore,4);
+        TManifest manifest;
+        get_manifest(&pathIgnore,rootDir,manifest,4);
+        if ((list1.size()<dirs.size())||(list1!=list4)||(manifest.pathList!=list1)
+            ||(!std::is_sorted(list1.begin(),list1.end())))
+            ++result;
+        printf("dir list by threads: %ld paths\n",(long)list4.size());
+    }
+    if (!_removePathList(list1.empty()?dirs:list1)) ++result;
+    if (result)
+        printf("\n dir list by threads error!!!\n");
+    return result;
+}
+
+    static std::string _randPathStr(const char* chars,size_t maxLen){
+        std::string result;
+        const size_t len=1+(size_t)_rand()%maxLen;
+        for (size_t i=0;i<len;++i)
+            result.push_back(chars[_rand()%strlen(chars)]);
+        return result;
+    }
+    static bool _isIgnoreMatchSame(CIgnorePathMatcher& matcher,const std::vector<std::string>& ignoreList,
+                                   const char* path){
+        std::string subPath(path);
+        formatIgnorePathName(subPath);
+        const bool isMatched=isMatchIgnoreList(subPath,ignoreList);
+        if (matcher.isMatch(subPath)==isMatched) return true;
+        printf("\n ignore path matcher error!!! path:\"%s\" matched:%d\n",path,(int)isMatched);
+        return false;
+    }
+
+//CIgnorePathMatcher must give same result as isMatchIgnoreList() for the same ignore list
+static long test_ignore_path_matcher(){
+    const char* kIgnores[]={"*.tmp#*/cache/*#build/#a?b#*.O#thumbs.db#*:x*","doc/*/old*#*.bak*#.git/#b*c.txt","*"};
+    const char* kPaths[]={"a.tmp","x/a.tmp","a.tmp/","a.tmpx","A.TMP","cache/","x/cache/","x/cache/y","xcache/y",
+                          "build/","build","x/build/","build/x.o","a?b","x/a?b/c","axb","a.O","a.o","x/thumbs.db",
+                          "thumbs.db.x","ax","x*y","doc/","doc/a/old","doc/a/b/old","doc/a/old/x","x.bak","x.bak.1",
+                          ".git/","x/.git/y","bc.txt","bxc.txt","b/c.txt","x/bxyc.txt"};
+    long result=0;
+    for (size_t i=0;i<sizeof(kIgnores)/sizeof(kIgnores[0]);++i){
+        std::vector<std::string> ignoreList;
+        if (!_getIgnorePathSetList(ignoreList,kIgnores[i])) { ++result; continue; }
+        CIgnorePathMatcher matcher;
+        matcher.addIgnoreList(ignoreList);
+        for (size_t p=0;p<sizeof(kPaths)/sizeof(kPaths[0]);++p){
+            if (!_isIgnoreMatchSame(matcher,ignoreList,kPaths[p])) ++result;
+        }
+    }
+    //random ignore lists & paths by few chars, paths in walk order & random order
+    _srand(39);
+    size_t checkCount=0;
+    for (size_t t=0;(t<300)&&(result==0);++t){
+        std::string ignores;
+        const size_t ignoreCount=1+(size_t)_rand()%4;
+        for (size_t i=0;i<ignoreCount;++i){
+            if (i>0) ignores.push_back('#');
+            ignores+=_randPathStr("ab.?/**",6);
+        }
+        std::vector<std::string> ignoreList;
+        if (!_getIgnorePathSetList(ignoreList,ignores.c_str())) continue; //like "**"
+        CIgnorePathMatcher matcher;
+        matcher.addIgnoreList(ignoreList);
+        std::vector<std::string> paths;
+        for (size_t p=0;p<100;++p){
+            std::string path=_randPathStr("ab.?A",4);
+            while ((_rand()%2)==0)
+                path+="/"+_randPathStr("ab.?A",4);
+            if ((_rand()%4)==0) path.push_back('/');
+            paths.push_back(path);
+        }
+        if ((t%2)==0) std::sort(paths.begin(),paths.end());
+        for (size_t p=0;p<paths.size();++p,++checkCount){
+            if (!_isIgnoreMatchSame(matcher,ignoreList,paths[p].c_str())) { ++result; break; }
+        }
+        if (result) printf(" ignore list:\"%s\"\n",ignores.c_str());
+    }
+    printf("ignore path matcher: checked %ld random paths\n",(long)checkCount);
+    return result;
+}
+
+//dir diff by file pair (-D-pair): changed, moved & new files, new file's datas from other old files;
+//  diff->patch round-trip, & covers of uncovered new datas matched by block with all old files;
+//  & hdiffData saved as segments, patch by 1 thread & by threads with min open file number
+static long test_dir_diff_by_pair(){
+    const std::string oldDir=std::string("_unit_test_dir_old")+kPatch_dirSeparator;
+    const std::string newDir=std::string("_unit_test_dir_new")+kPatch_dirSeparator;
+    const std::string subDir=std::string("sub")+kPatch_dirSeparator;
+    _srand(9);
+    std::vector<TByte> a(1024*256),b(1024*256),c(1024*64),d(1024*128),r(1024*16);
+    setRandData(a); setRandData(b); setRandData(c); setRandData(d); setRandData(r);
+    std::vector<TByte> newA(a),newB(b),e;
+    setScatteredEdits(newA,1024*8);
+    setScatteredEdits(newB,1024*8);
+    e.insert(e.end(),d.begin(),d.begin()+1024*32); //from old sub/d.dat, deleted in new
+    e.insert(e.end(),a.begin()+1024*100,a.begin()+1024*132);
+    e.insert(e.end(),r.begin(),r.end());
+    long result=0;
+    if (!(hpatch_makeNewDir(oldDir.c_str())&&hpatch_makeNewDir((oldDir+subDir).c_str())
+          &&hpatch_makeNewDir(newDir.c_str())&&hpatch_makeNewDir((newDir+subDir).c_str())
+          &&_writeFile(oldDir+"a.dat",a)&&_writeFile(oldDir+"b.dat",b)&&_writeFile(oldDir+"c.txt",c)
+          &&_writeFile(oldDir+subDir+"d.dat",d)
+          &&_writeFile(newDir+"a.dat",newA)&&_writeFile(newDir+subDir+"b.dat",newB) //b moved
+          &&_writeFile(newDir+"c.txt",c)&&_writeFile(newDir+"e.dat",e)))
+        ++result;
+    TManifest oldManifest,newManifest;
+    if (result==0){
+        TNoPathIgnore pathIgnore;
+        get_manifest(&pathIgnore,oldDir,oldManifest);
+        get_manifest(&pathIgnore,newDir,newManifest);
+    }
+    printf("dir diff by file pair:\n");
+    for (int isDiffInMem=0;(result==0)&&(isDiffInMem<=1);++isDiffInMem){
+        size_t diffSizes[4]={0,0,0,0}; //[no pair, pair by 1 thread, pair by 4 threads, pair as segments]
+        for (int m=0;m<4;++m){
+            THDiffSets sets; memset(&sets,0,sizeof(sets));
+            sets.isDiffInMem=isDiffInMem;
+            sets.isDiffByFilePair=(m>0);
+            sets.matchScore=kMinSingleMatchScore_default;
+            sets.patchStepMemSize=kDefaultPatchStepMemSize;
+            sets.matchBlockSize=kMatchBlockSize_default;
+            sets.threadNum=(m==2)?4:1;
+            sets.threadNumSearch_s=sets.threadNum;
+            sets.hdiffSegmentSize=(m==3)?1024*64:0;
+            std::vector<TByte> diffData;
+            TVectorAsStreamOutput diffStream(diffData);
+            IDirDiffListener listener;
+            bool isOk=true;
+            try{
+                dir_diff(&listener,oldManifest,newManifest,&diffStream,0,0,sets,kMaxOpenFileNumber_default_diff);
+                hpatch_TStreamInput diffIn;
+                mem_as_hStreamInput(&diffIn,diffData.data(),diffData.data()+diffData.size());
+                isOk=check_dirdiff(&listener,oldManifest,newManifest,&diffIn,0,0,
+                                   kMaxOpenFileNumber_default_diff,sets.threadNum);
+                if (isOk&&(m==3)) //every patch thread open old files by self, limit to 1 handle
+                    isOk=check_dirdiff(&listener,oldManifest,newManifest,&diffIn,0,0,
+                                       kMaxOpenFileNumber_limit_min,4);
+            }catch(const std::exception& ex){
+                printf("%s\n",ex.what());
+                isOk=false;
+            }
+            if (!isOk){
+                printf("\n dir diff by pair error!!! isDiffInMem:%d mode:%d\n",isDiffInMem,m);
+                ++result;
+                break;
+            }
+            diffSizes[m]=diffData.size();
+        }
+        if (result) break;
+        printf("  %s diffSize: no pair %ld, pair %ld, pair by threads %ld, pair as segments %ld\n",
+               isDiffInMem?"mem   ":"stream",(long)diffSizes[0],(long)diffSizes[1],(long)diffSizes[2],(long)diffSizes[3]);
+        //e.dat's datas from 2 old files: one by pair, other matched by block with all old (else +32KB);
+        //  same covers by threads
+        if ((diffSizes[1]!=diffSizes[2])||(diffSizes[1]>diffSizes[0]+1024)){
+            printf("\n dir diff by pair error!!! isDiffInMem:%d\n",isDiffInMem);
+            ++result;
+        }
+    }
+    hpatch_removeFile((oldDir+"a.dat").c_str());  hpatch_removeFile((newDir+"a.dat").c_str());
+    hpatch_removeFile((oldDir+"b.dat").c_str());  hpatch_removeFile((newDir+subDir+"b.dat").c_str());
+    hpatch_removeFile((oldDir+"c.txt").c_str());  hpatch_removeFile((newDir+"c.txt").c_str());
+    hpatch_removeFile((oldDir+subDir+"d.dat").c_str()); hpatch_removeFile((newDir+"e.dat").c_str());
+    hpatch_removeDir((oldDir+subDir).c_str());    hpatch_removeDir((newDir+subDir).c_str());
+    hpatch_removeDir(oldDir.c_str());             hpatch_removeDir(newDir.c_str());
+    return result;
+}
+
+    typedef std::vector<std::pair<std::string,std::vector<TByte> > > TDirDatas;
+    //all sub paths (relative to rootDir) & file datas in rootDir
+    static bool _readDirDatas(const std::string& rootDir,TDirDatas& out_datas){
+        std::vector<std::string> pathList;
+        TNoPathIgnore pathIgnore;
+        getDirAllPathList(rootDir,pathList,&pathIgnore,1);
+        out_datas.resize(pathList.size());
+        for (size_t i=0;i<pathList.size();++i){
+            const std::string& path=pathList[i];
+            out_datas[i].first=path.substr(rootDir.size());
+            out_datas[i].second.clear();
+            if ((!hpatch_getIsDirName(path.c_str()))&&(!_readFile(path,out_datas[i].second)))
+                return false;
+        }
+        return true;
+    }
+    static hpatch_StreamPos_t _getFileID(const std::string& fileName){
+#ifdef _WIN32
+        return 0;
+#else
+        struct stat st;
+        if (0!=stat(fileName.c_str(),&st)) return ~(hpatch_StreamPos_t)0;
+        return (hpatch_StreamPos_t)st.st_ino;
+#endif
+    }
+    //same as hpatchz's dir patch when oldPath==outNewPath: patch to tempDir by tempDirPatchListener,
+    //  then update oldDir in place; return 0 if ok, else the failed step
+    static int _dirPatchInPlace(const std::string& oldDir,const std::string& tempDir,const std::vector<TByte>& diffData){
+        int     result=0;
+        TDirPatcher dirPatcher;
+        const TDirDiffInfo* dirDiffInfo=0;
+        const hpatch_TStreamInput*  oldStream=0;
+        const hpatch_TStreamOutput* newStream=0;
+        IHPatchDirListener* hlistener=&tempDirPatchListener;
+        std::vector<TByte> temp_cache(hpatch_kStreamCacheSize*8);
+        hpatch_TStreamInput diffIn;
+        mem_as_hStreamInput(&diffIn,diffData.data(),diffData.data()+diffData.size());
+        TDirPatcher_init(&dirPatcher);
+        hlistener->fileError=0;
+        memset(&hlistener->copyCounts,0,sizeof(hlistener->copyCounts));
+        if (!(TDirPatcher_open(&dirPatcher,&diffIn,&dirDiffInfo)&&dirDiffInfo->isDirDiff
+              &&TDirPatcher_loadDirData(&dirPatcher,0,oldDir.c_str(),tempDir.c_str())))
+            result=1;
+        bool isBegin=(result==0)&&hlistener->patchBegin(hlistener,&dirPatcher);
+        if ((result==0)&&!(isBegin
+              &&TDirPatcher_openOldRefAsStream(&dirPatcher,kMaxOpenFileNumber_default_patch,&oldStream)
+              &&TDirPatcher_openNewDirAsStream(&dirPatcher,&hlistener->base,&newStream)))
+            result=2;
+        if ((result==0)&&!TDirPatcher_patch(&dirPatcher,newStream,oldStream,temp_cache.data(),
+                                            temp_cache.data()+temp_cache.size(),1))
+            result=3;
+        if (isBegin&&(!hlistener->patchFinish(hlistener,result==0))&&(result==0))
+            result=4;
+        if ((!TDirPatcher_closeNewDirStream(&dirPatcher))&&(result==0)) result=5;
+        if ((!TDirPatcher_closeOldRefStream(&dirPatcher))&&(result==0)) result=5;
+        TDirPatcher_close(&dirPatcher);
+        return result;
+    }
+
+//dir patch when oldPath==outNewPath: only changed paths in oldDir updated, same file at same path not touched;
+//  a patch failed midway keep oldDir unchanged & remove tempDir
+static long test_dir_patch_in_place(){
+    const std::string oldDir=std::string("_unit_test_inplace_old")+kPatch_dirSeparator;
+    const std::string newDir=std::string("_unit_test_inplace_new")+kPatch_dirSeparator;
+    const std::string tempDir=std::string("_unit_test_inplace_temp")+kPatch_dirSeparator;
+    const std::string subDir=std::string("sub")+kPatch_dirSeparator;
+    const std::string delDir=std::string("del")+kPatch_dirSeparator;
+    _srand(37);
+    std::vector<TByte> keep(1024*64),x(1024*32),y(1024*48),p(1024*16),q(1024*24),mod(1024*128),del(1024*8),r(1024*40);
+    setRandData(keep); setRandData(x); setRandData(y); setRandData(p);
+    setRandData(q); setRandData(mod); setRandData(del); setRandData(r);
+    std::vector<TByte> newMod(mod);
+    setScatteredEdits(newMod,1024*4);
+    long result=0;
+    //x.dat renamed to y.dat, old y.dat overwritten & renamed to z.dat; p.dat q.dat swapped;
+    //  keep.dat not changed & also copyed to sub/keep.dat; del.dat del/ del/del.dat deleted
+    if (!(hpatch_makeNewDir(oldDir.c_str())&&hpatch_makeNewDir((oldDir+delDir).c_str())
+          &&hpatch_makeNewDir(newDir.c_str())&&hpatch_makeNewDir((newDir+subDir).c_str())
+          &&_writeFile(oldDir+"keep.dat",keep)&&_writeFile(oldDir+"x.dat",x)&&_writeFile(oldDir+"y.dat",y)
+          &&_writeFile(oldDir+"p.dat",p)&&_writeFile(oldDir+"q.dat",q)&&_writeFile(oldDir+"mod.dat",mod)
+          &&_writeFile(oldDir+"del.dat",del)&&_writeFile(oldDir+delDir+"del.dat",del)
+          &&_writeFile(newDir+"keep.dat",keep)&&_writeFile(newDir+subDir+"keep.dat",keep)
+          &&_writeFile(newDir+"y.dat",x)&&_writeFile(newDir+"z.dat",y)
+          &&_writeFile(newDir+"p.dat",q)&&_writeFile(newDir+"q.dat",p)
+          &&_writeFile(newDir+"mod.dat",newMod)&&_writeFile(newDir+subDir+"r.dat",r)))
+        ++result;
+    std::vector<TByte> diffData;
+    if (result==0){
+        TManifest oldManifest,newManifest;
+        TNoPathIgnore pathIgnore;
+        get_manifest(&pathIgnore,oldDir,oldManifest);
+        get_manifest(&pathIgnore,newDir,newManifest);
+        THDiffSets sets; memset(&sets,0,sizeof(sets));
+        sets.isDiffInMem=true;
+        sets.matchScore=kMinSingleMatchScore_default;
+        sets.patchStepMemSize=kDefaultPatchStepMemSize;
+        sets.threadNum=1;
+        sets.threadNumSearch_s=1;
+        TVectorAsStreamOutput diffStream(diffData);
+        IDirDiffListener listener;
+        try{
+            dir_diff(&listener,oldManifest,newManifest,&diffStream,0,0,sets,kMaxOpenFileNumber_default_diff);
+        }catch(const std::exception& ex){
+            printf("%s\n",ex.what());
+            ++result;
+        }
+    }
+    TDirDatas oldDatas,newDatas,outDatas;
+    if ((result==0)&&!(_readDirDatas(oldDir,oldDatas)&&_readDirDatas(newDir,newDatas)))
+        ++result;
+
+    //patch failed midway (diffData lost tail): oldDir unchanged, tempDir removed
+    if (result==0){
+        std::vector<TByte> badDiff(diffData.begin(),diffData.end()-r.size()/2);
+        int rt=_dirPatchInPlace(oldDir,tempDir,badDiff);
+        if ((rt!=3)||(!_readDirDatas(oldDir,outDatas))||(outDatas!=oldDatas)
+            ||(!hpatch_isPathNotExist(tempDir.c_str()))){
+            printf("\n dir patch in place failed midway error!!! step:%d\n",rt);
+            ++result;
+        }
+    }
+    //patch ok: oldDir same as newDir, keep.dat not touched
+    if (result==0){
+        hpatch_StreamPos_t keepID=_getFileID(oldDir+"keep.dat");
+        int rt=_dirPatchInPlace(oldDir,tempDir,diffData);
+        if ((rt!=0)||(!_readDirDatas(oldDir,outDatas))||(outDatas!=newDatas)
+            ||(!hpatch_isPathNotExist(tempDir.c_str()))||(keepID!=_getFileID(oldDir+"keep.dat"))
+            ||(tempDirPatchListener.copyCounts.clonedSize+tempDirPatchListener.copyCounts.kernelCopiedSize
+               +tempDirPatchListener.copyCounts.userCopiedSize!=keep.size())){ //only sub/keep.dat copyed
+            printf("\n dir patch in place error!!! step:%d\n",rt);
+            ++result;
+        }else{
+            printf("dir patch in place: %ld paths updated to %ld paths\n",(long)oldDatas.size(),(long)newDatas.size());
+        }
+    }
+    const std::string roots[3]={oldDir,newDir,tempDir};
+    for (int d=0;d<3;++d){
+        if (hpatch_isPathNotExist(roots[d].c_str())) continue;
+        TNoPathIgnore pathIgnore;
+        std::vector<std::string> pathList;
+        getDirAllPathList(roots[d],pathList,&pathIgnore,1);
+        if (!_removePathList(pathList)) ++result;
+    }
+    return result;
+}
+#endif
+
+//hdiff_ICoverCostModel by TCompressDetect, same as the default cost model
+struct TOrder1CostModel:public hdiff_ICoverCostModel{
+#if (_IS_USED_MULTITHREAD)
+    CHLocker locker;
+#endif
+    size_t   openCount;
+    size_t   closeCount;
+    TOrder1CostModel():openCount(0),closeCount(0){
+        open=_open; close=_close; add_chars=_add_chars; cost=_cost; }
+    static void* _open(const hdiff_ICoverCostModel* costModel){
+        TOrder1CostModel* self=(TOrder1CostModel*)costModel;
+#if (_IS_USED_MULTITHREAD)
+        CAutoLocker _auto_locker(self->locker.locker);
+#endif
+        ++self->openCount;
+        return new TCompressDetect();
+    }
+    static void _close(const hdiff_ICoverCostModel* costModel,void* model){
+        TOrder1CostModel* self=(TOrder1CostModel*)costModel;
+#if (_IS_USED_MULTITHREAD)
+        CAutoLocker _auto_locker(self->locker.locker);
+#endif
+        ++self->closeCount;
+        delete (TCompressDetect*)model;
+    }
+    static void _add_chars(void* model,const unsigned char* d,size_t n,const unsigned char* sub){
+        ((TCompressDetect*)model)->add_chars(d,n,sub); }
+    static size_t _cost(const void* model,const unsigned char* d,size_t n,const unsigned char* sub){
+        return ((const TCompressDetect*)model)->cost(d,n,sub); }
+};
+
+struct TCoverCostListener:public ICoverLinesListener{
+    const hdiff_ICoverCostModel* costModel;
+    explicit TCoverCostListener(const hdiff_ICoverCostModel* _costModel):costModel(_costModel){
+        ICoverLinesListener* listener=this;
+        memset(listener,0,sizeof(*listener));
+        get_cover_cost_model=_get_cover_cost_model;
+    }
+    static const hdiff_ICoverCostModel* _get_cover_cost_model(const ICoverLinesListener* listener){
+        return ((const TCoverCostListener*)listener)->costModel; }
+};
+
+//select covers by a cost model set by ICoverLinesListener; a model is opened for every select region
+static long test_cover_cost_model(){
+    const size_t kDataSize=1024*1024*3;
+    std::vector<TByte> oldData(kDataSize);
+    std::vector<TByte> newData;
+    _srand(8);
+    for (size_t i=0;i<kDataSize;++i)
+        oldData[i]=(TByte)('a'+_rand()%8); //compressible
+    newData=oldData;
+    setScatteredEdits(newData,1024*4);
+
+    long result=0;
+    const size_t threadNums[]={1,4};
+    for (size_t t=0;t<sizeof(threadNums)/sizeof(threadNums[0]);++t){
+        std::vector<TByte> diffData0;
+        std::vector<TByte> diffData;
+        create_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                      oldData.data()+oldData.size(),diffData0,compressPlugin,
+                                      kMinSingleMatchScore_default,kDefaultPatchStepMemSize,false,0,threadNums[t]);
+        TOrder1CostModel   costModel;
+        TCoverCostListener listener(&costModel);
+        create_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                      oldData.data()+oldData.size(),diffData,compressPlugin,
+                                      kMinSingleMatchScore_default,kDefaultPatchStepMemSize,false,&listener,threadNums[t]);
+        if ((diffData!=diffData0)||(costModel.openCount<2)||(costModel.openCount!=costModel.closeCount)
+            ||(!check_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),
+                    oldData.data()+oldData.size(),diffData.data(),diffData.data()+diffData.size(),decompressPlugin))){
+            printf("\n cover cost model error!!! threadNum:%d\n",(int)threadNums[t]);
+            ++result;
+        }
+        TCoverCostListener order0Listener(getOrder0CoverCostModel());
+        diffData.clear();
+        create_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),
+                                      oldData.data()+oldData.size(),diffData,compressPlugin,
+                                      kMinSingleMatchScore_default,kDefaultPatchStepMemSize,false,&order0Listener,threadNums[t]);
+        if (!check_single_compressed_diff(newData.data(),newData.data()+newData.size(),oldData.data(),
+                    oldData.data()+oldData.size(),diffData.data(),diffData.data()+diffData.size(),decompressPlugin)){
+            printf("\n cover cost model order-0 error!!! threadNum:%d\n",(int)threadNums[t]);
+            ++result;
+        }
+    }
+    return result;
+}
+
+#ifndef _IS_NEED_MAIN
+#   define  _IS_NEED_MAIN 1
+#endif
+#if (_IS_NEED_MAIN)
 int main(int argc, const char * argv[]){
 #if (_IS_OUT_DIFF_INFO)
     _hdiff_is_out_diff_info=0;
@@ -828,6 +2285,24 @@ int main(int argc, const char * argv[]){
         }
     }
 
+    errorCount+=test_hsynz_mt_local_diff();
+    errorCount+=test_hsynz_sync_ranges();
+    errorCount+=test_hsynz_sync_ranges_mt();
+    errorCount+=test_hsynz_sync_seeds();
+    errorCount+=test_hsynz_create_by_prev();
+    errorCount+=test_hsynz_sync_cdc();
+    errorCount+=test_hsynz_mappable();
+#if (_IS_NEED_DIR_DIFF_PATCH)
+    errorCount+=test_res_handle_limit();
+    errorCount+=test_dir_diff_by_pair();
+    errorCount+=test_dir_patch_in_place();
+    errorCount+=test_dir_list_mt();
+    errorCount+=test_ignore_path_matcher();
+    errorCount+=test_file_copy_by_system();
+    errorCount+=test_manifest_cache();
+#endif
+    errorCount+=test_cover_cost_model();
+
     const int kMaxDataSize=1024*32;
     
     std::vector<int> seeds(kRandTestCount);
@@ -887,3 +2362,4 @@ int main(int argc, const char * argv[]){
 
     return (int)errorCount;
 }
+#endif //_IS_NEED_MAIN